@@ -60,6 +60,10 @@ typedef enum {
 	SYS_WAITQ_SLEEP,
 	SYS_WAITQ_WAKEUP,
 	SYS_WAITQ_DESTROY,
+	SYS_FUTEX_SLEEP,
+	SYS_FUTEX_WAKEUP,
+	SYS_FUTEX_REQUEUE,
+	SYS_FUTEX_DESTROY,
 	SYS_SMC_COHERENCE,
 
 	SYS_AS_AREA_CREATE,
@@ -107,7 +111,9 @@ typedef enum {
 
 	SYS_DEBUG_CONSOLE,
 
-	SYS_KLOG
+	SYS_KLOG,
+
+	SYS_TRACEBUF_CONTROL
 } syscall_t;
 
 #endif
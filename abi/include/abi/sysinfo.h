@@ -65,11 +65,15 @@ typedef enum {
  *
  */
 typedef struct {
-	unsigned int id;         /**< CPU ID as stored by kernel */
-	bool active;             /**< CPU is activate */
-	uint16_t frequency_mhz;  /**< Frequency in MHz */
-	uint64_t idle_cycles;    /**< Number of idle cycles */
-	uint64_t busy_cycles;    /**< Number of busy cycles */
+	unsigned int id;             /**< CPU ID as stored by kernel */
+	bool active;                 /**< CPU is activate */
+	uint16_t frequency_mhz;      /**< Frequency in MHz */
+	uint64_t idle_cycles;        /**< Number of idle cycles */
+	uint64_t busy_cycles;        /**< Number of busy cycles */
+	uint64_t mutex_waits;        /**< Number of contended mutex acquisitions */
+	uint64_t mutex_spins;        /**< Contended acquisitions without sleeping */
+	uint64_t mutex_wait_cycles;  /**< Cycles spent waiting for mutexes */
+	uint64_t mutex_hold_cycles;  /**< Cycles contended mutexes were held */
 } stats_cpu_t;
 
 /** Physical memory statistics
@@ -110,6 +114,35 @@ typedef struct {
 	stats_ipc_t ipc_info;         /**< IPC statistics */
 } stats_task_t;
 
+/** Magic value identifying the shared task statistics page */
+#define STATS_PAGE_MAGIC  0x53544154
+
+/** Entry of the shared task statistics page
+ *
+ * The kernel keeps @c seq odd for the course of an update of the entry.
+ * Readers copy the entry and retry if @c seq was odd or has changed
+ * meanwhile. Entries with zero task ID are unused.
+ *
+ */
+typedef struct {
+	volatile uint32_t seq;  /**< Update sequence number */
+	stats_task_t task;      /**< Task statistics */
+} stats_page_entry_t;
+
+/** Shared task statistics page
+ *
+ * Maintained by the kernel as tasks run and mapped read-only by user
+ * space, see the stats.faddr and stats.pages sysinfo items.
+ *
+ */
+typedef struct {
+	uint32_t magic;              /**< STATS_PAGE_MAGIC */
+	uint32_t entries;            /**< Number of entries */
+	volatile uint32_t used;      /**< Entries past this one are unused */
+	volatile uint32_t overflow;  /**< Number of tasks without an entry */
+	stats_page_entry_t tasks[];  /**< Task entries */
+} stats_page_t;
+
 /** Statistics about a single thread
  *
  */
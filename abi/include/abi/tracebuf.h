@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup abi_generic
+ * @{
+ */
+/** @file
+ * Kernel trace buffer shared with userspace.
+ */
+
+#ifndef _ABI_TRACEBUF_H_
+#define _ABI_TRACEBUF_H_
+
+#include <stdint.h>
+
+/** Magic number identifying the trace buffer area ("TRAC"). */
+#define TRACEBUF_MAGIC  0x54524143
+
+/** Trace events */
+typedef enum {
+	/** Timer-driven program counter sample (pc, from userspace) */
+	TRACEBUF_SAMPLE,
+	/** Thread switch (previous thread ID, priority of the new thread) */
+	TRACEBUF_SWITCH,
+	/** IPC request sent (method, callee task ID) */
+	TRACEBUF_IPC_SEND,
+	/** IPC request answered (return value, caller task ID) */
+	TRACEBUF_IPC_ANSWER,
+	/** Page fault (address, access) */
+	TRACEBUF_PAGE_FAULT,
+	/** Syscall (syscall number, 0) */
+	TRACEBUF_SYSCALL,
+	/** Exception or interrupt (number, from userspace) */
+	TRACEBUF_IRQ,
+	TRACEBUF_EVENTS
+} tracebuf_event_t;
+
+/** Bit of the event mask enabling an event */
+#define TRACEBUF_MASK(event)  (1U << (event))
+/** Mask enabling all events */
+#define TRACEBUF_MASK_ALL     (TRACEBUF_MASK(TRACEBUF_EVENTS) - 1)
+
+/** Trace record */
+typedef struct {
+	/** Cycle counter of the processor when the event occurred */
+	uint64_t cycle;
+	/** ID of the running thread or zero if there was none */
+	uint64_t tid;
+	/** First event argument */
+	uint64_t arg1;
+	/** Second event argument */
+	uint32_t arg2;
+	/** Event (tracebuf_event_t) */
+	uint32_t event;
+} tracebuf_record_t;
+
+/** Trace ring of a single processor
+ *
+ * Records are written by the processor only, without any locking. The
+ * record with sequence number n is stored at index n modulo the number
+ * of records in the ring. A reader must copy a record and then check that
+ * the head has not advanced by the size of the ring or more, otherwise the
+ * record might have been overwritten while being copied.
+ */
+typedef struct {
+	/** Number of records ever written to the ring */
+	volatile uint64_t head;
+	uint64_t reserved[7];
+} tracebuf_ring_t;
+
+/** Header of the trace buffer area */
+typedef struct {
+	/** TRACEBUF_MAGIC */
+	uint32_t magic;
+	/** Number of rings (one per processor) */
+	uint32_t cpus;
+	/** Number of records in each ring (power of two) */
+	uint64_t records;
+	/** Offset of the records of the first ring from the area start */
+	uint64_t offset;
+	/** Enabled events (TRACEBUF_MASK bits) */
+	volatile uint32_t mask;
+	/** Clock ticks between program counter samples */
+	volatile uint32_t sample_ticks;
+	uint64_t reserved[4];
+	/** Ring heads */
+	tracebuf_ring_t rings[];
+} tracebuf_header_t;
+
+#endif
+
+/** @}
+ */
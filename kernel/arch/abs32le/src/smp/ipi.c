@@ -40,6 +40,10 @@ void ipi_broadcast_arch(int ipi)
 {
 }
 
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
@@ -69,6 +69,12 @@ _NO_TRACE static inline void cpu_sleep(void)
 	);
 }
 
+/** Hint the processor that the caller is spinning in a busy-wait loop */
+_NO_TRACE static inline void cpu_spin_hint(void)
+{
+	asm volatile ("pause");
+}
+
 _NO_TRACE static inline void __attribute__((noreturn)) cpu_halt(void)
 {
 	while (true) {
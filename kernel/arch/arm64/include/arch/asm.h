@@ -53,6 +53,12 @@ _NO_TRACE static inline void cpu_sleep(void)
 	asm volatile ("wfe");
 }
 
+/** Hint the processor that the caller is spinning in a busy-wait loop */
+_NO_TRACE static inline void cpu_spin_hint(void)
+{
+	asm volatile ("yield");
+}
+
 /** Return base address of current stack.
  *
  * Return the base address of the current stack.
@@ -46,6 +46,16 @@ void ipi_broadcast_arch(int ipi)
 	panic("broadcast IPI not implemented.");
 }
 
+/** Deliver IPI to selected processors except the current one.
+ *
+ * @param mask Processors to deliver the IPI to.
+ * @param ipi  IPI number.
+ */
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+	panic("multicast IPI not implemented.");
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
@@ -63,6 +63,12 @@ _NO_TRACE static inline void cpu_sleep(void)
 	);
 }
 
+/** Hint the processor that the caller is spinning in a busy-wait loop */
+_NO_TRACE static inline void cpu_spin_hint(void)
+{
+	asm volatile ("pause");
+}
+
 #define GEN_READ_REG(reg) _NO_TRACE static inline sysarg_t read_ ##reg (void) \
 	{ \
 		sysarg_t res; \
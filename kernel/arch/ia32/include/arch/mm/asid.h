@@ -51,6 +51,12 @@ typedef int32_t asid_t;
 #define asid_get()  (ASID_START + 1)
 #define asid_put(asid)
 
+/*
+ * Reloading CR3 on address space switch flushes all non-global
+ * TLB entries, i.e. all entries of the user address space.
+ */
+#define AS_SWITCH_FLUSHES_TLB
+
 #endif
 
 /** @}
@@ -36,12 +36,37 @@
 
 #include <smp/ipi.h>
 #include <arch/smp/apic.h>
+#include <config.h>
+#include <cpu.h>
 
 void ipi_broadcast_arch(int ipi)
 {
 	(void) l_apic_broadcast_custom_ipi((uint8_t) ipi);
 }
 
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+	size_t count = 0;
+
+	cpu_mask_for_each(*mask, cpu_id) {
+		if (cpu_id != CPU->id)
+			count++;
+	}
+
+	/* Use the broadcast shorthand when all other CPUs are to be hit. */
+	if (count + 1 >= config.cpu_active) {
+		(void) l_apic_broadcast_custom_ipi((uint8_t) ipi);
+		return;
+	}
+
+	cpu_mask_for_each(*mask, cpu_id) {
+		if (cpu_id != CPU->id) {
+			(void) l_apic_send_custom_ipi(cpus[cpu_id].arch.id,
+			    (uint8_t) ipi);
+		}
+	}
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
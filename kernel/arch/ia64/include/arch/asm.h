@@ -479,6 +479,12 @@ _NO_TRACE static inline void pk_disable(void)
 	);
 }
 
+/** Hint the processor that the caller is spinning in a busy-wait loop */
+_NO_TRACE static inline void cpu_spin_hint(void)
+{
+	asm volatile ("hint @pause\n");
+}
+
 extern void cpu_halt(void) __attribute__((noreturn));
 extern void cpu_sleep(void);
 extern void asm_delay_loop(uint32_t t);
@@ -39,6 +39,7 @@
 #include <interrupt.h>
 #include <arch/asm.h>
 #include <typedefs.h>
+#include <cpu.h>
 
 static irq_t dorder_irq;
 
@@ -49,6 +50,18 @@ void ipi_broadcast_arch(int ipi)
 	pio_write_32(((ioport32_t *) MSIM_DORDER_ADDRESS), 0x7fffffff);
 }
 
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+	uint32_t targets = 0;
+
+	cpu_mask_for_each(*mask, cpu_id) {
+		if ((cpu_id != CPU->id) && (cpu_id < 31))
+			targets |= 1 << cpu_id;
+	}
+
+	pio_write_32(((ioport32_t *) MSIM_DORDER_ADDRESS), targets);
+}
+
 #endif
 
 static irq_ownership_t dorder_claim(irq_t *irq)
@@ -542,6 +542,11 @@ _NO_TRACE static inline void nucleus_leave(void)
 	asm volatile ("wrpr %g0, %g0, %tl\n");
 }
 
+/** Hint the processor that the caller is spinning in a busy-wait loop */
+_NO_TRACE static inline void cpu_spin_hint(void)
+{
+}
+
 extern void cpu_halt(void) __attribute__((noreturn));
 extern void cpu_sleep(void);
 extern void asm_delay_loop(const uint32_t usec);
@@ -172,5 +172,33 @@ void ipi_broadcast_arch(int ipi)
 	}
 }
 
+/** Deliver IPI to selected processors except the current one.
+ *
+ * We assume that interrupts are disabled.
+ *
+ * @param mask Processors to deliver the IPI to.
+ * @param ipi  IPI number.
+ */
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+	void (*func)(void);
+
+	switch (ipi) {
+	case IPI_TLB_SHOOTDOWN:
+		func = tlb_shootdown_ipi_recv;
+		break;
+	default:
+		panic("Unknown IPI (%d).\n", ipi);
+		break;
+	}
+
+	cpu_mask_for_each(*mask, cpu_id) {
+		if (&cpus[cpu_id] == CPU)
+			continue;
+
+		cross_call(cpus[cpu_id].arch.mid, func);
+	}
+}
+
 /** @}
  */
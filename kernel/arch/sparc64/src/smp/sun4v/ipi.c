@@ -121,5 +121,39 @@ void ipi_broadcast_arch(int ipi)
 	ipi_brodcast_to(func, ipi_cpu_list[CPU->arch.id], idx);
 }
 
+/*
+ * Deliver IPI to selected processors except the current one.
+ *
+ * We assume that interrupts are disabled.
+ *
+ * @param mask Processors to deliver the IPI to.
+ * @param ipi  IPI number.
+ */
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+	void (*func)(void);
+
+	switch (ipi) {
+	case IPI_TLB_SHOOTDOWN:
+		func = tlb_shootdown_ipi_recv;
+		break;
+	default:
+		panic("Unknown IPI (%d).\n", ipi);
+		break;
+	}
+
+	unsigned idx = 0;
+	cpu_mask_for_each(*mask, cpu_id) {
+		if (&cpus[cpu_id] == CPU)
+			continue;
+
+		ipi_cpu_list[CPU->id][idx] = (uint16_t) cpus[cpu_id].id;
+		idx++;
+	}
+
+	if (idx > 0)
+		ipi_brodcast_to(func, ipi_cpu_list[CPU->arch.id], idx);
+}
+
 /** @}
  */
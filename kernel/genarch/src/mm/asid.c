@@ -61,6 +61,7 @@
 #include <mm/as.h>
 #include <mm/tlb.h>
 #include <arch/mm/asid.h>
+#include <cpu/cpu_mask.h>
 #include <synch/spinlock.h>
 #include <synch/mutex.h>
 #include <adt/list.h>
@@ -128,6 +129,13 @@ asid_t asid_get(void)
 		ipl_t ipl = tlb_shootdown_start(TLB_INVL_ASID, asid, 0, 0);
 		tlb_invalidate_asid(asid);
 		tlb_shootdown_finalize(ipl);
+
+		/*
+		 * No processor holds TLB entries of the address space
+		 * anymore.
+		 */
+		if (as->cpu_mask)
+			cpu_mask_none(as->cpu_mask);
 	} else {
 
 		/*
@@ -40,6 +40,7 @@
 #include <mm/page.h>
 #include <mm/frame.h>
 #include <mm/km.h>
+#include <mm/tlb.h>
 #include <mm/as.h>
 #include <arch/mm/page.h>
 #include <arch/mm/as.h>
@@ -52,6 +53,11 @@
 #include <bitops.h>
 
 static void pt_mapping_insert(as_t *, uintptr_t, uintptr_t, unsigned int);
+#ifdef LARGE_PAGE_WIDTH
+static bool pt_mapping_insert_large(as_t *, uintptr_t, uintptr_t,
+    unsigned int);
+static void pt_mapping_split_large(as_t *, uintptr_t);
+#endif
 static void pt_mapping_remove(as_t *, uintptr_t);
 static bool pt_mapping_find(as_t *, uintptr_t, bool, pte_t *pte);
 static void pt_mapping_update(as_t *, uintptr_t, bool, pte_t *pte);
@@ -59,25 +65,28 @@ static void pt_mapping_make_global(uintptr_t, size_t);
 
 page_mapping_operations_t pt_mapping_operations = {
 	.mapping_insert = pt_mapping_insert,
+#ifdef LARGE_PAGE_WIDTH
+	.mapping_insert_large = pt_mapping_insert_large,
+	.mapping_split_large = pt_mapping_split_large,
+#else
+	.mapping_insert_large = NULL,
+	.mapping_split_large = NULL,
+#endif
 	.mapping_remove = pt_mapping_remove,
 	.mapping_find = pt_mapping_find,
 	.mapping_update = pt_mapping_update,
 	.mapping_make_global = pt_mapping_make_global
 };
 
-/** Map page to frame using hierarchical page tables.
+/** Get PTL2 table for page, allocating any missing page tables.
  *
- * Map virtual address page to physical address frame
- * using flags.
+ * @param as   Address space to wich page belongs.
+ * @param page Virtual address of the page.
  *
- * @param as    Address space to wich page belongs.
- * @param page  Virtual address of the page to be mapped.
- * @param frame Physical address of memory frame to which the mapping is done.
- * @param flags Flags to be used for mapping.
+ * @return PTL2 table covering page.
  *
  */
-void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
-    unsigned int flags)
+static pte_t *pt_ptl2_get(as_t *as, uintptr_t page)
 {
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
 
@@ -117,7 +126,151 @@ void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
 		SET_PTL2_PRESENT(ptl1, PTL1_INDEX(page));
 	}
 
+	return (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+}
+
+#ifdef LARGE_PAGE_WIDTH
+
+/** Split large page mapping into a PTL3 table.
+ *
+ * The new PTL3 table maps the same frames with the same flags as the large
+ * page. The page size of the live translations changes though, and TLBs
+ * may then hold both sizes for the same address, which the architecture
+ * does not allow. The translations of the large page are therefore
+ * invalidated on all processors using the address space. The caller
+ * must not be in the middle of a TLB shootdown.
+ *
+ * @param as   Address space to which the large page belongs.
+ * @param page Virtual address within the large page.
+ * @param ptl2 PTL2 table.
+ * @param i    Index of the PTL2 entry mapping the large page.
+ *
+ */
+static void pt_large_split(as_t *as, uintptr_t page, pte_t *ptl2, size_t i)
+{
+	uintptr_t frame = (uintptr_t) GET_PTL3_ADDRESS(ptl2, i);
+	unsigned int flags = GET_PTL3_FLAGS(ptl2, i);
+
+	pte_t *newpt = (pte_t *)
+	    PA2KA(frame_alloc(PTL3_FRAMES, FRAME_LOWMEM, PTL3_SIZE - 1));
+	memsetb(newpt, PTL3_SIZE, 0);
+
+	for (size_t j = 0; j < PTL3_ENTRIES; j++) {
+		SET_FRAME_ADDRESS(newpt, j, frame + P2SZ(j));
+		SET_FRAME_FLAGS(newpt, j, flags);
+	}
+
+	/*
+	 * Replace the large page entry at once, so that a concurrent hardware
+	 * page table walk sees either the large page or the new PTL3.
+	 */
+	pte_t pte;
+	memsetb(&pte, sizeof(pte_t), 0);
+	SET_PTL3_ADDRESS(&pte, 0, KA2PA(newpt));
+	SET_PTL3_FLAGS(&pte, 0, PAGE_USER | PAGE_EXEC | PAGE_CACHEABLE |
+	    PAGE_WRITE);
+
+	write_barrier();
+	ptl2[i] = pte;
+
+	uintptr_t base = ALIGN_DOWN(page, LARGE_PAGE_SIZE);
+	ipl_t ipl = tlb_shootdown_start_as(as, base, PTL3_ENTRIES);
+	tlb_invalidate_pages(as->asid, base, PTL3_ENTRIES);
+	as_invalidate_translation_cache(as, base, PTL3_ENTRIES);
+	tlb_shootdown_finalize(ipl);
+}
+
+/** Map large page to a physically contiguous run of frames.
+ *
+ * The large page is mapped directly by a PTL2 entry.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the large page to be mapped.
+ * @param frame Physical address of the first frame of the run.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return True if the mapping was created, false if a PTL3 table already
+ *         exists for the large page.
+ *
+ */
+bool pt_mapping_insert_large(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	assert(page_table_locked(as));
+	assert(IS_ALIGNED(page, LARGE_PAGE_SIZE));
+	assert(IS_ALIGNED(frame, LARGE_PAGE_SIZE));
+
+	pte_t *ptl2 = pt_ptl2_get(as, page);
+
+	if (!(GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT))
+		return false;
+
+	SET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page), frame);
+	SET_PTL3_FLAGS(ptl2, PTL2_INDEX(page), flags | PAGE_NOT_PRESENT);
+	SET_PTL3_LARGE(ptl2, PTL2_INDEX(page));
+	/*
+	 * Make the new mapping visible only after it is fully initialized.
+	 */
+	write_barrier();
+	SET_PTL3_PRESENT(ptl2, PTL2_INDEX(page));
+
+	return true;
+}
+
+/** Split large page mapping crossing an address.
+ *
+ * @param as   Address space to wich page belongs.
+ * @param page Virtual address of the first page to be demapped.
+ *
+ */
+void pt_mapping_split_large(as_t *as, uintptr_t page)
+{
+	assert(page_table_locked(as));
+
+	if (IS_ALIGNED(page, LARGE_PAGE_SIZE))
+		return;
+
+	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
+	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+
+	pte_t *ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
+	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+
 	pte_t *ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+
+	if (GET_PTL3_LARGE(ptl2, PTL2_INDEX(page)))
+		pt_large_split(as, page, ptl2, PTL2_INDEX(page));
+}
+
+#endif /* LARGE_PAGE_WIDTH */
+
+/** Map page to frame using hierarchical page tables.
+ *
+ * Map virtual address page to physical address frame
+ * using flags.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the page to be mapped.
+ * @param frame Physical address of memory frame to which the mapping is done.
+ * @param flags Flags to be used for mapping.
+ *
+ */
+void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	assert(page_table_locked(as));
+
+	pte_t *ptl2 = pt_ptl2_get(as, page);
+
+#ifdef LARGE_PAGE_WIDTH
+	if ((!(GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)) &&
+	    (GET_PTL3_LARGE(ptl2, PTL2_INDEX(page))))
+		pt_large_split(as, page, ptl2, PTL2_INDEX(page));
+#endif
 
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT) {
 		pte_t *newpt = (pte_t *)
@@ -177,6 +330,24 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return;
 
+	bool empty = true;
+	unsigned int i;
+
+#ifdef LARGE_PAGE_WIDTH
+	/*
+	 * A large page is removed as a whole, the callers remove all its
+	 * pages in ascending order. Keep the large page mapped until its last
+	 * page is removed, so that the other pages can still be looked up.
+	 */
+	if (GET_PTL3_LARGE(ptl2, PTL2_INDEX(page))) {
+		if (PTL3_INDEX(page) != PTL3_ENTRIES - 1)
+			return;
+
+		memsetb(&ptl2[PTL2_INDEX(page)], sizeof(pte_t), 0);
+		goto check_ptl2;
+	}
+#endif
+
 	pte_t *ptl3 = (pte_t *) PA2KA(GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page)));
 
 	/*
@@ -195,9 +366,6 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 	 */
 
 	/* Check PTL3 */
-	bool empty = true;
-
-	unsigned int i;
 	for (i = 0; i < PTL3_ENTRIES; i++) {
 		if (PTE_VALID(&ptl3[i])) {
 			empty = false;
@@ -232,6 +400,9 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 		return;
 	}
 
+#ifdef LARGE_PAGE_WIDTH
+check_ptl2:
+#endif
 	/* Check PTL2, empty is still true */
 #if (PTL2_ENTRIES != 0)
 	for (i = 0; i < PTL2_ENTRIES; i++) {
@@ -291,8 +462,11 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 #endif /* PTL1_ENTRIES != 0 */
 }
 
-static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
+static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock,
+    bool *large)
 {
+	*large = false;
+
 	assert(nolock || page_table_locked(as));
 
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
@@ -316,6 +490,13 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return NULL;
 
+#ifdef LARGE_PAGE_WIDTH
+	if (GET_PTL3_LARGE(ptl2, PTL2_INDEX(page))) {
+		*large = true;
+		return &ptl2[PTL2_INDEX(page)];
+	}
+#endif
+
 #if (PTL2_ENTRIES != 0)
 	/*
 	 * Always read ptl3 only after we are sure it is present.
@@ -339,9 +520,18 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
  */
 bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
-	if (t)
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
+	if (t) {
 		*pte = *t;
+#ifdef LARGE_PAGE_WIDTH
+		/* Describe the small page within the large page. */
+		if (large) {
+			SET_FRAME_ADDRESS(pte, 0, PTE_GET_FRAME(t) +
+			    (page & (LARGE_PAGE_SIZE - 1)));
+		}
+#endif
+	}
 	return t != NULL;
 }
 
@@ -354,17 +544,27 @@ bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
  */
 void pt_mapping_update(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
 	if (!t)
 		panic("Updating non-existent PTE");
 
-	assert(PTE_VALID(t) == PTE_VALID(pte));
-	assert(PTE_PRESENT(t) == PTE_PRESENT(pte));
-	assert(PTE_GET_FRAME(t) == PTE_GET_FRAME(pte));
-	assert(PTE_WRITABLE(t) == PTE_WRITABLE(pte));
-	assert(PTE_EXECUTABLE(t) == PTE_EXECUTABLE(pte));
+	pte_t new_pte = *pte;
+#ifdef LARGE_PAGE_WIDTH
+	if (large) {
+		/* Translate the small page PTE back to the large page. */
+		SET_FRAME_ADDRESS(&new_pte, 0, PTE_GET_FRAME(pte) -
+		    (page & (LARGE_PAGE_SIZE - 1)));
+	}
+#endif
+
+	assert(PTE_VALID(t) == PTE_VALID(&new_pte));
+	assert(PTE_PRESENT(t) == PTE_PRESENT(&new_pte));
+	assert(PTE_GET_FRAME(t) == PTE_GET_FRAME(&new_pte));
+	assert(PTE_WRITABLE(t) == PTE_WRITABLE(&new_pte));
+	assert(PTE_EXECUTABLE(t) == PTE_EXECUTABLE(&new_pte));
 
-	*t = *pte;
+	*t = new_pte;
 }
 
 /** Return the size of the region mapped by a single PTL0 entry.
@@ -38,8 +38,6 @@
 #include <abi/cap.h>
 #include <typedefs.h>
 #include <adt/list.h>
-#include <adt/hash.h>
-#include <adt/hash_table.h>
 #include <lib/ra.h>
 #include <synch/mutex.h>
 #include <atomic.h>
@@ -76,6 +74,10 @@ extern kobject_ops_t *kobject_ops[];
 /*
  * Everything in kobject_t except for the atomic reference count, the capability
  * list and its lock is imutable.
+ *
+ * Kernel objects are looked up without locking and their memory is type-safe
+ * (see SLAB_CACHE_TYPESAFE). The reference count of a freed kernel object is
+ * zero and must not be the first member, which the slab allocator reuses.
  */
 typedef struct kobject {
 	kobject_type_t type;
@@ -110,18 +112,39 @@ typedef struct cap {
 	/* Link to the task's capabilities of the same kobject type. */
 	link_t type_link;
 
-	ht_link_t caps_link;
-
 	/* The underlying kernel object. */
 	kobject_t *kobject;
 } cap_t;
 
+/** Order of the number of slots in a leaf of the capability table */
+#define CAPS_LEAF_ORDER  10
+#define CAPS_LEAF_SIZE   (1 << CAPS_LEAF_ORDER)
+/** Number of leaves of the capability table */
+#define CAPS_DIR_SIZE    1024
+
+/** Slot of the capability table */
+typedef struct cap_slot {
+	/** Capability, protected by the cap_info_t lock. */
+	cap_t *cap;
+
+	/**
+	 * Kernel object of the capability if published. Updated under
+	 * the cap_info_t lock, but read without locking.
+	 */
+	_Atomic(kobject_t *) kobject;
+} cap_slot_t;
+
 typedef struct cap_info {
 	mutex_t lock;
 
 	list_t type_list[KOBJECT_TYPE_MAX];
 
-	hash_table_t caps;
+	/**
+	 * Two-level table of capability slots indexed by the handle.
+	 * Leaves are allocated under the lock and never freed before
+	 * the task is destroyed.
+	 */
+	_Atomic(cap_slot_t *) caps[CAPS_DIR_SIZE];
 	ra_arena_t *handles;
 } cap_info_t;
 
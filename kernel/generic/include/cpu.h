@@ -36,6 +36,7 @@
 #define KERN_CPU_H_
 
 #include <mm/tlb.h>
+#include <mm/frame.h>
 #include <synch/spinlock.h>
 #include <proc/scheduler.h>
 #include <arch/cpu.h>
@@ -52,8 +53,25 @@
 typedef struct cpu {
 	IRQ_SPINLOCK_DECLARE(lock);
 
-	tlb_shootdown_msg_t tlb_messages[TLB_MESSAGE_QUEUE_LEN];
-	size_t tlb_messages_count;
+	/** TLB shootdown request sent by this processor. */
+	tlb_shootdown_t tlb_shootdown;
+
+	/**
+	 * Sequence numbers of TLB shootdown requests sent to this
+	 * processor, indexed by the sender. Written by the senders.
+	 */
+	atomic_size_t *tlb_requests;
+
+	/**
+	 * Sequence numbers of the last acknowledged and processed
+	 * TLB shootdown requests, indexed by the sender. Accessed only
+	 * by this processor with interrupts disabled.
+	 */
+	size_t *tlb_acked;
+	size_t *tlb_processed;
+
+	/** Free frames cached by this processor. */
+	frame_cache_t frame_cache;
 
 	context_t saved_context;
 
@@ -87,7 +105,6 @@ typedef struct cpu {
 	unsigned int id;
 
 	bool active;
-	volatile bool tlb_active;
 
 	uint16_t frequency_mhz;
 	uint32_t delay_loop_const;
@@ -96,6 +113,21 @@ typedef struct cpu {
 
 	struct thread *fpu_owner;
 
+	/**
+	 * Thread currently running on this processor. Only compared by
+	 * adaptive mutexes, never dereferenced by other processors.
+	 */
+	struct thread *volatile running;
+
+	/**
+	 * Mutex contention statistics. Updated only by this processor
+	 * with preemption disabled.
+	 */
+	uint64_t mutex_waits;
+	uint64_t mutex_spins;
+	uint64_t mutex_wait_cycles;
+	uint64_t mutex_hold_cycles;
+
 	/**
 	 * Stack used by scheduler when there is no running thread.
 	 */
@@ -51,6 +51,8 @@ typedef struct {
 	pfn_t frames;
 	/** Allow mapping by unprivileged tasks. */
 	bool unpriv;
+	/** Allow only read-only mappings. */
+	bool rdonly;
 	/** Indicate whether the area is actually mapped. */
 	bool mapped;
 } parea_t;
@@ -48,6 +48,7 @@
 #include <lib/elf.h>
 #include <arch.h>
 #include <lib/refcount.h>
+#include <atomic.h>
 
 #define AS                   CURRENT->as
 
@@ -115,6 +116,20 @@ typedef struct as {
 	 */
 	asid_t asid;
 
+	/**
+	 * Processors which may hold TLB entries of this
+	 * address space. NULL for the kernel address space.
+	 * Protected by asidlock.
+	 */
+	struct cpu_mask *cpu_mask;
+
+	/**
+	 * Number of TLB shootdowns in progress which prevent
+	 * this address space from being switched to.
+	 * Protected by asidlock.
+	 */
+	size_t tlb_shootdown;
+
 	/** Number of references (i.e. tasks that reference this as). */
 	atomic_refcount_t refcount;
 
@@ -126,6 +141,12 @@ typedef struct as {
 	 */
 	odict_t as_areas;
 
+	/** Number of pages in all address space areas. */
+	atomic_size_t virt_pages;
+
+	/** Number of used pages in all address space areas. */
+	atomic_size_t resident_pages;
+
 	/** Non-generic content. */
 	as_genarch_t genarch;
 
@@ -183,6 +204,8 @@ typedef struct used_space {
 	odict_t ivals;
 	/** Total number of used pages. */
 	size_t pages;
+	/** Address space whose resident page count to maintain. */
+	struct as *as;
 } used_space_t;
 
 /**
@@ -221,6 +244,8 @@ struct mem_backend;
 typedef union mem_backend_data {
 	/* anon_backend members */
 	struct {
+		/** Page expected to fault next if the area is used sequentially. */
+		uintptr_t fault_hint;
 	};
 
 	/** elf_backend members */
@@ -336,7 +361,11 @@ extern void as_pagemap_remove(as_page_mapping_t *);
 
 extern unsigned int as_area_get_flags(as_area_t *);
 extern bool as_area_check_access(as_area_t *, pf_access_t);
+#ifdef LARGE_PAGE_SIZE
+extern bool as_area_large_page_usable(as_area_t *, uintptr_t);
+#endif
 extern size_t as_area_get_size(uintptr_t);
+extern bool as_area_check_flags(as_t *, uintptr_t, unsigned int);
 extern used_space_ival_t *used_space_first(used_space_t *);
 extern used_space_ival_t *used_space_next(used_space_ival_t *);
 extern used_space_ival_t *used_space_find_gteq(used_space_t *, uintptr_t);
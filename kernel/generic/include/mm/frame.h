@@ -47,6 +47,15 @@
 /** Maximum number of zones in the system. */
 #define ZONES_MAX  32
 
+/**
+ * Number of block orders tracked by the free block index of a zone.
+ * Aligned blocks of up to 2^ZONE_INDEX_ORDERS frames are indexed.
+ */
+#define ZONE_INDEX_ORDERS  10
+
+/** Number of free frames cached by each CPU for each kind of memory. */
+#define FRAME_CACHE_SIZE  32
+
 typedef uint8_t frame_flags_t;
 
 #define FRAME_NONE        0x00
@@ -113,10 +122,29 @@ typedef struct {
 	/** Frame bitmap */
 	bitmap_t bitmap;
 
+	/**
+	 * Free block index. Bit i of index[k - 1] is set if the naturally
+	 * aligned block of 2^k frames starting at ((base >> k) + i) << k
+	 * lies within the zone and is completely free.
+	 */
+	bitmap_t index[ZONE_INDEX_ORDERS];
+
 	/** Array of frame_t structures in this zone */
 	frame_t *frames;
 } zone_t;
 
+/** Per-CPU cache of free single frames.
+ *
+ * The cached frames remain allocated in their zones, so that they can be
+ * handed out without taking the zones lock. Index 0 holds frames from low
+ * memory zones, index 1 frames from high memory zones.
+ */
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+	size_t count[2];
+	pfn_t pfn[2][FRAME_CACHE_SIZE];
+} frame_cache_t;
+
 /*
  * The zoneinfo.lock must be locked when accessing zoneinfo structure.
  * Some of the attributes in zone_t structures are 'read-only'
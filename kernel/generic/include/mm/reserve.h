@@ -40,6 +40,7 @@
 
 extern void reserve_init(void);
 extern bool reserve_try_alloc(size_t);
+extern bool reserve_try_alloc_noreclaim(size_t);
 extern void reserve_force_alloc(size_t);
 extern void reserve_free(size_t);
 
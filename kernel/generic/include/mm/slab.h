@@ -63,6 +63,8 @@
 #define SLAB_CACHE_SLINSIDE     0x02
 /** We add magazine cache later, if we have this flag */
 #define SLAB_CACHE_MAGDEFERRED  (0x04 | SLAB_CACHE_NOMAGAZINE)
+/** Never release slabs, freed objects are only reused by this cache */
+#define SLAB_CACHE_TYPESAFE     0x08
 
 typedef struct {
 	link_t link;
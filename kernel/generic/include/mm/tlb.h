@@ -36,11 +36,12 @@
 #define KERN_TLB_H_
 
 #include <arch/mm/asid.h>
+#include <atomic.h>
 #include <typedefs.h>
 
 /**
- * Number of TLB shootdown messages that can be queued in processor tlb_messages
- * queue.
+ * Number of TLB shootdown messages that can be batched in one TLB shootdown
+ * request.
  */
 #define TLB_MESSAGE_QUEUE_LEN	10
 
@@ -64,15 +65,47 @@ typedef struct {
 	size_t count;			/**< Number of pages to invalidate. */
 } tlb_shootdown_msg_t;
 
+struct as;
+struct cpu_mask;
+
+/** TLB shootdown request.
+ *
+ * Every processor owns one request which it uses to send TLB shootdown
+ * messages to other processors. The request can be reused only after
+ * all its recipients processed it.
+ */
+typedef struct {
+	/** Sequence number of the current request. */
+	size_t seq;
+	/** Sequence number of the last request whose sender finished. */
+	atomic_size_t done;
+	/** Number of recipients which have not acknowledged the request. */
+	atomic_size_t acks_pending;
+	/** Number of recipients which have not processed the request. */
+	atomic_size_t process_pending;
+	/** Recipients of the current request. */
+	struct cpu_mask *mask;
+	/** Address space whose switching is blocked by the request. */
+	struct as *as;
+	/** Batched messages. */
+	tlb_shootdown_msg_t messages[TLB_MESSAGE_QUEUE_LEN];
+	size_t messages_count;
+} tlb_shootdown_t;
+
 extern void tlb_init(void);
 
 #ifdef CONFIG_SMP
 extern ipl_t tlb_shootdown_start(tlb_invalidate_type_t, asid_t, uintptr_t,
     size_t);
+extern ipl_t tlb_shootdown_start_as(struct as *, uintptr_t, size_t);
+extern void tlb_shootdown_add(tlb_invalidate_type_t, asid_t, uintptr_t,
+    size_t);
 extern void tlb_shootdown_finalize(ipl_t);
 extern void tlb_shootdown_ipi_recv(void);
 #else
 #define tlb_shootdown_start(w, x, y, z)	interrupts_disable()
+#define tlb_shootdown_start_as(x, y, z)	interrupts_disable()
+#define tlb_shootdown_add(w, x, y, z)
 #define tlb_shootdown_finalize(i)	(interrupts_restore(i));
 #define tlb_shootdown_ipi_recv()
 #endif /* CONFIG_SMP */
@@ -80,7 +113,6 @@ extern void tlb_shootdown_ipi_recv(void);
 /* Export TLB interface that each architecture must implement. */
 extern void tlb_arch_init(void);
 extern void tlb_print(void);
-extern void tlb_shootdown_ipi_send(void);
 
 extern void tlb_invalidate_all(void);
 extern void tlb_invalidate_asid(asid_t);
@@ -89,6 +89,8 @@ typedef struct task {
 	atomic_t refcount;
 	/** Number of threads that haven't exited yet. */
 	atomic_t lifecount;
+	/** Number of futexes of the task. */
+	atomic_size_t futexes;
 
 	/** Task permissions. */
 	perm_t perms;
@@ -129,6 +131,14 @@ typedef struct task {
 	/** Accumulated accounting. */
 	uint64_t ucycles;
 	uint64_t kcycles;
+
+	/** Entry in the shared task statistics page or NULL. */
+	stats_page_entry_t *stats_entry;
+	/** Protects stats_entry updates and the published accounting. */
+	IRQ_SPINLOCK_DECLARE(stats_lock);
+	/** Accounting published to the shared task statistics page. */
+	uint64_t stats_ucycles;
+	uint64_t stats_kcycles;
 } task_t;
 
 /** Synchronize access to @c tasks */
@@ -119,6 +119,8 @@ typedef struct thread {
 
 	/** Wait queue in which this thread sleeps. */
 	waitq_t *sleep_queue;
+	/** Futex in which this thread sleeps, changed when requeued. */
+	struct futex *futex;
 	/** Timeout used for timeoutable sleeping.  */
 	timeout_t sleep_timeout;
 	/** Flag signalling sleep timeout in progress. */
@@ -182,6 +184,9 @@ typedef struct thread {
 	/** Thread accounting. */
 	uint64_t ucycles;
 	uint64_t kcycles;
+	/** Part of the accounting already added to the task statistics. */
+	uint64_t ucycles_published;
+	uint64_t kcycles_published;
 	/** Last sampled cycle. */
 	uint64_t last_cycle;
 	/** Thread doesn't affect accumulated accounting. */
@@ -37,12 +37,17 @@
 
 #ifdef CONFIG_SMP
 
+#include <cpu/cpu_mask.h>
+
 extern void ipi_broadcast(int);
 extern void ipi_broadcast_arch(int);
+extern void ipi_multicast(cpu_mask_t *, int);
+extern void ipi_multicast_arch(cpu_mask_t *, int);
 
 #else
 
 #define ipi_broadcast(ipi)
+#define ipi_multicast(mask, ipi)
 
 #endif /* CONFIG_SMP */
 
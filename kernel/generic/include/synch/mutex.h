@@ -47,11 +47,19 @@ typedef enum {
 } mutex_type_t;
 
 struct thread;
+struct cpu;
 
 typedef struct {
 	mutex_type_t type;
 	semaphore_t sem;
-	struct thread *owner;
+	/** Thread holding the mutex (not tracked for active mutexes). */
+	struct thread *volatile owner;
+	/** Processor on which the owner acquired the mutex. */
+	struct cpu *volatile owner_cpu;
+	/** Cycle counter value when the mutex was acquired. */
+	uint64_t locked_cycle;
+	/** Another thread waited for the mutex while it was held. */
+	volatile bool contended;
 	unsigned nesting;
 } mutex_t;
 
@@ -107,7 +107,7 @@ _NO_TRACE static inline void spinlock_lock(spinlock_t *lock)
 	preemption_disable();
 	while (atomic_flag_test_and_set_explicit(&lock->flag,
 	    memory_order_acquire))
-		;
+		cpu_spin_hint();
 }
 
 /** Release spinlock
@@ -35,9 +35,17 @@
 #ifndef KERN_STATS_H_
 #define KERN_STATS_H_
 
+#include <proc/task.h>
+#include <proc/thread.h>
+
 extern void kload(void *arg);
 extern void stats_init(void);
 
+extern void stats_task_attach(task_t *);
+extern void stats_task_detach(task_t *);
+extern void stats_task_rename(task_t *);
+extern void stats_thread_publish(thread_t *);
+
 #endif
 
 /** @}
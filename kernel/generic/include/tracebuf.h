@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_generic_debug
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_TRACEBUF_H_
+#define KERN_TRACEBUF_H_
+
+#include <abi/tracebuf.h>
+#include <arch/istate.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <typedefs.h>
+
+extern volatile uint32_t tracebuf_mask;
+
+/** Check whether recording of a trace event is enabled */
+static inline bool tracebuf_enabled(tracebuf_event_t event)
+{
+	return (tracebuf_mask & TRACEBUF_MASK(event)) != 0;
+}
+
+/** Record a trace event if it is enabled */
+#define tracebuf_event(event, arg1, arg2) \
+	do { \
+		if (tracebuf_enabled(event)) \
+			tracebuf_record((event), (arg1), (arg2)); \
+	} while (0)
+
+extern void tracebuf_init(void);
+extern void tracebuf_record(tracebuf_event_t, uint64_t, uint32_t);
+extern void tracebuf_exc_enter(unsigned int, istate_t *);
+extern void tracebuf_exc_leave(void);
+extern void tracebuf_tick(void);
+
+extern sys_errno_t sys_tracebuf_control(sysarg_t, sysarg_t);
+
+#endif
+
+/** @}
+ */
@@ -242,6 +242,106 @@ static int constraint_satisfy(size_t index, size_t base, size_t constraint)
 	return (((base + index) & constraint) == 0);
 }
 
+/** Count clear bits at the beginning of a bit range
+ *
+ * @param bitmap Bitmap structure.
+ * @param start  First bit of the range.
+ * @param count  Number of bits in the range.
+ *
+ * @return Number of clear bits preceding the first set bit
+ *         in the range (or count if all bits are clear).
+ *
+ */
+static size_t bitmap_clear_prefix(bitmap_t *bitmap, size_t start,
+    size_t count)
+{
+	size_t i = 0;
+
+	while (i < count) {
+		size_t element = start + i;
+
+		if (((element & BITMAP_REMAINER) == 0) &&
+		    (count - i >= BITMAP_ELEMENT) &&
+		    (bitmap->bits[element / BITMAP_ELEMENT] == ALL_ZEROES)) {
+			i += BITMAP_ELEMENT;
+			continue;
+		}
+
+		if (bitmap_get_fast(bitmap, element))
+			break;
+
+		i++;
+	}
+
+	return i;
+}
+
+/** Find a continuous zero bit range with an aligned start
+ *
+ * Only the bits whose address is aligned to align are considered
+ * as the start of the range, which avoids scanning the bitmap
+ * bit by bit when allocating large aligned ranges.
+ *
+ * @param bitmap     Bitmap structure.
+ * @param count      Number of continuous zero bits to find.
+ * @param base       Address of the first bit in the bitmap.
+ * @param prefered   Prefered address to start searching from.
+ * @param constraint Constraint for the address of the first zero bit.
+ * @param align      Alignment implied by the constraint.
+ * @param index      Place to store the index of the first zero
+ *                   bit. Can be NULL (in which case the bitmap
+ *                   is not modified).
+ *
+ * @return True if a suitable range has been found.
+ *
+ */
+static bool bitmap_allocate_range_aligned(bitmap_t *bitmap, size_t count,
+    size_t base, size_t prefered, size_t constraint, size_t align,
+    size_t *index)
+{
+	size_t first = ALIGN_UP(base, align) - base;
+	if (first >= bitmap->elements)
+		return false;
+
+	size_t candidates = (bitmap->elements - first + align - 1) / align;
+
+	/* Start searching at the next-fit or the prefered address */
+	size_t hint = bitmap->next_fit * BITMAP_ELEMENT;
+	if ((prefered > base) && (prefered < base + bitmap->elements))
+		hint = max(hint, prefered - base);
+
+	size_t start = (hint > first) ? (hint - first) / align : 0;
+	if (start >= candidates)
+		start = 0;
+
+	for (size_t pos = 0; pos < candidates; pos++) {
+		size_t i = first + ((start + pos) % candidates) * align;
+
+		if ((i + count > bitmap->elements) ||
+		    (!constraint_satisfy(i, base, constraint)))
+			continue;
+
+		size_t clear = bitmap_clear_prefix(bitmap, i, count);
+		if (clear == count) {
+			if (index != NULL) {
+				bitmap_set_range(bitmap, i, count);
+				bitmap->next_fit = i / BITMAP_ELEMENT;
+				*index = i;
+			}
+
+			return true;
+		}
+
+		/*
+		 * All candidates up to the first set bit
+		 * would contain it as well.
+		 */
+		pos += clear / align;
+	}
+
+	return false;
+}
+
 /** Find a continuous zero bit range
  *
  * Find a continuous zero bit range in the bitmap. The address
@@ -274,6 +374,16 @@ bool bitmap_allocate_range(bitmap_t *bitmap, size_t count, size_t base,
 	if (count == 0)
 		return false;
 
+	/*
+	 * The trailing ones of the constraint determine the alignment
+	 * of the range. Large alignments are handled separately.
+	 */
+	size_t align = (constraint & ~(constraint + 1)) + 1;
+	if (align >= BITMAP_ELEMENT) {
+		return bitmap_allocate_range_aligned(bitmap, count, base,
+		    prefered, constraint, align, index);
+	}
+
 	size_t size = bitmap_size(bitmap->elements);
 	size_t next_fit = bitmap->next_fit;
 
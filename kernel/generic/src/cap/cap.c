@@ -73,6 +73,15 @@
  * kobject_get() or kobject_add_ref(). When the kernel object is removed from
  * the container, the reference count should go down via a call to
  * kobject_put().
+ *
+ * The capabilities of a task are kept in a two-level table indexed by the
+ * capability handle. The table is modified under the task's capability lock,
+ * but kobject_get() reads it without any locking, so that threads of a task
+ * which uses its capabilities heavily do not contend on the lock. This is
+ * safe because the leaves of the table are only freed along with the task
+ * and the memory of kernel objects is type-safe. A reference to a kernel
+ * object is only taken if its reference count is not zero and the object is
+ * then checked to be still published under the looked up handle.
  */
 
 #include <cap/cap.h>
@@ -92,8 +101,8 @@
 #include <stdlib.h>
 
 #define CAPS_START	((intptr_t) CAP_NIL + 1)
-#define CAPS_SIZE	(INT_MAX - (int) CAPS_START)
-#define CAPS_LAST	(CAPS_SIZE - 1)
+#define CAPS_SIZE	(CAPS_DIR_SIZE * CAPS_LEAF_SIZE - (int) CAPS_START)
+#define CAPS_LAST	(CAPS_START + CAPS_SIZE - 1)
 
 static slab_cache_t *cap_cache;
 static slab_cache_t *kobject_cache;
@@ -105,37 +114,48 @@ kobject_ops_t *kobject_ops[KOBJECT_TYPE_MAX] = {
 	[KOBJECT_TYPE_WAITQ] = &waitq_kobject_ops
 };
 
-static size_t caps_hash(const ht_link_t *item)
-{
-	cap_t *cap = hash_table_get_inst(item, cap_t, caps_link);
-	return hash_mix(cap_handle_raw(cap->handle));
-}
-
-static size_t caps_key_hash(const void *key)
+/** Construct kernel object memory
+ *
+ * Memory of a freed kernel object keeps its zero reference count, fresh
+ * memory gets one here, so that lockless readers never take a reference
+ * to an object which is not initialized.
+ */
+static errno_t kobject_ctor(void *obj, unsigned int kmflags)
 {
-	const cap_handle_t *handle = key;
-	return hash_mix(cap_handle_raw(*handle));
-}
+	kobject_t *kobj = (kobject_t *) obj;
 
-static bool caps_key_equal(const void *key, const ht_link_t *item)
-{
-	const cap_handle_t *handle = key;
-	cap_t *cap = hash_table_get_inst(item, cap_t, caps_link);
-	return *handle == cap->handle;
+	atomic_store_explicit(&kobj->refcnt, 0, memory_order_relaxed);
+	return EOK;
 }
 
-static hash_table_ops_t caps_ops = {
-	.hash = caps_hash,
-	.key_hash = caps_key_hash,
-	.key_equal = caps_key_equal
-};
-
 void caps_init(void)
 {
 	cap_cache = slab_cache_create("cap_t", sizeof(cap_t), 0, NULL,
 	    NULL, 0);
 	kobject_cache = slab_cache_create("kobject_t", sizeof(kobject_t), 0,
-	    NULL, NULL, 0);
+	    kobject_ctor, NULL, SLAB_CACHE_TYPESAFE);
+}
+
+/** Find the slot of a capability handle in the capability table
+ *
+ * @param cap_info  Capability info structure.
+ * @param handle    Capability handle.
+ *
+ * @return Slot of the capability handle or NULL if there is none.
+ */
+static cap_slot_t *cap_slot(cap_info_t *cap_info, cap_handle_t handle)
+{
+	if ((cap_handle_raw(handle) < CAPS_START) ||
+	    (cap_handle_raw(handle) > CAPS_LAST))
+		return NULL;
+
+	uintptr_t raw = (uintptr_t) cap_handle_raw(handle);
+	cap_slot_t *leaf = atomic_load_explicit(
+	    &cap_info->caps[raw >> CAPS_LEAF_ORDER], memory_order_acquire);
+	if (!leaf)
+		return NULL;
+
+	return &leaf[raw & (CAPS_LEAF_SIZE - 1)];
 }
 
 /** Allocate the capability info structure
@@ -152,8 +172,8 @@ errno_t caps_task_alloc(task_t *task)
 		goto error_handles;
 	if (!ra_span_add(task->cap_info->handles, CAPS_START, CAPS_SIZE))
 		goto error_span;
-	if (!hash_table_create(&task->cap_info->caps, 0, 0, &caps_ops))
-		goto error_span;
+	for (size_t i = 0; i < CAPS_DIR_SIZE; i++)
+		atomic_init(&task->cap_info->caps[i], NULL);
 	return EOK;
 
 error_span:
@@ -181,7 +201,9 @@ void caps_task_init(task_t *task)
  */
 void caps_task_free(task_t *task)
 {
-	hash_table_destroy(&task->cap_info->caps);
+	for (size_t i = 0; i < CAPS_DIR_SIZE; i++)
+		free(atomic_load_explicit(&task->cap_info->caps[i],
+		    memory_order_relaxed));
 	ra_arena_destroy(task->cap_info->handles);
 	free(task->cap_info);
 }
@@ -242,18 +264,47 @@ static cap_t *cap_get(task_t *task, cap_handle_t handle, cap_state_t state)
 {
 	assert(mutex_locked(&task->cap_info->lock));
 
-	if ((cap_handle_raw(handle) < CAPS_START) ||
-	    (cap_handle_raw(handle) > CAPS_LAST))
+	cap_slot_t *slot = cap_slot(task->cap_info, handle);
+	if (!slot)
 		return NULL;
-	ht_link_t *link = hash_table_find(&task->cap_info->caps, &handle);
-	if (!link)
-		return NULL;
-	cap_t *cap = hash_table_get_inst(link, cap_t, caps_link);
-	if (cap->state != state)
+	cap_t *cap = slot->cap;
+	if ((!cap) || (cap->state != state))
 		return NULL;
 	return cap;
 }
 
+/** Make sure the capability table has a slot for a handle
+ *
+ * @param cap_info  Capability info structure.
+ * @param handle    Capability handle.
+ *
+ * @return Slot of the capability handle or NULL if out of memory.
+ */
+static cap_slot_t *cap_slot_alloc(cap_info_t *cap_info, cap_handle_t handle)
+{
+	assert(mutex_locked(&cap_info->lock));
+
+	cap_slot_t *slot = cap_slot(cap_info, handle);
+	if (slot)
+		return slot;
+
+	cap_slot_t *leaf = malloc(sizeof(cap_slot_t) * CAPS_LEAF_SIZE);
+	if (!leaf)
+		return NULL;
+
+	for (size_t i = 0; i < CAPS_LEAF_SIZE; i++) {
+		leaf[i].cap = NULL;
+		atomic_init(&leaf[i].kobject, NULL);
+	}
+
+	/* Publish the initialized leaf to the lockless readers. */
+	uintptr_t raw = (uintptr_t) cap_handle_raw(handle);
+	atomic_store_explicit(&cap_info->caps[raw >> CAPS_LEAF_ORDER], leaf,
+	    memory_order_release);
+
+	return &leaf[raw & (CAPS_LEAF_SIZE - 1)];
+}
+
 /** Allocate new capability
  *
  * @param task  Task for which to allocate the new capability.
@@ -276,8 +327,15 @@ errno_t cap_alloc(task_t *task, cap_handle_t *handle)
 		mutex_unlock(&task->cap_info->lock);
 		return ENOMEM;
 	}
+	cap_slot_t *slot = cap_slot_alloc(task->cap_info, (cap_handle_t) hbase);
+	if (!slot) {
+		ra_free(task->cap_info->handles, hbase, 1);
+		slab_free(cap_cache, cap);
+		mutex_unlock(&task->cap_info->lock);
+		return ENOMEM;
+	}
 	cap_initialize(cap, task, (cap_handle_t) hbase);
-	hash_table_insert(&task->cap_info->caps, &cap->caps_link);
+	slot->cap = cap;
 
 	cap->state = CAP_STATE_ALLOCATED;
 	*handle = cap->handle;
@@ -308,12 +366,16 @@ cap_publish(task_t *task, cap_handle_t handle, kobject_t *kobj)
 	cap->kobject = kobj;
 	list_append(&cap->kobj_link, &kobj->caps_list);
 	list_append(&cap->type_link, &task->cap_info->type_list[kobj->type]);
+	atomic_store_explicit(&cap_slot(task->cap_info, handle)->kobject, kobj,
+	    memory_order_release);
 	mutex_unlock(&task->cap_info->lock);
 	mutex_unlock(&kobj->caps_list_lock);
 }
 
 static void cap_unpublish_unsafe(cap_t *cap)
 {
+	atomic_store_explicit(&cap_slot(cap->task->cap_info,
+	    cap->handle)->kobject, NULL, memory_order_relaxed);
 	cap->kobject = NULL;
 	list_remove(&cap->kobj_link);
 	list_remove(&cap->type_link);
@@ -401,7 +463,7 @@ void cap_free(task_t *task, cap_handle_t handle)
 
 	assert(cap);
 
-	hash_table_remove_item(&task->cap_info->caps, &cap->caps_link);
+	cap_slot(task->cap_info, handle)->cap = NULL;
 	ra_free(task->cap_info->handles, cap_handle_raw(handle), 1);
 	slab_free(cap_cache, cap);
 	mutex_unlock(&task->cap_info->lock);
@@ -412,12 +474,26 @@ kobject_t *kobject_alloc(unsigned int flags)
 	return slab_alloc(kobject_cache, flags);
 }
 
+/** Free kernel object memory
+ *
+ * Only kernel objects which were never initialized or whose last reference
+ * was dropped by kobject_put() may be freed. Initialized kernel objects must
+ * be disposed of by kobject_put(), because a lockless reader may still hold
+ * a reference to them.
+ *
+ * @param kobj  Kernel object to free.
+ */
 void kobject_free(kobject_t *kobj)
 {
+	assert(atomic_load_explicit(&kobj->refcnt, memory_order_relaxed) == 0);
 	slab_free(kobject_cache, kobj);
 }
 
 /** Initialize kernel object
+ *
+ * The memory may have belonged to a freed kernel object which lockless
+ * readers still look at. Its reference count is zero, which stops them
+ * from taking a reference, so it is only raised from zero.
  *
  * @param kobj  Kernel object to initialize.
  * @param type  Type of the kernel object.
@@ -425,7 +501,11 @@ void kobject_free(kobject_t *kobj)
  */
 void kobject_initialize(kobject_t *kobj, kobject_type_t type, void *raw)
 {
-	atomic_store(&kobj->refcnt, 1);
+	size_t refcnt = 0;
+	bool unused = atomic_compare_exchange_strong_explicit(&kobj->refcnt,
+	    &refcnt, 1, memory_order_relaxed, memory_order_relaxed);
+	assert(unused);
+	(void) unused;
 
 	mutex_initialize(&kobj->caps_list_lock, MUTEX_PASSIVE);
 	list_initialize(&kobj->caps_list);
@@ -434,7 +514,30 @@ void kobject_initialize(kobject_t *kobj, kobject_type_t type, void *raw)
 	kobj->raw = raw;
 }
 
+/** Record new reference unless the kernel object is being destroyed
+ *
+ * @param kobj  Kernel object, possibly already freed.
+ *
+ * @return True if the reference was recorded.
+ */
+static bool kobject_try_add_ref(kobject_t *kobj)
+{
+	size_t refcnt = atomic_load_explicit(&kobj->refcnt,
+	    memory_order_relaxed);
+
+	do {
+		if (refcnt == 0)
+			return false;
+	} while (!atomic_compare_exchange_weak_explicit(&kobj->refcnt,
+	    &refcnt, refcnt + 1, memory_order_acquire, memory_order_relaxed));
+
+	return true;
+}
+
 /** Get new reference to kernel object from capability
+ *
+ * The capability table is read without locking, see the comment at the top
+ * of this file.
  *
  * @param task    Task from which to get the reference.
  * @param handle  Capability handle.
@@ -447,19 +550,38 @@ void kobject_initialize(kobject_t *kobj, kobject_type_t type, void *raw)
 kobject_t *
 kobject_get(struct task *task, cap_handle_t handle, kobject_type_t type)
 {
-	kobject_t *kobj = NULL;
+	cap_slot_t *slot = cap_slot(task->cap_info, handle);
+	if (!slot)
+		return NULL;
 
-	mutex_lock(&task->cap_info->lock);
-	cap_t *cap = cap_get(task, handle, CAP_STATE_PUBLISHED);
-	if (cap) {
-		if (cap->kobject->type == type) {
-			kobj = cap->kobject;
-			atomic_inc(&kobj->refcnt);
+	while (true) {
+		kobject_t *kobj = atomic_load_explicit(&slot->kobject,
+		    memory_order_acquire);
+		if (!kobj)
+			return NULL;
+
+		if (!kobject_try_add_ref(kobj)) {
+			/* The object was unpublished and destroyed meanwhile. */
+			continue;
 		}
-	}
-	mutex_unlock(&task->cap_info->lock);
 
-	return kobj;
+		/*
+		 * The object might have been destroyed and its memory reused
+		 * for another kernel object before the reference was taken.
+		 */
+		if (atomic_load_explicit(&slot->kobject,
+		    memory_order_acquire) != kobj) {
+			kobject_put(kobj);
+			continue;
+		}
+
+		if (kobj->type != type) {
+			kobject_put(kobj);
+			return NULL;
+		}
+
+		return kobj;
+	}
 }
 
 /** Record new reference
@@ -36,6 +36,7 @@
  */
 
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
 #include <arch.h>
 #include <arch/cpu.h>
 #include <stdlib.h>
@@ -83,6 +84,29 @@ void cpu_init(void)
 			cpus[i].id = i;
 
 			irq_spinlock_initialize(&cpus[i].lock, "cpus[].lock");
+			irq_spinlock_initialize(&cpus[i].frame_cache.lock,
+			    "cpus[].frame_cache.lock");
+
+#ifdef CONFIG_SMP
+			cpus[i].tlb_requests = (atomic_size_t *)
+			    malloc(sizeof(atomic_size_t) * config.cpu_count);
+			cpus[i].tlb_acked = (size_t *)
+			    malloc(sizeof(size_t) * config.cpu_count);
+			cpus[i].tlb_processed = (size_t *)
+			    malloc(sizeof(size_t) * config.cpu_count);
+			cpus[i].tlb_shootdown.mask = (cpu_mask_t *)
+			    malloc(cpu_mask_size());
+			if ((!cpus[i].tlb_requests) || (!cpus[i].tlb_acked) ||
+			    (!cpus[i].tlb_processed) ||
+			    (!cpus[i].tlb_shootdown.mask))
+				panic("Cannot allocate TLB shootdown structures.");
+
+			for (size_t j = 0; j < config.cpu_count; j++) {
+				atomic_init(&cpus[i].tlb_requests[j], 0);
+				cpus[i].tlb_acked[j] = 0;
+				cpus[i].tlb_processed[j] = 0;
+			}
+#endif /* CONFIG_SMP */
 
 			for (unsigned int j = 0; j < RQ_COUNT; j++) {
 				irq_spinlock_initialize(&cpus[i].rq[j].lock, "cpus[].rq[].lock");
@@ -97,7 +121,6 @@ void cpu_init(void)
 	CPU = &cpus[config.cpu_active - 1];
 
 	CPU->active = true;
-	CPU->tlb_active = true;
 
 	CPU->idle = false;
 	CPU->last_cycle = get_cycle();
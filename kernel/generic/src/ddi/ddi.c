@@ -115,7 +115,8 @@ void ddi_parea_register(parea_t *parea)
  * @param bound Lowest virtual address bound.
  *
  * @return EOK on success.
- * @return EPERM if the caller lacks permissions to use this syscall.
+ * @return EPERM if the caller lacks permissions to use this syscall or
+ *         requests a writable mapping of a read-only physical area.
  * @return EBADMEM if phys is not page aligned.
  * @return ENOENT if there is no task matching the specified ID or
  *         the physical address space is not enabled for mapping.
@@ -158,6 +159,11 @@ _NO_TRACE static errno_t physmem_map(uintptr_t phys, size_t pages,
 			return EPERM;
 		}
 
+		if ((parea->rdonly) && (flags & AS_AREA_WRITE)) {
+			mutex_unlock(&pareas_lock);
+			return EPERM;
+		}
+
 		goto map;
 	}
 
@@ -434,7 +440,20 @@ _NO_TRACE static errno_t dmamem_map_anonymous(size_t size, uintptr_t constraint,
 		return EINVAL;
 
 	// FIXME: probably need to ensure that the memory is suitable for DMA
-	*phys = frame_alloc(frames, FRAME_ATOMIC, constraint);
+	*phys = 0;
+
+#ifdef LARGE_PAGE_SIZE
+	/*
+	 * Prefer memory aligned so that the area can be mapped by large pages.
+	 */
+	if (size >= LARGE_PAGE_SIZE) {
+		*phys = frame_alloc(frames, FRAME_ATOMIC | FRAME_NO_RECLAIM,
+		    constraint | (LARGE_PAGE_SIZE - 1));
+	}
+#endif
+
+	if (*phys == 0)
+		*phys = frame_alloc(frames, FRAME_ATOMIC, constraint);
 	if (*phys == 0)
 		return ENOMEM;
 
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_generic_debug
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Per-processor trace rings.
+ *
+ * Selected kernel events (thread switches, IPC, page faults, syscalls and
+ * exceptions) and timer-driven program counter samples are recorded as
+ * binary records into a ring of the processor on which they occurred. The
+ * rings live in a physical memory area which a privileged task can map
+ * using physmem_map(), so that the records can be read from userspace
+ * without copying. Recording is disabled until enabled using
+ * sys_tracebuf_control(), a disabled event costs a single test.
+ */
+
+#include <tracebuf.h>
+#include <align.h>
+#include <arch.h>
+#include <arch/asm.h>
+#include <arch/cycle.h>
+#include <barrier.h>
+#include <config.h>
+#include <cpu.h>
+#include <ddi/ddi.h>
+#include <errno.h>
+#include <log.h>
+#include <mem.h>
+#include <mm/frame.h>
+#include <proc/task.h>
+#include <proc/thread.h>
+#include <security/perm.h>
+#include <stdlib.h>
+#include <sysinfo/sysinfo.h>
+
+/** Number of records in the ring of each processor */
+#define TRACEBUF_RECORDS  4096
+
+/** Default number of clock ticks between program counter samples */
+#define TRACEBUF_SAMPLE_TICKS  1
+
+/** Processor-local sampling state */
+typedef struct {
+	/** State interrupted by the exception being handled or NULL */
+	istate_t *istate;
+	/** Clock ticks remaining until the next sample */
+	unsigned int countdown;
+} tracebuf_cpu_t;
+
+/** Enabled events, mirrored in the shared header */
+volatile uint32_t tracebuf_mask = 0;
+
+static tracebuf_header_t *tracebuf = NULL;
+static tracebuf_record_t *tracebuf_records;
+static tracebuf_cpu_t *tracebuf_cpus;
+
+/** Physical memory area of the trace buffer */
+static parea_t tracebuf_parea;
+
+/** Allocate the trace rings and publish them to userspace */
+void tracebuf_init(void)
+{
+	size_t hdr_size = ALIGN_UP(sizeof(tracebuf_header_t) +
+	    config.cpu_count * sizeof(tracebuf_ring_t), PAGE_SIZE);
+	size_t size = hdr_size + config.cpu_count * TRACEBUF_RECORDS *
+	    sizeof(tracebuf_record_t);
+	size_t frames = SIZE2FRAMES(size);
+
+	tracebuf_cpus = malloc(config.cpu_count * sizeof(tracebuf_cpu_t));
+	if (tracebuf_cpus == NULL) {
+		log(LF_OTHER, LVL_WARN, "Cannot allocate trace buffer.");
+		return;
+	}
+
+	uintptr_t faddr = frame_alloc(frames, FRAME_LOWMEM | FRAME_ATOMIC, 0);
+	if (faddr == 0) {
+		free(tracebuf_cpus);
+		log(LF_OTHER, LVL_WARN, "Cannot allocate trace buffer.");
+		return;
+	}
+
+	tracebuf_header_t *hdr = (tracebuf_header_t *) PA2KA(faddr);
+	memsetb(hdr, hdr_size, 0);
+
+	hdr->magic = TRACEBUF_MAGIC;
+	hdr->cpus = config.cpu_count;
+	hdr->records = TRACEBUF_RECORDS;
+	hdr->offset = hdr_size;
+	hdr->mask = 0;
+	hdr->sample_ticks = TRACEBUF_SAMPLE_TICKS;
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		tracebuf_cpus[i].istate = NULL;
+		tracebuf_cpus[i].countdown = TRACEBUF_SAMPLE_TICKS;
+	}
+
+	tracebuf_records = (tracebuf_record_t *) ((uint8_t *) hdr + hdr_size);
+	tracebuf = hdr;
+
+	ddi_parea_init(&tracebuf_parea);
+	tracebuf_parea.pbase = faddr;
+	tracebuf_parea.frames = frames;
+	tracebuf_parea.unpriv = false;
+	tracebuf_parea.mapped = false;
+	ddi_parea_register(&tracebuf_parea);
+
+	sysinfo_set_item_val("tracebuf.faddr", NULL, (sysarg_t) faddr);
+	sysinfo_set_item_val("tracebuf.pages", NULL, frames);
+}
+
+/** Record a trace event
+ *
+ * Use tracebuf_event() instead, which tests whether the event is enabled
+ * first.
+ *
+ * @param event  Trace event.
+ * @param arg1   First event argument.
+ * @param arg2   Second event argument.
+ */
+void tracebuf_record(tracebuf_event_t event, uint64_t arg1, uint32_t arg2)
+{
+	ipl_t ipl = interrupts_disable();
+
+	if ((tracebuf != NULL) && (CPU != NULL)) {
+		tracebuf_ring_t *ring = &tracebuf->rings[CPU->id];
+		uint64_t head = ring->head;
+
+		tracebuf_record_t *rec = &tracebuf_records[CPU->id *
+		    TRACEBUF_RECORDS + (head & (TRACEBUF_RECORDS - 1))];
+		rec->cycle = get_cycle();
+		rec->tid = (THREAD != NULL) ? THREAD->tid : 0;
+		rec->arg1 = arg1;
+		rec->arg2 = arg2;
+		rec->event = event;
+
+		/*
+		 * Publish the record only after the slot is written, so that
+		 * readers which see the new head also see the whole record.
+		 */
+		write_barrier();
+		ring->head = head + 1;
+	}
+
+	interrupts_restore(ipl);
+}
+
+/** Note the entry to an exception handler
+ *
+ * Called with interrupts disabled.
+ *
+ * @param n       Exception number.
+ * @param istate  Interrupted state.
+ */
+void tracebuf_exc_enter(unsigned int n, istate_t *istate)
+{
+	if ((tracebuf == NULL) || (CPU == NULL))
+		return;
+
+	tracebuf_event(TRACEBUF_IRQ, n, istate_from_uspace(istate));
+	tracebuf_cpus[CPU->id].istate = istate;
+}
+
+/** Note the exit from an exception handler
+ *
+ * Called with interrupts disabled.
+ */
+void tracebuf_exc_leave(void)
+{
+	if ((tracebuf == NULL) || (CPU == NULL))
+		return;
+
+	tracebuf_cpus[CPU->id].istate = NULL;
+}
+
+/** Take a program counter sample if one is due
+ *
+ * Called on each clock tick with interrupts disabled. The sample records
+ * the state interrupted by the clock interrupt.
+ */
+void tracebuf_tick(void)
+{
+	if ((tracebuf == NULL) || (!tracebuf_enabled(TRACEBUF_SAMPLE)))
+		return;
+
+	tracebuf_cpu_t *tcpu = &tracebuf_cpus[CPU->id];
+	if (tcpu->countdown > 1) {
+		tcpu->countdown--;
+		return;
+	}
+
+	tcpu->countdown = tracebuf->sample_ticks;
+
+	if (tcpu->istate != NULL) {
+		tracebuf_record(TRACEBUF_SAMPLE, istate_get_pc(tcpu->istate),
+		    istate_from_uspace(tcpu->istate));
+	}
+}
+
+/** Enable or disable recording of trace events
+ *
+ * @param mask          Events to record (TRACEBUF_MASK bits), zero
+ *                      disables recording.
+ * @param sample_ticks  Clock ticks between program counter samples,
+ *                      zero selects the default.
+ *
+ * @return EOK on success, EPERM if the caller is not allowed to read the
+ *         trace buffer, ENOTSUP if there is no trace buffer or EINVAL
+ *         if the mask is invalid.
+ */
+sys_errno_t sys_tracebuf_control(sysarg_t mask, sysarg_t sample_ticks)
+{
+	if ((perm_get(TASK) & PERM_MEM_MANAGER) != PERM_MEM_MANAGER)
+		return (sys_errno_t) EPERM;
+
+	if (tracebuf == NULL)
+		return (sys_errno_t) ENOTSUP;
+
+	if ((mask & ~((sysarg_t) TRACEBUF_MASK_ALL)) != 0)
+		return (sys_errno_t) EINVAL;
+
+	if (sample_ticks == 0)
+		sample_ticks = TRACEBUF_SAMPLE_TICKS;
+
+	tracebuf->sample_ticks = sample_ticks;
+	tracebuf->mask = mask;
+	tracebuf_mask = mask;
+
+	return (sys_errno_t) EOK;
+}
+
+/** @}
+ */
@@ -56,6 +56,7 @@
 #include <arch/stack.h>
 #include <str.h>
 #include <trace.h>
+#include <tracebuf.h>
 
 exc_table_t exc_table[IVT_ITEMS];
 IRQ_SPINLOCK_INITIALIZE(exctbl_lock);
@@ -128,8 +129,14 @@ _NO_TRACE void exc_dispatch(unsigned int n, istate_t *istate)
 		THREAD->udebug.uspace_state = istate;
 #endif
 
+	if (tracebuf_mask != 0)
+		tracebuf_exc_enter(n + IVT_FIRST, istate);
+
 	exc_table[n].handler(n + IVT_FIRST, istate);
 
+	if (tracebuf_mask != 0)
+		tracebuf_exc_leave();
+
 #ifdef CONFIG_UDEBUG
 	if (THREAD)
 		THREAD->udebug.uspace_state = NULL;
@@ -61,6 +61,7 @@
 #include <ipc/irq.h>
 #include <cap/cap.h>
 #include <stdlib.h>
+#include <tracebuf.h>
 
 static void ipc_forget_call(call_t *);
 
@@ -317,6 +318,9 @@ void _ipc_answer_free_call(call_t *call, bool selflocked)
 
 	call->data.task_id = TASK->taskid;
 
+	tracebuf_event(TRACEBUF_IPC_ANSWER,
+	    (sysarg_t) ipc_get_retval(&call->data), call->sender->taskid);
+
 	if (do_lock)
 		irq_spinlock_lock(&callerbox->lock, true);
 
@@ -411,6 +415,9 @@ static void _ipc_call(phone_t *phone, answerbox_t *box, call_t *call,
 	if (!(call->flags & IPC_CALL_FORWARDED))
 		_ipc_call_actions_internal(phone, call, preforget);
 
+	tracebuf_event(TRACEBUF_IPC_SEND, ipc_get_imethod(&call->data),
+	    box->task->taskid);
+
 	irq_spinlock_lock(&box->lock, true);
 	list_append(&call->ab_link, &box->calls);
 	irq_spinlock_unlock(&box->lock, true);
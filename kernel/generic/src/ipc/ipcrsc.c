@@ -85,7 +85,7 @@ errno_t phone_alloc(task_t *task, bool publish, cap_phone_handle_t *phandle,
 		if (!hcall) {
 			cap_free(TASK, handle);
 			slab_free(phone_cache, phone);
-			free(kobj);
+			kobject_free(kobj);
 			return ENOMEM;
 		}
 
@@ -58,6 +58,7 @@
 #include <mm/as.h>
 #include <mm/frame.h>
 #include <mm/km.h>
+#include <mm/zero_pool.h>
 #include <stdio.h>
 #include <log.h>
 #include <mem.h>
@@ -70,6 +71,7 @@
 #include <str.h>
 #include <sysinfo/stats.h>
 #include <sysinfo/sysinfo.h>
+#include <tracebuf.h>
 #include <align.h>
 #include <stdlib.h>
 
@@ -151,6 +153,12 @@ void kinit(void *arg)
 	 */
 	ARCH_OP(post_smp_init);
 
+	/* Start threads maintaining the pools of pre-zeroed frames */
+	zero_pool_init();
+
+	/* Allocate the trace rings now that all processors are known */
+	tracebuf_init();
+
 	/* Start thread computing system load */
 	thread = thread_create(kload, NULL, TASK, THREAD_FLAG_NONE,
 	    "kload");
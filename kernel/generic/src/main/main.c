@@ -77,6 +77,7 @@
 #include <mm/reserve.h>
 #include <synch/waitq.h>
 #include <synch/syswaitq.h>
+#include <synch/futex.h>
 #include <arch/arch.h>
 #include <arch.h>
 #include <arch/faddr.h>
@@ -277,6 +278,7 @@ void main_bsp_separated_stack(void)
 	task_init();
 	thread_init();
 	sys_waitq_init();
+	futex_init();
 
 	sysinfo_set_item_data("boot_args", NULL, bargs, str_size(bargs) + 1);
 
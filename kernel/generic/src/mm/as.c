@@ -58,6 +58,7 @@
 #include <genarch/mm/page_ht.h>
 #include <mm/asid.h>
 #include <arch/mm/asid.h>
+#include <cpu/cpu_mask.h>
 #include <preemption.h>
 #include <synch/spinlock.h>
 #include <synch/mutex.h>
@@ -80,6 +81,7 @@
 #include <arch/interrupt.h>
 #include <interrupt.h>
 #include <stdlib.h>
+#include <tracebuf.h>
 
 /**
  * Each architecture decides what functions will be used to carry out
@@ -118,7 +120,7 @@ as_t *AS_KERNEL = NULL;
 static void *as_areas_getkey(odlink_t *);
 static int as_areas_cmp(void *, void *);
 
-static void used_space_initialize(used_space_t *);
+static void used_space_initialize(used_space_t *, as_t *);
 static void used_space_finalize(used_space_t *);
 static void *used_space_getkey(odlink_t *);
 static int used_space_cmp(void *, void *);
@@ -172,6 +174,20 @@ as_t *as_create(unsigned int flags)
 	if (!as)
 		return NULL;
 
+	if (flags & FLAG_AS_KERNEL) {
+		as->cpu_mask = NULL;
+	} else {
+		as->cpu_mask = (cpu_mask_t *) malloc(cpu_mask_size());
+		if (!as->cpu_mask) {
+			slab_free(as_cache, as);
+			return NULL;
+		}
+
+		cpu_mask_none(as->cpu_mask);
+	}
+
+	as->tlb_shootdown = 0;
+
 	(void) as_create_arch(as, 0);
 
 	odict_initialize(&as->as_areas, as_areas_getkey, as_areas_cmp);
@@ -184,6 +200,9 @@ as_t *as_create(unsigned int flags)
 	refcount_init(&as->refcount);
 	as->cpu_refcount = 0;
 
+	atomic_store(&as->virt_pages, 0);
+	atomic_store(&as->resident_pages, 0);
+
 #ifdef AS_PAGE_TABLE
 	as->genarch.page_table = page_table_create(flags);
 #else
@@ -269,6 +288,7 @@ retry:
 	page_table_destroy(NULL);
 #endif
 
+	free(as->cpu_mask);
 	slab_free(as_cache, as);
 }
 
@@ -459,7 +479,7 @@ _NO_TRACE static bool check_area_conflicts(as_t *as, uintptr_t addr,
 	return true;
 }
 
-/** Return pointer to unmapped address space area
+/** Return pointer to unmapped address space area with aligned start
  *
  * The address space must be already locked when calling
  * this function.
@@ -468,13 +488,14 @@ _NO_TRACE static bool check_area_conflicts(as_t *as, uintptr_t addr,
  * @param bound   Lowest address bound.
  * @param size    Requested size of the allocation.
  * @param guarded True if the allocation must be protected by guard pages.
+ * @param align   Alignment of the start address (multiple of PAGE_SIZE).
  *
  * @return Address of the beginning of unmapped address space area.
  * @return -1 if no suitable address space area was found.
  *
  */
-_NO_TRACE static uintptr_t as_get_unmapped_area(as_t *as, uintptr_t bound,
-    size_t size, bool guarded)
+_NO_TRACE static uintptr_t as_get_unmapped_area_aligned(as_t *as,
+    uintptr_t bound, size_t size, bool guarded, size_t align)
 {
 	assert(mutex_locked(&as->lock));
 
@@ -495,16 +516,17 @@ _NO_TRACE static uintptr_t as_get_unmapped_area(as_t *as, uintptr_t bound,
 	 */
 
 	/* First check the bound address itself */
-	uintptr_t addr = ALIGN_UP(bound, PAGE_SIZE);
-	if (addr >= bound) {
-		if (guarded) {
-			/*
-			 * Leave an unmapped page between the lower
-			 * bound and the area's start address.
-			 */
-			addr += P2SZ(1);
-		}
+	uintptr_t addr = bound;
+	if (guarded) {
+		/*
+		 * Leave an unmapped page between the lower
+		 * bound and the area's start address.
+		 */
+		addr += P2SZ(1);
+	}
 
+	addr = ALIGN_UP(addr, align);
+	if (addr >= bound) {
 		if (check_area_conflicts(as, addr, pages, guarded, NULL))
 			return addr;
 	}
@@ -524,6 +546,8 @@ _NO_TRACE static uintptr_t as_get_unmapped_area(as_t *as, uintptr_t bound,
 			addr += P2SZ(1);
 		}
 
+		addr = ALIGN_UP(addr, align);
+
 		bool avail =
 		    ((addr >= bound) && (addr >= area->base) &&
 		    (check_area_conflicts(as, addr, pages, guarded, area)));
@@ -540,6 +564,39 @@ _NO_TRACE static uintptr_t as_get_unmapped_area(as_t *as, uintptr_t bound,
 	return (uintptr_t) -1;
 }
 
+/** Return pointer to unmapped address space area
+ *
+ * Areas large enough to be mapped by large pages are preferably
+ * placed at addresses aligned to LARGE_PAGE_SIZE.
+ *
+ * The address space must be already locked when calling
+ * this function.
+ *
+ * @param as      Address space.
+ * @param bound   Lowest address bound.
+ * @param size    Requested size of the allocation.
+ * @param guarded True if the allocation must be protected by guard pages.
+ *
+ * @return Address of the beginning of unmapped address space area.
+ * @return -1 if no suitable address space area was found.
+ *
+ */
+_NO_TRACE static uintptr_t as_get_unmapped_area(as_t *as, uintptr_t bound,
+    size_t size, bool guarded)
+{
+#ifdef LARGE_PAGE_SIZE
+	if (size >= LARGE_PAGE_SIZE) {
+		uintptr_t addr = as_get_unmapped_area_aligned(as, bound, size,
+		    guarded, LARGE_PAGE_SIZE);
+		if (addr != (uintptr_t) -1)
+			return addr;
+	}
+#endif
+
+	return as_get_unmapped_area_aligned(as, bound, size, guarded,
+	    PAGE_SIZE);
+}
+
 /** Get key function for pagemap ordered dictionary.
  *
  * The key is the virtual address of the page (as_page_mapping_t.vaddr)
@@ -843,8 +900,9 @@ as_area_t *as_area_create(as_t *as, unsigned int flags, size_t size,
 		}
 	}
 
-	used_space_initialize(&area->used_space);
+	used_space_initialize(&area->used_space, as);
 	odict_insert(&area->las_areas, &as->as_areas, NULL);
+	atomic_fetch_add(&as->virt_pages, pages);
 
 	mutex_unlock(&as->lock);
 
@@ -950,13 +1008,18 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 
 		page_table_lock(as, false);
 
+		/*
+		 * A large page crossing the new end of the area has to be
+		 * mapped by small pages before the shootdown starts.
+		 */
+		page_mapping_split_large(as, start_free);
+
 		/*
 		 * Start TLB shootdown sequence.
 		 */
 
-		ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES,
-		    as->asid, area->base + P2SZ(pages),
-		    area->pages - pages);
+		ipl_t ipl = tlb_shootdown_start_as(as,
+		    area->base + P2SZ(pages), area->pages - pages);
 
 		/*
 		 * Remove frames belonging to used space starting from
@@ -1071,6 +1134,11 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 		}
 	}
 
+	if (pages > area->pages)
+		atomic_fetch_add(&as->virt_pages, pages - area->pages);
+	else
+		atomic_fetch_sub(&as->virt_pages, area->pages - pages);
+
 	area->pages = pages;
 
 	mutex_unlock(&area->lock);
@@ -1102,10 +1170,10 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 
 	page_table_lock(as, false);
 	/*
-	 * Start TLB shootdown sequence.
+	 * Start TLB shootdown sequence. Only the pages mapped by used_space
+	 * are invalidated, their intervals are added to the sequence below.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
-	    area->pages);
+	ipl_t ipl = tlb_shootdown_start_as(as, 0, 0);
 
 	/*
 	 * Visit only the pages mapped by used_space.
@@ -1134,6 +1202,9 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 			page_mapping_remove(as, ptr + P2SZ(size));
 		}
 
+		tlb_shootdown_add(TLB_INVL_PAGES, as->asid, ptr, ival->count);
+		tlb_invalidate_pages(as->asid, ptr, ival->count);
+
 		used_space_remove_ival(ival);
 		ival = used_space_first(&area->used_space);
 	}
@@ -1142,8 +1213,6 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 	 * Finish TLB shootdown sequence.
 	 */
 
-	tlb_invalidate_pages(as->asid, area->base, area->pages);
-
 	/*
 	 * Invalidate potential software translation caches
 	 * (e.g. TSB on sparc64, PHT on ppc32).
@@ -1163,6 +1232,7 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 	 * Remove the empty area from address space.
 	 */
 	odict_remove(&area->las_areas);
+	atomic_fetch_sub(&as->virt_pages, area->pages);
 
 	free(area);
 
@@ -1404,8 +1474,7 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
-	    area->pages);
+	ipl_t ipl = tlb_shootdown_start_as(as, area->base, area->pages);
 
 	/*
 	 * Remove used pages from page tables and remember their frame
@@ -1514,6 +1583,8 @@ int as_page_fault(uintptr_t address, pf_access_t access, istate_t *istate)
 	uintptr_t page = ALIGN_DOWN(address, PAGE_SIZE);
 	int rc = AS_PF_FAULT;
 
+	tracebuf_event(TRACEBUF_PAGE_FAULT, address, access);
+
 	if (!THREAD)
 		goto page_fault;
 
@@ -1637,6 +1708,20 @@ retry:
 		DEADLOCK_PROBE(p_asidlock, DEADLOCK_THRESHOLD);
 		goto retry;
 	}
+
+	if ((new_as->tlb_shootdown > 0) &&
+	    (!cpu_mask_is_set(new_as->cpu_mask, CPU->id))) {
+		/*
+		 * A TLB shootdown which does not target this
+		 * processor is in progress in the new address
+		 * space. Wait for it to finish, otherwise we
+		 * could cache stale translations.
+		 */
+		spinlock_unlock(&asidlock);
+		(void) interrupts_enable();
+		DEADLOCK_PROBE(p_asidlock, DEADLOCK_THRESHOLD);
+		goto retry;
+	}
 	preemption_enable();
 
 	/*
@@ -1663,6 +1748,15 @@ retry:
 		 * is being removed from the CPU.
 		 */
 		as_deinstall_arch(old_as);
+
+#ifdef AS_SWITCH_FLUSHES_TLB
+		/*
+		 * Switching the address space flushes its TLB entries,
+		 * so this processor no longer needs its TLB shootdowns.
+		 */
+		if (old_as->cpu_mask)
+			cpu_mask_reset(old_as->cpu_mask, CPU->id);
+#endif
 	}
 
 	/*
@@ -1675,6 +1769,9 @@ retry:
 			new_as->asid = asid_get();
 	}
 
+	if (new_as->cpu_mask)
+		cpu_mask_set(new_as->cpu_mask, CPU->id);
+
 #ifdef AS_PAGE_TABLE
 	SET_PTL0_ADDRESS(new_as->genarch.page_table);
 #endif
@@ -1704,6 +1801,34 @@ _NO_TRACE unsigned int as_area_get_flags(as_area_t *area)
 	return area_flags_to_page_flags(area->flags);
 }
 
+#ifdef LARGE_PAGE_SIZE
+
+/** Check whether a large page can be mapped in an address space area.
+ *
+ * The large page must lie completely within the area and none of its
+ * pages may be mapped yet.
+ *
+ * @param area Address space area.
+ * @param page Virtual address of the large page.
+ *
+ * @return True if the large page can be mapped.
+ *
+ */
+_NO_TRACE bool as_area_large_page_usable(as_area_t *area, uintptr_t page)
+{
+	assert(mutex_locked(&area->lock));
+	assert(IS_ALIGNED(page, LARGE_PAGE_SIZE));
+
+	if ((page < area->base) ||
+	    (page - area->base + LARGE_PAGE_SIZE > P2SZ(area->pages)))
+		return false;
+
+	used_space_ival_t *ival = used_space_find_gteq(&area->used_space, page);
+	return (ival == NULL) || (ival->page >= page + LARGE_PAGE_SIZE);
+}
+
+#endif
+
 /** Get key function for the @c as_t.as_areas ordered dictionary.
  *
  * @param odlink Link
@@ -1843,14 +1968,41 @@ size_t as_area_get_size(uintptr_t base)
 	return size;
 }
 
+/** Check whether an address belongs to an area with the given flags.
+ *
+ * @param as    Address space.
+ * @param va    Virtual address.
+ * @param flags Flags of the AS_AREA_* family the area must have.
+ *
+ * @return True if va belongs to an address space area which has
+ *         all the flags.
+ *
+ */
+bool as_area_check_flags(as_t *as, uintptr_t va, unsigned int flags)
+{
+	mutex_lock(&as->lock);
+
+	as_area_t *area = find_area_and_lock(as, va);
+	bool valid = false;
+	if (area) {
+		valid = ((area->flags & flags) == flags);
+		mutex_unlock(&area->lock);
+	}
+
+	mutex_unlock(&as->lock);
+	return valid;
+}
+
 /** Initialize used space map.
  *
  * @param used_space Used space map
+ * @param as         Address space of the area
  */
-static void used_space_initialize(used_space_t *used_space)
+static void used_space_initialize(used_space_t *used_space, as_t *as)
 {
 	odict_initialize(&used_space->ivals, used_space_getkey, used_space_cmp);
 	used_space->pages = 0;
+	used_space->as = as;
 }
 
 /** Finalize used space map.
@@ -1995,6 +2147,7 @@ static int used_space_cmp(void *a, void *b)
 static void used_space_remove_ival(used_space_ival_t *ival)
 {
 	ival->used_space->pages -= ival->count;
+	atomic_fetch_sub(&ival->used_space->as->resident_pages, ival->count);
 	odict_remove(&ival->lused_space);
 	slab_free(used_space_ival_cache, ival);
 }
@@ -2010,6 +2163,8 @@ static void used_space_shorten_ival(used_space_ival_t *ival, size_t count)
 	assert(count < ival->count);
 
 	ival->used_space->pages -= ival->count - count;
+	atomic_fetch_sub(&ival->used_space->as->resident_pages,
+	    ival->count - count);
 	ival->count = count;
 }
 
@@ -2060,9 +2215,13 @@ bool used_space_insert(used_space_t *used_space, uintptr_t page, size_t count)
 	adj_b = (b != NULL) && page + P2SZ(count) == b->page;
 
 	if (adj_a && adj_b) {
-		/* Fuse into a single interval */
+		/*
+		 * Fuse into a single interval. The pages of B stay used,
+		 * so do not account for them as removed.
+		 */
 		a->count += count + b->count;
-		used_space_remove_ival(b);
+		odict_remove(&b->lused_space);
+		slab_free(used_space_ival_cache, b);
 	} else if (adj_a) {
 		/* Append to A */
 		a->count += count;
@@ -2083,6 +2242,7 @@ bool used_space_insert(used_space_t *used_space, uintptr_t page, size_t count)
 	}
 
 	used_space->pages += count;
+	atomic_fetch_add(&used_space->as->resident_pages, count);
 	return true;
 }
 
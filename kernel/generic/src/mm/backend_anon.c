@@ -45,6 +45,7 @@
 #include <mm/frame.h>
 #include <mm/slab.h>
 #include <mm/km.h>
+#include <mm/zero_pool.h>
 #include <synch/mutex.h>
 #include <adt/list.h>
 #include <errno.h>
@@ -53,6 +54,9 @@
 #include <mem.h>
 #include <arch.h>
 
+/** Maximum number of pages mapped ahead of a sequential page fault. */
+#define ANON_FAULT_AROUND  8
+
 static bool anon_create(as_area_t *);
 static bool anon_resize(as_area_t *, size_t);
 static void anon_share(as_area_t *);
@@ -82,6 +86,8 @@ mem_backend_t anon_backend = {
 
 bool anon_create(as_area_t *area)
 {
+	area->backend_data.fault_hint = 0;
+
 	if (area->flags & AS_AREA_LATE_RESERVE)
 		return true;
 
@@ -170,6 +176,143 @@ bool anon_is_shareable(as_area_t *area)
 	return !(area->flags & AS_AREA_LATE_RESERVE);
 }
 
+/** Allocate a zeroed frame for an anonymous page.
+ *
+ * The frame is preferably taken from the pool of pre-zeroed frames. The
+ * memory must have been already reserved by the caller.
+ *
+ * @param flags FRAME_ATOMIC or zero.
+ *
+ * @return Physical address of the frame or 0 if FRAME_ATOMIC was specified
+ *         and there is no free frame.
+ */
+static uintptr_t anon_frame_alloc(frame_flags_t flags)
+{
+	uintptr_t frame = zero_pool_frame_get();
+	if (frame != 0)
+		return frame;
+
+	uintptr_t kpage = km_temporary_page_get(&frame,
+	    FRAME_NO_RESERVE | flags);
+	if (frame == 0)
+		return 0;
+
+	memsetb((void *) kpage, PAGE_SIZE, 0);
+	km_temporary_page_put(kpage);
+
+	return frame;
+}
+
+/** Map pages following a sequentially faulting page in advance.
+ *
+ * If the page fault at @a upage continues a run of faults on consecutive
+ * pages, up to ANON_FAULT_AROUND following pages which are not mapped yet
+ * are mapped as well. This saves page faults for areas which are touched
+ * sequentially, such as a growing heap.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param area Pointer to the private address space area.
+ * @param upage Page which has just been mapped.
+ */
+static void anon_fault_around(as_area_t *area, uintptr_t upage)
+{
+	uintptr_t hint = area->backend_data.fault_hint;
+	area->backend_data.fault_hint = upage + PAGE_SIZE;
+
+	if (upage != hint)
+		return;
+
+	size_t count = ANON_FAULT_AROUND;
+	uintptr_t start = upage + PAGE_SIZE;
+	uintptr_t end = area->base + P2SZ(area->pages);
+
+	if (start >= end)
+		return;
+	if (count > (end - start) >> PAGE_WIDTH)
+		count = (end - start) >> PAGE_WIDTH;
+
+	/* Do not run into pages which are already mapped. */
+	used_space_ival_t *ival = used_space_find_gteq(&area->used_space,
+	    start);
+	if ((ival != NULL) && (ival->page < start + P2SZ(count)))
+		count = (ival->page - start) >> PAGE_WIDTH;
+
+	unsigned int flags = as_area_get_flags(area);
+	size_t i;
+	for (i = 0; i < count; i++) {
+		if (area->flags & AS_AREA_LATE_RESERVE) {
+			if (!reserve_try_alloc_noreclaim(1))
+				break;
+		}
+
+		uintptr_t frame = anon_frame_alloc(FRAME_ATOMIC);
+		if (frame == 0) {
+			if (area->flags & AS_AREA_LATE_RESERVE)
+				reserve_free(1);
+			break;
+		}
+
+		page_mapping_insert(AS, start + P2SZ(i), frame, flags);
+	}
+
+	if (i == 0)
+		return;
+
+	if (!used_space_insert(&area->used_space, start, i))
+		panic("Cannot insert used space.");
+
+	area->backend_data.fault_hint = start + P2SZ(i);
+}
+
+#ifdef LARGE_PAGE_SIZE
+
+/** Try to service a page fault in a private anonymous area by a large page.
+ *
+ * Only areas whose memory is reserved in advance are mapped by large pages.
+ * If the large page does not fit into the area, some of its pages are
+ * already mapped or there is no free aligned run of frames, the caller
+ * falls back to small pages.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param area Pointer to the address space area.
+ * @param upage Faulting virtual page.
+ *
+ * @return True if the large page containing upage has been mapped.
+ */
+static bool anon_page_fault_large(as_area_t *area, uintptr_t upage)
+{
+	uintptr_t lpage = ALIGN_DOWN(upage, LARGE_PAGE_SIZE);
+
+	if (area->flags & AS_AREA_LATE_RESERVE)
+		return false;
+
+	if (!as_area_large_page_usable(area, lpage))
+		return false;
+
+	uintptr_t frame = frame_alloc(LARGE_PAGE_FRAMES, FRAME_LOWMEM |
+	    FRAME_ATOMIC | FRAME_NO_RECLAIM | FRAME_NO_RESERVE,
+	    LARGE_PAGE_SIZE - 1);
+	if (frame == 0)
+		return false;
+
+	memsetb((void *) PA2KA(frame), LARGE_PAGE_SIZE, 0);
+
+	if (!page_mapping_insert_large(AS, lpage, frame,
+	    as_area_get_flags(area))) {
+		frame_free_noreserve(frame, LARGE_PAGE_FRAMES);
+		return false;
+	}
+
+	if (!used_space_insert(&area->used_space, lpage, LARGE_PAGE_FRAMES))
+		panic("Cannot insert used space.");
+
+	return true;
+}
+
+#endif /* LARGE_PAGE_SIZE */
+
 /** Service a page fault in the anonymous memory address space area.
  *
  * The address space area and page tables must be already locked.
@@ -183,7 +326,6 @@ bool anon_is_shareable(as_area_t *area)
  */
 int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 {
-	uintptr_t kpage;
 	uintptr_t frame;
 
 	assert(page_table_locked(AS));
@@ -206,10 +348,7 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		    upage - area->base, &frame);
 		if (rc != EOK) {
 			/* Need to allocate the frame */
-			kpage = km_temporary_page_get(&frame,
-			    FRAME_NO_RESERVE);
-			memsetb((void *) kpage, PAGE_SIZE, 0);
-			km_temporary_page_put(kpage);
+			frame = anon_frame_alloc(0);
 
 			/*
 			 * Insert the address of the newly allocated
@@ -236,6 +375,13 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		 *   the different causes
 		 */
 
+#ifdef LARGE_PAGE_SIZE
+		if (anon_page_fault_large(area, upage)) {
+			mutex_unlock(&area->sh_info->lock);
+			return AS_PF_OK;
+		}
+#endif
+
 		if (area->flags & AS_AREA_LATE_RESERVE) {
 			/*
 			 * Reserve the memory for this page now.
@@ -246,10 +392,9 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 			}
 		}
 
-		kpage = km_temporary_page_get(&frame, FRAME_NO_RESERVE);
-		memsetb((void *) kpage, PAGE_SIZE, 0);
-		km_temporary_page_put(kpage);
+		frame = anon_frame_alloc(0);
 	}
+	bool shared = area->sh_info->shared;
 	mutex_unlock(&area->sh_info->lock);
 
 	/*
@@ -261,6 +406,9 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	if (!used_space_insert(&area->used_space, upage, 1))
 		panic("Cannot insert used space.");
 
+	if (!shared)
+		anon_fault_around(area, upage);
+
 	return AS_PF_OK;
 }
 
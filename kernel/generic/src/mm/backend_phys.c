@@ -139,6 +139,28 @@ int phys_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		return AS_PF_FAULT;
 
 	assert(upage - area->base < area->backend_data.frames * FRAME_SIZE);
+
+#ifdef LARGE_PAGE_SIZE
+	/*
+	 * Map the whole large page at once if it fits into the area and
+	 * the physical memory behind it is suitably aligned.
+	 */
+	uintptr_t lpage = ALIGN_DOWN(upage, LARGE_PAGE_SIZE);
+	if ((lpage >= area->base) &&
+	    (lpage - area->base + LARGE_PAGE_SIZE <=
+	    area->backend_data.frames * FRAME_SIZE) &&
+	    (IS_ALIGNED(base + (lpage - area->base), LARGE_PAGE_SIZE)) &&
+	    (as_area_large_page_usable(area, lpage)) &&
+	    (page_mapping_insert_large(AS, lpage, base + (lpage - area->base),
+	    as_area_get_flags(area)))) {
+		if (!used_space_insert(&area->used_space, lpage,
+		    LARGE_PAGE_FRAMES))
+			panic("Cannot insert used space.");
+
+		return AS_PF_OK;
+	}
+#endif
+
 	page_mapping_insert(AS, upage, base + (upage - area->base),
 	    as_area_get_flags(area));
 
@@ -38,6 +38,12 @@
  *
  * This file contains the physical frame allocator and memory zone management.
  * The frame allocator is built on top of the two-level bitmap structure.
+ * Each zone additionally keeps an index of naturally aligned free blocks,
+ * which is used to quickly find room for multi-frame allocations, and
+ * each CPU caches a few free frames to serve single-frame allocations
+ * without contending for the zones lock. Single frames being freed are
+ * put into the cache under the zones lock, which protects the zone
+ * lookup and the reference count, but skip the bitmap and index update.
  *
  */
 
@@ -61,6 +67,7 @@
 #include <config.h>
 #include <str.h>
 #include <proc/thread.h> /* THREAD */
+#include <cpu.h>
 
 zones_t zones;
 
@@ -73,6 +80,8 @@ static condvar_t mem_avail_cv;
 static size_t mem_avail_req = 0;  /**< Number of frames requested. */
 static size_t mem_avail_gen = 0;  /**< Generation counter. */
 
+_NO_TRACE static size_t frame_cache_count(size_t);
+
 /** Initialize frame structure.
  *
  * @param frame Frame structure to be initialized.
@@ -161,7 +170,7 @@ _NO_TRACE static size_t frame_total_free_get_internal(void)
 	size_t i;
 
 	for (i = 0; i < zones.count; i++)
-		total += zones.info[i].free_count;
+		total += zones.info[i].free_count + frame_cache_count(i);
 
 	return total;
 }
@@ -209,6 +218,189 @@ _NO_TRACE size_t find_zone(pfn_t frame, size_t count, size_t hint)
 	return (size_t) -1;
 }
 
+/** Get number of blocks of given order which overlap a zone.
+ *
+ * @param base  Base frame of the zone.
+ * @param count Number of frames of the zone.
+ * @param order Order of the blocks.
+ *
+ * @return Number of blocks.
+ *
+ */
+_NO_TRACE static size_t zone_index_elements(pfn_t base, size_t count,
+    unsigned int order)
+{
+	if (count == 0)
+		return 0;
+
+	return ((base + count - 1) >> order) - (base >> order) + 1;
+}
+
+/** Initialize the free block index of a zone.
+ *
+ * The base and size of the zone must be already set. All blocks
+ * are marked busy.
+ *
+ * @param zone Zone whose index is to be initialized.
+ * @param data Memory used to hold the index.
+ *
+ */
+_NO_TRACE static void zone_index_initialize(zone_t *zone, void *data)
+{
+	for (unsigned int order = 1; order <= ZONE_INDEX_ORDERS; order++) {
+		size_t elements = zone_index_elements(zone->base, zone->count,
+		    order);
+
+		bitmap_initialize(&zone->index[order - 1], elements, data);
+		bitmap_clear_range(&zone->index[order - 1], 0, elements);
+
+		data += bitmap_size(elements);
+	}
+}
+
+/** Check whether an aligned block of frames is free.
+ *
+ * @param zone  Zone to examine.
+ * @param order Order of the block.
+ * @param block Number of the block (i.e. its first frame number
+ *              shifted right by the order).
+ *
+ * @return True if the block lies within the zone and is free.
+ *
+ */
+_NO_TRACE static bool zone_block_free(zone_t *zone, unsigned int order,
+    pfn_t block)
+{
+	if (order == 0) {
+		if ((block < zone->base) || (block >= zone->base + zone->count))
+			return false;
+
+		return !bitmap_get(&zone->bitmap, block - zone->base);
+	}
+
+	pfn_t first = zone->base >> order;
+	if (block < first)
+		return false;
+
+	return bitmap_get(&zone->index[order - 1], block - first);
+}
+
+/** Update the free block index after a change of the frame bitmap.
+ *
+ * @param zone  Zone whose index is to be updated.
+ * @param index Index of the first changed frame in the zone.
+ * @param count Number of changed frames.
+ *
+ */
+_NO_TRACE static void zone_index_update(zone_t *zone, size_t index,
+    size_t count)
+{
+	if (count == 0)
+		return;
+
+	pfn_t start = zone->base + index;
+	pfn_t end = start + count - 1;
+
+	for (unsigned int order = 1; order <= ZONE_INDEX_ORDERS; order++) {
+		pfn_t first = zone->base >> order;
+
+		for (pfn_t block = start >> order; block <= (end >> order);
+		    block++) {
+			bool free =
+			    zone_block_free(zone, order - 1, block << 1) &&
+			    zone_block_free(zone, order - 1, (block << 1) + 1);
+
+			bitmap_set(&zone->index[order - 1], block - first, free);
+		}
+	}
+}
+
+/** Find the first set bit in a range of a bitmap.
+ *
+ * @param bitmap Bitmap to search.
+ * @param start  First bit of the range.
+ * @param end    First bit after the range.
+ *
+ * @return Index of the set bit or -1 if there is none.
+ *
+ */
+_NO_TRACE static size_t zone_index_scan(bitmap_t *bitmap, size_t start,
+    size_t end)
+{
+	size_t i = start;
+
+	while (i < end) {
+		if (((i & BITMAP_REMAINER) == 0) &&
+		    (end - i >= BITMAP_ELEMENT) &&
+		    (bitmap->bits[i / BITMAP_ELEMENT] == 0)) {
+			i += BITMAP_ELEMENT;
+			continue;
+		}
+
+		if (bitmap_get(bitmap, i))
+			return i;
+
+		i++;
+	}
+
+	return (size_t) -1;
+}
+
+/** Find free frames using the free block index.
+ *
+ * The smallest naturally aligned block which can hold the frames and
+ * satisfy the alignment implied by the constraint is looked up. Blocks
+ * with low-priority memory are preferred. Single frames and constraints
+ * other than alignment are not handled by the index.
+ *
+ * @param zone       Zone to search.
+ * @param count      Number of free frames we are trying to find.
+ * @param constraint Indication of bits that cannot be set in the
+ *                   physical frame number of the first allocated frame.
+ * @param index      Place to store the index of the first frame in the
+ *                   zone. Can be NULL.
+ *
+ * @return True if a suitable block has been found.
+ *
+ */
+_NO_TRACE static bool zone_index_find(zone_t *zone, size_t count,
+    pfn_t constraint, size_t *index)
+{
+	if (count < 2)
+		return false;
+
+	if (((constraint & (constraint + 1)) != 0) || (constraint + 1 == 0))
+		return false;
+
+	unsigned int order = fnzb(count - 1) + 1;
+	if (constraint != 0)
+		order = max(order, (unsigned int) fnzb(constraint + 1));
+
+	if (order > ZONE_INDEX_ORDERS)
+		return false;
+
+	bitmap_t *level = &zone->index[order - 1];
+	pfn_t first = zone->base >> order;
+
+	/* Start searching at the first block of low-priority memory. */
+	size_t start = 0;
+	pfn_t lowprio = ALIGN_UP(FRAME_LOWPRIO, ((pfn_t) 1) << order) >> order;
+	if (lowprio > first)
+		start = min(lowprio - first, level->elements);
+
+	size_t i = zone_index_scan(level, start, level->elements);
+	if (i == (size_t) -1)
+		i = zone_index_scan(level, 0, start);
+
+	if (i == (size_t) -1)
+		return false;
+
+	if (index != NULL)
+		*index = ((first + i) << order) - zone->base;
+
+	return true;
+}
+
 /** @return True if zone can allocate specified number of frames */
 _NO_TRACE static bool zone_can_alloc(zone_t *zone, size_t count,
     pfn_t constraint)
@@ -218,9 +410,14 @@ _NO_TRACE static bool zone_can_alloc(zone_t *zone, size_t count,
 	 * the bitmap if the last argument is NULL.
 	 */
 
-	return ((zone->flags & ZONE_AVAILABLE) &&
-	    bitmap_allocate_range(&zone->bitmap, count, zone->base,
-	    FRAME_LOWPRIO, constraint, NULL));
+	if (!(zone->flags & ZONE_AVAILABLE))
+		return false;
+
+	if (zone_index_find(zone, count, constraint, NULL))
+		return true;
+
+	return bitmap_allocate_range(&zone->bitmap, count, zone->base,
+	    FRAME_LOWPRIO, constraint, NULL);
 }
 
 /** Find a zone that can allocate specified number of frames
@@ -269,6 +466,126 @@ _NO_TRACE static bool is_high_priority(pfn_t base, size_t count)
 	return (base + count <= FRAME_LOWPRIO);
 }
 
+/*************************/
+/* Frame cache functions */
+/*************************/
+
+/** Get kind of per-CPU frame cache for frames of a zone. */
+_NO_TRACE static unsigned int frame_cache_kind(zone_t *zone)
+{
+	return (zone->flags & ZONE_HIGHMEM) ? 1 : 0;
+}
+
+/** Count frames of a zone held by the per-CPU frame caches.
+ *
+ * Assume interrupts are disabled and zones lock is
+ * locked.
+ *
+ * @param znum Zone number.
+ *
+ * @return Number of cached frames belonging to the zone.
+ *
+ */
+_NO_TRACE static size_t frame_cache_count(size_t znum)
+{
+	if (cpus == NULL)
+		return 0;
+
+	zone_t *zone = &zones.info[znum];
+	unsigned int kind = frame_cache_kind(zone);
+	size_t cached = 0;
+
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		frame_cache_t *cache = &cpus[i].frame_cache;
+
+		irq_spinlock_lock(&cache->lock, false);
+
+		for (size_t j = 0; j < cache->count[kind]; j++) {
+			pfn_t pfn = cache->pfn[kind][j];
+
+			if ((pfn >= zone->base) &&
+			    (pfn < zone->base + zone->count))
+				cached++;
+		}
+
+		irq_spinlock_unlock(&cache->lock, false);
+	}
+
+	return cached;
+}
+
+/** Take a free frame from the cache of the current CPU.
+ *
+ * @param highmem True if a frame from high memory is preferred.
+ *                Frames from low memory are returned otherwise.
+ * @param pfn     Place to store the frame number.
+ *
+ * @return True if a cached frame has been found.
+ *
+ */
+_NO_TRACE static bool frame_cache_get(bool highmem, pfn_t *pfn)
+{
+	bool found = false;
+
+	ipl_t ipl = interrupts_disable();
+
+	if (CPU != NULL) {
+		frame_cache_t *cache = &CPU->frame_cache;
+
+		irq_spinlock_lock(&cache->lock, false);
+
+		/* Fall back to low memory the same way try_find_zone() does. */
+		for (int kind = highmem ? 1 : 0; kind >= 0; kind--) {
+			if (cache->count[kind] > 0) {
+				*pfn = cache->pfn[kind][--cache->count[kind]];
+				found = true;
+				break;
+			}
+		}
+
+		irq_spinlock_unlock(&cache->lock, false);
+	}
+
+	interrupts_restore(ipl);
+
+	return found;
+}
+
+/** Put a frame being freed to the cache of the current CPU.
+ *
+ * High priority memory is never cached, so that it is available
+ * for allocations which require it.
+ *
+ * Assume interrupts are disabled and zones lock is
+ * locked.
+ *
+ * @param zone Zone containing the frame.
+ * @param pfn  Frame number.
+ *
+ * @return True if the frame has been cached.
+ *
+ */
+_NO_TRACE static bool frame_cache_put(zone_t *zone, pfn_t pfn)
+{
+	if ((CPU == NULL) || (is_high_priority(pfn, 1)))
+		return false;
+
+	frame_cache_t *cache = &CPU->frame_cache;
+	unsigned int kind = frame_cache_kind(zone);
+	bool cached = false;
+
+	irq_spinlock_lock(&cache->lock, false);
+
+	if (cache->count[kind] < FRAME_CACHE_SIZE) {
+		cache->pfn[kind][cache->count[kind]++] = pfn;
+		cached = true;
+	}
+
+	irq_spinlock_unlock(&cache->lock, false);
+
+	return cached;
+}
+
 /** Find a zone that can allocate specified number of frames
  *
  * This function ignores zones that contain only high-priority
@@ -372,12 +689,18 @@ _NO_TRACE static size_t zone_frame_alloc(zone_t *zone, size_t count,
 
 	/* Allocate frames from zone */
 	size_t index = (size_t) -1;
-	int avail = bitmap_allocate_range(&zone->bitmap, count, zone->base,
-	    FRAME_LOWPRIO, constraint, &index);
+	if (zone_index_find(zone, count, constraint, &index)) {
+		bitmap_set_range(&zone->bitmap, index, count);
+	} else {
+		int avail = bitmap_allocate_range(&zone->bitmap, count,
+		    zone->base, FRAME_LOWPRIO, constraint, &index);
+
+		(void) avail;
+		assert(avail);
+	}
 
-	(void) avail;
-	assert(avail);
 	assert(index != (size_t) -1);
+	zone_index_update(zone, index, count);
 
 	/* Update frame reference count */
 	for (size_t i = 0; i < count; i++) {
@@ -414,6 +737,7 @@ _NO_TRACE static size_t zone_frame_free(zone_t *zone, size_t index)
 
 	if (!--frame->refcount) {
 		bitmap_set(&zone->bitmap, index, 0);
+		zone_index_update(zone, index, 1);
 
 		/* Update zone information. */
 		zone->free_count++;
@@ -436,6 +760,7 @@ _NO_TRACE static void zone_mark_unavailable(zone_t *zone, size_t index)
 
 	frame->refcount = 1;
 	bitmap_set_range(&zone->bitmap, index, 1);
+	zone_index_update(zone, index, 1);
 
 	zone->free_count--;
 	reserve_force_alloc(1);
@@ -491,6 +816,11 @@ _NO_TRACE static void zone_merge_internal(size_t z1, size_t z2, zone_t *old_z1,
 		zones.info[z1].frames[base_diff + i] =
 		    zones.info[z2].frames[i];
 	}
+
+	zone_index_initialize(&zones.info[z1], confdata +
+	    (sizeof(frame_t) * zones.info[z1].count) +
+	    bitmap_size(zones.info[z1].count));
+	zone_index_update(&zones.info[z1], 0, zones.info[z1].count);
 }
 
 /** Return old configuration frames into the zone.
@@ -649,9 +979,21 @@ _NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
 
 		for (size_t i = 0; i < count; i++)
 			frame_initialize(&zone->frames[i]);
+
+		/*
+		 * Initialize the free block index (located after
+		 * the frame bitmap).
+		 */
+
+		zone_index_initialize(zone, confdata +
+		    (sizeof(frame_t) * count) + bitmap_size(count));
+		zone_index_update(zone, 0, count);
 	} else {
 		bitmap_initialize(&zone->bitmap, 0, NULL);
 		zone->frames = NULL;
+
+		for (unsigned int order = 1; order <= ZONE_INDEX_ORDERS; order++)
+			bitmap_initialize(&zone->index[order - 1], 0, NULL);
 	}
 }
 
@@ -664,7 +1006,16 @@ _NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
  */
 size_t zone_conf_size(size_t count)
 {
-	return (count * sizeof(frame_t) + bitmap_size(count));
+	size_t size = count * sizeof(frame_t) + bitmap_size(count);
+
+	/*
+	 * The number of blocks of each order depends on the alignment
+	 * of the zone base, so count with the worst case.
+	 */
+	for (unsigned int order = 1; order <= ZONE_INDEX_ORDERS; order++)
+		size += bitmap_size((count >> order) + 2);
+
+	return size;
 }
 
 /** Allocate external configuration frames from low memory. */
@@ -829,6 +1180,54 @@ static size_t try_find_zone(size_t count, bool lowmem,
 	    frame_constraint, hint);
 }
 
+/** Return frames held by the per-CPU frame caches to their zones.
+ *
+ * @return Number of returned frames.
+ *
+ */
+static size_t frame_cache_drain(void)
+{
+	if (cpus == NULL)
+		return 0;
+
+	size_t drained = 0;
+
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		frame_cache_t *cache = &cpus[i].frame_cache;
+		pfn_t pfns[2 * FRAME_CACHE_SIZE];
+		size_t cnt = 0;
+
+		irq_spinlock_lock(&cache->lock, true);
+
+		for (unsigned int kind = 0; kind < 2; kind++) {
+			while (cache->count[kind] > 0)
+				pfns[cnt++] = cache->pfn[kind][--cache->count[kind]];
+		}
+
+		irq_spinlock_unlock(&cache->lock, true);
+
+		if (cnt == 0)
+			continue;
+
+		irq_spinlock_lock(&zones.lock, true);
+
+		for (size_t j = 0; j < cnt; j++) {
+			size_t znum = find_zone(pfns[j], 1, 0);
+
+			assert(znum != (size_t) -1);
+
+			(void) zone_frame_free(&zones.info[znum],
+			    pfns[j] - zones.info[znum].base);
+		}
+
+		irq_spinlock_unlock(&zones.lock, true);
+
+		drained += cnt;
+	}
+
+	return drained;
+}
+
 /** Allocate frames of physical memory.
  *
  * @param count      Number of continuous frames to allocate.
@@ -854,17 +1253,41 @@ uintptr_t frame_alloc_generic(size_t count, frame_flags_t flags,
 	if (!(flags & FRAME_NO_RESERVE))
 		reserve_force_alloc(count);
 
-loop:
-	irq_spinlock_lock(&zones.lock, true);
-
 	// TODO: Print diagnostic if neither is explicitly specified.
 	bool lowmem = (flags & FRAME_LOWMEM) || !(flags & FRAME_HIGHMEM);
 
+	/*
+	 * Unconstrained single frames are preferably taken from the cache
+	 * of the current CPU. The zone hint cannot be provided for them.
+	 */
+	if ((count == 1) && (frame_constraint == 0) && (pzone == NULL)) {
+		pfn_t pfn;
+
+		if (frame_cache_get(!lowmem, &pfn))
+			return PFN2ADDR(pfn);
+	}
+
+loop:
+	irq_spinlock_lock(&zones.lock, true);
+
 	/*
 	 * First, find suitable frame zone.
 	 */
 	size_t znum = try_find_zone(count, lowmem, frame_constraint, hint);
 
+	/*
+	 * If no memory, return frames cached by the CPUs to the zones.
+	 */
+	if (znum == (size_t) -1) {
+		irq_spinlock_unlock(&zones.lock, true);
+		size_t drained = frame_cache_drain();
+		irq_spinlock_lock(&zones.lock, true);
+
+		if (drained > 0)
+			znum = try_find_zone(count, lowmem,
+			    frame_constraint, hint);
+	}
+
 	/*
 	 * If no memory, reclaim some slab memory,
 	 * if it does not help, reclaim all.
@@ -987,8 +1410,22 @@ void frame_free_generic(uintptr_t start, size_t count, frame_flags_t flags)
 
 		assert(znum != (size_t) -1);
 
-		freed += zone_frame_free(&zones.info[znum],
-		    pfn - zones.info[znum].base);
+		zone_t *zone = &zones.info[znum];
+		size_t index = pfn - zone->base;
+
+		/*
+		 * A single frame which is being released by its last user
+		 * is kept allocated in the cache of the current CPU. The
+		 * zones lock is still needed to find the zone and to check
+		 * the reference count.
+		 */
+		if ((count == 1) && (zone_get_frame(zone, index)->refcount == 1) &&
+		    (frame_cache_put(zone, pfn))) {
+			freed++;
+			continue;
+		}
+
+		freed += zone_frame_free(zone, index);
 	}
 
 	irq_spinlock_unlock(&zones.lock, true);
@@ -1184,8 +1621,13 @@ void zones_stats(uint64_t *total, uint64_t *unavail, uint64_t *busy,
 		*total += (uint64_t) FRAMES2SIZE(zones.info[i].count);
 
 		if (zones.info[i].flags & ZONE_AVAILABLE) {
-			*busy += (uint64_t) FRAMES2SIZE(zones.info[i].busy_count);
-			*free += (uint64_t) FRAMES2SIZE(zones.info[i].free_count);
+			/* Cached frames are free from the user's perspective. */
+			size_t cached = frame_cache_count(i);
+
+			*busy += (uint64_t) FRAMES2SIZE(zones.info[i].busy_count -
+			    cached);
+			*free += (uint64_t) FRAMES2SIZE(zones.info[i].free_count +
+			    cached);
 		} else
 			*unavail += (uint64_t) FRAMES2SIZE(zones.info[i].count);
 	}
@@ -1237,6 +1679,13 @@ void zones_print_list(void)
 		size_t busy_count = zones.info[i].busy_count;
 
 		bool available = ((flags & ZONE_AVAILABLE) != 0);
+
+		if (available) {
+			size_t cached = frame_cache_count(i);
+
+			free_count += cached;
+			busy_count -= cached;
+		}
 		bool lowmem = ((flags & ZONE_LOWMEM) != 0);
 		bool highmem = ((flags & ZONE_HIGHMEM) != 0);
 		bool highprio = is_high_priority(fbase, count);
@@ -1349,6 +1798,13 @@ void zone_print_one(size_t num)
 	size_t busy_count = zones.info[znum].busy_count;
 
 	bool available = ((flags & ZONE_AVAILABLE) != 0);
+
+	if (available) {
+		size_t cached = frame_cache_count(znum);
+
+		free_count += cached;
+		busy_count -= cached;
+	}
 	bool lowmem = ((flags & ZONE_LOWMEM) != 0);
 	bool highmem = ((flags & ZONE_HIGHMEM) != 0);
 	bool highprio = is_high_priority(fbase, count);
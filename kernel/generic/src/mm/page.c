@@ -109,12 +109,78 @@ _NO_TRACE void page_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
 	memory_barrier();
 }
 
+/** Insert mapping of large page to a physically contiguous run of frames.
+ *
+ * Map virtual address page to physical address frame using flags and
+ * a single large page. Allocate and setup any missing page tables.
+ *
+ * @param as    Address space to which page belongs.
+ * @param page  Virtual address of the large page to be mapped. Must be
+ *              aligned to LARGE_PAGE_SIZE.
+ * @param frame Physical address of the first frame of the run. Must be
+ *              aligned to LARGE_PAGE_SIZE.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return True if the mapping was created, false if the architecture does
+ *         not support large pages or part of the large page is already
+ *         mapped by small pages.
+ *
+ */
+_NO_TRACE bool page_mapping_insert_large(as_t *as, uintptr_t page,
+    uintptr_t frame, unsigned int flags)
+{
+	assert(page_table_locked(as));
+
+	assert(page_mapping_operations);
+
+	if (!page_mapping_operations->mapping_insert_large)
+		return false;
+
+	if (!page_mapping_operations->mapping_insert_large(as, page, frame,
+	    flags))
+		return false;
+
+	/* Repel prefetched accesses to the old mapping. */
+	memory_barrier();
+
+	return true;
+}
+
+/** Split large page mapping crossing an address.
+ *
+ * Map the large page containing page by small pages unless page is
+ * aligned to the large page boundary. Page tables may need to be
+ * allocated, so this must be done before starting the TLB shootdown
+ * sequence in which the mappings starting at page are removed.
+ *
+ * @param as   Address space to which page belongs.
+ * @param page Virtual address of the first page to be demapped.
+ *
+ */
+_NO_TRACE void page_mapping_split_large(as_t *as, uintptr_t page)
+{
+	assert(page_table_locked(as));
+
+	assert(page_mapping_operations);
+
+	if (!page_mapping_operations->mapping_split_large)
+		return;
+
+	page_mapping_operations->mapping_split_large(as,
+	    ALIGN_DOWN(page, PAGE_SIZE));
+}
+
 /** Remove mapping of page.
  *
  * Remove any mapping of page within address space as.
  * TLB shootdown should follow in order to make effects of
  * this call visible.
  *
+ * A page mapped by a large page is unmapped together with the rest
+ * of the large page when its last page is removed. To remove only
+ * a part of a large page, page_mapping_split_large() must be called
+ * first.
+ *
  * @param as   Address space to which page belongs.
  * @param page Virtual address of the page to be demapped.
  *
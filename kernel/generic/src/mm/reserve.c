@@ -39,6 +39,7 @@
 #include <mm/reserve.h>
 #include <mm/frame.h>
 #include <mm/slab.h>
+#include <mm/zero_pool.h>
 #include <synch/spinlock.h>
 #include <typedefs.h>
 #include <arch/types.h>
@@ -79,13 +80,14 @@ bool reserve_try_alloc(size_t size)
 		reserved = true;
 	} else {
 		/*
-		 * Some reservable frames may be cached by the slab allocator.
-		 * Try to reclaim some reservable memory. Try to be gentle for
-		 * the first time. If it does not help, try to reclaim
-		 * everything.
+		 * Some reservable frames may be cached by the slab allocator
+		 * or held by the pool of pre-zeroed frames. Try to reclaim
+		 * some reservable memory. Try to be gentle for the first time.
+		 * If it does not help, try to reclaim everything.
 		 */
 		irq_spinlock_unlock(&reserve_lock, true);
 		slab_reclaim(0);
+		zero_pool_reclaim();
 		irq_spinlock_lock(&reserve_lock, true);
 		if (reserve >= 0 && (size_t) reserve >= size) {
 			reserve -= size;
@@ -105,6 +107,30 @@ bool reserve_try_alloc(size_t size)
 	return reserved;
 }
 
+/** Try to reserve memory without reclaiming any.
+ *
+ * Unlike reserve_try_alloc(), this function never asks the caches to give
+ * back their memory, so it is suitable for opportunistic allocations.
+ *
+ * @param size		Number of frames to reserve.
+ * @return		True on success or false otherwise.
+ */
+bool reserve_try_alloc_noreclaim(size_t size)
+{
+	bool reserved = false;
+
+	assert(reserve_initialized);
+
+	irq_spinlock_lock(&reserve_lock, true);
+	if (reserve >= 0 && (size_t) reserve >= size) {
+		reserve -= size;
+		reserved = true;
+	}
+	irq_spinlock_unlock(&reserve_lock, true);
+
+	return reserved;
+}
+
 /** Reserve memory.
  *
  * This function simply marks the respective amount of memory frames reserved.
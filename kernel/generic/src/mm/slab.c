@@ -253,8 +253,13 @@ _NO_TRACE static size_t slab_obj_destroy(slab_cache_t *cache, void *obj,
 	slab->nextavail = (obj - slab->start) / cache->size;
 	slab->available++;
 
-	/* Move it to correct list */
-	if (slab->available == cache->objects) {
+	/*
+	 * Move it to correct list. Memory of type-safe caches is never
+	 * released, so that a freed object can still be safely inspected
+	 * by lockless readers.
+	 */
+	if ((slab->available == cache->objects) &&
+	    (!(cache->flags & SLAB_CACHE_TYPESAFE))) {
 		/* Free associated memory */
 		list_remove(&slab->link);
 		irq_spinlock_unlock(&cache->slablock, true);
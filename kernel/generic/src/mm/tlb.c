@@ -35,11 +35,23 @@
  * @brief Generic TLB shootdown algorithm.
  *
  * The algorithm implemented here is based on the CMU TLB shootdown
- * algorithm and is further simplified (e.g. all CPUs receive all TLB
- * shootdown messages).
+ * algorithm. Each processor owns one shootdown request which batches
+ * up to TLB_MESSAGE_QUEUE_LEN messages. Shootdowns concerning a user
+ * address space are sent only to the processors recorded in the CPU
+ * mask of the address space, while the address space cannot be
+ * switched to on any other processor until the shootdown finishes.
+ *
+ * The sender publishes the sequence number of its request in the
+ * tlb_requests array of each recipient and waits until all of them
+ * acknowledge it. The recipients then wait until the sender finishes
+ * modifying the page tables and process the batched messages. While
+ * waiting with interrupts disabled, a processor keeps acknowledging
+ * and processing requests of other processors, so that several
+ * shootdowns can be in progress at the same time.
  */
 
 #include <mm/tlb.h>
+#include <mm/as.h>
 #include <mm/asid.h>
 #include <arch/mm/tlb.h>
 #include <assert.h>
@@ -51,6 +63,8 @@
 #include <arch.h>
 #include <panic.h>
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
+#include <mem.h>
 
 void tlb_init(void)
 {
@@ -59,13 +73,243 @@ void tlb_init(void)
 
 #ifdef CONFIG_SMP
 
-/**
- * This lock is used for synchronisation between sender and
- * recipients of TLB shootdown message. It must be acquired
- * before CPU structure lock.
+/** Acknowledge TLB shootdown requests sent to the current processor.
+ *
+ * Interrupts must be disabled.
+ *
+ */
+static void tlb_shootdown_ack(void)
+{
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		size_t seq = atomic_load_explicit(&CPU->tlb_requests[i],
+		    memory_order_acquire);
+		if (seq == CPU->tlb_acked[i])
+			continue;
+
+		CPU->tlb_acked[i] = seq;
+		atomic_fetch_sub_explicit(&cpus[i].tlb_shootdown.acks_pending,
+		    1, memory_order_release);
+	}
+}
+
+/** Invalidate TLB entries described by a shootdown request.
+ *
+ * @param req Shootdown request.
+ *
+ */
+static void tlb_shootdown_invalidate(tlb_shootdown_t *req)
+{
+	assert(req->messages_count <= TLB_MESSAGE_QUEUE_LEN);
+
+	for (size_t i = 0; i < req->messages_count; i++) {
+		tlb_invalidate_type_t type = req->messages[i].type;
+		asid_t asid = req->messages[i].asid;
+		uintptr_t page = req->messages[i].page;
+		size_t count = req->messages[i].count;
+
+		switch (type) {
+		case TLB_INVL_ALL:
+			tlb_invalidate_all();
+			break;
+		case TLB_INVL_ASID:
+			tlb_invalidate_asid(asid);
+			break;
+		case TLB_INVL_PAGES:
+			assert(count);
+			tlb_invalidate_pages(asid, page, count);
+			break;
+		default:
+			panic("Unknown type (%d).", type);
+			break;
+		}
+
+		if (type == TLB_INVL_ALL)
+			break;
+	}
+}
+
+/** Process acknowledged TLB shootdown requests.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param wait If true, wait until the senders of all acknowledged
+ *             requests finish. Otherwise process only the requests
+ *             whose senders have already finished.
+ *
+ */
+static void tlb_shootdown_process(bool wait)
+{
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		size_t seq = CPU->tlb_acked[i];
+		if (seq == CPU->tlb_processed[i])
+			continue;
+
+		tlb_shootdown_t *req = &cpus[i].tlb_shootdown;
+
+		while (atomic_load_explicit(&req->done,
+		    memory_order_acquire) != seq) {
+			if (!wait)
+				break;
+
+			/*
+			 * Keep acknowledging other requests, their
+			 * senders might be holding up our sender.
+			 */
+			tlb_shootdown_ack();
+		}
+
+		if (atomic_load_explicit(&req->done,
+		    memory_order_acquire) != seq)
+			continue;
+
+		tlb_shootdown_invalidate(req);
+
+		CPU->tlb_processed[i] = seq;
+		atomic_fetch_sub_explicit(&req->process_pending, 1,
+		    memory_order_release);
+	}
+}
+
+/** Handle TLB shootdown requests while busy waiting.
+ *
+ * Interrupts must be disabled.
+ *
+ */
+static void tlb_shootdown_poll(void)
+{
+	tlb_shootdown_ack();
+	tlb_shootdown_process(false);
+}
+
+/** Acquire the ASID lock from within a TLB shootdown.
+ *
+ * The holder of the lock may be waiting for us to acknowledge
+ * its own TLB shootdown request.
+ *
+ */
+static void tlb_shootdown_asidlock_lock(void)
+{
+	while (!spinlock_trylock(&asidlock))
+		tlb_shootdown_poll();
+}
+
+/** Store a message into the shootdown request of the current processor.
+ *
+ * If the request is full, the batched messages are collapsed into
+ * a single message covering all of them.
+ *
+ * @param req   Shootdown request of the current processor.
+ * @param type  Type describing scope of shootdown.
+ * @param asid  Address space, if required by type.
+ * @param page  Virtual page address, if required by type.
+ * @param count Number of pages, if required by type.
+ *
+ */
+static void tlb_shootdown_enqueue(tlb_shootdown_t *req,
+    tlb_invalidate_type_t type, asid_t asid, uintptr_t page, size_t count)
+{
+	for (size_t i = 0; i < req->messages_count; i++) {
+		tlb_shootdown_msg_t *msg = &req->messages[i];
+
+		if (msg->type == TLB_INVL_ALL)
+			return;
+		if ((msg->type == TLB_INVL_ASID) && (type != TLB_INVL_ALL) &&
+		    (msg->asid == asid))
+			return;
+	}
+
+	if (req->messages_count == TLB_MESSAGE_QUEUE_LEN) {
+		/*
+		 * The request is full.
+		 * Replace the messages with a single TLB_INVL_ASID
+		 * message if they all concern the same address space,
+		 * or with a TLB_INVL_ALL message otherwise.
+		 */
+		bool same_asid = (type != TLB_INVL_ALL);
+		for (size_t i = 0; i < req->messages_count; i++) {
+			if (req->messages[i].asid != asid)
+				same_asid = false;
+		}
+
+		req->messages_count = 1;
+		req->messages[0].type = same_asid ? TLB_INVL_ASID :
+		    TLB_INVL_ALL;
+		req->messages[0].asid = same_asid ? asid : ASID_INVALID;
+		req->messages[0].page = 0;
+		req->messages[0].count = 0;
+		return;
+	}
+
+	size_t idx = req->messages_count++;
+	req->messages[idx].type = type;
+	req->messages[idx].asid = asid;
+	req->messages[idx].page = page;
+	req->messages[idx].count = count;
+}
+
+/** Send the shootdown request of the current processor.
+ *
+ * The recipients are taken from the mask of the request. The function
+ * returns after all recipients acknowledged the request.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param req Shootdown request of the current processor.
+ *
+ */
+static void tlb_shootdown_send(tlb_shootdown_t *req)
+{
+	size_t recipients = 0;
+
+	cpu_mask_for_each(*req->mask, cpu_id) {
+		if ((cpu_id != CPU->id) && (cpus[cpu_id].active))
+			recipients++;
+		else
+			cpu_mask_reset(req->mask, cpu_id);
+	}
+
+	if (recipients == 0)
+		return;
+
+	atomic_store_explicit(&req->acks_pending, recipients,
+	    memory_order_relaxed);
+	atomic_store_explicit(&req->process_pending, recipients,
+	    memory_order_relaxed);
+
+	cpu_mask_for_each(*req->mask, cpu_id) {
+		atomic_store_explicit(&cpus[cpu_id].tlb_requests[CPU->id],
+		    req->seq, memory_order_release);
+	}
+
+	ipi_multicast(req->mask, VECTOR_TLB_SHOOTDOWN_IPI);
+
+	while (atomic_load_explicit(&req->acks_pending,
+	    memory_order_acquire) > 0)
+		tlb_shootdown_poll();
+}
+
+/** Prepare the shootdown request of the current processor.
+ *
+ * Waits until all recipients of the previous request processed it.
+ * Interrupts must be disabled.
+ *
+ * @return Shootdown request of the current processor.
  *
  */
-IRQ_SPINLOCK_STATIC_INITIALIZE(tlblock);
+static tlb_shootdown_t *tlb_shootdown_prepare(void)
+{
+	tlb_shootdown_t *req = &CPU->tlb_shootdown;
+
+	while (atomic_load_explicit(&req->process_pending,
+	    memory_order_acquire) > 0)
+		tlb_shootdown_poll();
+
+	req->seq++;
+	req->as = NULL;
+	req->messages_count = 0;
+
+	return req;
+}
 
 /** Send TLB shootdown message.
  *
@@ -84,51 +328,76 @@ ipl_t tlb_shootdown_start(tlb_invalidate_type_t type, asid_t asid,
     uintptr_t page, size_t count)
 {
 	ipl_t ipl = interrupts_disable();
-	CPU->tlb_active = false;
-	irq_spinlock_lock(&tlblock, false);
 
-	size_t i;
-	for (i = 0; i < config.cpu_count; i++) {
-		if (i == CPU->id)
-			continue;
+	tlb_shootdown_t *req = tlb_shootdown_prepare();
+	tlb_shootdown_enqueue(req, type, asid, page, count);
+	cpu_mask_active(req->mask);
+	tlb_shootdown_send(req);
 
-		cpu_t *cpu = &cpus[i];
+	return ipl;
+}
 
-		irq_spinlock_lock(&cpu->lock, false);
-		if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
-			/*
-			 * The message queue is full.
-			 * Erase the queue and store one TLB_INVL_ALL message.
-			 */
-			cpu->tlb_messages_count = 1;
-			cpu->tlb_messages[0].type = TLB_INVL_ALL;
-			cpu->tlb_messages[0].asid = ASID_INVALID;
-			cpu->tlb_messages[0].page = 0;
-			cpu->tlb_messages[0].count = 0;
-		} else {
-			/*
-			 * Enqueue the message.
-			 */
-			size_t idx = cpu->tlb_messages_count++;
-			cpu->tlb_messages[idx].type = type;
-			cpu->tlb_messages[idx].asid = asid;
-			cpu->tlb_messages[idx].page = page;
-			cpu->tlb_messages[idx].count = count;
-		}
-		irq_spinlock_unlock(&cpu->lock, false);
-	}
+/** Send TLB shootdown message concerning a user address space.
+ *
+ * The message is delivered only to the processors on which the address
+ * space may have left TLB entries behind. Until tlb_shootdown_finalize()
+ * is called, the address space cannot be switched to on any other
+ * processor. Further messages can be batched with tlb_shootdown_add().
+ *
+ * @param as    Address space.
+ * @param page  First virtual page to invalidate.
+ * @param count Number of pages to invalidate. If zero, no message
+ *              is sent initially.
+ *
+ * @return The interrupt priority level as it existed prior to this call.
+ *
+ */
+ipl_t tlb_shootdown_start_as(as_t *as, uintptr_t page, size_t count)
+{
+	ipl_t ipl = interrupts_disable();
 
-	tlb_shootdown_ipi_send();
+	tlb_shootdown_t *req = tlb_shootdown_prepare();
+	if (count > 0)
+		tlb_shootdown_enqueue(req, TLB_INVL_PAGES, as->asid, page,
+		    count);
 
-busy_wait:
-	for (i = 0; i < config.cpu_count; i++) {
-		if (cpus[i].tlb_active)
-			goto busy_wait;
+	if (!as->cpu_mask) {
+		/* Kernel address space mappings may be cached anywhere. */
+		cpu_mask_active(req->mask);
+		tlb_shootdown_send(req);
+		return ipl;
 	}
 
+	tlb_shootdown_asidlock_lock();
+	as->tlb_shootdown++;
+	memcpy(req->mask, as->cpu_mask, cpu_mask_size());
+	spinlock_unlock(&asidlock);
+
+	req->as = as;
+	tlb_shootdown_send(req);
+
 	return ipl;
 }
 
+/** Add TLB shootdown message to the current shootdown sequence.
+ *
+ * The recipients have already acknowledged the request and process
+ * the message once tlb_shootdown_finalize() is called.
+ *
+ * @param type  Type describing scope of shootdown.
+ * @param asid  Address space, if required by type.
+ * @param page  Virtual page address, if required by type.
+ * @param count Number of pages, if required by type.
+ *
+ */
+void tlb_shootdown_add(tlb_invalidate_type_t type, asid_t asid,
+    uintptr_t page, size_t count)
+{
+	assert(interrupts_disabled());
+
+	tlb_shootdown_enqueue(&CPU->tlb_shootdown, type, asid, page, count);
+}
+
 /** Finish TLB shootdown sequence.
  *
  * @param ipl Previous interrupt priority level.
@@ -136,14 +405,19 @@ busy_wait:
  */
 void tlb_shootdown_finalize(ipl_t ipl)
 {
-	irq_spinlock_unlock(&tlblock, false);
-	CPU->tlb_active = true;
-	interrupts_restore(ipl);
-}
+	tlb_shootdown_t *req = &CPU->tlb_shootdown;
 
-void tlb_shootdown_ipi_send(void)
-{
-	ipi_broadcast(VECTOR_TLB_SHOOTDOWN_IPI);
+	atomic_store_explicit(&req->done, req->seq, memory_order_release);
+
+	if (req->as) {
+		tlb_shootdown_asidlock_lock();
+		assert(req->as->tlb_shootdown > 0);
+		req->as->tlb_shootdown--;
+		spinlock_unlock(&asidlock);
+		req->as = NULL;
+	}
+
+	interrupts_restore(ipl);
 }
 
 /** Receive TLB shootdown message.
@@ -153,43 +427,8 @@ void tlb_shootdown_ipi_recv(void)
 {
 	assert(CPU);
 
-	CPU->tlb_active = false;
-	irq_spinlock_lock(&tlblock, false);
-	irq_spinlock_unlock(&tlblock, false);
-
-	irq_spinlock_lock(&CPU->lock, false);
-	assert(CPU->tlb_messages_count <= TLB_MESSAGE_QUEUE_LEN);
-
-	size_t i;
-	for (i = 0; i < CPU->tlb_messages_count; i++) {
-		tlb_invalidate_type_t type = CPU->tlb_messages[i].type;
-		asid_t asid = CPU->tlb_messages[i].asid;
-		uintptr_t page = CPU->tlb_messages[i].page;
-		size_t count = CPU->tlb_messages[i].count;
-
-		switch (type) {
-		case TLB_INVL_ALL:
-			tlb_invalidate_all();
-			break;
-		case TLB_INVL_ASID:
-			tlb_invalidate_asid(asid);
-			break;
-		case TLB_INVL_PAGES:
-			assert(count);
-			tlb_invalidate_pages(asid, page, count);
-			break;
-		default:
-			panic("Unknown type (%d).", type);
-			break;
-		}
-
-		if (type == TLB_INVL_ALL)
-			break;
-	}
-
-	CPU->tlb_messages_count = 0;
-	irq_spinlock_unlock(&CPU->lock, false);
-	CPU->tlb_active = true;
+	tlb_shootdown_ack();
+	tlb_shootdown_process(true);
 }
 
 #endif /* CONFIG_SMP */
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_generic_mm
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Pool of pre-zeroed frames.
+ *
+ * Each CPU keeps a small stack of frames which have already been cleared
+ * by a kernel thread wired to that CPU. The thread clears frames only while
+ * no other thread is ready to run on the CPU. The anonymous memory
+ * backend takes frames from the pool when servicing page faults and thus
+ * avoids clearing the page on the fault path.
+ *
+ * Frames held by the pool are accounted as reserved. The reservation is
+ * given back when a frame is handed out, because the consumer has already
+ * reserved the memory for the address space area.
+ */
+
+#include <assert.h>
+#include <mm/zero_pool.h>
+#include <mm/frame.h>
+#include <mm/km.h>
+#include <mm/reserve.h>
+#include <synch/spinlock.h>
+#include <synch/waitq.h>
+#include <proc/thread.h>
+#include <config.h>
+#include <cpu.h>
+#include <log.h>
+#include <mem.h>
+#include <stdlib.h>
+
+/** Number of frames kept by each per-CPU pool. */
+#define ZERO_POOL_SIZE  64
+
+/** The zeroing thread is woken up when the pool drops to this level. */
+#define ZERO_POOL_LOW  (ZERO_POOL_SIZE / 2)
+
+/** Interval in which the zeroing thread retries refilling the pool. */
+#define ZERO_POOL_INTERVAL  100000
+
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+
+	/** Number of valid entries in @c frames. */
+	size_t count;
+	/** Physical addresses of the pre-zeroed frames. */
+	uintptr_t frames[ZERO_POOL_SIZE];
+
+	/** Wait queue of the zeroing thread. */
+	waitq_t wq;
+} zero_pool_t;
+
+/** Per-CPU pools, indexed by CPU ID. */
+static zero_pool_t *zero_pools = NULL;
+
+/** Zero one frame and put it into the pool.
+ *
+ * @param pool Pool to refill.
+ *
+ * @return True if the frame was added, false if the pool is full or
+ *         there is no free memory to spare.
+ */
+static bool zero_pool_refill_one(zero_pool_t *pool)
+{
+	irq_spinlock_lock(&pool->lock, true);
+	bool full = (pool->count >= ZERO_POOL_SIZE);
+	irq_spinlock_unlock(&pool->lock, true);
+
+	if (full)
+		return false;
+
+	if (!reserve_try_alloc_noreclaim(1))
+		return false;
+
+	uintptr_t frame;
+	uintptr_t page = km_temporary_page_get(&frame,
+	    FRAME_NO_RESERVE | FRAME_ATOMIC);
+	if (frame == 0) {
+		reserve_free(1);
+		return false;
+	}
+
+	memsetb((void *) page, PAGE_SIZE, 0);
+	km_temporary_page_put(page);
+
+	irq_spinlock_lock(&pool->lock, true);
+	if (pool->count < ZERO_POOL_SIZE) {
+		pool->frames[pool->count++] = frame;
+		frame = 0;
+	}
+	irq_spinlock_unlock(&pool->lock, true);
+
+	if (frame != 0) {
+		/* Someone else filled the pool meanwhile. */
+		frame_free(frame, 1);
+		return false;
+	}
+
+	return true;
+}
+
+/** Zeroing thread.
+ *
+ * The thread is wired to one CPU and refills its pool only when there
+ * is no other thread ready to run on that CPU.
+ *
+ * @param arg Pool of the CPU the thread is wired to.
+ *
+ */
+static void kzero(void *arg)
+{
+	zero_pool_t *pool = (zero_pool_t *) arg;
+
+	thread_detach(THREAD);
+
+	while (true) {
+		waitq_sleep_timeout(&pool->wq, ZERO_POOL_INTERVAL,
+		    SYNCH_FLAGS_NONE, NULL);
+
+		while (atomic_load(&CPU->nrdy) == 0) {
+			if (!zero_pool_refill_one(pool))
+				break;
+		}
+	}
+}
+
+/** Initialize the pools and start the zeroing threads.
+ *
+ * Must be called after all CPUs have been brought up.
+ */
+void zero_pool_init(void)
+{
+	zero_pool_t *pools = malloc(sizeof(zero_pool_t) * config.cpu_count);
+	if (!pools) {
+		log(LF_OTHER, LVL_ERROR, "Unable to allocate zero frame pools");
+		return;
+	}
+
+	unsigned int i;
+	for (i = 0; i < config.cpu_count; i++) {
+		irq_spinlock_initialize(&pools[i].lock, "zero_pool.lock");
+		pools[i].count = 0;
+		waitq_initialize(&pools[i].wq);
+	}
+
+	zero_pools = pools;
+
+	for (i = 0; i < config.cpu_count; i++) {
+		thread_t *thread = thread_create(kzero, &pools[i], TASK,
+		    THREAD_FLAG_UNCOUNTED, "kzero");
+		if (thread != NULL) {
+			thread_wire(thread, &cpus[i]);
+			thread_ready(thread);
+		} else
+			log(LF_OTHER, LVL_ERROR,
+			    "Unable to create kzero thread for cpu%u", i);
+	}
+}
+
+/** Take a pre-zeroed frame from the pool of the current CPU.
+ *
+ * The frame is returned in the same state as if it was allocated using
+ * frame_alloc() with FRAME_NO_RESERVE, i.e. the caller must have already
+ * reserved the memory.
+ *
+ * @return Physical address of the frame or 0 if the pool is empty.
+ *
+ */
+uintptr_t zero_pool_frame_get(void)
+{
+	if (zero_pools == NULL)
+		return 0;
+
+	ipl_t ipl = interrupts_disable();
+	zero_pool_t *pool = &zero_pools[CPU->id];
+
+	uintptr_t frame = 0;
+	bool wakeup = false;
+
+	irq_spinlock_lock(&pool->lock, false);
+	if (pool->count > 0) {
+		frame = pool->frames[--pool->count];
+		wakeup = (pool->count == ZERO_POOL_LOW);
+	}
+	irq_spinlock_unlock(&pool->lock, false);
+	interrupts_restore(ipl);
+
+	if (wakeup)
+		waitq_wakeup(&pool->wq, WAKEUP_FIRST);
+
+	if (frame != 0)
+		reserve_free(1);
+
+	return frame;
+}
+
+/** Return all pooled frames to the frame allocator.
+ *
+ * This is used when the reservable memory is running low.
+ *
+ * @return Number of frames released.
+ *
+ */
+size_t zero_pool_reclaim(void)
+{
+	if (zero_pools == NULL)
+		return 0;
+
+	size_t freed = 0;
+	unsigned int i;
+	for (i = 0; i < config.cpu_count; i++) {
+		zero_pool_t *pool = &zero_pools[i];
+
+		while (true) {
+			uintptr_t frame = 0;
+
+			irq_spinlock_lock(&pool->lock, true);
+			if (pool->count > 0)
+				frame = pool->frames[--pool->count];
+			irq_spinlock_unlock(&pool->lock, true);
+
+			if (frame == 0)
+				break;
+
+			frame_free(frame, 1);
+			freed++;
+		}
+	}
+
+	return freed;
+}
+
+/** @}
+ */
@@ -47,6 +47,7 @@
 #include <mm/page.h>
 #include <mm/as.h>
 #include <time/timeout.h>
+#include <tracebuf.h>
 #include <time/delay.h>
 #include <arch/asm.h>
 #include <arch/faddr.h>
@@ -64,6 +65,7 @@
 #include <stdio.h>
 #include <log.h>
 #include <stacktrace.h>
+#include <sysinfo/stats.h>
 
 static void scheduler_separated_stack(void);
 
@@ -317,6 +319,7 @@ void scheduler(void)
 
 		/* Update thread kernel accounting */
 		THREAD->kcycles += get_cycle() - THREAD->last_cycle;
+		stats_thread_publish(THREAD);
 
 #if (defined CONFIG_FPU) && (!defined CONFIG_FPU_LAZY)
 		fpu_context_save(THREAD->saved_fpu_context);
@@ -385,6 +388,7 @@ void scheduler_separated_stack(void)
 	DEADLOCK_PROBE_INIT(p_joinwq);
 	task_t *old_task = TASK;
 	as_t *old_as = AS;
+	thread_id_t old_tid = (THREAD) ? THREAD->tid : 0;
 
 	assert((!THREAD) || (irq_spinlock_locked(&THREAD->lock)));
 	assert(CPU != NULL);
@@ -466,6 +470,7 @@ void scheduler_separated_stack(void)
 		}
 
 		THREAD = NULL;
+		CPU->running = NULL;
 	}
 
 	THREAD = find_best_thread();
@@ -507,6 +512,9 @@ void scheduler_separated_stack(void)
 
 	irq_spinlock_lock(&THREAD->lock, false);
 	THREAD->state = Running;
+	CPU->running = THREAD;
+
+	tracebuf_event(TRACEBUF_SWITCH, old_tid, THREAD->priority);
 
 #ifdef SCHEDULER_VERBOSE
 	log(LF_OTHER, LVL_DEBUG,
@@ -58,6 +58,7 @@
 #include <str.h>
 #include <syscall/copy.h>
 #include <macros.h>
+#include <sysinfo/stats.h>
 
 /** Spinlock protecting the @c tasks ordered dictionary. */
 IRQ_SPINLOCK_INITIALIZE(tasks_lock);
@@ -161,6 +162,7 @@ errno_t tsk_constructor(void *obj, unsigned int kmflags)
 	atomic_store(&task->lifecount, 0);
 
 	irq_spinlock_initialize(&task->lock, "task_t_lock");
+	irq_spinlock_initialize(&task->stats_lock, "task_t_stats_lock");
 
 	list_initialize(&task->threads);
 
@@ -210,6 +212,7 @@ task_t *task_create(as_t *as, const char *name)
 	task->perms = 0;
 	task->ucycles = 0;
 	task->kcycles = 0;
+	atomic_store(&task->futexes, 0);
 
 	caps_task_init(task);
 
@@ -257,6 +260,8 @@ task_t *task_create(as_t *as, const char *name)
 
 	irq_spinlock_unlock(&tasks_lock, true);
 
+	stats_task_attach(task);
+
 	return task;
 }
 
@@ -274,6 +279,8 @@ void task_destroy(task_t *task)
 	odict_remove(&task->ltasks);
 	irq_spinlock_unlock(&tasks_lock, true);
 
+	stats_task_detach(task);
+
 	/*
 	 * Perform architecture specific task destruction.
 	 */
@@ -393,6 +400,8 @@ sys_errno_t sys_task_set_name(const uspace_ptr_char uspace_name, size_t name_len
 	irq_spinlock_unlock(&TASK->lock, false);
 	irq_spinlock_unlock(&tasks_lock, true);
 
+	stats_task_rename(TASK);
+
 	return EOK;
 }
 
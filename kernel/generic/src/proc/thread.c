@@ -48,6 +48,7 @@
 #include <synch/spinlock.h>
 #include <synch/waitq.h>
 #include <synch/syswaitq.h>
+#include <synch/futex.h>
 #include <cpu.h>
 #include <str.h>
 #include <context.h>
@@ -68,6 +69,7 @@
 #include <syscall/copy.h>
 #include <errno.h>
 #include <debug.h>
+#include <sysinfo/stats.h>
 
 /** Thread states */
 const char *thread_states[] = {
@@ -132,6 +134,7 @@ static void cushion(void)
 	irq_spinlock_lock(&THREAD->lock, true);
 	if (!THREAD->uncounted) {
 		thread_update_accounting(true);
+		stats_thread_publish(THREAD);
 		uint64_t ucycles = THREAD->ucycles;
 		THREAD->ucycles = 0;
 		uint64_t kcycles = THREAD->kcycles;
@@ -372,6 +375,8 @@ thread_t *thread_create(void (*func)(void *), void *arg, task_t *task,
 	thread->ticks = -1;
 	thread->ucycles = 0;
 	thread->kcycles = 0;
+	thread->ucycles_published = 0;
+	thread->kcycles_published = 0;
 	thread->uncounted =
 	    ((flags & THREAD_FLAG_UNCOUNTED) == THREAD_FLAG_UNCOUNTED);
 	thread->priority = -1;          /* Start in rq[0] */
@@ -388,6 +393,7 @@ thread_t *thread_create(void (*func)(void *), void *arg, task_t *task,
 	thread->sleep_interruptible = false;
 	thread->sleep_composable = false;
 	thread->sleep_queue = NULL;
+	thread->futex = NULL;
 	thread->timeout_pending = false;
 
 	thread->in_copy_from_uspace = false;
@@ -520,6 +526,7 @@ void thread_exit(void)
 			 */
 			ipc_cleanup();
 			sys_waitq_task_cleanup();
+			futex_task_cleanup();
 			LOG("Cleanup of task %" PRIu64 " completed.", TASK->taskid);
 		}
 	}
@@ -59,6 +59,21 @@ void ipi_broadcast(int ipi)
 		ipi_broadcast_arch(ipi);
 }
 
+/** Send IPI message to selected CPUs
+ *
+ * The current CPU never receives the message, even if it is
+ * present in the mask.
+ *
+ * @param mask CPUs to send the message to.
+ * @param ipi  Message to send.
+ *
+ */
+void ipi_multicast(cpu_mask_t *mask, int ipi)
+{
+	if (config.cpu_count > 1)
+		ipi_multicast_arch(mask, ipi);
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
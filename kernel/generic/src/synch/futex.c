@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_sync
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Wait queues keyed by userspace addresses.
+ *
+ * A userspace futex is a counter manipulated by atomic instructions. Only
+ * when the counter indicates contention, the kernel is asked to put the
+ * calling thread to sleep or to wake up a sleeping thread. The kernel wait
+ * queue is looked up by the address of the counter in a hash table, so
+ * userspace does not need to create the wait queue in advance.
+ *
+ * The wait queue records wakeups that did not find any sleeper, which is
+ * why the kernel never needs to read the counter. A futex structure is
+ * created on the first sleep or wakeup and destroyed when it is neither
+ * referenced nor holds any pending wakeups, so that it carries no state.
+ * Pending wakeups are discarded when userspace destroys the futex, so that
+ * a futex created later at the same address starts afresh.
+ *
+ * Futexes can only be created at addresses within writable address space
+ * areas and each task can have only a limited number of them.
+ */
+
+#include <assert.h>
+#include <synch/futex.h>
+#include <synch/mutex.h>
+#include <synch/spinlock.h>
+#include <synch/waitq.h>
+#include <adt/hash.h>
+#include <adt/list.h>
+#include <mm/as.h>
+#include <mm/slab.h>
+#include <proc/task.h>
+#include <proc/thread.h>
+#include <arch.h>
+#include <atomic.h>
+#include <errno.h>
+
+#ifdef CONFIG_UDEBUG
+#include <udebug/udebug.h>
+#endif
+
+/** Number of hash buckets of futexes. */
+#define FUTEX_BUCKETS  64
+
+/** Maximum number of futexes of a task. */
+#define FUTEX_MAX_PER_TASK  1024
+
+typedef struct futex {
+	/** Link to futex_bucket_t.futexes. */
+	link_t link;
+
+	/** Task the futex belongs to. */
+	task_t *task;
+	/** Userspace address of the futex counter. */
+	uintptr_t uaddr;
+
+	/**
+	 * Number of threads using the futex. Decremented to zero only with
+	 * the bucket lock held.
+	 */
+	atomic_size_t refcount;
+
+	/** Wait queue of the futex. */
+	waitq_t wq;
+} futex_t;
+
+typedef struct {
+	mutex_t lock;
+	list_t futexes;
+} futex_bucket_t;
+
+static futex_bucket_t futex_buckets[FUTEX_BUCKETS];
+
+static slab_cache_t *futex_cache;
+
+/** Initialize the futex subsystem. */
+void futex_init(void)
+{
+	for (size_t i = 0; i < FUTEX_BUCKETS; i++) {
+		mutex_initialize(&futex_buckets[i].lock, MUTEX_PASSIVE);
+		list_initialize(&futex_buckets[i].futexes);
+	}
+
+	futex_cache = slab_cache_create("futex_t", sizeof(futex_t), 0, NULL,
+	    NULL, 0);
+}
+
+static futex_bucket_t *futex_bucket(task_t *task, uintptr_t uaddr)
+{
+	return &futex_buckets[hash_mix((uintptr_t) task ^ uaddr) %
+	    FUTEX_BUCKETS];
+}
+
+/** Find the futex at an address of the current task.
+ *
+ * The bucket of the futex must be locked.
+ *
+ * @param bucket Bucket of the futex.
+ * @param uaddr  Userspace address of the futex counter.
+ *
+ * @return Futex or NULL if there is no futex at the address.
+ */
+static futex_t *futex_find(futex_bucket_t *bucket, uintptr_t uaddr)
+{
+	assert(mutex_locked(&bucket->lock));
+
+	list_foreach(bucket->futexes, link, futex_t, cur) {
+		if ((cur->task == TASK) && (cur->uaddr == uaddr))
+			return cur;
+	}
+
+	return NULL;
+}
+
+/** Create a futex at an address of the current task.
+ *
+ * The bucket of the futex must be locked.
+ *
+ * @param bucket Bucket of the futex.
+ * @param uaddr  Userspace address of the futex counter.
+ * @param rfutex Place to store the referenced futex.
+ *
+ * @return EOK on success, ENOENT if the address does not belong to
+ *         a writable address space area, ELIMIT if the task has too many
+ *         futexes or ENOMEM if there is not enough memory.
+ */
+static errno_t futex_create(futex_bucket_t *bucket, uintptr_t uaddr,
+    futex_t **rfutex)
+{
+	assert(mutex_locked(&bucket->lock));
+
+	if (!as_area_check_flags(AS, uaddr, AS_AREA_WRITE))
+		return ENOENT;
+
+	if (atomic_postinc(&TASK->futexes) >= FUTEX_MAX_PER_TASK) {
+		atomic_dec(&TASK->futexes);
+		return ELIMIT;
+	}
+
+	futex_t *futex = slab_alloc(futex_cache, FRAME_ATOMIC);
+	if (futex == NULL) {
+		atomic_dec(&TASK->futexes);
+		return ENOMEM;
+	}
+
+	link_initialize(&futex->link);
+	futex->task = TASK;
+	futex->uaddr = uaddr;
+	atomic_init(&futex->refcount, 1);
+	waitq_initialize(&futex->wq);
+
+	list_append(&futex->link, &bucket->futexes);
+
+	*rfutex = futex;
+	return EOK;
+}
+
+/** Find or create the futex at an address of the current task.
+ *
+ * @param uaddr  Userspace address of the futex counter.
+ * @param rfutex Place to store the referenced futex.
+ *
+ * @return EOK on success or an error code from futex_create().
+ */
+static errno_t futex_get(uintptr_t uaddr, futex_t **rfutex)
+{
+	futex_bucket_t *bucket = futex_bucket(TASK, uaddr);
+	errno_t rc = EOK;
+
+	mutex_lock(&bucket->lock);
+
+	futex_t *futex = futex_find(bucket, uaddr);
+	if (futex != NULL) {
+		atomic_inc(&futex->refcount);
+		*rfutex = futex;
+	} else {
+		rc = futex_create(bucket, uaddr, rfutex);
+	}
+
+	mutex_unlock(&bucket->lock);
+
+	return rc;
+}
+
+/** Free an unreferenced futex removed from its bucket. */
+static void futex_free(futex_t *futex)
+{
+	atomic_dec(&futex->task->futexes);
+	slab_free(futex_cache, futex);
+}
+
+/** Check whether the wait queue of a futex carries any state. */
+static bool futex_idle(futex_t *futex)
+{
+	irq_spinlock_lock(&futex->wq.lock, true);
+	bool idle = (futex->wq.missed_wakeups == 0) &&
+	    (futex->wq.ignore_wakeups == 0) &&
+	    (list_empty(&futex->wq.sleepers));
+	irq_spinlock_unlock(&futex->wq.lock, true);
+
+	return idle;
+}
+
+/** Drop a reference to a futex.
+ *
+ * The futex is destroyed when it is not referenced and its wait queue
+ * is idle.
+ *
+ * @param futex Futex to release.
+ */
+static void futex_put(futex_t *futex)
+{
+	futex_bucket_t *bucket = futex_bucket(futex->task, futex->uaddr);
+	bool destroy = false;
+
+	mutex_lock(&bucket->lock);
+
+	if ((atomic_predec(&futex->refcount) == 0) && futex_idle(futex)) {
+		list_remove(&futex->link);
+		destroy = true;
+	}
+
+	mutex_unlock(&bucket->lock);
+
+	if (destroy)
+		futex_free(futex);
+}
+
+/** Destroy all futexes of the exiting task.
+ *
+ * Must be called by the last userspace thread of the task, so
+ * that no thread of the task can be sleeping in any of its futexes.
+ */
+void futex_task_cleanup(void)
+{
+	for (size_t i = 0; i < FUTEX_BUCKETS; i++) {
+		futex_bucket_t *bucket = &futex_buckets[i];
+
+		mutex_lock(&bucket->lock);
+
+		list_foreach_safe(bucket->futexes, cur, next) {
+			futex_t *futex = list_get_instance(cur, futex_t, link);
+
+			if (futex->task == TASK) {
+				assert(list_empty(&futex->wq.sleepers));
+
+				list_remove(&futex->link);
+				futex_free(futex);
+			}
+		}
+
+		mutex_unlock(&bucket->lock);
+	}
+}
+
+static bool futex_uaddr_valid(uintptr_t uaddr)
+{
+	return (uaddr != 0) && (uaddr % sizeof(int) == 0);
+}
+
+/** Sleep in a futex
+ *
+ * @param uaddr    Userspace address of the futex counter.
+ * @param timeout  Timeout in microseconds.
+ * @param flags    Flags from SYNCH_FLAGS_* family. SYNCH_FLAGS_INTERRUPTIBLE is
+ *                 always implied.
+ *
+ * @return         Error code.
+ */
+sys_errno_t sys_futex_sleep(uintptr_t uaddr, uint32_t timeout,
+    unsigned int flags)
+{
+	if (!futex_uaddr_valid(uaddr))
+		return (sys_errno_t) EINVAL;
+
+	futex_t *futex;
+	errno_t rc = futex_get(uaddr, &futex);
+	if (rc != EOK)
+		return (sys_errno_t) rc;
+
+	THREAD->futex = futex;
+
+#ifdef CONFIG_UDEBUG
+	udebug_stoppable_begin();
+#endif
+
+	bool blocked;
+	ipl_t ipl = waitq_sleep_prepare(&futex->wq);
+	rc = waitq_sleep_timeout_unsafe(&futex->wq, timeout,
+	    SYNCH_FLAGS_INTERRUPTIBLE | flags, &blocked);
+
+	/*
+	 * The thread might have been requeued to another futex,
+	 * whose wait queue is the one to finish the sleep with.
+	 */
+	futex_t *last = THREAD->futex;
+	waitq_sleep_finish(&last->wq, blocked, ipl);
+
+#ifdef CONFIG_UDEBUG
+	udebug_stoppable_end();
+#endif
+
+	THREAD->futex = NULL;
+
+	if (last != futex)
+		futex_put(last);
+	futex_put(futex);
+
+	return (sys_errno_t) rc;
+}
+
+/** Wakeup a thread sleeping in a futex
+ *
+ * If there is no thread sleeping in the futex, the wakeup is recorded
+ * and the next sleep returns immediately.
+ *
+ * @param uaddr  Userspace address of the futex counter.
+ *
+ * @return       Error code.
+ */
+sys_errno_t sys_futex_wakeup(uintptr_t uaddr)
+{
+	if (!futex_uaddr_valid(uaddr))
+		return (sys_errno_t) EINVAL;
+
+	futex_t *futex;
+	errno_t rc = futex_get(uaddr, &futex);
+	if (rc != EOK)
+		return (sys_errno_t) rc;
+
+	waitq_wakeup(&futex->wq, WAKEUP_FIRST);
+
+	futex_put(futex);
+	return (sys_errno_t) EOK;
+}
+
+/** Wakeup a thread sleeping in a futex and move the others to another one
+ *
+ * The first thread sleeping in the source futex is woken up the same way
+ * as by sys_futex_wakeup(). All the remaining sleepers are moved to the
+ * destination futex without being woken up. This allows e.g. to wake up
+ * all waiters of a condition variable without having them contend for the
+ * associated mutex at once.
+ *
+ * Requeueing is meant for sleeps without a timeout, since a requeued
+ * thread which times out affects the destination futex.
+ *
+ * @param uaddr   Userspace address of the source futex counter.
+ * @param uaddr2  Userspace address of the destination futex counter.
+ *
+ * @return        Error code.
+ */
+sys_errno_t sys_futex_requeue(uintptr_t uaddr, uintptr_t uaddr2)
+{
+	if ((!futex_uaddr_valid(uaddr)) || (!futex_uaddr_valid(uaddr2)) ||
+	    (uaddr == uaddr2))
+		return (sys_errno_t) EINVAL;
+
+	futex_t *src;
+	errno_t rc = futex_get(uaddr, &src);
+	if (rc != EOK)
+		return (sys_errno_t) rc;
+
+	futex_t *dst;
+	rc = futex_get(uaddr2, &dst);
+	if (rc != EOK) {
+		futex_put(src);
+		return (sys_errno_t) rc;
+	}
+
+	/* Lock both wait queues in a fixed order to avoid deadlock. */
+	waitq_t *first = (src < dst) ? &src->wq : &dst->wq;
+	waitq_t *second = (src < dst) ? &dst->wq : &src->wq;
+
+	ipl_t ipl = interrupts_disable();
+	irq_spinlock_lock(&first->lock, false);
+	irq_spinlock_lock(&second->lock, false);
+
+	_waitq_wakeup_unsafe(&src->wq, WAKEUP_FIRST);
+
+	while (!list_empty(&src->wq.sleepers)) {
+		thread_t *thread = list_get_instance(
+		    list_first(&src->wq.sleepers), thread_t, wq_link);
+
+		irq_spinlock_lock(&thread->lock, false);
+
+		list_remove(&thread->wq_link);
+		list_append(&thread->wq_link, &dst->wq.sleepers);
+		thread->sleep_queue = &dst->wq;
+
+		/* The requeued thread drops this reference when it wakes up. */
+		assert(thread->futex == src);
+		thread->futex = dst;
+		atomic_inc(&dst->refcount);
+
+		irq_spinlock_unlock(&thread->lock, false);
+	}
+
+	irq_spinlock_unlock(&second->lock, false);
+	irq_spinlock_unlock(&first->lock, false);
+	interrupts_restore(ipl);
+
+	futex_put(dst);
+	futex_put(src);
+
+	return (sys_errno_t) EOK;
+}
+
+/** Destroy a futex
+ *
+ * Free the futex at the address together with any wakeups recorded in it.
+ * A futex which is later used at the same address starts with no pending
+ * wakeups.
+ *
+ * @param uaddr  Userspace address of the futex counter.
+ *
+ * @return       EOK on success or if there is no futex at the address,
+ *               EBUSY if a thread is using the futex.
+ */
+sys_errno_t sys_futex_destroy(uintptr_t uaddr)
+{
+	if (!futex_uaddr_valid(uaddr))
+		return (sys_errno_t) EINVAL;
+
+	futex_bucket_t *bucket = futex_bucket(TASK, uaddr);
+	errno_t rc = EOK;
+
+	mutex_lock(&bucket->lock);
+
+	futex_t *futex = futex_find(bucket, uaddr);
+	if (futex != NULL) {
+		if (atomic_load(&futex->refcount) == 0)
+			list_remove(&futex->link);
+		else
+			rc = EBUSY;
+	}
+
+	mutex_unlock(&bucket->lock);
+
+	if ((futex != NULL) && (rc == EOK))
+		futex_free(futex);
+
+	return (sys_errno_t) rc;
+}
+
+/** @}
+ */
@@ -40,6 +40,8 @@
 #include <synch/mutex.h>
 #include <synch/semaphore.h>
 #include <arch.h>
+#include <arch/cycle.h>
+#include <preemption.h>
 #include <stacktrace.h>
 #include <cpu.h>
 #include <proc/thread.h>
@@ -53,6 +55,9 @@ void mutex_initialize(mutex_t *mtx, mutex_type_t type)
 {
 	mtx->type = type;
 	mtx->owner = NULL;
+	mtx->owner_cpu = NULL;
+	mtx->locked_cycle = 0;
+	mtx->contended = false;
 	mtx->nesting = 0;
 	semaphore_initialize(&mtx->sem, 1);
 }
@@ -70,6 +75,88 @@ bool mutex_locked(mutex_t *mtx)
 
 #define MUTEX_DEADLOCK_THRESHOLD	100000000
 
+/** Maximum number of iterations spent spinning on a held mutex. */
+#define MUTEX_SPIN_LIMIT	10000
+
+/** Spin while the owner of the mutex is running on another processor.
+ *
+ * Critical sections protected by passive mutexes are often short, so
+ * if the owner is running, it is likely to release the mutex sooner
+ * than it would take to put the current thread to sleep and wake it up
+ * again. The owner fields are read without any locking, which is fine
+ * because the owner thread is only compared, never dereferenced.
+ *
+ * @param mtx  Mutex.
+ *
+ * @return  True if the mutex was acquired, false if the caller should
+ *          sleep.
+ */
+static bool mutex_spin(mutex_t *mtx)
+{
+	for (unsigned int i = 0; i < MUTEX_SPIN_LIMIT; i++) {
+		thread_t *owner = mtx->owner;
+		cpu_t *cpu = mtx->owner_cpu;
+
+		if (owner == NULL) {
+			/* The mutex is being released or handed over. */
+			if (semaphore_trydown(&mtx->sem) == EOK)
+				return true;
+		} else if ((cpu == NULL) || (cpu == CPU) ||
+		    (cpu->running != owner)) {
+			/* The owner is not running, stop wasting cycles. */
+			return false;
+		}
+
+		cpu_spin_hint();
+	}
+
+	return false;
+}
+
+/** Acquire a passive or recursive mutex, spinning adaptively.
+ *
+ * @param mtx    Mutex.
+ * @param usec   Timeout in microseconds.
+ * @param flags  Specify mode of operation.
+ *
+ * @return See comment for waitq_sleep_timeout().
+ *
+ */
+static errno_t mutex_acquire(mutex_t *mtx, uint32_t usec, unsigned int flags)
+{
+	errno_t rc = semaphore_trydown(&mtx->sem);
+	if ((rc == EOK) || ((usec == SYNCH_NO_TIMEOUT) &&
+	    (flags & SYNCH_FLAGS_NON_BLOCKING)))
+		return rc;
+
+	/* The mutex is contended. */
+	mtx->contended = true;
+	uint64_t begin = get_cycle();
+
+	bool spun = mutex_spin(mtx);
+	if (spun)
+		rc = EOK;
+	else
+		rc = _semaphore_down_timeout(&mtx->sem, usec, flags);
+
+	preemption_disable();
+	CPU->mutex_waits++;
+	if (spun)
+		CPU->mutex_spins++;
+	CPU->mutex_wait_cycles += get_cycle() - begin;
+	preemption_enable();
+
+	return rc;
+}
+
+/** Record the current thread as the owner of the mutex. */
+static void mutex_owned(mutex_t *mtx)
+{
+	mtx->owner = THREAD;
+	mtx->owner_cpu = CPU;
+	mtx->locked_cycle = get_cycle();
+}
+
 /** Acquire mutex.
  *
  * Timeout mode and non-blocking mode can be requested.
@@ -89,7 +176,9 @@ errno_t _mutex_lock_timeout(mutex_t *mtx, uint32_t usec, unsigned int flags)
 	errno_t rc;
 
 	if (mtx->type == MUTEX_PASSIVE && THREAD) {
-		rc = _semaphore_down_timeout(&mtx->sem, usec, flags);
+		rc = mutex_acquire(mtx, usec, flags);
+		if (rc == EOK)
+			mutex_owned(mtx);
 	} else if (mtx->type == MUTEX_RECURSIVE) {
 		assert(THREAD);
 
@@ -97,9 +186,9 @@ errno_t _mutex_lock_timeout(mutex_t *mtx, uint32_t usec, unsigned int flags)
 			mtx->nesting++;
 			return EOK;
 		} else {
-			rc = _semaphore_down_timeout(&mtx->sem, usec, flags);
+			rc = mutex_acquire(mtx, usec, flags);
 			if (rc == EOK) {
-				mtx->owner = THREAD;
+				mutex_owned(mtx);
 				mtx->nesting = 1;
 			}
 		}
@@ -137,8 +226,21 @@ void mutex_unlock(mutex_t *mtx)
 		assert(mtx->owner == THREAD);
 		if (--mtx->nesting > 0)
 			return;
+	}
+
+	if (mtx->owner != NULL) {
+		if (mtx->contended) {
+			mtx->contended = false;
+
+			preemption_disable();
+			CPU->mutex_hold_cycles += get_cycle() - mtx->locked_cycle;
+			preemption_enable();
+		}
+
 		mtx->owner = NULL;
+		mtx->owner_cpu = NULL;
 	}
+
 	semaphore_up(&mtx->sem);
 }
 
@@ -79,6 +79,8 @@ void spinlock_lock_debug(spinlock_t *lock)
 
 	preemption_disable();
 	while (atomic_flag_test_and_set_explicit(&lock->flag, memory_order_acquire)) {
+		cpu_spin_hint();
+
 		/*
 		 * We need to be careful about particular locks
 		 * which are directly used to report deadlocks
@@ -104,16 +104,15 @@ sys_errno_t sys_waitq_create(uspace_ptr_cap_waitq_handle_t whandle)
 	cap_handle_t handle;
 	errno_t rc = cap_alloc(TASK, &handle);
 	if (rc != EOK) {
-		slab_free(waitq_cache, wq);
-		kobject_free(kobj);
+		/* Destroys the waitq as well */
+		kobject_put(kobj);
 		return (sys_errno_t) rc;
 	}
 
 	rc = copy_to_uspace(whandle, &handle, sizeof(handle));
 	if (rc != EOK) {
 		cap_free(TASK, handle);
-		kobject_free(kobj);
-		slab_free(waitq_cache, wq);
+		kobject_put(kobj);
 		return (sys_errno_t) rc;
 	}
 
@@ -47,6 +47,7 @@
 #include <ipc/sysipc.h>
 #include <synch/smc.h>
 #include <synch/syswaitq.h>
+#include <synch/futex.h>
 #include <ddi/ddi.h>
 #include <ipc/event.h>
 #include <security/perm.h>
@@ -54,6 +55,7 @@
 #include <console/console.h>
 #include <udebug/udebug.h>
 #include <log.h>
+#include <tracebuf.h>
 
 static syshandler_t syscall_table[] = {
 	/* System management syscalls. */
@@ -77,6 +79,10 @@ static syshandler_t syscall_table[] = {
 	[SYS_WAITQ_SLEEP] = (syshandler_t) sys_waitq_sleep,
 	[SYS_WAITQ_WAKEUP] = (syshandler_t) sys_waitq_wakeup,
 	[SYS_WAITQ_DESTROY] = (syshandler_t) sys_waitq_destroy,
+	[SYS_FUTEX_SLEEP] = (syshandler_t) sys_futex_sleep,
+	[SYS_FUTEX_WAKEUP] = (syshandler_t) sys_futex_wakeup,
+	[SYS_FUTEX_REQUEUE] = (syshandler_t) sys_futex_requeue,
+	[SYS_FUTEX_DESTROY] = (syshandler_t) sys_futex_destroy,
 	[SYS_SMC_COHERENCE] = (syshandler_t) sys_smc_coherence,
 
 	/* Address space related syscalls. */
@@ -133,6 +139,8 @@ static syshandler_t syscall_table[] = {
 	[SYS_DEBUG_CONSOLE] = (syshandler_t) sys_debug_console,
 
 	[SYS_KLOG] = (syshandler_t) sys_klog,
+
+	[SYS_TRACEBUF_CONTROL] = (syshandler_t) sys_tracebuf_control,
 };
 
 /** Dispatch system call */
@@ -160,6 +168,8 @@ sysarg_t syscall_handler(sysarg_t a1, sysarg_t a2, sysarg_t a3,
 		udebug_syscall_event(a1, a2, a3, a4, a5, a6, id, 0, false);
 #endif
 
+	tracebuf_event(TRACEBUF_SYSCALL, id, 0);
+
 	sysarg_t rc;
 	if (id < sizeof_array(syscall_table)) {
 		rc = syscall_table[id](a1, a2, a3, a4, a5, a6);
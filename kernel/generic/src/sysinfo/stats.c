@@ -52,6 +52,10 @@
 #include <cpu.h>
 #include <arch.h>
 #include <stdlib.h>
+#include <barrier.h>
+#include <ddi/ddi.h>
+#include <log.h>
+#include <mem.h>
 
 /** Bits of fixed-point precision for load */
 #define LOAD_FIXED_SHIFT  11
@@ -68,6 +72,9 @@
 /** Compute load in 5 second intervals */
 #define LOAD_INTERVAL  5
 
+/** Number of entries in the shared task statistics page */
+#define STATS_PAGE_ENTRIES  512
+
 /** IPC connections statistics state */
 typedef struct {
 	bool counting;
@@ -91,6 +98,18 @@ static load_t avenrdy[LOAD_STEPS] = { 0, 0, 0 };
 /** Load calculation lock */
 static mutex_t load_lock;
 
+/** Shared task statistics page */
+static stats_page_t *stats_page = NULL;
+
+/** Physical memory area of the shared task statistics page */
+static parea_t stats_parea;
+
+/** Entries of the shared task statistics page in use */
+static bool stats_page_used[STATS_PAGE_ENTRIES];
+
+/** Protects allocation of the shared task statistics page entries */
+IRQ_SPINLOCK_STATIC_INITIALIZE(stats_page_lock);
+
 /** Get statistics of all CPUs
  *
  * @param item    Sysinfo item (unused).
@@ -125,6 +144,10 @@ static void *get_stats_cpus(struct sysinfo_item *item, size_t *size,
 		stats_cpus[i].frequency_mhz = cpus[i].frequency_mhz;
 		stats_cpus[i].busy_cycles = cpus[i].busy_cycles;
 		stats_cpus[i].idle_cycles = cpus[i].idle_cycles;
+		stats_cpus[i].mutex_waits = cpus[i].mutex_waits;
+		stats_cpus[i].mutex_spins = cpus[i].mutex_spins;
+		stats_cpus[i].mutex_wait_cycles = cpus[i].mutex_wait_cycles;
+		stats_cpus[i].mutex_hold_cycles = cpus[i].mutex_hold_cycles;
 
 		irq_spinlock_unlock(&cpus[i].lock, true);
 	}
@@ -132,80 +155,6 @@ static void *get_stats_cpus(struct sysinfo_item *item, size_t *size,
 	return ((void *) stats_cpus);
 }
 
-/** Get the size of a virtual address space
- *
- * @param as Address space.
- *
- * @return Size of the mapped virtual address space (bytes).
- *
- */
-static size_t get_task_virtmem(as_t *as)
-{
-	/*
-	 * We are holding spinlocks here and therefore are not allowed to
-	 * block. Only attempt to lock the address space and address space
-	 * area mutexes conditionally. If it is not possible to lock either
-	 * object, return inexact statistics by skipping the respective object.
-	 */
-
-	if (mutex_trylock(&as->lock) != EOK)
-		return 0;
-
-	size_t pages = 0;
-
-	/* Walk areas in the address space and count pages */
-	as_area_t *area = as_area_first(as);
-	while (area != NULL) {
-		if (mutex_trylock(&area->lock) != EOK)
-			continue;
-
-		pages += area->pages;
-		mutex_unlock(&area->lock);
-		area = as_area_next(area);
-	}
-
-	mutex_unlock(&as->lock);
-
-	return (pages << PAGE_WIDTH);
-}
-
-/** Get the resident (used) size of a virtual address space
- *
- * @param as Address space.
- *
- * @return Size of the resident (used) virtual address space (bytes).
- *
- */
-static size_t get_task_resmem(as_t *as)
-{
-	/*
-	 * We are holding spinlocks here and therefore are not allowed to
-	 * block. Only attempt to lock the address space and address space
-	 * area mutexes conditionally. If it is not possible to lock either
-	 * object, return inexact statistics by skipping the respective object.
-	 */
-
-	if (mutex_trylock(&as->lock) != EOK)
-		return 0;
-
-	size_t pages = 0;
-
-	/* Walk areas in the address space and count pages */
-	as_area_t *area = as_area_first(as);
-	while (area != NULL) {
-		if (mutex_trylock(&area->lock) != EOK)
-			continue;
-
-		pages += area->used_space.pages;
-		mutex_unlock(&area->lock);
-		area = as_area_next(area);
-	}
-
-	mutex_unlock(&as->lock);
-
-	return (pages << PAGE_WIDTH);
-}
-
 /** Produce task statistics
  *
  * Summarize task information into task statistics.
@@ -221,8 +170,9 @@ static void produce_stats_task(task_t *task, stats_task_t *stats_task)
 
 	stats_task->task_id = task->taskid;
 	str_cpy(stats_task->name, TASK_NAME_BUFLEN, task->name);
-	stats_task->virtmem = get_task_virtmem(task->as);
-	stats_task->resmem = get_task_resmem(task->as);
+	stats_task->virtmem = atomic_load(&task->as->virt_pages) << PAGE_WIDTH;
+	stats_task->resmem =
+	    atomic_load(&task->as->resident_pages) << PAGE_WIDTH;
 	stats_task->threads = atomic_load(&task->refcount);
 	task_get_accounting(task, &(stats_task->ucycles),
 	    &(stats_task->kcycles));
@@ -864,6 +814,196 @@ void kload(void *arg)
 	}
 }
 
+/** Allocate the shared task statistics page
+ *
+ */
+static void stats_page_init(void)
+{
+	size_t size = sizeof(stats_page_t) +
+	    STATS_PAGE_ENTRIES * sizeof(stats_page_entry_t);
+	size_t frames = SIZE2FRAMES(size);
+
+	uintptr_t faddr = frame_alloc(frames, FRAME_LOWMEM | FRAME_ATOMIC, 0);
+	if (faddr == 0) {
+		log(LF_OTHER, LVL_WARN, "Cannot allocate task statistics page.");
+		return;
+	}
+
+	stats_page_t *page = (stats_page_t *) PA2KA(faddr);
+	memsetb(page, FRAMES2SIZE(frames), 0);
+
+	page->magic = STATS_PAGE_MAGIC;
+	page->entries = STATS_PAGE_ENTRIES;
+	page->used = 0;
+	page->overflow = 0;
+
+	stats_page = page;
+
+	ddi_parea_init(&stats_parea);
+	stats_parea.pbase = faddr;
+	stats_parea.frames = frames;
+	stats_parea.unpriv = true;
+	stats_parea.rdonly = true;
+	stats_parea.mapped = false;
+	ddi_parea_register(&stats_parea);
+
+	sysinfo_set_item_val("stats.faddr", NULL, (sysarg_t) faddr);
+	sysinfo_set_item_val("stats.pages", NULL, frames);
+}
+
+/** Begin an update of a shared task statistics entry */
+static void stats_entry_begin(stats_page_entry_t *entry)
+{
+	entry->seq++;
+	write_barrier();
+}
+
+/** Finish an update of a shared task statistics entry */
+static void stats_entry_end(stats_page_entry_t *entry)
+{
+	write_barrier();
+	entry->seq++;
+}
+
+/** Assign an entry of the shared task statistics page to a task
+ *
+ * If all entries are taken, the task is only counted as overflowing
+ * and user space has to fall back to the system.tasks sysinfo item.
+ *
+ * @param task Newly created task.
+ *
+ */
+void stats_task_attach(task_t *task)
+{
+	task->stats_entry = NULL;
+	task->stats_ucycles = 0;
+	task->stats_kcycles = 0;
+
+	if (stats_page == NULL)
+		return;
+
+	irq_spinlock_lock(&stats_page_lock, true);
+
+	size_t i;
+	for (i = 0; i < STATS_PAGE_ENTRIES; i++) {
+		if (!stats_page_used[i])
+			break;
+	}
+
+	if (i == STATS_PAGE_ENTRIES) {
+		stats_page->overflow++;
+		irq_spinlock_unlock(&stats_page_lock, true);
+		return;
+	}
+
+	stats_page_used[i] = true;
+	if (i >= stats_page->used)
+		stats_page->used = i + 1;
+
+	stats_page_entry_t *entry = &stats_page->tasks[i];
+
+	stats_entry_begin(entry);
+	memsetb(&entry->task, sizeof(entry->task), 0);
+	entry->task.task_id = task->taskid;
+	str_cpy(entry->task.name, TASK_NAME_BUFLEN, task->name);
+	stats_entry_end(entry);
+
+	task->stats_entry = entry;
+
+	irq_spinlock_unlock(&stats_page_lock, true);
+}
+
+/** Release the shared task statistics page entry of a task
+ *
+ * @param task Task being destroyed.
+ *
+ */
+void stats_task_detach(task_t *task)
+{
+	if (stats_page == NULL)
+		return;
+
+	irq_spinlock_lock(&stats_page_lock, true);
+
+	stats_page_entry_t *entry = task->stats_entry;
+	if (entry != NULL) {
+		stats_entry_begin(entry);
+		entry->task.task_id = 0;
+		stats_entry_end(entry);
+
+		stats_page_used[entry - stats_page->tasks] = false;
+		task->stats_entry = NULL;
+	} else {
+		stats_page->overflow--;
+	}
+
+	irq_spinlock_unlock(&stats_page_lock, true);
+}
+
+/** Update the name in the shared task statistics entry of a task
+ *
+ * @param task Task whose name has changed.
+ *
+ */
+void stats_task_rename(task_t *task)
+{
+	irq_spinlock_lock(&task->stats_lock, true);
+
+	stats_page_entry_t *entry = task->stats_entry;
+	if (entry != NULL) {
+		stats_entry_begin(entry);
+		str_cpy(entry->task.name, TASK_NAME_BUFLEN, task->name);
+		stats_entry_end(entry);
+	}
+
+	irq_spinlock_unlock(&task->stats_lock, true);
+}
+
+/** Publish statistics of the task of a thread
+ *
+ * Add the CPU cycles consumed by the thread since the previous call to
+ * the shared task statistics entry and refresh the memory and IPC
+ * counters of the task. This is done whenever a thread leaves the CPU,
+ * so the entry never lags behind by more than a time slice of each
+ * running thread.
+ *
+ * @param thread Thread whose accounting was just updated.
+ *
+ */
+void stats_thread_publish(thread_t *thread)
+{
+	assert(interrupts_disabled());
+	assert(irq_spinlock_locked(&thread->lock));
+
+	task_t *task = thread->task;
+	if ((task->stats_entry == NULL) || (thread->uncounted))
+		return;
+
+	uint64_t ucycles = thread->ucycles - thread->ucycles_published;
+	uint64_t kcycles = thread->kcycles - thread->kcycles_published;
+	thread->ucycles_published = thread->ucycles;
+	thread->kcycles_published = thread->kcycles;
+
+	irq_spinlock_lock(&task->stats_lock, false);
+
+	task->stats_ucycles += ucycles;
+	task->stats_kcycles += kcycles;
+
+	stats_page_entry_t *entry = task->stats_entry;
+	stats_entry_begin(entry);
+	entry->task.virtmem =
+	    atomic_load(&task->as->virt_pages) << PAGE_WIDTH;
+	entry->task.resmem =
+	    atomic_load(&task->as->resident_pages) << PAGE_WIDTH;
+	entry->task.threads = atomic_load(&task->refcount);
+	entry->task.ucycles = task->stats_ucycles;
+	entry->task.kcycles = task->stats_kcycles;
+	entry->task.ipc_info = task->ipc_info;
+	stats_entry_end(entry);
+
+	irq_spinlock_unlock(&task->stats_lock, false);
+}
+
 /** Register sysinfo statistical items
  *
  */
@@ -881,6 +1021,8 @@ void stats_init(void)
 	sysinfo_set_subtree_fn("system.tasks", NULL, get_stats_task, NULL);
 	sysinfo_set_subtree_fn("system.threads", NULL, get_stats_thread, NULL);
 	sysinfo_set_subtree_fn("system.exceptions", NULL, get_stats_exception, NULL);
+
+	stats_page_init();
 }
 
 /** @}
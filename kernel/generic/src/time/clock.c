@@ -57,6 +57,7 @@
 #include <mm/frame.h>
 #include <ddi/ddi.h>
 #include <arch/cycle.h>
+#include <tracebuf.h>
 
 /* Pointer to variable with uptime */
 uptime_t *uptime;
@@ -147,6 +148,9 @@ void clock(void)
 {
 	size_t missed_clock_ticks = CPU->missed_clock_ticks;
 
+	/* Sample the interrupted program counter */
+	tracebuf_tick();
+
 	/* Account CPU usage */
 	cpu_update_accounting();
 
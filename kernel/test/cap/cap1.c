@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+#include <atomic.h>
+#include <cap/cap.h>
+#include <ipc/ipc.h>
+#include <proc/thread.h>
+
+#include <arch.h>
+
+#define READERS  4
+#define ROUNDS   100000
+
+static cap_handle_t handle;
+static atomic_t finish;
+static atomic_t readers_finished;
+
+/** Look the capability up while the main thread keeps recycling it. */
+static void reader(void *data)
+{
+	thread_detach(THREAD);
+
+	while (!atomic_load(&finish)) {
+		kobject_t *kobj = kobject_get(TASK, handle, KOBJECT_TYPE_CALL);
+		if (kobj)
+			kobject_put(kobj);
+	}
+	atomic_inc(&readers_finished);
+}
+
+const char *test_cap1(void)
+{
+	const char *err = NULL;
+	size_t total = 0;
+
+	if (cap_alloc(TASK, &handle) != EOK)
+		return "Could not allocate a capability";
+
+	atomic_store(&finish, 0);
+	atomic_store(&readers_finished, 0);
+
+	for (unsigned int i = 0; i < READERS; i++) {
+		thread_t *t = thread_create(reader, NULL, TASK,
+		    THREAD_FLAG_NONE, "cap1");
+		if (!t) {
+			TPRINTF("Could not create thread %u\n", i);
+			break;
+		}
+		thread_ready(t);
+		total++;
+	}
+
+	TPRINTF("Recycling the capability object %d times...\n", ROUNDS);
+
+	for (unsigned int i = 0; i < ROUNDS; i++) {
+		call_t *call = ipc_call_alloc();
+		if (!call) {
+			err = "Could not allocate a call";
+			break;
+		}
+
+		cap_publish(TASK, handle, call->kobject);
+		kobject_t *kobj = cap_unpublish(TASK, handle,
+		    KOBJECT_TYPE_CALL);
+		kobject_put(kobj);
+
+		/* Dispose of an object that was never published. */
+		call = ipc_call_alloc();
+		if (!call) {
+			err = "Could not allocate a call";
+			break;
+		}
+		kobject_put(call->kobject);
+	}
+
+	/*
+	 * A reader that resurrected a freed object would leave the next
+	 * published object with more than the single reference of the
+	 * capability once all readers are gone.
+	 */
+	call_t *call = ipc_call_alloc();
+	if (call)
+		cap_publish(TASK, handle, call->kobject);
+
+	atomic_store(&finish, 1);
+	while (atomic_load(&readers_finished) < total) {
+		TPRINTF("Readers left: %zu\n",
+		    total - atomic_load(&readers_finished));
+		thread_usleep(100000);
+	}
+
+	if (call) {
+		kobject_t *kobj = cap_unpublish(TASK, handle,
+		    KOBJECT_TYPE_CALL);
+		if (!err && atomic_load(&kobj->refcnt) != 1)
+			err = "Stale reference to a freed object";
+		kobject_put(kobj);
+	} else if (!err) {
+		err = "Could not allocate a call";
+	}
+
+	cap_free(TASK, handle);
+	return err;
+}
@@ -40,6 +40,7 @@ bool test_quiet;
 
 test_t tests[] = {
 #include <atomic/atomic1.def>
+#include <cap/cap1.def>
 #include <debug/mips1.def>
 #include <fault/fault1.def>
 #include <mm/falloc1.def>
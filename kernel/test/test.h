@@ -57,6 +57,7 @@ typedef struct {
 } test_t;
 
 extern const char *test_atomic1(void);
+extern const char *test_cap1(void);
 extern const char *test_mips1(void);
 extern const char *test_fault1(void);
 extern const char *test_falloc1(void);
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup blkbench
+ * @{
+ */
+
+/** @file
+ * Block device benchmark
+ *
+ * Issues read or write requests to a block device from a number of
+ * concurrent connections and reports the achieved IOPS and bandwidth.
+ *
+ */
+
+#include <bd.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <inttypes.h>
+#include <ipc/services.h>
+#include <loc.h>
+#include <macros.h>
+#include <perf.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+
+#define NAME  "blkbench"
+
+#define DEFAULT_DEPTH  1
+#define DEFAULT_BLOCKS  8
+#define DEFAULT_REQUESTS  10000
+
+/** Benchmark worker, one per outstanding request */
+typedef struct {
+	/** Session to the block device */
+	async_sess_t *sess;
+
+	/** Block device connection */
+	bd_t *bd;
+
+	/** Number of requests to make */
+	size_t requests;
+
+	/** Number of completed requests */
+	size_t done;
+
+	/** Next block for sequential access */
+	aoff64_t next;
+
+	/** Error which stopped the worker */
+	errno_t rc;
+} worker_t;
+
+static size_t blocks = DEFAULT_BLOCKS;
+static size_t block_size;
+static aoff64_t num_blocks;
+static bool random_access = false;
+static bool write_access = false;
+
+static FIBRIL_MUTEX_INITIALIZE(workers_lock);
+static FIBRIL_CONDVAR_INITIALIZE(workers_cv);
+static size_t workers_running;
+
+static void syntax_print(void)
+{
+	fprintf(stderr, "Usage: %s [<options>] <device>\n", NAME);
+	fprintf(stderr, "  -b <count>  Blocks per request (default %d)\n",
+	    DEFAULT_BLOCKS);
+	fprintf(stderr, "  -d <count>  Queue depth, i.e. number of outstanding "
+	    "requests (default %d)\n", DEFAULT_DEPTH);
+	fprintf(stderr, "  -n <count>  Total number of requests (default %d)\n",
+	    DEFAULT_REQUESTS);
+	fprintf(stderr, "  -r          Random instead of sequential access\n");
+	fprintf(stderr, "  -w          Write instead of read "
+	    "(destroys data on the device)\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  e.g. %s -d 16 -r "
+	    "devices/\\hw\\pci0\\00:04.0\\port0\n", NAME);
+}
+
+/** Choose the first block of the next request */
+static aoff64_t next_block(worker_t *worker)
+{
+	aoff64_t slots = num_blocks / blocks;
+
+	if (random_access) {
+		uint64_t r = (uint64_t) rand() * ((uint64_t) RAND_MAX + 1) +
+		    (uint64_t) rand();
+		return (r % slots) * blocks;
+	}
+
+	aoff64_t ba = worker->next;
+	worker->next = (worker->next + blocks) % (slots * blocks);
+	return ba;
+}
+
+static errno_t worker_fibril(void *arg)
+{
+	worker_t *worker = (worker_t *) arg;
+	size_t size = blocks * block_size;
+
+	void *buf = calloc(1, size);
+	if (buf == NULL) {
+		worker->rc = ENOMEM;
+		goto out;
+	}
+
+	while (worker->done < worker->requests) {
+		aoff64_t ba = next_block(worker);
+
+		if (write_access)
+			worker->rc = bd_write_blocks(worker->bd, ba, blocks,
+			    buf, size);
+		else
+			worker->rc = bd_read_blocks(worker->bd, ba, blocks,
+			    buf, size);
+
+		if (worker->rc != EOK)
+			break;
+
+		worker->done++;
+	}
+
+	free(buf);
+out:
+	fibril_mutex_lock(&workers_lock);
+	workers_running--;
+	fibril_condvar_broadcast(&workers_cv);
+	fibril_mutex_unlock(&workers_lock);
+
+	return EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t depth = DEFAULT_DEPTH;
+	size_t requests = DEFAULT_REQUESTS;
+	worker_t *workers = NULL;
+	errno_t rc;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] != '-')
+			break;
+
+		if (str_cmp(argv[i], "-r") == 0) {
+			random_access = true;
+			continue;
+		}
+
+		if (str_cmp(argv[i], "-w") == 0) {
+			write_access = true;
+			continue;
+		}
+
+		size_t *value;
+		if (str_cmp(argv[i], "-b") == 0)
+			value = &blocks;
+		else if (str_cmp(argv[i], "-d") == 0)
+			value = &depth;
+		else if (str_cmp(argv[i], "-n") == 0)
+			value = &requests;
+		else
+			value = NULL;
+
+		if ((value == NULL) || (i + 1 >= argc) ||
+		    (str_size_t(argv[i + 1], NULL, 10, true, value) != EOK) ||
+		    (*value == 0)) {
+			syntax_print();
+			return 1;
+		}
+
+		i++;
+	}
+
+	if (i + 1 != argc) {
+		syntax_print();
+		return 1;
+	}
+
+	service_id_t service_id;
+	rc = loc_service_get_id(argv[i], &service_id, 0);
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Cannot resolve device '%s'.\n", NAME,
+		    argv[i]);
+		return 1;
+	}
+
+	depth = min(depth, requests);
+	workers = calloc(depth, sizeof(worker_t));
+	if (workers == NULL) {
+		fprintf(stderr, "%s: Out of memory.\n", NAME);
+		return 1;
+	}
+
+	/*
+	 * The block device server handles requests of one connection one
+	 * after another, so every outstanding request needs its own.
+	 */
+	for (size_t w = 0; w < depth; w++) {
+		workers[w].sess = loc_service_connect(service_id,
+		    INTERFACE_BLOCK, IPC_FLAG_BLOCKING);
+		if (workers[w].sess == NULL) {
+			rc = EIO;
+			goto error;
+		}
+
+		rc = bd_open(workers[w].sess, &workers[w].bd);
+		if (rc != EOK)
+			goto error;
+
+		workers[w].requests = requests / depth +
+		    ((w < requests % depth) ? 1 : 0);
+	}
+
+	rc = bd_get_block_size(workers[0].bd, &block_size);
+	if (rc == EOK)
+		rc = bd_get_num_blocks(workers[0].bd, &num_blocks);
+	if (rc != EOK)
+		goto error;
+
+	if (num_blocks < blocks) {
+		fprintf(stderr, "%s: Device has only %" PRIuOFF64 " blocks.\n",
+		    NAME, num_blocks);
+		rc = EINVAL;
+		goto error;
+	}
+
+	/* Spread sequential streams of the workers over the device */
+	for (size_t w = 0; w < depth; w++)
+		workers[w].next = (num_blocks / blocks / depth) * w * blocks;
+
+	printf("%s: %zu %s %s requests of %zu B, queue depth %zu\n", NAME,
+	    requests, random_access ? "random" : "sequential",
+	    write_access ? "write" : "read", blocks * block_size, depth);
+
+	stopwatch_t stopwatch;
+	stopwatch_init(&stopwatch);
+	stopwatch_start(&stopwatch);
+
+	workers_running = depth;
+	for (size_t w = 0; w < depth; w++) {
+		fid_t fid = fibril_create(worker_fibril, &workers[w]);
+		if (fid == 0) {
+			workers[w].rc = ENOMEM;
+			fibril_mutex_lock(&workers_lock);
+			workers_running--;
+			fibril_mutex_unlock(&workers_lock);
+			continue;
+		}
+
+		fibril_add_ready(fid);
+	}
+
+	fibril_mutex_lock(&workers_lock);
+	while (workers_running > 0)
+		fibril_condvar_wait(&workers_cv, &workers_lock);
+	fibril_mutex_unlock(&workers_lock);
+
+	stopwatch_stop(&stopwatch);
+
+	size_t done = 0;
+	for (size_t w = 0; w < depth; w++) {
+		done += workers[w].done;
+
+		if (workers[w].rc != EOK) {
+			fprintf(stderr, "%s: Worker %zu failed: %s.\n", NAME, w,
+			    str_error(workers[w].rc));
+		}
+	}
+
+	nsec_t nsec = stopwatch_get_nanos(&stopwatch);
+	uint64_t usec = max(NSEC2USEC(nsec), 1);
+	uint64_t bytes = (uint64_t) done * blocks * block_size;
+
+	printf("%s: %zu of %zu requests completed in %" PRIu64 " ms\n", NAME,
+	    done, requests, usec / 1000);
+	printf("%s: %" PRIu64 " IOPS, %" PRIu64 " KiB/s, %" PRIu64
+	    " us average latency\n", NAME, (uint64_t) done * 1000000 / usec,
+	    bytes * 1000000 / 1024 / usec,
+	    (done > 0) ? usec * depth / done : 0);
+
+	rc = (done == requests) ? EOK : EIO;
+	goto out;
+error:
+	fprintf(stderr, "%s: Failed opening device '%s': %s.\n", NAME, argv[i],
+	    str_error(rc));
+out:
+	for (size_t w = 0; w < depth; w++) {
+		if (workers[w].bd != NULL)
+			bd_close(workers[w].bd);
+		if (workers[w].sess != NULL)
+			async_hangup(workers[w].sess);
+	}
+
+	free(workers);
+	return (rc == EOK) ? 0 : 1;
+}
+
+/** @}
+ */
@@ -0,0 +1,4 @@
+/** @addtogroup blkbench blkbench
+ * @brief Block device benchmark
+ * @ingroup apps
+ */
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup chkext4
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Tool for checking consistency of Ext4 file systems.
+ */
+
+#include <errno.h>
+#include <ext4/filesystem.h>
+#include <inttypes.h>
+#include <loc.h>
+#include <stdio.h>
+#include <str.h>
+#include <str_error.h>
+
+#define NAME	"chkext4"
+
+static void syntax_print(void);
+
+int main(int argc, char **argv)
+{
+	errno_t rc;
+	char *dev_path;
+	service_id_t service_id;
+	ext4_check_t check;
+
+	if (argc < 2) {
+		printf(NAME ": Error, argument missing.\n");
+		syntax_print();
+		return 1;
+	}
+
+	if (str_cmp(argv[1], "--help") == 0) {
+		syntax_print();
+		return 0;
+	}
+
+	if (argc != 2) {
+		printf(NAME ": Error, unexpected argument.\n");
+		syntax_print();
+		return 1;
+	}
+
+	dev_path = argv[1];
+	printf("Device: %s\n", dev_path);
+
+	rc = loc_service_get_id(dev_path, &service_id, 0);
+	if (rc != EOK) {
+		printf(NAME ": Error resolving device `%s'.\n", dev_path);
+		return 2;
+	}
+
+	rc = ext4_filesystem_check(service_id, &check);
+	if (rc != EOK) {
+		printf(NAME ": Error checking file system: %s.\n",
+		    str_error(rc));
+		return 3;
+	}
+
+	if ((check.state & EXT4_SUPERBLOCK_STATE_ERROR_FS) != 0)
+		printf("State: not unmounted cleanly or errors detected\n");
+	else if ((check.state & EXT4_SUPERBLOCK_STATE_VALID_FS) == 0)
+		printf("State: not unmounted cleanly\n");
+	else
+		printf("State: clean\n");
+
+	printf("Block groups: %" PRIu32 "\n", check.groups);
+	printf("Free blocks: %" PRIu64 " (superblock: %" PRIu64 ")\n",
+	    check.free_blocks, check.sb_free_blocks);
+	printf("Free i-nodes: %" PRIu32 " (superblock: %" PRIu32 ")\n",
+	    check.free_inodes, check.sb_free_inodes);
+
+	if (check.bad_descriptors != 0) {
+		printf("Block group descriptors corrupted: %" PRIu32 "\n",
+		    check.bad_descriptors);
+	}
+
+	if (check.bad_free_blocks != 0) {
+		printf("Block groups with wrong free blocks count: %" PRIu32
+		    "\n", check.bad_free_blocks);
+	}
+
+	if (check.bad_free_inodes != 0) {
+		printf("Block groups with wrong free i-nodes count: %" PRIu32
+		    "\n", check.bad_free_inodes);
+	}
+
+	if (check.lost_inodes != 0) {
+		printf("I-nodes in use marked free: %" PRIu32 "\n",
+		    check.lost_inodes);
+	}
+
+	if (check.bad_descriptors != 0 || check.bad_free_blocks != 0 ||
+	    check.bad_free_inodes != 0 || check.lost_inodes != 0) {
+		printf("File system is inconsistent.\n");
+		return 4;
+	}
+
+	printf("File system is consistent.\n");
+	return 0;
+}
+
+static void syntax_print(void)
+{
+	printf("syntax: chkext4 <device_name>\n");
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,4 @@
+/** @addtogroup chkext4 chkext4
+ * @brief Tool for checking consistency of Ext4 file systems
+ * @ingroup apps
+ */
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "bench.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using bench_clock = std::chrono::steady_clock;
+
+    /**
+     * Keys are drawn from a simple LCG so that the
+     * benchmark does not depend on <random> and keys
+     * are not inserted in hash order.
+     */
+    std::vector<std::uint64_t> make_keys(std::size_t count, std::uint64_t seed)
+    {
+        std::vector<std::uint64_t> keys{};
+        keys.reserve(count);
+
+        auto x = seed;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            keys.push_back(x >> 16);
+        }
+
+        return keys;
+    }
+
+    long long elapsed_us(bench_clock::time_point start)
+    {
+        return static_cast<long long>((bench_clock::now() - start).count());
+    }
+
+    template<class Map>
+    void bench_map(const char* name, const std::vector<std::uint64_t>& keys,
+                   const std::vector<std::uint64_t>& missing)
+    {
+        Map map{};
+
+        auto start = bench_clock::now();
+        for (auto key: keys)
+            map.emplace(key, key);
+        auto insert_us = elapsed_us(start);
+
+        std::uint64_t sum{};
+        start = bench_clock::now();
+        for (auto key: keys)
+        {
+            auto it = map.find(key);
+            if (it != map.end())
+                sum += it->second;
+        }
+        auto hit_us = elapsed_us(start);
+
+        start = bench_clock::now();
+        for (auto key: missing)
+            sum += map.count(key);
+        auto miss_us = elapsed_us(start);
+
+        start = bench_clock::now();
+        for (auto key: keys)
+            map.erase(key);
+        auto erase_us = elapsed_us(start);
+
+        std::printf("%-20s %10zu %12lld %12lld %12lld %12lld%s\n", name,
+                    keys.size(), insert_us, hit_us, miss_us, erase_us,
+                    map.empty() && sum != 0 ? "" : " (!)");
+    }
+}
+
+namespace bench
+{
+    void hash_tables(std::size_t max_count)
+    {
+        std::printf("%-20s %10s %12s %12s %12s %12s\n", "container",
+                    "elements", "insert [us]", "hit [us]", "miss [us]",
+                    "erase [us]");
+
+        for (std::size_t count = 1000; count <= max_count; count *= 10)
+        {
+            auto keys = make_keys(count, 1);
+            auto missing = make_keys(count, 2);
+
+            bench_map<std::unordered_map<std::uint64_t, std::uint64_t>>(
+                "unordered_map", keys, missing
+            );
+            bench_map<std::aux::flat_unordered_map<std::uint64_t, std::uint64_t>>(
+                "flat_unordered_map", keys, missing
+            );
+        }
+    }
+}
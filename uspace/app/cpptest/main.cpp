@@ -27,6 +27,7 @@
  */
 
 #include <__bits/test/tests.hpp>
+#include "bench.hpp"
 
 /* using namespace std::chrono_literals; */
 
@@ -100,8 +101,29 @@
 
 #include <__bits/trycatch.hpp>
 
-int main()
+static void print_usage(const char* name)
 {
+    std::printf("Usage: %s [--bench [<max elements>]]\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+    {
+        if (std::strcmp(argv[1], "--bench") != 0 || argc > 3)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+
+        std::size_t max_count{10'000'000};
+        if (argc == 3)
+            max_count = ::strtoul(argv[2], nullptr, 10);
+
+        bench::hash_tables(max_count);
+        return 0;
+    }
+
     std::test::test_set ts{};
     ts.add<std::test::vector_test>();
     ts.add<std::test::string_test>();
@@ -121,6 +143,7 @@ int main()
     ts.add<std::test::functional_test>();
     ts.add<std::test::algorithm_test>();
     ts.add<std::test::future_test>();
+    ts.add<std::test::thread_test>();
 
     return ts.run(true) ? 0 : 1;
 }
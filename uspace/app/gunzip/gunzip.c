@@ -34,16 +34,77 @@
 
 #include <errno.h>
 #include <gzip.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+/** Size of the input and output buffers */
+#define BUFFER_SIZE  65536
+
+/** Decompress a GZIP stream from one file to another
+ *
+ * The data are processed in chunks, thus the memory usage does not
+ * depend on the size of the file.
+ *
+ * @param dec   GZIP decoder.
+ * @param f     Source file.
+ * @param wf    Destination file.
+ * @param ibuf  Input buffer (BUFFER_SIZE bytes).
+ * @param obuf  Output buffer (BUFFER_SIZE bytes).
+ *
+ * @return EOK on success.
+ * @return EIO on I/O error.
+ * @return ELIMIT on truncated stream.
+ * @return Other error code on invalid stream.
+ *
+ */
+static errno_t gunzip_stream(gzip_dec_t *dec, FILE *f, FILE *wf,
+    uint8_t *ibuf, uint8_t *obuf)
+{
+	size_t ilen = 0;
+	size_t ipos = 0;
+	bool eof = false;
+
+	while (!gzip_dec_done(dec)) {
+		if ((ipos == ilen) && (!eof)) {
+			ilen = fread(ibuf, 1, BUFFER_SIZE, f);
+			ipos = 0;
+
+			if (ilen < BUFFER_SIZE) {
+				if (ferror(f))
+					return EIO;
+
+				eof = true;
+			}
+		}
+
+		size_t used;
+		size_t produced;
+
+		errno_t rc = gzip_dec_process(dec, ibuf + ipos, ilen - ipos,
+		    &used, obuf, BUFFER_SIZE, &produced);
+		if (rc != EOK)
+			return rc;
+
+		ipos += used;
+
+		if (fwrite(obuf, 1, produced, wf) != produced)
+			return EIO;
+
+		if ((produced == 0) && (ipos == ilen) && (eof) &&
+		    (!gzip_dec_done(dec)))
+			return ELIMIT;
+	}
+
+	return EOK;
+}
+
 int main(int argc, char *argv[])
 {
 	errno_t rc;
-	void *data, *ddata;
-	size_t size, dsize;
-	size_t nread, nwr;
-	long len;
+	gzip_dec_t *dec;
+	uint8_t *ibuf, *obuf;
 	FILE *f, *wf;
 
 	if (argc != 3) {
@@ -51,64 +112,44 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	f = fopen(argv[1], "rb");
-	if (f == NULL) {
-		printf("Error opening '%s'\n", argv[1]);
+	ibuf = malloc(BUFFER_SIZE);
+	obuf = malloc(BUFFER_SIZE);
+	if ((ibuf == NULL) || (obuf == NULL)) {
+		printf("Out of memory.\n");
 		return 1;
 	}
 
-	if (fseek(f, 0, SEEK_END) < 0) {
-		printf("Error determining size of '%s'\n", argv[1]);
-		fclose(f);
+	rc = gzip_dec_create(&dec);
+	if (rc != EOK) {
+		printf("Out of memory.\n");
 		return 1;
 	}
 
-	len = ftell(f);
-	if (len < 0) {
-		printf("Error determining size of '%s'\n", argv[1]);
-		fclose(f);
+	f = fopen(argv[1], "rb");
+	if (f == NULL) {
+		printf("Error opening '%s'\n", argv[1]);
 		return 1;
 	}
 
-	if (fseek(f, 0, SEEK_SET) < 0) {
-		printf ("Error rewinding '%s'\n", argv[1]);
+	wf = fopen(argv[2], "wb");
+	if (wf == NULL) {
+		printf("Error creating file '%s'\n", argv[2]);
 		fclose(f);
 		return 1;
 	}
 
-	data = malloc(len);
-	if (data == NULL) {
-		printf("Error allocating %ld bytes.\n", len);
-		fclose(f);
-		return 1;
-	}
+	rc = gunzip_stream(dec, f, wf, ibuf, obuf);
+	fclose(f);
 
-	nread = fread(data, 1, len, f);
-	if (nread != (size_t)len) {
-		printf("Error reading '%s'\n", argv[1]);
-		fclose(f);
+	if (rc == EIO) {
+		printf("Error reading '%s' or writing '%s'\n", argv[1],
+		    argv[2]);
+		fclose(wf);
 		return 1;
 	}
 
-	fclose(f);
-
-	size = (size_t) len;
-
-	rc = gzip_expand(data, size, &ddata, &dsize);
 	if (rc != EOK) {
 		printf("Error decompressing data.\n");
-		return 1;
-	}
-
-	wf = fopen(argv[2], "wb");
-	if (wf == NULL) {
-		printf("Error creating file '%s'\n", argv[2]);
-		return 1;
-	}
-
-	nwr = fwrite(ddata, 1, dsize, wf);
-	if (nwr != dsize) {
-		printf("Error writing '%s'\n", argv[2]);
 		fclose(wf);
 		return 1;
 	}
@@ -118,6 +159,9 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	gzip_dec_destroy(dec);
+	free(ibuf);
+	free(obuf);
 	return 0;
 }
 
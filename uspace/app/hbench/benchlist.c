@@ -38,8 +38,10 @@
 #include "hbench.h"
 
 benchmark_t *benchmarks[] = {
+	&benchmark_aes,
 	&benchmark_dir_read,
 	&benchmark_fibril_mutex,
+	&benchmark_fibril_mutex_mt,
 	&benchmark_file_read,
 	&benchmark_malloc1,
 	&benchmark_malloc2,
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <crypto.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include "../hbench.h"
+
+#define BUFFER_SIZE 4096
+
+typedef enum {
+	AES_MODE_ECB,
+	AES_MODE_CTR,
+	AES_MODE_GCM,
+	AES_MODE_CCM
+} aes_mode_t;
+
+/** Execute AES throughput benchmark.
+ *
+ * Each iteration processes one buffer of BUFFER_SIZE bytes in the
+ * selected mode (use 'mode' param with one of ecb, ctr, gcm or ccm,
+ * 'keysize' param with 128, 192 or 256 and 'aesni' param set to 'no'
+ * to force the table based implementation).
+ */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *mode = bench_env_param_get(env, "mode", "ctr");
+	const char *keysize = bench_env_param_get(env, "keysize", "128");
+	const char *aesni = bench_env_param_get(env, "aesni", "yes");
+
+	size_t key_len;
+	if (str_cmp(keysize, "128") == 0)
+		key_len = 16;
+	else if (str_cmp(keysize, "192") == 0)
+		key_len = 24;
+	else if (str_cmp(keysize, "256") == 0)
+		key_len = 32;
+	else
+		return bench_run_fail(run, "invalid key size %s", keysize);
+
+	aes_mode_t aes_mode;
+	if (str_cmp(mode, "ecb") == 0)
+		aes_mode = AES_MODE_ECB;
+	else if (str_cmp(mode, "ctr") == 0)
+		aes_mode = AES_MODE_CTR;
+	else if (str_cmp(mode, "gcm") == 0)
+		aes_mode = AES_MODE_GCM;
+	else if (str_cmp(mode, "ccm") == 0)
+		aes_mode = AES_MODE_CCM;
+	else
+		return bench_run_fail(run, "unknown mode %s", mode);
+
+	uint8_t key[32];
+	uint8_t iv[AES_CIPHER_LENGTH];
+	uint8_t tag[AES_CIPHER_LENGTH];
+
+	for (size_t i = 0; i < sizeof(key); i++)
+		key[i] = i;
+
+	memset(iv, 0, sizeof(iv));
+
+	aes_ctx_t ctx;
+	errno_t rc = aes_init(&ctx, key, key_len);
+	if (rc != EOK)
+		return bench_run_fail(run, "failed to prepare key");
+
+	if (str_cmp(aesni, "no") == 0)
+		ctx.aesni = false;
+
+	uint8_t *buf = malloc(BUFFER_SIZE);
+	if (buf == NULL) {
+		return bench_run_fail(run, "failed to allocate %dB buffer", BUFFER_SIZE);
+	}
+
+	memset(buf, 0, BUFFER_SIZE);
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		switch (aes_mode) {
+		case AES_MODE_ECB:
+			for (size_t off = 0; off < BUFFER_SIZE; off += AES_CIPHER_LENGTH)
+				aes_encrypt_block(&ctx, buf + off, buf + off);
+			break;
+		case AES_MODE_CTR:
+			aes_ctr(&ctx, iv, buf, buf, BUFFER_SIZE);
+			break;
+		case AES_MODE_GCM:
+			rc = aes_gcm_encrypt(&ctx, iv, 12, NULL, 0, buf, buf,
+			    BUFFER_SIZE, tag, sizeof(tag));
+			break;
+		case AES_MODE_CCM:
+			rc = aes_ccm_encrypt(&ctx, iv, 13, NULL, 0, buf, buf,
+			    BUFFER_SIZE, tag, 8);
+			break;
+		}
+
+		if (rc != EOK) {
+			free(buf);
+			return bench_run_fail(run, "encryption failed");
+		}
+	}
+	bench_run_stop(run);
+
+	free(buf);
+	return true;
+}
+
+benchmark_t benchmark_aes = {
+	.name = "aes",
+	.desc = "AES encryption throughput, one iteration processes 4KB (use 'mode', 'keysize' and 'aesni' params).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <stdatomic.h>
+#include <str.h>
+#include "../hbench.h"
+
+/*
+ * Benchmark for mutexes contended across threads. Several fibrils, each
+ * (as long as there are enough runner threads) executed by a different
+ * thread, increment a shared counter under a mutex. Unlike in the
+ * fibril_mutex benchmark, the competing fibrils run in parallel and
+ * contention is resolved by sleeping in a kernel futex.
+ *
+ * Use the 'threads' param to set the number of competing fibrils.
+ */
+
+#define DEFAULT_THREADS "4"
+
+/** Number of runner threads spawned so far. */
+static size_t runners_spawned = 0;
+
+typedef struct {
+	fibril_mutex_t mutex;
+	uint64_t counter;
+	uint64_t iterations;
+	atomic_size_t running;
+} shared_t;
+
+static errno_t competitor(void *arg)
+{
+	shared_t *shared = arg;
+	fibril_detach(fibril_get_id());
+
+	for (uint64_t i = 0; i < shared->iterations; i++) {
+		fibril_mutex_lock(&shared->mutex);
+		shared->counter++;
+		fibril_mutex_unlock(&shared->mutex);
+	}
+
+	atomic_fetch_sub(&shared->running, 1);
+
+	return EOK;
+}
+
+static bool get_threads(bench_env_t *env, bench_run_t *run, size_t *threads)
+{
+	const char *value = bench_env_param_get(env, "threads",
+	    DEFAULT_THREADS);
+
+	errno_t rc = str_size_t(value, NULL, 10, true, threads);
+	if ((rc != EOK) || (*threads == 0))
+		return bench_run_fail(run, "invalid number of threads %s", value);
+
+	return true;
+}
+
+static bool setup(bench_env_t *env, bench_run_t *run)
+{
+	size_t threads;
+	if (!get_threads(env, run, &threads))
+		return false;
+
+	/* The main thread is one of the runners already. */
+	while (runners_spawned + 1 < threads) {
+		if (fibril_test_spawn_runners(1) != 1)
+			return bench_run_fail(run, "failed to spawn runner thread");
+		runners_spawned++;
+	}
+
+	return true;
+}
+
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	size_t threads;
+	if (!get_threads(env, run, &threads))
+		return false;
+
+	shared_t shared;
+	fibril_mutex_initialize(&shared.mutex);
+	shared.counter = 0;
+	shared.iterations = size / threads;
+	atomic_store(&shared.running, threads);
+
+	bench_run_start(run);
+
+	for (size_t i = 0; i < threads; i++) {
+		fid_t fid = fibril_create(competitor, &shared);
+		if (fid == 0) {
+			/* Wait for the fibrils already started. */
+			atomic_fetch_sub(&shared.running, threads - i);
+			while (atomic_load(&shared.running) > 0)
+				fibril_yield();
+
+			return bench_run_fail(run, "failed to create fibril");
+		}
+
+		fibril_add_ready(fid);
+	}
+
+	while (atomic_load(&shared.running) > 0)
+		fibril_yield();
+
+	bench_run_stop(run);
+
+	if (shared.counter != shared.iterations * threads) {
+		return bench_run_fail(run, "counter mismatch (%" PRIu64
+		    " instead of %" PRIu64 ")", shared.counter,
+		    shared.iterations * threads);
+	}
+
+	return true;
+}
+
+benchmark_t benchmark_fibril_mutex_mt = {
+	.name = "fibril_mutex_mt",
+	.desc = "Speed of mutex lock/unlock contended across threads",
+	.entry = &runner,
+	.setup = &setup,
+	.teardown = NULL
+};
+
+/** @}
+ */
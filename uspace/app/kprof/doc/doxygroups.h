@@ -0,0 +1,4 @@
+/** @addtogroup kprof kprof
+ * @brief Record and summarize kernel trace events
+ * @ingroup apps
+ */
@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kprof
+ * @{
+ */
+/**
+ * @file Record and summarize kernel trace events.
+ */
+
+#include <barrier.h>
+#include <errno.h>
+#include <fibril.h>
+#include <inttypes.h>
+#include <stats.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <tracebuf.h>
+
+#define NAME  "kprof"
+
+/** Default recording duration in seconds */
+#define DEFAULT_DURATION  1
+
+/** Number of most frequent values to show */
+#define TOP_COUNT  10
+
+static const char *event_names[TRACEBUF_EVENTS] = {
+	[TRACEBUF_SAMPLE] = "sample",
+	[TRACEBUF_SWITCH] = "switch",
+	[TRACEBUF_IPC_SEND] = "ipc_send",
+	[TRACEBUF_IPC_ANSWER] = "ipc_answer",
+	[TRACEBUF_PAGE_FAULT] = "fault",
+	[TRACEBUF_SYSCALL] = "syscall",
+	[TRACEBUF_IRQ] = "irq"
+};
+
+/** Value with the number of its occurrences */
+typedef struct {
+	uint64_t value;
+	size_t count;
+} histogram_t;
+
+/** Records copied from the trace rings */
+static tracebuf_record_t *records;
+static size_t records_count;
+
+static void usage(void)
+{
+	printf("Usage: %s [-e <events>] [-s <ticks>] [-t <seconds>] [-d]\n",
+	    NAME);
+	printf("\n");
+	printf("  -e <events>   Comma-separated list of events to record:\n");
+	printf("                sample, switch, ipc_send, ipc_answer, fault,\n");
+	printf("                syscall, irq or all (default)\n");
+	printf("  -s <ticks>    Clock ticks between program counter samples\n");
+	printf("  -t <seconds>  Duration of the recording (default %d)\n",
+	    DEFAULT_DURATION);
+	printf("  -d            Dump the records instead of a summary\n");
+}
+
+static errno_t parse_events(const char *str, unsigned int *rmask)
+{
+	char *copy = str_dup(str);
+	if (copy == NULL)
+		return ENOMEM;
+
+	unsigned int mask = 0;
+	char *state;
+	char *tok = str_tok(copy, ",", &state);
+	while (tok != NULL) {
+		if (str_cmp(tok, "all") == 0) {
+			mask |= TRACEBUF_MASK_ALL;
+		} else {
+			tracebuf_event_t ev;
+			for (ev = 0; ev < TRACEBUF_EVENTS; ev++) {
+				if (str_cmp(tok, event_names[ev]) == 0)
+					break;
+			}
+
+			if (ev == TRACEBUF_EVENTS) {
+				printf("%s: Unknown event '%s'.\n", NAME, tok);
+				free(copy);
+				return EINVAL;
+			}
+
+			mask |= TRACEBUF_MASK(ev);
+		}
+
+		tok = str_tok(NULL, ",", &state);
+	}
+
+	free(copy);
+	*rmask = mask;
+	return EOK;
+}
+
+/** Copy records written to a ring since a given head
+ *
+ * @param hdr    Trace buffer.
+ * @param cpu    Processor whose ring to read.
+ * @param start  Head of the ring when the recording started.
+ *
+ * @return Number of records which were overwritten before being copied.
+ */
+static uint64_t copy_ring(tracebuf_header_t *hdr, unsigned int cpu,
+    uint64_t start)
+{
+	tracebuf_record_t *ring = (tracebuf_record_t *) ((uint8_t *) hdr +
+	    hdr->offset) + cpu * hdr->records;
+	uint64_t head = hdr->rings[cpu].head;
+	uint64_t lost = 0;
+
+	read_barrier();
+
+	if (head - start > hdr->records) {
+		lost = head - start - hdr->records;
+		start = head - hdr->records;
+	}
+
+	for (uint64_t seq = start; seq < head; seq++) {
+		tracebuf_record_t rec = ring[seq & (hdr->records - 1)];
+
+		/* Check that the record was not overwritten meanwhile. */
+		read_barrier();
+		if (hdr->rings[cpu].head >= seq + hdr->records) {
+			lost++;
+			continue;
+		}
+
+		records[records_count++] = rec;
+	}
+
+	return lost;
+}
+
+static int histogram_value_cmp(const void *a, const void *b)
+{
+	const histogram_t *ha = a;
+	const histogram_t *hb = b;
+
+	if (ha->value != hb->value)
+		return (ha->value < hb->value) ? -1 : 1;
+
+	return 0;
+}
+
+static int histogram_count_cmp(const void *a, const void *b)
+{
+	const histogram_t *ha = a;
+	const histogram_t *hb = b;
+
+	if (ha->count != hb->count)
+		return (ha->count > hb->count) ? -1 : 1;
+
+	return histogram_value_cmp(a, b);
+}
+
+/** Get the value of a record to count in a histogram */
+typedef bool (*record_value_t)(tracebuf_record_t *, uint64_t *);
+
+/** Print the most frequent values of records
+ *
+ * @param title      Title of the histogram.
+ * @param get_value  Function selecting the records and their values.
+ * @param print      Function printing a value.
+ */
+static void print_top(const char *title, record_value_t get_value,
+    void (*print)(uint64_t))
+{
+	histogram_t *hist = malloc(records_count * sizeof(histogram_t));
+	if (hist == NULL)
+		return;
+
+	size_t n = 0;
+	for (size_t i = 0; i < records_count; i++) {
+		if (get_value(&records[i], &hist[n].value)) {
+			hist[n].count = 1;
+			n++;
+		}
+	}
+
+	if (n == 0) {
+		free(hist);
+		return;
+	}
+
+	/* Merge equal values */
+	qsort(hist, n, sizeof(histogram_t), histogram_value_cmp);
+
+	size_t total = n;
+	size_t uniq = 0;
+	for (size_t i = 1; i < n; i++) {
+		if (hist[i].value == hist[uniq].value) {
+			hist[uniq].count++;
+		} else {
+			uniq++;
+			hist[uniq] = hist[i];
+		}
+	}
+
+	n = uniq + 1;
+	qsort(hist, n, sizeof(histogram_t), histogram_count_cmp);
+
+	printf("\n%s (%zu total):\n", title, total);
+	for (size_t i = 0; (i < n) && (i < TOP_COUNT); i++) {
+		printf("  %10zu %5.1f%%  ", hist[i].count,
+		    100.0 * hist[i].count / total);
+		print(hist[i].value);
+		printf("\n");
+	}
+
+	free(hist);
+}
+
+static stats_thread_t *threads;
+static size_t threads_count;
+static stats_task_t *tasks;
+static size_t tasks_count;
+
+static bool kernel_sample(tracebuf_record_t *rec, uint64_t *value)
+{
+	*value = rec->arg1;
+	return (rec->event == TRACEBUF_SAMPLE) && (rec->arg2 == 0);
+}
+
+static bool user_sample(tracebuf_record_t *rec, uint64_t *value)
+{
+	*value = rec->arg1;
+	return (rec->event == TRACEBUF_SAMPLE) && (rec->arg2 != 0);
+}
+
+static bool thread_sample(tracebuf_record_t *rec, uint64_t *value)
+{
+	*value = rec->tid;
+	return rec->event == TRACEBUF_SAMPLE;
+}
+
+static bool syscall_event(tracebuf_record_t *rec, uint64_t *value)
+{
+	*value = rec->arg1;
+	return rec->event == TRACEBUF_SYSCALL;
+}
+
+static bool irq_event(tracebuf_record_t *rec, uint64_t *value)
+{
+	*value = rec->arg1;
+	return rec->event == TRACEBUF_IRQ;
+}
+
+static bool ipc_callee(tracebuf_record_t *rec, uint64_t *value)
+{
+	*value = rec->arg2;
+	return rec->event == TRACEBUF_IPC_SEND;
+}
+
+static bool fault_thread(tracebuf_record_t *rec, uint64_t *value)
+{
+	*value = rec->tid;
+	return rec->event == TRACEBUF_PAGE_FAULT;
+}
+
+static const char *task_name(task_id_t task_id)
+{
+	for (size_t i = 0; i < tasks_count; i++) {
+		if (tasks[i].task_id == task_id)
+			return tasks[i].name;
+	}
+
+	return "?";
+}
+
+static void print_address(uint64_t value)
+{
+	printf("%#" PRIx64, value);
+}
+
+static void print_number(uint64_t value)
+{
+	printf("%" PRIu64, value);
+}
+
+static void print_thread(uint64_t value)
+{
+	printf("thread %" PRIu64, value);
+
+	for (size_t i = 0; i < threads_count; i++) {
+		if (threads[i].thread_id == value) {
+			printf(" (%s)", task_name(threads[i].task_id));
+			return;
+		}
+	}
+}
+
+static void print_task(uint64_t value)
+{
+	printf("task %" PRIu64 " (%s)", value, task_name(value));
+}
+
+static void print_summary(size_t *counts)
+{
+	printf("Events:\n");
+	for (tracebuf_event_t ev = 0; ev < TRACEBUF_EVENTS; ev++)
+		printf("  %-10s %10zu\n", event_names[ev], counts[ev]);
+
+	threads = stats_get_threads(&threads_count);
+	tasks = stats_get_tasks(&tasks_count);
+
+	print_top("Kernel program counter samples", kernel_sample,
+	    print_address);
+	print_top("Userspace program counter samples", user_sample,
+	    print_address);
+	print_top("Samples by thread", thread_sample, print_thread);
+	print_top("Page faults by thread", fault_thread, print_thread);
+	print_top("Syscalls", syscall_event, print_number);
+	print_top("Exceptions and interrupts", irq_event, print_number);
+	print_top("IPC requests by callee", ipc_callee, print_task);
+
+	free(threads);
+	free(tasks);
+}
+
+static void dump_records(void)
+{
+	for (size_t i = 0; i < records_count; i++) {
+		tracebuf_record_t *rec = &records[i];
+		const char *name = (rec->event < TRACEBUF_EVENTS) ?
+		    event_names[rec->event] : "?";
+
+		printf("%20" PRIu64 " %8" PRIu64 " %-10s %#18" PRIx64
+		    " %10" PRIu32 "\n", rec->cycle, rec->tid, name, rec->arg1,
+		    rec->arg2);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int mask = TRACEBUF_MASK_ALL;
+	unsigned int sample_ticks = 0;
+	unsigned int duration = DEFAULT_DURATION;
+	bool dump = false;
+	errno_t rc;
+
+	for (int i = 1; i < argc; i++) {
+		if (str_cmp(argv[i], "-d") == 0) {
+			dump = true;
+		} else if ((str_cmp(argv[i], "-e") == 0) && (i + 1 < argc)) {
+			rc = parse_events(argv[++i], &mask);
+			if (rc != EOK)
+				return 1;
+		} else if ((str_cmp(argv[i], "-s") == 0) && (i + 1 < argc)) {
+			sample_ticks = strtoul(argv[++i], NULL, 10);
+		} else if ((str_cmp(argv[i], "-t") == 0) && (i + 1 < argc)) {
+			duration = strtoul(argv[++i], NULL, 10);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+
+	tracebuf_header_t *hdr;
+	size_t size;
+	rc = tracebuf_map(&hdr, &size);
+	if (rc != EOK) {
+		printf("%s: Cannot map trace buffer: %s.\n", NAME,
+		    str_error(rc));
+		return 2;
+	}
+
+	records = malloc(hdr->cpus * hdr->records * sizeof(tracebuf_record_t));
+	uint64_t *start = malloc(hdr->cpus * sizeof(uint64_t));
+	if ((records == NULL) || (start == NULL)) {
+		printf("%s: Out of memory.\n", NAME);
+		tracebuf_unmap(hdr);
+		return 2;
+	}
+
+	for (unsigned int cpu = 0; cpu < hdr->cpus; cpu++)
+		start[cpu] = hdr->rings[cpu].head;
+
+	rc = tracebuf_control(mask, sample_ticks);
+	if (rc != EOK) {
+		printf("%s: Cannot enable tracing: %s.\n", NAME,
+		    str_error(rc));
+		tracebuf_unmap(hdr);
+		return 2;
+	}
+
+	fibril_sleep(duration);
+
+	(void) tracebuf_control(0, 0);
+
+	uint64_t lost = 0;
+	for (unsigned int cpu = 0; cpu < hdr->cpus; cpu++)
+		lost += copy_ring(hdr, cpu, start[cpu]);
+
+	tracebuf_unmap(hdr);
+	free(start);
+
+	printf("%s: %zu records, %" PRIu64 " lost\n", NAME, records_count,
+	    lost);
+
+	if (dump) {
+		dump_records();
+	} else {
+		size_t counts[TRACEBUF_EVENTS] = { 0 };
+		for (size_t i = 0; i < records_count; i++) {
+			if (records[i].event < TRACEBUF_EVENTS)
+				counts[records[i].event]++;
+		}
+
+		print_summary(counts);
+	}
+
+	free(records);
+	return 0;
+}
+
+/** @}
+ */
@@ -59,6 +59,7 @@ typedef enum {
 	LIST_THREADS,
 	LIST_IPCCS,
 	LIST_CPUS,
+	LIST_MUTEXES,
 	PRINT_LOAD,
 	PRINT_UPTIME,
 	PRINT_ARCH
@@ -193,6 +194,39 @@ static void list_cpus(void)
 	free(cpus);
 }
 
+static void list_mutexes(void)
+{
+	size_t count;
+	stats_cpu_t *cpus = stats_get_cpus(&count);
+
+	if (cpus == NULL) {
+		fprintf(stderr, "%s: Unable to get CPU statistics\n", NAME);
+		return;
+	}
+
+	printf("[id] [waits      ] [spun       ] [wait cycles] [hold cycles]\n");
+
+	for (size_t i = 0; i < count; i++) {
+		printf("%-4u ", cpus[i].id);
+		if (cpus[i].active) {
+			uint64_t waits, spins, wcycles, hcycles;
+			char wsuffix, ssuffix, wcsuffix, hcsuffix;
+
+			order_suffix(cpus[i].mutex_waits, &waits, &wsuffix);
+			order_suffix(cpus[i].mutex_spins, &spins, &ssuffix);
+			order_suffix(cpus[i].mutex_wait_cycles, &wcycles, &wcsuffix);
+			order_suffix(cpus[i].mutex_hold_cycles, &hcycles, &hcsuffix);
+
+			printf("%12" PRIu64 "%c %12" PRIu64 "%c %12" PRIu64 "%c "
+			    "%12" PRIu64 "%c\n", waits, wsuffix, spins, ssuffix,
+			    wcycles, wcsuffix, hcycles, hcsuffix);
+		} else
+			printf("inactive\n");
+	}
+
+	free(cpus);
+}
+
 static void print_load(void)
 {
 	size_t count;
@@ -367,7 +401,7 @@ static void print_arch(void)
 static void usage(const char *name)
 {
 	printf(
-	    "Usage: %s [-t task_id] [-i task_id] [-at] [-ai] [-c] [-l] [-u] [-d]\n"
+	    "Usage: %s [-t task_id] [-i task_id] [-at] [-ai] [-c] [-m] [-l] [-u] [-d]\n"
 	    "\n"
 	    "Options:\n"
 	    "\t-t task_id | --task=task_id\n"
@@ -385,6 +419,9 @@ static void usage(const char *name)
 	    "\t-c | --cpus\n"
 	    "\t\tList CPUs\n"
 	    "\n"
+	    "\t-m | --mutexes\n"
+	    "\t\tList mutex contention statistics of CPUs\n"
+	    "\n"
 	    "\t-l | --load\n"
 	    "\t\tPrint system load\n"
 	    "\n"
@@ -468,6 +505,12 @@ int main(int argc, char *argv[])
 			continue;
 		}
 
+		/* Mutexes */
+		if ((off = arg_parse_short_long(argv[i], "-m", "--mutexes")) != -1) {
+			output_toggle = LIST_MUTEXES;
+			continue;
+		}
+
 		/* Load */
 		if ((off = arg_parse_short_long(argv[i], "-l", "--load")) != -1) {
 			output_toggle = PRINT_LOAD;
@@ -500,6 +543,9 @@ int main(int argc, char *argv[])
 	case LIST_CPUS:
 		list_cpus();
 		break;
+	case LIST_MUTEXES:
+		list_mutexes();
+		break;
 	case PRINT_LOAD:
 		print_load();
 		break;
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <as.h>
+#include <macros.h>
+#include <errno.h>
+#include <perf.h>
+#include "../tester.h"
+
+/** Size of the tested area; halved until the area can be created. */
+#define AREA_SIZE_MAX  (UINT64_C(4) << 30)
+#define AREA_SIZE_MIN  (UINT64_C(64) << 20)
+
+/** Size of pages mapped by the kernel on architectures with large pages. */
+#define LARGE_SIZE  (2 * 1024 * 1024)
+
+/** Number of random accesses in each pass. */
+#define ACCESSES  (16 * 1024 * 1024)
+
+static uint64_t rnd_state;
+
+static uint64_t rnd_next(void)
+{
+	/* xorshift64 */
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 7;
+	rnd_state ^= rnd_state << 17;
+	return rnd_state;
+}
+
+static uint64_t value_of(size_t idx)
+{
+	return (idx * UINT64_C(0x9e3779b97f4a7c15)) | 1;
+}
+
+/** Count large-page-sized chunks backed by contiguous aligned frames.
+ *
+ * A chunk whose first and last pages map to an aligned physically
+ * contiguous run is most likely mapped by a large page.
+ */
+static size_t count_large(uint8_t *area, size_t size)
+{
+	size_t large = 0;
+
+	for (size_t off = 0; off + LARGE_SIZE <= size; off += LARGE_SIZE) {
+		uintptr_t first;
+		uintptr_t last;
+
+		if (as_get_physical_mapping(area + off, &first) != EOK)
+			continue;
+		if (as_get_physical_mapping(area + off + LARGE_SIZE - PAGE_SIZE,
+		    &last) != EOK)
+			continue;
+
+		if ((first % LARGE_SIZE == 0) &&
+		    (last - first == LARGE_SIZE - PAGE_SIZE))
+			large++;
+	}
+
+	return large;
+}
+
+static void report(const char *what, stopwatch_t *sw)
+{
+	nsec_t ns = stopwatch_get_nanos(sw);
+
+	TPRINTF("%s: %llu ms (%llu ns per access)\n", what,
+	    (unsigned long long) NSEC2MSEC(ns),
+	    (unsigned long long) (ns / ACCESSES));
+}
+
+const char *test_largepage1(void)
+{
+	/* Do not exhaust the address space on 32-bit architectures. */
+	size_t size = (size_t) min(AREA_SIZE_MAX, (uint64_t) SIZE_MAX / 4 + 1);
+	uint8_t *area = AS_MAP_FAILED;
+
+	while (size >= AREA_SIZE_MIN) {
+		area = as_area_create(AS_AREA_ANY, size,
+		    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+		    AS_AREA_UNPAGED);
+		if (area != AS_MAP_FAILED)
+			break;
+
+		size /= 2;
+	}
+
+	if (area == AS_MAP_FAILED)
+		return "Cannot create address space area";
+
+	TPRINTF("Area of %zu MiB at %p\n", size >> 20, area);
+
+	uint64_t *words = (uint64_t *) area;
+	size_t nwords = size / sizeof(uint64_t);
+	stopwatch_t sw;
+	stopwatch_init(&sw);
+
+	/*
+	 * First pass faults the area in at random places and checks
+	 * that the new memory is zeroed.
+	 */
+	rnd_state = 0x2545f4914f6cdd1d;
+	stopwatch_start(&sw);
+	for (size_t i = 0; i < ACCESSES; i++) {
+		size_t idx = rnd_next() % nwords;
+		if ((words[idx] != 0) && (words[idx] != value_of(idx))) {
+			as_area_destroy(area);
+			return "Newly mapped memory is not zeroed";
+		}
+		words[idx] = value_of(idx);
+	}
+	stopwatch_stop(&sw);
+	report("Fault-in pass", &sw);
+
+	size_t large = count_large(area, size);
+	TPRINTF("Chunks mapped by large pages: %zu of %zu\n", large,
+	    size / LARGE_SIZE);
+
+	/* Second pass measures random accesses to already mapped memory. */
+	rnd_state = 0x2545f4914f6cdd1d;
+	stopwatch_start(&sw);
+	for (size_t i = 0; i < ACCESSES; i++) {
+		size_t idx = rnd_next() % nwords;
+		if (words[idx] != value_of(idx)) {
+			as_area_destroy(area);
+			return "Memory content mismatch";
+		}
+	}
+	stopwatch_stop(&sw);
+	report("Random access pass", &sw);
+
+	if (as_area_destroy(area) != EOK)
+		return "Failed to destroy AS area";
+
+	return NULL;
+}
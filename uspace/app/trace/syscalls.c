@@ -58,6 +58,10 @@ const sc_desc_t syscall_desc[] = {
 	[SYS_WAITQ_SLEEP] = { "waitq_sleep", 3, V_ERRNO },
 	[SYS_WAITQ_WAKEUP] = { "waitq_wakeup", 1, V_ERRNO },
 	[SYS_WAITQ_DESTROY] = { "waitq_destroy", 1, V_ERRNO },
+	[SYS_FUTEX_SLEEP] = { "futex_sleep", 3, V_ERRNO },
+	[SYS_FUTEX_WAKEUP] = { "futex_wakeup", 1, V_ERRNO },
+	[SYS_FUTEX_REQUEUE] = { "futex_requeue", 2, V_ERRNO },
+	[SYS_FUTEX_DESTROY] = { "futex_destroy", 1, V_ERRNO },
 	[SYS_SMC_COHERENCE] = { "smc_coherence", 2, V_ERRNO },
 
 	/* Address space related syscalls. */
@@ -113,7 +117,9 @@ const sc_desc_t syscall_desc[] = {
 	/* Kernel console syscalls. */
 	[SYS_DEBUG_CONSOLE] = { "debug_console", 0, V_ERRNO },
 
-	[SYS_KLOG] = { "klog", 5, V_ERRNO }
+	[SYS_KLOG] = { "klog", 5, V_ERRNO },
+
+	[SYS_TRACEBUF_CONTROL] = { "tracebuf_control", 2, V_ERRNO }
 };
 
 const size_t syscall_desc_len = (sizeof(syscall_desc) / sizeof(sc_desc_t));
@@ -33,15 +33,47 @@
  */
 
 #include <errno.h>
+#include <gzip.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <untar.h>
 
+/** Size of the buffer for compressed input */
+#define GZIP_BUFFER_SIZE  65536
+
 typedef struct {
 	const char *filename;
 	FILE *file;
+
+	/** GZIP decoder (NULL for uncompressed archives) */
+	gzip_dec_t *dec;
+	/** Buffer for compressed input */
+	uint8_t *ibuf;
+	size_t ipos;
+	size_t ilen;
 } tar_state_t;
 
+/** Check whether the archive is GZIP compressed
+ *
+ * @param file Archive file (positioned at the beginning).
+ *
+ * @return True if the file starts with the GZIP magic.
+ *
+ */
+static bool tar_is_gzip(FILE *file)
+{
+	uint8_t magic[2];
+
+	size_t nread = fread(magic, 1, sizeof(magic), file);
+	rewind(file);
+
+	return (nread == sizeof(magic)) && (magic[0] == 0x1f) &&
+	    (magic[1] == 0x8b);
+}
+
 static int tar_open(tar_file_t *tar)
 {
 	tar_state_t *state = (tar_state_t *) tar->data;
@@ -50,18 +82,86 @@ static int tar_open(tar_file_t *tar)
 	if (state->file == NULL)
 		return errno;
 
+	state->dec = NULL;
+	state->ibuf = NULL;
+	state->ipos = 0;
+	state->ilen = 0;
+
+	if (tar_is_gzip(state->file)) {
+		state->ibuf = malloc(GZIP_BUFFER_SIZE);
+		if (state->ibuf == NULL) {
+			fclose(state->file);
+			return ENOMEM;
+		}
+
+		errno_t rc = gzip_dec_create(&state->dec);
+		if (rc != EOK) {
+			free(state->ibuf);
+			fclose(state->file);
+			return rc;
+		}
+	}
+
 	return EOK;
 }
 
 static void tar_close(tar_file_t *tar)
 {
 	tar_state_t *state = (tar_state_t *) tar->data;
+
+	gzip_dec_destroy(state->dec);
+	free(state->ibuf);
 	fclose(state->file);
 }
 
+/** Read decompressed data from GZIP compressed archive
+ *
+ * @param state Archive state.
+ * @param data  Destination buffer.
+ * @param size  Number of bytes to read.
+ *
+ * @return Number of bytes read (less than @a size on end of
+ *         the archive or on error).
+ *
+ */
+static size_t tar_read_gzip(tar_state_t *state, void *data, size_t size)
+{
+	size_t total = 0;
+
+	while ((total < size) && (!gzip_dec_done(state->dec))) {
+		if (state->ipos == state->ilen) {
+			state->ilen = fread(state->ibuf, 1, GZIP_BUFFER_SIZE,
+			    state->file);
+			state->ipos = 0;
+		}
+
+		size_t used;
+		size_t produced;
+
+		errno_t rc = gzip_dec_process(state->dec,
+		    state->ibuf + state->ipos, state->ilen - state->ipos, &used,
+		    (uint8_t *) data + total, size - total, &produced);
+		if (rc != EOK)
+			break;
+
+		state->ipos += used;
+		total += produced;
+
+		/* Truncated archive */
+		if ((produced == 0) && (state->ilen == 0))
+			break;
+	}
+
+	return total;
+}
+
 static size_t tar_read(tar_file_t *tar, void *data, size_t size)
 {
 	tar_state_t *state = (tar_state_t *) tar->data;
+
+	if (state->dec != NULL)
+		return tar_read_gzip(state, data, size);
+
 	return fread(data, 1, size, state->file);
 }
 
@@ -81,7 +181,7 @@ tar_file_t tar = {
 int main(int argc, char *argv[])
 {
 	if (argc != 2) {
-		fprintf(stderr, "Usage: %s tar-file\n", argv[0]);
+		fprintf(stderr, "Usage: %s tar-file[.gz]\n", argv[0]);
 		return 1;
 	}
 
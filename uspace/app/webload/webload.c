@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup webload
+ * @{
+ */
+
+/** @file
+ * HTTP load generator
+ *
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <inttypes.h>
+#include <macros.h>
+#include <perf.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+
+#include <http/http.h>
+#include <uri.h>
+
+#define NAME  "webload"
+
+#define DEFAULT_CONNECTIONS  1
+#define DEFAULT_REQUESTS  1000
+#define DEFAULT_PIPELINE  1
+
+/** Buffer for receiving response bodies */
+#define BUFFER_SIZE  16384
+
+/** Load generating connection */
+typedef struct {
+	/** HTTP connection */
+	http_t *http;
+
+	/** Number of requests to make */
+	size_t requests;
+
+	/** Number of successful requests */
+	size_t done;
+
+	/** Number of bytes received in response bodies */
+	uint64_t bytes;
+
+	/** Error which stopped the connection */
+	errno_t rc;
+} worker_t;
+
+/** Formatted request repeated pipeline times */
+static char *request;
+static size_t request_size;
+
+static size_t pipeline = DEFAULT_PIPELINE;
+static bool reconnect = false;
+
+static FIBRIL_MUTEX_INITIALIZE(workers_lock);
+static FIBRIL_CONDVAR_INITIALIZE(workers_cv);
+static size_t workers_running;
+
+static void syntax_print(void)
+{
+	fprintf(stderr, "Usage: %s [<options>] <url>\n", NAME);
+	fprintf(stderr, "  -c <count>  Number of concurrent connections "
+	    "(default %d)\n", DEFAULT_CONNECTIONS);
+	fprintf(stderr, "  -n <count>  Total number of requests "
+	    "(default %d)\n", DEFAULT_REQUESTS);
+	fprintf(stderr, "  -p <count>  Requests pipelined on a connection "
+	    "(default %d)\n", DEFAULT_PIPELINE);
+	fprintf(stderr, "  -r          Open a new connection for each "
+	    "request\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  e.g. %s -c 8 -p 4 http://127.0.0.1:8080/\n", NAME);
+}
+
+/** Receive one response and discard its body
+ *
+ * @param worker     Worker.
+ * @param buf        Buffer for the response body.
+ * @param keep_alive Place to store true if the connection persists.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+static errno_t receive_response(worker_t *worker, char *buf, bool *keep_alive)
+{
+	receive_buffer_t *rb = &worker->http->recv_buffer;
+	http_response_t *response = NULL;
+	char *value;
+	errno_t rc;
+
+	rc = http_receive_response(rb, &response, 16 * 1024, 100);
+	if (rc != EOK)
+		return rc;
+
+	if (response->status != 200) {
+		rc = EIO;
+		goto out;
+	}
+
+	uint64_t length;
+	rc = http_headers_get(&response->headers, "Content-Length", &value);
+	if (rc == EOK)
+		rc = str_uint64_t(value, NULL, 10, false, &length);
+
+	/* Persistent connections need to know where the body ends */
+	if (rc != EOK) {
+		rc = ENOTSUP;
+		goto out;
+	}
+
+	*keep_alive = true;
+	rc = http_headers_get(&response->headers, "Connection", &value);
+	if ((rc == EOK) && (str_casecmp(value, "close") == 0))
+		*keep_alive = false;
+
+	while (length > 0) {
+		size_t nrecv;
+
+		rc = recv_buffer(rb, buf, min(length, (uint64_t) BUFFER_SIZE),
+		    &nrecv);
+		if (rc != EOK)
+			goto out;
+
+		if (nrecv == 0) {
+			rc = EIO;
+			goto out;
+		}
+
+		length -= nrecv;
+		worker->bytes += nrecv;
+	}
+
+	rc = EOK;
+out:
+	http_response_destroy(response);
+	return rc;
+}
+
+/** Make requests on one connection */
+static errno_t worker_run(worker_t *worker, char *buf)
+{
+	bool connected = false;
+	errno_t rc;
+
+	while (worker->done < worker->requests) {
+		if (!connected) {
+			recv_reset(&worker->http->recv_buffer);
+			rc = http_connect(worker->http);
+			if (rc != EOK)
+				return rc;
+
+			connected = true;
+		}
+
+		size_t count = reconnect ? 1 :
+		    min(pipeline, worker->requests - worker->done);
+
+		rc = tcp_conn_send(worker->http->conn, request,
+		    count * request_size);
+		if (rc != EOK)
+			return rc;
+
+		bool keep_alive = true;
+		for (size_t i = 0; i < count; i++) {
+			rc = receive_response(worker, buf, &keep_alive);
+			if (rc != EOK)
+				return rc;
+
+			worker->done++;
+
+			/* The server closes the connection, drop the rest */
+			if (!keep_alive)
+				break;
+		}
+
+		if ((reconnect) || (!keep_alive)) {
+			http_close(worker->http);
+			connected = false;
+		}
+	}
+
+	return EOK;
+}
+
+static errno_t worker_fibril(void *arg)
+{
+	worker_t *worker = (worker_t *) arg;
+
+	char *buf = malloc(BUFFER_SIZE);
+	if (buf != NULL) {
+		worker->rc = worker_run(worker, buf);
+		free(buf);
+	} else {
+		worker->rc = ENOMEM;
+	}
+
+	fibril_mutex_lock(&workers_lock);
+	workers_running--;
+	fibril_condvar_broadcast(&workers_cv);
+	fibril_mutex_unlock(&workers_lock);
+
+	return EOK;
+}
+
+/** Format the request repeated for pipelining */
+static errno_t format_request(uri_t *uri)
+{
+	const char *path = uri->path;
+	if ((path == NULL) || (*path == '\0'))
+		path = "/";
+
+	http_request_t *req = http_request_create("GET", path);
+	if (req == NULL)
+		return ENOMEM;
+
+	errno_t rc = http_headers_append(&req->headers, "Host", uri->host);
+	if (rc != EOK)
+		goto out;
+
+	char *buf;
+	rc = http_request_format(req, &buf, &request_size);
+	if (rc != EOK)
+		goto out;
+
+	request = malloc(pipeline * request_size);
+	if (request == NULL) {
+		free(buf);
+		rc = ENOMEM;
+		goto out;
+	}
+
+	for (size_t i = 0; i < pipeline; i++)
+		memcpy(request + i * request_size, buf, request_size);
+
+	free(buf);
+out:
+	http_request_destroy(req);
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t connections = DEFAULT_CONNECTIONS;
+	size_t requests = DEFAULT_REQUESTS;
+	worker_t *workers = NULL;
+	uri_t *uri = NULL;
+	errno_t rc;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] != '-')
+			break;
+
+		if (str_cmp(argv[i], "-r") == 0) {
+			reconnect = true;
+			continue;
+		}
+
+		size_t *value;
+		if (str_cmp(argv[i], "-c") == 0)
+			value = &connections;
+		else if (str_cmp(argv[i], "-n") == 0)
+			value = &requests;
+		else if (str_cmp(argv[i], "-p") == 0)
+			value = &pipeline;
+		else
+			value = NULL;
+
+		if ((value == NULL) || (i + 1 >= argc) ||
+		    (str_size_t(argv[i + 1], NULL, 10, true, value) != EOK) ||
+		    (*value == 0)) {
+			syntax_print();
+			return 1;
+		}
+
+		i++;
+	}
+
+	if (i + 1 != argc) {
+		syntax_print();
+		return 1;
+	}
+
+	uri = uri_parse(argv[i]);
+	if ((uri == NULL) || (!uri_validate(uri)) || (uri->host == NULL) ||
+	    (str_cmp(uri->scheme, "http") != 0)) {
+		fprintf(stderr, "%s: Invalid URI '%s'.\n", NAME, argv[i]);
+		rc = EINVAL;
+		goto error;
+	}
+
+	uint16_t port = 80;
+	if (uri->port != NULL) {
+		rc = str_uint16_t(uri->port, NULL, 10, true, &port);
+		if (rc != EOK) {
+			fprintf(stderr, "%s: Invalid port number '%s'.\n", NAME,
+			    uri->port);
+			goto error;
+		}
+	}
+
+	rc = format_request(uri);
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Failed formatting request: %s.\n", NAME,
+		    str_error(rc));
+		goto error;
+	}
+
+	connections = min(connections, requests);
+	workers = calloc(connections, sizeof(worker_t));
+	if (workers == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	for (size_t w = 0; w < connections; w++) {
+		workers[w].requests = requests / connections +
+		    ((w < requests % connections) ? 1 : 0);
+		workers[w].http = http_create(uri->host, port);
+		if (workers[w].http == NULL) {
+			rc = ENOMEM;
+			goto error;
+		}
+	}
+
+	printf("%s: %zu requests, %zu connections, pipeline %zu%s\n", NAME,
+	    requests, connections, pipeline, reconnect ? ", reconnecting" : "");
+
+	stopwatch_t stopwatch;
+	stopwatch_init(&stopwatch);
+	stopwatch_start(&stopwatch);
+
+	workers_running = connections;
+	for (size_t w = 0; w < connections; w++) {
+		fid_t fid = fibril_create(worker_fibril, &workers[w]);
+		if (fid == 0) {
+			workers[w].rc = ENOMEM;
+			fibril_mutex_lock(&workers_lock);
+			workers_running--;
+			fibril_mutex_unlock(&workers_lock);
+			continue;
+		}
+
+		fibril_add_ready(fid);
+	}
+
+	fibril_mutex_lock(&workers_lock);
+	while (workers_running > 0)
+		fibril_condvar_wait(&workers_cv, &workers_lock);
+	fibril_mutex_unlock(&workers_lock);
+
+	stopwatch_stop(&stopwatch);
+
+	size_t done = 0;
+	uint64_t bytes = 0;
+	for (size_t w = 0; w < connections; w++) {
+		done += workers[w].done;
+		bytes += workers[w].bytes;
+
+		if (workers[w].rc != EOK) {
+			fprintf(stderr, "%s: Connection %zu failed: %s.\n",
+			    NAME, w, str_error(workers[w].rc));
+		}
+	}
+
+	nsec_t nsec = stopwatch_get_nanos(&stopwatch);
+	uint64_t msec = max(NSEC2MSEC(nsec), 1);
+
+	printf("%s: %zu of %zu requests completed in %" PRIu64 " ms\n", NAME,
+	    done, requests, msec);
+	printf("%s: %" PRIu64 " requests/s, %" PRIu64 " KiB/s\n", NAME,
+	    (uint64_t) done * 1000 / msec, bytes * 1000 / 1024 / msec);
+
+	rc = (done == requests) ? EOK : EIO;
+error:
+	if (workers != NULL) {
+		for (size_t w = 0; w < connections; w++) {
+			if (workers[w].http != NULL)
+				http_destroy(workers[w].http);
+		}
+
+		free(workers);
+	}
+
+	free(request);
+	if (uri != NULL)
+		uri_destroy(uri);
+
+	return (rc == EOK) ? 0 : 1;
+}
+
+/** @}
+ */
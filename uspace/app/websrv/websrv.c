@@ -34,7 +34,6 @@
  */
 
 #include <errno.h>
-#include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -48,20 +47,48 @@
 #include <inet/endpoint.h>
 #include <inet/tcp.h>
 
+#include <http/receive-buffer.h>
+
 #include <arg_parse.h>
+#include <fibril_synch.h>
+#include <gzip.h>
+#include <deflate.h>
 #include <macros.h>
 #include <str.h>
 #include <str_error.h>
+#include <time.h>
 
 #define NAME  "websrv"
 
 #define DEFAULT_PORT  8080
 
+#define DEFAULT_MAX_REQUESTS  64
+
+#define DEFAULT_MAX_CONNECTIONS  256
+
+/** Time an idle persistent connection waits for the next request. */
+#define KEEP_ALIVE_TIMEOUT  SEC2USEC(15)
+
+/** Time a client has to send the rest of the request header. */
+#define REQUEST_TIMEOUT  SEC2USEC(10)
+
 #define WEB_ROOT  "/data/web"
 
 /** Buffer for receiving the request. */
 #define BUFFER_SIZE  1024
 
+/** Buffer for sending the response header and file contents. */
+#define SEND_BUFFER_SIZE  65536
+
+/** Buffer for compressing the response. */
+#define GZIP_BUFFER_SIZE  16384
+
+/** Size line preceding each chunk in chunked transfer encoding. */
+#define CHUNK_HEADER_SIZE  10
+
+/** Line terminating each chunk in chunked transfer encoding. */
+#define CHUNK_TRAILER_SIZE  2
+
 static void websrv_new_conn(tcp_listener_t *, tcp_conn_t *);
 
 static tcp_listen_cb_t listen_cb = {
@@ -74,28 +101,73 @@ static tcp_cb_t conn_cb = {
 
 static uint16_t port = DEFAULT_PORT;
 
+/** Maximum number of requests served at the same time. */
+static int max_requests = DEFAULT_MAX_REQUESTS;
+
+/** Limits the number of requests served at the same time. */
+static fibril_semaphore_t request_sem;
+
+/** Maximum number of connections open at the same time. */
+static int max_connections = DEFAULT_MAX_CONNECTIONS;
+
+/** Number of open connections */
+static int connections = 0;
+
+/** Protects the number of open connections */
+static FIBRIL_MUTEX_INITIALIZE(connections_lock);
+
+/** Client connection */
 typedef struct {
 	tcp_conn_t *conn;
 
-	char rbuf[BUFFER_SIZE];
-	size_t rbuf_out;
-	size_t rbuf_in;
+	/** Buffered data received from the client */
+	receive_buffer_t rb;
+
+	/** Time by which the data being received must arrive */
+	struct timespec deadline;
+
+	/** Request line or header field being parsed */
+	char lbuf[BUFFER_SIZE];
+
+	/** Response header and file contents being sent */
+	char *sbuf;
+} client_t;
+
+/** Request */
+typedef struct {
+	/** Request method is GET */
+	bool get;
 
-	char lbuf[BUFFER_SIZE + 1];
-	size_t lbuf_used;
-} recv_t;
+	/** Request has header fields (i.e. it is not HTTP/0.9) */
+	bool fields;
+
+	/** Client speaks HTTP/1.1 */
+	bool http11;
+
+	/** Client accepts gzip encoding */
+	bool gzip;
+
+	/** Connection persists after the response */
+	bool keep_alive;
+
+	/** Requested URI */
+	char uri[BUFFER_SIZE];
+} req_t;
 
 static bool verbose = false;
 
-/** Responses to send to client. */
+/** Compress responses for clients which accept gzip encoding. */
+static bool use_gzip = true;
 
-static const char *msg_ok =
-    "HTTP/1.0 200 OK\r\n"
-    "\r\n";
+/** Extensions of files which are already compressed */
+static const char *compressed_exts[] = {
+	".gz", ".tgz", ".bz2", ".xz", ".zip", ".png", ".jpg", ".jpeg", ".gif",
+	".webp", ".mp3", ".ogg", ".mp4"
+};
+
+/** Responses to send to client. */
 
 static const char *msg_bad_request =
-    "HTTP/1.0 400 Bad Request\r\n"
-    "\r\n"
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>400 Bad Request</title>\r\n"
@@ -107,8 +179,6 @@ static const char *msg_bad_request =
     "</html>\r\n";
 
 static const char *msg_not_found =
-    "HTTP/1.0 404 Not Found\r\n"
-    "\r\n"
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>404 Not Found</title>\r\n"
@@ -120,8 +190,6 @@ static const char *msg_not_found =
     "</html>\r\n";
 
 static const char *msg_not_implemented =
-    "HTTP/1.0 501 Not Implemented\r\n"
-    "\r\n"
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>501 Not Implemented</title>\r\n"
@@ -132,77 +200,86 @@ static const char *msg_not_implemented =
     "</body>\r\n"
     "</html>\r\n";
 
-static errno_t recv_create(tcp_conn_t *conn, recv_t **rrecv)
+/** Receive data from the client (receive buffer callback) */
+static errno_t client_receive(void *arg, void *buf, size_t size,
+    size_t *nrecv)
 {
-	recv_t *recv;
+	client_t *client = (client_t *) arg;
+	struct timespec now;
 
-	recv = calloc(1, sizeof(recv_t));
-	if (recv == NULL)
-		return ENOMEM;
+	getuptime(&now);
+	usec_t timeout = NSEC2USEC(ts_sub_diff(&client->deadline, &now));
+	if (timeout <= 0)
+		return ETIMEOUT;
 
-	recv->conn = conn;
-	recv->rbuf_out = 0;
-	recv->rbuf_in = 0;
-	recv->lbuf_used = 0;
+	errno_t rc = tcp_conn_recv_wait_timeout(client->conn, buf, size, nrecv,
+	    timeout);
+	if (rc == ETIMEOUT)
+		return rc;
+
+	if (rc != EOK) {
+		fprintf(stderr, "tcp_conn_recv() failed: %s\n", str_error(rc));
+		return rc;
+	}
+
+	/* Connection closed by the client */
+	if (*nrecv == 0)
+		return ECONNABORTED;
 
-	*rrecv = recv;
 	return EOK;
 }
 
-static void recv_destroy(recv_t *recv)
+static errno_t client_create(tcp_conn_t *conn, client_t **rclient)
 {
-	free(recv);
-}
+	client_t *client;
 
-/** Receive one character (with buffering) */
-static errno_t recv_char(recv_t *recv, char *c)
-{
-	size_t nrecv;
-	errno_t rc;
+	client = calloc(1, sizeof(client_t));
+	if (client == NULL)
+		return ENOMEM;
 
-	if (recv->rbuf_out == recv->rbuf_in) {
-		recv->rbuf_out = 0;
-		recv->rbuf_in = 0;
+	client->conn = conn;
 
-		rc = tcp_conn_recv_wait(recv->conn, recv->rbuf, BUFFER_SIZE, &nrecv);
-		if (rc != EOK) {
-			fprintf(stderr, "tcp_conn_recv() failed: %s\n", str_error(rc));
-			return rc;
-		}
+	client->sbuf = malloc(SEND_BUFFER_SIZE);
+	if (client->sbuf == NULL) {
+		free(client);
+		return ENOMEM;
+	}
 
-		recv->rbuf_in = nrecv;
+	errno_t rc = recv_buffer_init(&client->rb, BUFFER_SIZE, client_receive,
+	    client);
+	if (rc != EOK) {
+		free(client->sbuf);
+		free(client);
+		return rc;
 	}
 
-	*c = recv->rbuf[recv->rbuf_out++];
+	*rclient = client;
 	return EOK;
 }
 
-/** Receive one line with length limit */
-static errno_t recv_line(recv_t *recv, char **rbuf)
+static void client_destroy(client_t *client)
 {
-	char *bp = recv->lbuf;
-	char c = '\0';
+	if (client == NULL)
+		return;
 
-	while (bp < recv->lbuf + BUFFER_SIZE) {
-		char prev = c;
-		errno_t rc = recv_char(recv, &c);
-
-		if (rc != EOK)
-			return rc;
-
-		*bp++ = c;
-		if ((prev == '\r') && (c == '\n'))
-			break;
-	}
+	recv_buffer_fini(&client->rb);
+	free(client->sbuf);
+	free(client);
+}
 
-	recv->lbuf_used = bp - recv->lbuf;
-	*bp = '\0';
+/** Set the time the client has to deliver the data being received */
+static void client_set_timeout(client_t *client, usec_t timeout)
+{
+	getuptime(&client->deadline);
+	ts_add_diff(&client->deadline, USEC2NSEC(timeout));
+}
 
-	if (bp == recv->lbuf + BUFFER_SIZE)
-		return ELIMIT;
+/** Receive one line into the line buffer */
+static errno_t client_recv_line(client_t *client)
+{
+	size_t nrecv;
 
-	*rbuf = recv->lbuf;
-	return EOK;
+	return recv_line(&client->rb, client->lbuf, BUFFER_SIZE, &nrecv);
 }
 
 static bool uri_is_valid(char *uri)
@@ -224,14 +301,253 @@ static bool uri_is_valid(char *uri)
 	return true;
 }
 
-static errno_t send_response(tcp_conn_t *conn, const char *msg)
+/** Check whether a header field has a given name
+ *
+ * @param line  Header field.
+ * @param name  Field name including the colon.
+ *
+ * @return Pointer to the field value or NULL if the name does not match.
+ *
+ */
+static const char *field_value(const char *line, const char *name)
+{
+	size_t len = str_length(name);
+
+	if (str_lcasecmp(line, name, len) != 0)
+		return NULL;
+
+	line += str_size(name);
+	while ((*line == ' ') || (*line == '\t'))
+		line++;
+
+	return line;
+}
+
+/** Check whether a quality value is zero
+ *
+ * @param q Quality value (following "q=").
+ *
+ * @return True if the value is zero.
+ *
+ */
+static bool qvalue_zero(const char *q)
+{
+	if (*q != '0')
+		return false;
+
+	q++;
+	if (*q == '.') {
+		q++;
+		while (*q == '0')
+			q++;
+	}
+
+	return (*q < '1') || (*q > '9');
+}
+
+/** Check whether the client accepts gzip encoding
+ *
+ * An explicit gzip entry takes precedence over the "*" entry.
+ * Codings with zero quality value are not acceptable.
+ *
+ * @param value Value of the Accept-Encoding field.
+ *
+ * @return True if gzip encoding is acceptable.
+ *
+ */
+static bool accepts_gzip(const char *value)
 {
-	size_t response_size = str_size(msg);
+	int gzip = -1;
+	int any = -1;
+
+	while (*value != '\0') {
+		while ((*value == ' ') || (*value == '\t') || (*value == ','))
+			value++;
+
+		const char *name = value;
+		while ((*value != '\0') && (*value != ',') && (*value != ';') &&
+		    (*value != ' ') && (*value != '\t'))
+			value++;
+
+		size_t len = value - name;
+		bool zero = false;
+
+		/* Parameters of the coding */
+		while ((*value != '\0') && (*value != ',')) {
+			if (*value == ';') {
+				value++;
+				while ((*value == ' ') || (*value == '\t'))
+					value++;
+
+				if (str_lcasecmp(value, "q=", 2) == 0)
+					zero = qvalue_zero(value + 2);
+			} else {
+				value++;
+			}
+		}
+
+		if (((len == 4) && (str_lcasecmp(name, "gzip", 4) == 0)) ||
+		    ((len == 6) && (str_lcasecmp(name, "x-gzip", 6) == 0)))
+			gzip = zero ? 0 : 1;
+		else if ((len == 1) && (name[0] == '*'))
+			any = zero ? 0 : 1;
+	}
+
+	if (gzip >= 0)
+		return gzip == 1;
+
+	return any == 1;
+}
+
+/** Check whether a file is already compressed
+ *
+ * The file type is determined by its extension.
+ *
+ * @param uri Requested URI.
+ *
+ * @return True if compressing the file would not pay off.
+ *
+ */
+static bool uri_compressed(const char *uri)
+{
+	const char *ext = str_rchr(uri, '.');
+	if ((ext == NULL) || (str_chr(ext, '/') != NULL))
+		return false;
+
+	for (size_t i = 0; i < ARRAY_SIZE(compressed_exts); i++) {
+		if (str_casecmp(ext, compressed_exts[i]) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/** Receive a request
+ *
+ * Parse the request line and the header fields. Data following the
+ * request stay in the receive buffer, so pipelined requests are
+ * processed one by one.
+ *
+ * @param client Client connection.
+ * @param req    Place to store the request.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+static errno_t req_receive(client_t *client, req_t *req)
+{
+	errno_t rc;
+
+	/* Skip empty lines preceding the request */
+	do {
+		rc = client_recv_line(client);
+		if (rc != EOK)
+			return rc;
+	} while (client->lbuf[0] == '\0');
 
 	if (verbose)
-		fprintf(stderr, "Sending response\n");
+		fprintf(stderr, "Request: %s\n", client->lbuf);
+
+	req->get = (str_lcmp(client->lbuf, "GET ", 4) == 0);
+	req->fields = false;
+	req->http11 = false;
+	req->gzip = false;
+	req->keep_alive = false;
+	req->uri[0] = '\0';
+
+	/* Answer other methods with a full response and close */
+	if (!req->get) {
+		req->fields = true;
+		return EOK;
+	}
+
+	char *uri = client->lbuf + 4;
+	char *end_uri = str_chr(uri, ' ');
+
+	/* HTTP/0.9 requests have no version and no header fields */
+	if (end_uri != NULL) {
+		*end_uri = '\0';
+		req->fields = true;
+		req->http11 = (str_cmp(end_uri + 1, "HTTP/1.1") == 0);
+
+		/* HTTP/1.1 connections persist unless requested otherwise */
+		req->keep_alive = req->http11;
+	}
+
+	str_cpy(req->uri, BUFFER_SIZE, uri);
+	if (verbose)
+		fprintf(stderr, "Requested URI: %s\n", req->uri);
+
+	if (!req->fields)
+		return EOK;
+
+	while (true) {
+		rc = client_recv_line(client);
+		if (rc != EOK)
+			return rc;
+
+		const char *line = client->lbuf;
+		const char *value;
 
-	errno_t rc = tcp_conn_send(conn, (void *) msg, response_size);
+		if (line[0] == '\0')
+			return EOK;
+
+		value = field_value(line, "Accept-Encoding:");
+		if (value != NULL)
+			req->gzip = accepts_gzip(value);
+
+		value = field_value(line, "Connection:");
+		if (value != NULL) {
+			if (str_lcasecmp(value, "close", 5) == 0)
+				req->keep_alive = false;
+			else if (str_lcasecmp(value, "keep-alive", 10) == 0)
+				req->keep_alive = true;
+		}
+	}
+}
+
+/** Format response header
+ *
+ * @param req     Request.
+ * @param buf     Buffer for the header.
+ * @param size    Size of the buffer.
+ * @param status  Response status.
+ * @param length  Length of the response body.
+ * @param gzip    Response body is compressed and its length is unknown.
+ *
+ * @return Size of the header.
+ *
+ */
+static size_t format_header(req_t *req, char *buf, size_t size,
+    const char *status, uint64_t length, bool gzip)
+{
+	int n;
+
+	n = snprintf(buf, size, "HTTP/1.1 %s\r\n", status);
+
+	if (gzip) {
+		n += snprintf(buf + n, size - n, "Content-Encoding: gzip\r\n");
+		if (req->keep_alive) {
+			n += snprintf(buf + n, size - n,
+			    "Transfer-Encoding: chunked\r\n");
+		}
+	} else {
+		n += snprintf(buf + n, size - n,
+		    "Content-Length: %" PRIu64 "\r\n", length);
+	}
+
+	if ((req->keep_alive) && (!req->http11))
+		n += snprintf(buf + n, size - n, "Connection: keep-alive\r\n");
+	else if ((!req->keep_alive) && (req->http11))
+		n += snprintf(buf + n, size - n, "Connection: close\r\n");
+
+	n += snprintf(buf + n, size - n, "\r\n");
+	return n;
+}
+
+static errno_t send_data(client_t *client, const void *data, size_t size)
+{
+	errno_t rc = tcp_conn_send(client->conn, data, size);
 	if (rc != EOK) {
 		fprintf(stderr, "tcp_conn_send() failed\n");
 		return rc;
@@ -240,20 +556,161 @@ static errno_t send_response(tcp_conn_t *conn, const char *msg)
 	return EOK;
 }
 
-static errno_t uri_get(const char *uri, tcp_conn_t *conn)
+static errno_t send_response(client_t *client, req_t *req, const char *status,
+    const char *msg)
 {
-	char *fbuf = NULL;
-	char *fname = NULL;
+	size_t msg_size = str_size(msg);
+
+	if (verbose)
+		fprintf(stderr, "Sending response\n");
+
+	size_t hdr_size = format_header(req, client->sbuf, SEND_BUFFER_SIZE,
+	    status, msg_size, false);
+
+	if (!req->fields)
+		hdr_size = 0;
+
+	memcpy(client->sbuf + hdr_size, msg, msg_size);
+	return send_data(client, client->sbuf, hdr_size + msg_size);
+}
+
+/** Send file contents following the response header
+ *
+ * The file is read right behind the header already formatted in the send
+ * buffer, so the header and the start of the file leave in one message
+ * and each further part of the file takes one read and one send.
+ *
+ * @param client   Client connection.
+ * @param fd       File descriptor.
+ * @param hdr_size Size of the header at the start of the send buffer.
+ * @param length   Length of the file.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+static errno_t send_file(client_t *client, int fd, size_t hdr_size,
+    uint64_t length)
+{
+	aoff64_t pos = 0;
+	size_t used = hdr_size;
 	errno_t rc;
-	size_t nr;
-	int fd = -1;
 
-	fbuf = calloc(BUFFER_SIZE, 1);
-	if (fbuf == NULL) {
+	while (true) {
+		size_t chunk = min(length - pos,
+		    (uint64_t) (SEND_BUFFER_SIZE - used));
+		size_t nr = 0;
+
+		if (chunk > 0) {
+			rc = vfs_read(fd, &pos, client->sbuf + used, chunk, &nr);
+			if (rc != EOK)
+				return rc;
+
+			/* The file was truncated meanwhile */
+			if (nr == 0)
+				return EIO;
+		}
+
+		rc = send_data(client, client->sbuf, used + nr);
+		if (rc != EOK)
+			return rc;
+
+		if (pos == length)
+			return EOK;
+
+		used = 0;
+	}
+}
+
+/** Send file contents compressed using gzip encoding
+ *
+ * @param client  Client connection.
+ * @param fd      File descriptor.
+ * @param chunked Use chunked transfer encoding.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+static errno_t send_gzip(client_t *client, int fd, bool chunked)
+{
+	gzip_enc_t *enc = NULL;
+	char *fbuf = client->sbuf;
+	char *zbuf = NULL;
+	aoff64_t pos = 0;
+	size_t nr = 0;
+	size_t fpos = 0;
+	bool eof = false;
+	errno_t rc;
+
+	zbuf = malloc(CHUNK_HEADER_SIZE + GZIP_BUFFER_SIZE + CHUNK_TRAILER_SIZE);
+	if (zbuf == NULL) {
 		rc = ENOMEM;
 		goto out;
 	}
 
+	rc = gzip_enc_create(DEFLATE_DEFAULT_LEVEL, &enc);
+	if (rc != EOK)
+		goto out;
+
+	while (!gzip_enc_done(enc)) {
+		if ((fpos == nr) && (!eof)) {
+			rc = vfs_read(fd, &pos, fbuf, SEND_BUFFER_SIZE, &nr);
+			if (rc != EOK)
+				goto out;
+
+			fpos = 0;
+			eof = (nr == 0);
+		}
+
+		size_t used;
+		size_t produced;
+
+		rc = gzip_enc_process(enc, fbuf + fpos, nr - fpos, &used,
+		    zbuf + CHUNK_HEADER_SIZE, GZIP_BUFFER_SIZE, &produced, eof);
+		if (rc != EOK)
+			goto out;
+
+		fpos += used;
+
+		if (produced == 0)
+			continue;
+
+		if (chunked) {
+			char line[CHUNK_HEADER_SIZE + 1];
+
+			snprintf(line, sizeof(line), "%08zx\r\n", produced);
+			memcpy(zbuf, line, CHUNK_HEADER_SIZE);
+			memcpy(zbuf + CHUNK_HEADER_SIZE + produced, "\r\n",
+			    CHUNK_TRAILER_SIZE);
+
+			rc = send_data(client, zbuf, CHUNK_HEADER_SIZE +
+			    produced + CHUNK_TRAILER_SIZE);
+		} else {
+			rc = send_data(client, zbuf + CHUNK_HEADER_SIZE,
+			    produced);
+		}
+
+		if (rc != EOK)
+			goto out;
+	}
+
+	/* Last chunk */
+	if (chunked)
+		rc = send_data(client, "0\r\n\r\n", 5);
+	else
+		rc = EOK;
+out:
+	gzip_enc_destroy(enc);
+	free(zbuf);
+	return rc;
+}
+
+static errno_t uri_get(client_t *client, req_t *req)
+{
+	const char *uri = req->uri;
+	char *fname = NULL;
+	errno_t rc;
+	int fd = -1;
+
 	if (str_cmp(uri, "/") == 0)
 		uri = "/index.html";
 
@@ -264,77 +721,80 @@ static errno_t uri_get(const char *uri, tcp_conn_t *conn)
 
 	rc = vfs_lookup_open(fname, WALK_REGULAR, MODE_READ, &fd);
 	if (rc != EOK) {
-		rc = send_response(conn, msg_not_found);
+		rc = send_response(client, req, "404 Not Found", msg_not_found);
 		goto out;
 	}
 
 	free(fname);
 	fname = NULL;
 
-	rc = send_response(conn, msg_ok);
+	vfs_stat_t stat;
+	rc = vfs_stat(fd, &stat);
 	if (rc != EOK)
 		goto out;
 
-	aoff64_t pos = 0;
-	while (true) {
-		rc = vfs_read(fd, &pos, fbuf, BUFFER_SIZE, &nr);
-		if (rc != EOK)
-			goto out;
+	bool gzip = use_gzip && req->gzip && !uri_compressed(uri);
 
-		if (nr == 0)
-			break;
+	/* Without chunked encoding the end of the body is the end of data */
+	if (gzip && !req->http11)
+		req->keep_alive = false;
 
-		rc = tcp_conn_send(conn, fbuf, nr);
-		if (rc != EOK) {
-			fprintf(stderr, "tcp_conn_send() failed\n");
+	size_t hdr_size = format_header(req, client->sbuf, SEND_BUFFER_SIZE,
+	    "200 OK", stat.size, gzip);
+
+	if (!req->fields)
+		hdr_size = 0;
+
+	if (gzip) {
+		rc = send_data(client, client->sbuf, hdr_size);
+		if (rc != EOK)
 			goto out;
-		}
+
+		rc = send_gzip(client, fd, req->keep_alive);
+		goto out;
 	}
 
-	rc = EOK;
+	rc = send_file(client, fd, hdr_size, stat.size);
 out:
 	if (fd >= 0)
 		vfs_put(fd);
 	free(fname);
-	free(fbuf);
 	return rc;
 }
 
-static errno_t req_process(tcp_conn_t *conn, recv_t *recv)
+/** Serve one received request
+ *
+ * @param client     Client connection.
+ * @param req        Request.
+ * @param keep_alive Place to store true if the connection persists.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+static errno_t req_process(client_t *client, req_t *req, bool *keep_alive)
 {
-	char *reqline = NULL;
-
-	errno_t rc = recv_line(recv, &reqline);
-	if (rc != EOK) {
-		fprintf(stderr, "recv_line() failed\n");
-		return rc;
-	}
+	errno_t rc;
 
-	if (verbose)
-		fprintf(stderr, "Request: %s", reqline);
+	*keep_alive = false;
 
-	if (str_lcmp(reqline, "GET ", 4) != 0) {
-		rc = send_response(conn, msg_not_implemented);
-		return rc;
+	if (!req->get) {
+		/* The request might carry a body we cannot skip */
+		return send_response(client, req, "501 Not Implemented",
+		    msg_not_implemented);
 	}
 
-	char *uri = reqline + 4;
-	char *end_uri = str_chr(uri, ' ');
-	if (end_uri == NULL) {
-		end_uri = reqline + str_size(reqline) - 2;
-		assert(*end_uri == '\r');
+	if (!uri_is_valid(req->uri)) {
+		req->keep_alive = false;
+		return send_response(client, req, "400 Bad Request",
+		    msg_bad_request);
 	}
 
-	*end_uri = '\0';
-	if (verbose)
-		fprintf(stderr, "Requested URI: %s\n", uri);
-
-	if (!uri_is_valid(uri)) {
-		rc = send_response(conn, msg_bad_request);
+	rc = uri_get(client, req);
+	if (rc != EOK)
 		return rc;
-	}
 
-	return uri_get(uri, conn);
+	*keep_alive = req->keep_alive;
+	return EOK;
 }
 
 static void usage(void)
@@ -347,10 +807,20 @@ static void usage(void)
 	    "-p port_number | --port=port_number\n"
 	    "\tListening port (default " STRING(DEFAULT_PORT) ").\n"
 	    "\n"
+	    "-c count | --requests=count\n"
+	    "\tMaximum number of requests served at the same time (default "
+	    STRING(DEFAULT_MAX_REQUESTS) ").\n"
+	    "\n"
+	    "-C count | --connections=count\n"
+	    "\tMaximum number of connections open at the same time (default "
+	    STRING(DEFAULT_MAX_CONNECTIONS) ").\n"
+	    "\n"
 	    "-h | --help\n"
 	    "\tShow this application help.\n"
 	    "-v | --verbose\n"
-	    "\tVerbose mode\n");
+	    "\tVerbose mode\n"
+	    "-n | --no-gzip\n"
+	    "\tDo not compress responses\n");
 }
 
 static errno_t parse_option(int argc, char *argv[], int *index)
@@ -370,9 +840,32 @@ static errno_t parse_option(int argc, char *argv[], int *index)
 
 		port = (uint16_t) value;
 		break;
+	case 'c':
+		rc = arg_parse_int(argc, argv, index, &value, 0);
+		if (rc != EOK)
+			return rc;
+
+		if (value <= 0)
+			return EINVAL;
+
+		max_requests = value;
+		break;
+	case 'C':
+		rc = arg_parse_int(argc, argv, index, &value, 0);
+		if (rc != EOK)
+			return rc;
+
+		if (value <= 0)
+			return EINVAL;
+
+		max_connections = value;
+		break;
 	case 'v':
 		verbose = true;
 		break;
+	case 'n':
+		use_gzip = false;
+		break;
 	case '-':
 		/* Long options with double dash */
 		if (str_lcmp(argv[*index] + 2, "help", 5) == 0) {
@@ -384,8 +877,28 @@ static errno_t parse_option(int argc, char *argv[], int *index)
 				return rc;
 
 			port = (uint16_t) value;
+		} else if (str_lcmp(argv[*index] + 2, "requests=", 9) == 0) {
+			rc = arg_parse_int(argc, argv, index, &value, 11);
+			if (rc != EOK)
+				return rc;
+
+			if (value <= 0)
+				return EINVAL;
+
+			max_requests = value;
+		} else if (str_lcmp(argv[*index] + 2, "connections=", 12) == 0) {
+			rc = arg_parse_int(argc, argv, index, &value, 14);
+			if (rc != EOK)
+				return rc;
+
+			if (value <= 0)
+				return EINVAL;
+
+			max_connections = value;
 		} else if (str_cmp(argv[*index] + 2, "verbose") == 0) {
 			verbose = true;
+		} else if (str_cmp(argv[*index] + 2, "no-gzip") == 0) {
+			use_gzip = false;
 		} else {
 			usage();
 			return EINVAL;
@@ -402,22 +915,70 @@ static errno_t parse_option(int argc, char *argv[], int *index)
 static void websrv_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
 {
 	errno_t rc;
-	recv_t *recv = NULL;
+	client_t *client = NULL;
+	bool keep_alive = true;
+	req_t req;
+
+	/* Refuse the connection right away rather than queue it */
+	fibril_mutex_lock(&connections_lock);
+	if (connections >= max_connections) {
+		fibril_mutex_unlock(&connections_lock);
+		if (verbose)
+			fprintf(stderr, "Too many connections, refusing\n");
+		(void) tcp_conn_reset(conn);
+		return;
+	}
+	connections++;
+	fibril_mutex_unlock(&connections_lock);
 
 	if (verbose)
 		fprintf(stderr, "New connection, waiting for request\n");
 
-	rc = recv_create(conn, &recv);
+	rc = client_create(conn, &client);
 	if (rc != EOK) {
 		fprintf(stderr, "Out of memory.\n");
 		goto error;
 	}
 
-	rc = req_process(conn, recv);
-	if (rc != EOK) {
-		fprintf(stderr, "Error processing request (%s)\n",
-		    str_error(rc));
-		goto error;
+	while (keep_alive) {
+		char c;
+
+		/* Wait for the next request */
+		client_set_timeout(client, KEEP_ALIVE_TIMEOUT);
+		rc = recv_char(&client->rb, &c, false);
+		if (rc == ECONNABORTED || rc == ETIMEOUT)
+			break;
+
+		if (rc != EOK)
+			goto error;
+
+		/*
+		 * Take a slot only once the whole header is in, so that
+		 * slow or stalled clients do not hold any.
+		 */
+		client_set_timeout(client, REQUEST_TIMEOUT);
+		rc = req_receive(client, &req);
+		if (rc == ECONNABORTED)
+			break;
+
+		if (rc != EOK) {
+			fprintf(stderr, "Error receiving request (%s)\n",
+			    str_error(rc));
+			goto error;
+		}
+
+		fibril_semaphore_down(&request_sem);
+		rc = req_process(client, &req, &keep_alive);
+		fibril_semaphore_up(&request_sem);
+
+		if (rc == ECONNABORTED)
+			break;
+
+		if (rc != EOK) {
+			fprintf(stderr, "Error processing request (%s)\n",
+			    str_error(rc));
+			goto error;
+		}
 	}
 
 	rc = tcp_conn_send_fin(conn);
@@ -426,14 +987,17 @@ static void websrv_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
 		goto error;
 	}
 
-	recv_destroy(recv);
-	return;
+	goto out;
 error:
 	rc = tcp_conn_reset(conn);
 	if (rc != EOK)
 		fprintf(stderr, "Error resetting connection.\n");
+out:
+	client_destroy(client);
 
-	recv_destroy(recv);
+	fibril_mutex_lock(&connections_lock);
+	connections--;
+	fibril_mutex_unlock(&connections_lock);
 }
 
 int main(int argc, char *argv[])
@@ -457,6 +1021,8 @@ int main(int argc, char *argv[])
 
 	printf("%s: HelenOS web server\n", NAME);
 
+	fibril_semaphore_initialize(&request_sem, max_requests);
+
 	if (verbose)
 		fprintf(stderr, "Creating listener\n");
 
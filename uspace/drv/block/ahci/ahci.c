@@ -31,7 +31,11 @@
  */
 
 #include <as.h>
+#include <assert.h>
+#include <bitops.h>
+#include <byteorder.h>
 #include <errno.h>
+#include <macros.h>
 #include <stdio.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -113,11 +117,12 @@ static errno_t get_num_blocks(ddf_fun_t *, uint64_t *);
 static errno_t get_block_size(ddf_fun_t *, size_t *);
 static errno_t read_blocks(ddf_fun_t *, uint64_t, size_t, void *);
 static errno_t write_blocks(ddf_fun_t *, uint64_t, size_t, void *);
+static errno_t discard_blocks(ddf_fun_t *, uint64_t, size_t);
 
 static errno_t ahci_identify_device(sata_dev_t *);
 static errno_t ahci_set_highest_ultra_dma_mode(sata_dev_t *);
-static errno_t ahci_rb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
-static errno_t ahci_wb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
+static errno_t ahci_rw_fpdma(sata_dev_t *, bool, uint64_t, size_t, void *);
+static errno_t ahci_dsm_trim(sata_dev_t *, uint64_t, size_t);
 
 static void ahci_sata_devices_create(ahci_dev_t *, ddf_dev_t *);
 static ahci_dev_t *ahci_ahci_create(ddf_dev_t *);
@@ -139,7 +144,8 @@ static ahci_iface_t ahci_interface = {
 	.get_num_blocks = &get_num_blocks,
 	.get_block_size = &get_block_size,
 	.read_blocks = &read_blocks,
-	.write_blocks = &write_blocks
+	.write_blocks = &write_blocks,
+	.discard_blocks = &discard_blocks
 };
 
 static ddf_dev_ops_t ahci_ops = {
@@ -228,33 +234,7 @@ static errno_t read_blocks(ddf_fun_t *fun, uint64_t blocknum,
     size_t count, void *buf)
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
-
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	errno_t rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate read buffer.");
-		return rc;
-	}
-
-	memset(buf, 0, sata->block_size);
-
-	fibril_mutex_lock(&sata->lock);
-
-	for (size_t cur = 0; cur < count; cur++) {
-		rc = ahci_rb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-
-		memcpy((void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    ibuf, sata->block_size);
-	}
-
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
-
-	return rc;
+	return ahci_rw_fpdma(sata, false, blocknum, count, buf);
 }
 
 /** Write data blocks into SATA device.
@@ -271,30 +251,23 @@ static errno_t write_blocks(ddf_fun_t *fun, uint64_t blocknum,
     size_t count, void *buf)
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
+	return ahci_rw_fpdma(sata, true, blocknum, count, buf);
+}
 
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	errno_t rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate write buffer.");
-		return rc;
-	}
-
-	fibril_mutex_lock(&sata->lock);
-
-	for (size_t cur = 0; cur < count; cur++) {
-		memcpy(ibuf, (void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    sata->block_size);
-		rc = ahci_wb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-	}
-
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
-
-	return rc;
+/** Discard data blocks of SATA device.
+ *
+ * @param fun      Device function handling the call.
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks to discard.
+ *
+ * @return EOK if succeed, error code otherwise
+ *
+ */
+static errno_t discard_blocks(ddf_fun_t *fun, uint64_t blocknum,
+    size_t count)
+{
+	sata_dev_t *sata = fun_sata_dev(fun);
+	return ahci_dsm_trim(sata, blocknum, count);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -478,6 +451,9 @@ static errno_t ahci_identify_device(sata_dev_t *sata)
 		goto error;
 	}
 
+	/* Queue depth is reported as the maximum tag value. */
+	sata->slot_count = (idata->queue_depth & 0x1f) + 1;
+
 	uint16_t logsec = idata->physical_logic_sector_size;
 	if ((logsec & 0xc000) == 0x4000) {
 		/* Length of sector may be larger than 512 B */
@@ -523,6 +499,13 @@ static errno_t ahci_identify_device(sata_dev_t *sata)
 			    ((uint64_t) idata->total_lba48_2 << 32) |
 			    ((uint64_t) idata->total_lba48_3 << 48);
 		}
+
+		if ((idata->dsm & sata_dsm_trim) != 0) {
+			/* Zero means the limit is not reported. */
+			sata->trim = true;
+			sata->dsm_blocks = min(max(idata->max_dsm_blocks, 1),
+			    AHCI_SLOT_BUFFER_SIZE / SATA_DEFAULT_SECTOR_SIZE);
+		}
 	}
 
 	uint8_t udma_mask = idata->udma & 0x007f;
@@ -668,24 +651,68 @@ error:
 	return EINTR;
 }
 
-/** Set AHCI registers for reading one sector from the SATA device using FPDMA.
+/** Fill the PRDT of a command table.
+ *
+ * @param cmd_table Command table.
+ * @param phys      Physical address of the data buffer.
+ * @param size      Size of the data buffer.
+ *
+ * @return Number of PRDT entries used.
+ *
+ */
+static unsigned int ahci_fill_prdt(volatile uint32_t *cmd_table,
+    uintptr_t phys, size_t size)
+{
+	volatile ahci_cmd_prdt_t *prdt = (ahci_cmd_prdt_t *)
+	    (&cmd_table[AHCI_CMD_TABLE_PRDT_OFFSET / sizeof(uint32_t)]);
+	unsigned int entries = 0;
+
+	while (size > 0) {
+		assert(entries < AHCI_CMD_TABLE_PRDT_COUNT);
+
+		size_t len = min(size, (size_t) AHCI_PRDT_MAX_SIZE);
+
+		prdt[entries].data_address_low = LO(phys);
+		prdt[entries].data_address_upper = HI(phys);
+		prdt[entries].reserved1 = 0;
+		prdt[entries].dbc = len - 1;
+		prdt[entries].reserved2 = 0;
+		prdt[entries].ioc = 0;
+
+		phys += len;
+		size -= len;
+		entries++;
+	}
+
+	return entries;
+}
+
+/** Set AHCI registers for a queued FPDMA read or write.
+ *
+ * The data are transferred from or to the DMA buffer of the slot.
  *
  * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+ * @param slot     Command slot (and NCQ tag) to use.
+ * @param write    True for writing, false for reading.
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks to transfer.
  *
  */
-static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static void ahci_fpdma_cmd(sata_dev_t *sata, unsigned int slot, bool write,
+    uint64_t blocknum, size_t count)
 {
+	ahci_slot_t *s = &sata->slots[slot];
 	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
+	    (sata_ncq_command_frame_t *) s->cmd_table;
 
 	cmd->fis_type = SATA_CMD_FIS_TYPE;
 	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x60;
-	cmd->tag = 0;
+	cmd->command = write ? 0x61 : 0x60;
+	/* The tag is stored in bits 7:3 of the sector count register. */
+	cmd->tag = slot << 3;
 	cmd->control = 0;
+	/* Device register, LBA addressing. */
+	cmd->fua = 0x40;
 
 	cmd->reserved1 = 0;
 	cmd->reserved2 = 0;
@@ -694,8 +721,8 @@ static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->reserved5 = 0;
 	cmd->reserved6 = 0;
 
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
+	cmd->sector_count_low = count & 0xff;
+	cmd->sector_count_high = (count >> 8) & 0xff;
 
 	cmd->lba0 = blocknum & 0xff;
 	cmd->lba1 = (blocknum >> 8) & 0xff;
@@ -704,141 +731,315 @@ static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->lba4 = (blocknum >> 32) & 0xff;
 	cmd->lba5 = (blocknum >> 40) & 0xff;
 
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
-
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
+	volatile ahci_cmdhdr_t *hdr = &sata->cmd_header[slot];
 
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
+	hdr->prdtl = ahci_fill_prdt(s->cmd_table, s->buf_phys,
+	    count * sata->block_size);
+	hdr->flags = AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
 	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
+	if (write)
+		hdr->flags |= AHCI_CMDHDR_FLAGS_WRITE;
+	hdr->bytesprocessed = 0;
+}
 
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+/** Issue a prepared queued command to the device.
+ *
+ * Only the bit of the slot is written to the PxSACT and PxCI registers,
+ * writing zeros has no effect on them.
+ *
+ * @param sata SATA device structure, event_lock must be held.
+ * @param slot Command slot with a prepared command.
+ *
+ */
+static void ahci_fpdma_issue(sata_dev_t *sata, unsigned int slot)
+{
+	assert(fibril_mutex_is_locked(&sata->event_lock));
+
+	sata->slots[slot].done = false;
+	sata->slots[slot].failed = false;
+	sata->active_slots |= 1U << slot;
+
+	sata->port->pxsact = 1U << slot;
+	sata->port->pxci = 1U << slot;
 }
 
-/** Read one sector from the SATA device using FPDMA.
+/** Read or write blocks using queued FPDMA commands.
+ *
+ * The transfer is split into chunks of at most AHCI_SLOT_BUFFER_SIZE
+ * bytes, each of them moved by a single command. As many chunks as
+ * there are free command slots are kept in flight at the same time
+ * and other requests may use the remaining slots concurrently.
  *
  * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+ * @param write    True for writing, false for reading.
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks to transfer.
+ * @param buf      Data buffer.
  *
  * @return EOK if succeed, error code otherwise
  *
  */
-static errno_t ahci_rb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
+static errno_t ahci_rw_fpdma(sata_dev_t *sata, bool write, uint64_t blocknum,
+    size_t count, void *buf)
 {
-	if (sata->is_invalid_device) {
-		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA read from invalid device", sata->model);
-		return EINTR;
-	}
+	uint8_t *data = (uint8_t *) buf;
+	size_t bsize = sata->block_size;
+	size_t chunk = AHCI_SLOT_BUFFER_SIZE / bsize;
 
-	ahci_rb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	/* Slots in flight in the order of issue with their first block */
+	unsigned int queue[AHCI_MAX_SLOTS];
+	size_t first[AHCI_MAX_SLOTS];
+	unsigned int head = 0;
+	unsigned int inflight = 0;
 
-	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
-		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA read", sata->model);
-		return EINTR;
+	size_t next = 0;
+	errno_t rc = EOK;
+
+	fibril_mutex_lock(&sata->event_lock);
+
+	while ((next < count) || (inflight > 0)) {
+		/* Issue commands while there are free slots. */
+		while ((next < count) && (rc == EOK)) {
+			if (sata->is_invalid_device) {
+				ddf_msg(LVL_ERROR,
+				    "%s: FPDMA %s invalid device", sata->model,
+				    write ? "write to" : "read from");
+				rc = EINTR;
+				break;
+			}
+
+			if (sata->free_slots == 0) {
+				if (inflight > 0)
+					break;
+
+				fibril_condvar_wait(&sata->free_slot_condvar,
+				    &sata->event_lock);
+				continue;
+			}
+
+			unsigned int slot = fnzb32(sata->free_slots);
+			sata->free_slots &= ~(1U << slot);
+
+			size_t blocks = min(chunk, count - next);
+
+			/* The slot is ours, fill it without the lock. */
+			fibril_mutex_unlock(&sata->event_lock);
+
+			if (write) {
+				memcpy(sata->slots[slot].buf,
+				    data + next * bsize, blocks * bsize);
+			}
+
+			ahci_fpdma_cmd(sata, slot, write, blocknum + next,
+			    blocks);
+
+			fibril_mutex_lock(&sata->event_lock);
+			ahci_fpdma_issue(sata, slot);
+
+			queue[(head + inflight) % AHCI_MAX_SLOTS] = slot;
+			first[slot] = next;
+			inflight++;
+			next += blocks;
+		}
+
+		if (inflight == 0)
+			break;
+
+		/* Wait for the oldest command. */
+		unsigned int slot = queue[head];
+		ahci_slot_t *s = &sata->slots[slot];
+
+		while (!s->done)
+			fibril_condvar_wait(&s->done_condvar,
+			    &sata->event_lock);
+
+		head = (head + 1) % AHCI_MAX_SLOTS;
+		inflight--;
+
+		if (s->failed) {
+			ddf_msg(LVL_ERROR,
+			    "%s: Unrecoverable error during FPDMA %s",
+			    sata->model, write ? "write" : "read");
+			rc = EINTR;
+		} else if ((!write) && (rc == EOK)) {
+			size_t blocks = min(chunk, count - first[slot]);
+
+			fibril_mutex_unlock(&sata->event_lock);
+			memcpy(data + first[slot] * bsize, s->buf,
+			    blocks * bsize);
+			fibril_mutex_lock(&sata->event_lock);
+		}
+
+		sata->free_slots |= 1U << slot;
+		fibril_condvar_broadcast(&sata->free_slot_condvar);
 	}
 
-	return EOK;
+	fibril_mutex_unlock(&sata->event_lock);
+	return rc;
 }
 
-/** Set AHCI registers for writing one sector to the SATA device, use FPDMA.
+/** Set AHCI registers for a DATA SET MANAGEMENT TRIM command.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer with sector data.
- * @param blocknum Block number to write.
+ * The LBA range entries are transferred from the DMA buffer of the slot.
  *
- * @return EOK if succeed, error code otherwise
+ * @param sata   SATA device structure.
+ * @param slot   Command slot to use.
+ * @param blocks Number of blocks of LBA range entries.
  *
  */
-static void ahci_wb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static void ahci_dsm_trim_cmd(sata_dev_t *sata, unsigned int slot,
+    size_t blocks)
 {
-	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
+	ahci_slot_t *s = &sata->slots[slot];
+	volatile sata_std_command_frame_t *cmd =
+	    (sata_std_command_frame_t *) s->cmd_table;
 
 	cmd->fis_type = SATA_CMD_FIS_TYPE;
 	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x61;
-	cmd->tag = 0;
-	cmd->control = 0;
-
+	cmd->command = 0x06;
+	cmd->features = 0x01;
+	cmd->lba_lower = 0;
+	cmd->device = 0x40;
+	cmd->lba_upper = 0;
+	cmd->features_upper = 0;
+	cmd->count = blocks;
 	cmd->reserved1 = 0;
+	cmd->control = 0;
 	cmd->reserved2 = 0;
-	cmd->reserved3 = 0;
-	cmd->reserved4 = 0;
-	cmd->reserved5 = 0;
-	cmd->reserved6 = 0;
 
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
+	volatile ahci_cmdhdr_t *hdr = &sata->cmd_header[slot];
 
-	cmd->lba0 = blocknum & 0xff;
-	cmd->lba1 = (blocknum >> 8) & 0xff;
-	cmd->lba2 = (blocknum >> 16) & 0xff;
-	cmd->lba3 = (blocknum >> 24) & 0xff;
-	cmd->lba4 = (blocknum >> 32) & 0xff;
-	cmd->lba5 = (blocknum >> 40) & 0xff;
+	hdr->prdtl = ahci_fill_prdt(s->cmd_table, s->buf_phys,
+	    blocks * SATA_DEFAULT_SECTOR_SIZE);
+	hdr->flags = AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
+	    AHCI_CMDHDR_FLAGS_5DWCMD | AHCI_CMDHDR_FLAGS_WRITE;
+	hdr->bytesprocessed = 0;
+}
 
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
+/** Discard blocks using DATA SET MANAGEMENT TRIM commands.
+ *
+ * TRIM is not a queued command, so all command slots are taken over
+ * first. This waits for the queued commands in flight to finish and keeps
+ * new ones out until the TRIM commands are done.
+ *
+ * @param sata     SATA device structure.
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks to discard.
+ *
+ * @return EOK if succeed, error code otherwise
+ *
+ */
+static errno_t ahci_dsm_trim(sata_dev_t *sata, uint64_t blocknum,
+    size_t count)
+{
+	if (!sata->trim)
+		return ENOTSUP;
 
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
+	ahci_slot_t *s = &sata->slots[0];
+	uint64_t *ranges = (uint64_t *) s->buf;
+	size_t max_ranges = sata->dsm_blocks * SATA_DSM_RANGES_PER_BLOCK;
+	errno_t rc = EOK;
 
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_WRITE |
-	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
+	fibril_mutex_lock(&sata->event_lock);
 
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	while (sata->free_slots != sata->all_slots) {
+		fibril_condvar_wait(&sata->free_slot_condvar,
+		    &sata->event_lock);
+	}
+	sata->free_slots = 0;
+
+	while ((count > 0) && (rc == EOK)) {
+		if (sata->is_invalid_device) {
+			ddf_msg(LVL_ERROR, "%s: TRIM on invalid device",
+			    sata->model);
+			rc = EINTR;
+			break;
+		}
+
+		fibril_mutex_unlock(&sata->event_lock);
+
+		/* Entries hold a 48-bit LBA and a 16-bit block count. */
+		size_t nranges = 0;
+		while ((count > 0) && (nranges < max_ranges)) {
+			size_t n = min(count, (size_t) SATA_DSM_RANGE_MAX);
+			ranges[nranges++] = host2uint64_t_le(blocknum |
+			    ((uint64_t) n << 48));
+			blocknum += n;
+			count -= n;
+		}
+
+		size_t blocks = (nranges + SATA_DSM_RANGES_PER_BLOCK - 1) /
+		    SATA_DSM_RANGES_PER_BLOCK;
+		memset(&ranges[nranges], 0,
+		    (blocks * SATA_DSM_RANGES_PER_BLOCK - nranges) *
+		    sizeof(uint64_t));
+
+		ahci_dsm_trim_cmd(sata, 0, blocks);
+
+		fibril_mutex_lock(&sata->event_lock);
+
+		s->done = false;
+		s->failed = false;
+		sata->active_slots = 1;
+		sata->port->pxci = 1;
+
+		while (!s->done)
+			fibril_condvar_wait(&s->done_condvar,
+			    &sata->event_lock);
+
+		if (s->failed) {
+			ddf_msg(LVL_ERROR,
+			    "%s: Unrecoverable error during TRIM",
+			    sata->model);
+			rc = EINTR;
+		}
+	}
+
+	sata->free_slots = sata->all_slots;
+	fibril_condvar_broadcast(&sata->free_slot_condvar);
+
+	fibril_mutex_unlock(&sata->event_lock);
+	return rc;
 }
 
-/** Write one sector into the SATA device, use FPDMA.
+/** Evaluate completion of queued commands.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer with sector data.
- * @param blocknum Block number to write.
+ * Commands no longer indicated in PxSACT nor PxCI have finished. This
+ * also covers the non-queued TRIM command, which is only set in PxCI. After
+ * an error the HBA stops processing the command list, so all commands
+ * still outstanding are failed and the device is marked invalid.
  *
- * @return EOK if succeed, error code otherwise
+ * @param sata SATA device structure, event_lock must be held.
+ * @param pxis Value of port interrupt status register.
  *
  */
-static errno_t ahci_wb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
+static void ahci_fpdma_complete(sata_dev_t *sata, ahci_port_is_t pxis)
 {
-	if (sata->is_invalid_device) {
-		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA write to invalid device", sata->model);
-		return EINTR;
+	uint32_t pending = sata->port->pxsact | sata->port->pxci;
+	uint32_t completed = sata->active_slots & ~pending;
+	uint32_t failed = 0;
+
+	if (ahci_port_is_error(pxis)) {
+		failed = sata->active_slots & pending;
+		completed = sata->active_slots;
+		sata->is_invalid_device = true;
 	}
 
-	ahci_wb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	while (completed != 0) {
+		unsigned int slot = fnzb32(completed);
+		ahci_slot_t *s = &sata->slots[slot];
 
-	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
-		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA write", sata->model);
-		return EINTR;
+		s->done = true;
+		s->failed = (failed & (1U << slot)) != 0;
+		fibril_condvar_signal(&s->done_condvar);
+
+		completed &= ~(1U << slot);
 	}
 
-	return EOK;
+	if (failed != 0)
+		sata->active_slots = 0;
+	else
+		sata->active_slots &= pending;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -911,6 +1112,9 @@ static void ahci_interrupt(ipc_call_t *icall, ddf_dev_t *dev)
 	    (ahci_port_is_error(pxis))) {
 		fibril_mutex_lock(&sata->event_lock);
 
+		if (sata->active_slots != 0)
+			ahci_fpdma_complete(sata, pxis);
+
 		sata->event_pxis = pxis;
 		fibril_condvar_signal(&sata->event_condvar);
 
@@ -968,16 +1172,24 @@ static sata_dev_t *ahci_sata_allocate(ahci_dev_t *ahci, volatile ahci_port_t *po
 	sata->port->pxclb = LO(phys);
 	sata->cmd_header = (ahci_cmdhdr_t *) virt_cmd;
 
-	/* Allocate and init command table structure. */
-	rc = dmamem_map_anonymous(size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &virt_table);
+	/* Allocate and init command tables of all slots. */
+	rc = dmamem_map_anonymous(AHCI_MAX_SLOTS * AHCI_CMD_TABLE_SIZE,
+	    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &virt_table);
 	if (rc != EOK)
 		goto error_table;
 
-	memset(virt_table, 0, size);
-	sata->cmd_header->cmdtableu = HI(phys);
-	sata->cmd_header->cmdtable = LO(phys);
-	sata->cmd_table = (uint32_t *) virt_table;
+	memset(virt_table, 0, AHCI_MAX_SLOTS * AHCI_CMD_TABLE_SIZE);
+
+	for (unsigned int slot = 0; slot < AHCI_MAX_SLOTS; slot++) {
+		uintptr_t offset = slot * AHCI_CMD_TABLE_SIZE;
+
+		sata->cmd_header[slot].cmdtableu = HI(phys + offset);
+		sata->cmd_header[slot].cmdtable = LO(phys + offset);
+		sata->slots[slot].cmd_table =
+		    (uint32_t *) ((uint8_t *) virt_table + offset);
+	}
+
+	sata->cmd_table = sata->slots[0].cmd_table;
 
 	return sata;
 
@@ -990,6 +1202,52 @@ error_retfis:
 	return NULL;
 }
 
+/** Allocate DMA buffers of command slots used for queued commands.
+ *
+ * The number of slots is limited by both the HBA and the queue depth
+ * reported by the device.
+ *
+ * @param sata SATA device structure.
+ *
+ * @return EOK if succeed, error code otherwise.
+ *
+ */
+static errno_t ahci_sata_slots_init(sata_dev_t *sata)
+{
+	ahci_ghc_cap_t cap;
+	cap.u32 = sata->ahci->memregs->ghc.cap;
+
+	sata->slot_count = min(sata->slot_count, cap.ncs + 1U);
+
+	for (unsigned int slot = 0; slot < sata->slot_count; slot++) {
+		ahci_slot_t *s = &sata->slots[slot];
+
+		s->buf = AS_AREA_ANY;
+		errno_t rc = dmamem_map_anonymous(AHCI_SLOT_BUFFER_SIZE,
+		    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0, &s->buf_phys,
+		    &s->buf);
+		if (rc != EOK) {
+			ddf_msg(LVL_ERROR, "%s: Cannot allocate DMA buffers.",
+			    sata->model);
+
+			while (slot > 0)
+				dmamem_unmap_anonymous(sata->slots[--slot].buf);
+
+			sata->slot_count = 0;
+			return rc;
+		}
+	}
+
+	sata->all_slots = (sata->slot_count == AHCI_MAX_SLOTS) ?
+	    0xffffffff : (1U << sata->slot_count) - 1;
+	sata->free_slots = sata->all_slots;
+
+	ddf_msg(LVL_NOTE, "%s: Using %u command slots.", sata->model,
+	    sata->slot_count);
+
+	return EOK;
+}
+
 /** Initialize and start SATA hardware device.
  *
  * @param sata SATA device structure.
@@ -1056,6 +1314,10 @@ static errno_t ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	fibril_mutex_initialize(&sata->lock);
 	fibril_mutex_initialize(&sata->event_lock);
 	fibril_condvar_initialize(&sata->event_condvar);
+	fibril_condvar_initialize(&sata->free_slot_condvar);
+
+	for (unsigned int slot = 0; slot < AHCI_MAX_SLOTS; slot++)
+		fibril_condvar_initialize(&sata->slots[slot].done_condvar);
 
 	ahci_sata_hw_start(sata);
 
@@ -1067,6 +1329,10 @@ static errno_t ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	if (ahci_set_highest_ultra_dma_mode(sata) != EOK)
 		goto error;
 
+	/* Prepare command slots for queued commands */
+	if (ahci_sata_slots_init(sata) != EOK)
+		goto error;
+
 	/* Add device to the system */
 	char sata_dev_name[16];
 	snprintf(sata_dev_name, 16, "ahci_%u", sata_devices_count);
@@ -40,6 +40,17 @@
 #include <stdint.h>
 #include "ahci_hw.h"
 
+/** Number of PRDT entries in each command table. */
+#define AHCI_CMD_TABLE_PRDT_COUNT  8
+
+/** Size of a command table (including the PRDT), 128 B aligned. */
+#define AHCI_CMD_TABLE_SIZE \
+	(AHCI_CMD_TABLE_PRDT_OFFSET + \
+	AHCI_CMD_TABLE_PRDT_COUNT * sizeof(ahci_cmd_prdt_t))
+
+/** Size of the DMA buffer of each command slot. */
+#define AHCI_SLOT_BUFFER_SIZE  (64 * 1024)
+
 /** AHCI Device. */
 typedef struct {
 	/** Pointer to ddf device. */
@@ -55,6 +66,27 @@ typedef struct {
 	async_sess_t *parent_sess;
 } ahci_dev_t;
 
+/** AHCI command slot. */
+typedef struct {
+	/** Pointer to command table of the slot. */
+	volatile uint32_t *cmd_table;
+
+	/** DMA buffer of the slot. */
+	void *buf;
+
+	/** Physical address of the DMA buffer. */
+	uintptr_t buf_phys;
+
+	/** Command in the slot has finished. */
+	bool done;
+
+	/** Command in the slot has failed. */
+	bool failed;
+
+	/** Command completion condition variable. */
+	fibril_condvar_t done_condvar;
+} ahci_slot_t;
+
 /** SATA Device. */
 typedef struct {
 	/** Pointer to AHCI device. */
@@ -72,16 +104,34 @@ typedef struct {
 	/** Pointer to SATA port. */
 	volatile ahci_port_t *port;
 
-	/** Pointer to command header. */
+	/** Pointer to command list (command header of slot 0). */
 	volatile ahci_cmdhdr_t *cmd_header;
 
-	/** Pointer to command table. */
+	/** Pointer to command table of slot 0. */
 	volatile uint32_t *cmd_table;
 
+	/** Command slots. */
+	ahci_slot_t slots[AHCI_MAX_SLOTS];
+
+	/** Number of command slots used for queued commands. */
+	unsigned int slot_count;
+
+	/** Bitmap of all command slots used for queued commands. */
+	uint32_t all_slots;
+
+	/** Bitmap of free command slots. */
+	uint32_t free_slots;
+
+	/** Bitmap of commands issued to the device. */
+	uint32_t active_slots;
+
+	/** Free command slot condition variable. */
+	fibril_condvar_t free_slot_condvar;
+
 	/** Mutex for single operation on device. */
 	fibril_mutex_t lock;
 
-	/** Mutex for event signaling condition variable. */
+	/** Mutex for event signaling and command slots. */
 	fibril_mutex_t event_lock;
 
 	/** Event signaling condition variable. */
@@ -104,6 +154,12 @@ typedef struct {
 
 	/** Highest UDMA mode supported. */
 	uint8_t highest_udma_mode;
+
+	/** Device supports the TRIM command. */
+	bool trim;
+
+	/** Maximum number of blocks of TRIM data per command. */
+	unsigned int dsm_blocks;
 } sata_dev_t;
 
 #endif
@@ -42,6 +42,9 @@
 /** AHCI standard 1.3 - maximum ports. */
 #define AHCI_MAX_PORTS  32
 
+/** AHCI standard 1.3 - maximum command slots per port. */
+#define AHCI_MAX_SLOTS  32
+
 /*----------------------------------------------------------------------------*/
 /*-- AHCI PCI Registers ------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
@@ -1038,4 +1041,10 @@ typedef volatile struct {
 	unsigned int ioc : 1;
 } ahci_cmd_prdt_t;
 
+/** Offset of the first PRDT entry within the command table. */
+#define AHCI_CMD_TABLE_PRDT_OFFSET  0x80
+
+/** Maximum data byte count of a single PRDT entry. */
+#define AHCI_PRDT_MAX_SIZE  (4 * 1024 * 1024)
+
 #endif
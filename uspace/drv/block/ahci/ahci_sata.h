@@ -48,6 +48,12 @@
 /** Size for indentify (packet) device buffer in bytes. */
 #define SATA_IDENTIFY_DEVICE_BUFFER_LENGTH  512
 
+/** Number of LBA range entries in a block of DATA SET MANAGEMENT data. */
+#define SATA_DSM_RANGES_PER_BLOCK  64
+
+/** Maximum number of blocks described by a single LBA range entry. */
+#define SATA_DSM_RANGE_MAX  0xffff
+
 /*----------------------------------------------------------------------------*/
 /*-- SATA Fis Frames ---------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
@@ -209,12 +215,17 @@ typedef struct {
 	uint16_t total_lba48_2;
 	uint16_t total_lba48_3;
 
-	uint16_t reserved104[1 + 105 - 104];
+	uint16_t reserved104;
+	/** Maximum number of blocks of DATA SET MANAGEMENT data. */
+	uint16_t max_dsm_blocks;
 	uint16_t physical_logic_sector_size;
 	/* Note: more fields are defined in ATA/ATAPI-7. */
 	uint16_t reserved107[1 + 127 - 107];
 	uint16_t reserved128[1 + 159 - 128];
-	uint16_t reserved160[1 + 255 - 160];
+	uint16_t reserved160[1 + 168 - 160];
+	/** DATA SET MANAGEMENT support. */
+	uint16_t dsm;
+	uint16_t reserved170[1 + 255 - 170];
 } sata_identify_data_t;
 
 /** Capability bits for register device. */
@@ -231,6 +242,12 @@ enum sata_cs1 {
 	sata_cs1_addr48 = 0x0400
 };
 
+/** Bits of @c identify_data_t.dsm. */
+enum sata_dsm {
+	/** TRIM bit of DATA SET MANAGEMENT supported. */
+	sata_dsm_trim = 0x0001
+};
+
 /** SATA capatibilities for not packet device - Serial ATA revision 3_1. */
 enum sata_np_caps {
 	/** Supports READ LOG DMA EXT. */
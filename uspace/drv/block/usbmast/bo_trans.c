@@ -36,6 +36,7 @@
 
 #include <stdbool.h>
 #include <errno.h>
+#include <mem.h>
 #include <str_error.h>
 #include <usb/debug.h>
 #include <usb/dev/request.h>
@@ -47,16 +48,42 @@
 #define MASTLOG(format, ...) \
 	usb_log_debug2("USB cl08: " format, ##__VA_ARGS__)
 
-/** Send command via bulk-only transport.
+/** Receive data stage of a command.
  *
- * @param mfun		Mass storage function
- * @param tag		Command block wrapper tag (automatically compared
- *			with answer)
- * @param cmd		SCSI command
+ * The preallocated DMA buffer of the device is used if the data fit, so
+ * that a DMA buffer does not have to be set up for each command.
+ */
+static errno_t usb_massstor_data_in(usbmast_dev_t *mdev, void *buf,
+    size_t size, size_t *act_size)
+{
+	if (mdev->dma_buf == NULL || size > USBMAST_MAX_XFER_SIZE)
+		return usb_pipe_read(mdev->bulk_in_pipe, buf, size, act_size);
+
+	errno_t rc = usb_pipe_read_dma(mdev->bulk_in_pipe, mdev->dma_buf,
+	    mdev->dma_buf, size, act_size);
+	if (rc == EOK)
+		memcpy(buf, mdev->dma_buf, *act_size);
+	return rc;
+}
+
+/** Send data stage of a command.
  *
- * @return		Error code
+ * @see usb_massstor_data_in
  */
-errno_t usb_massstor_cmd(usbmast_fun_t *mfun, uint32_t tag, scsi_cmd_t *cmd)
+static errno_t usb_massstor_data_out(usbmast_dev_t *mdev, const void *buf,
+    size_t size)
+{
+	if (mdev->dma_buf == NULL || size > USBMAST_MAX_XFER_SIZE)
+		return usb_pipe_write(mdev->bulk_out_pipe, buf, size);
+
+	memcpy(mdev->dma_buf, buf, size);
+	return usb_pipe_write_dma(mdev->bulk_out_pipe, mdev->dma_buf,
+	    mdev->dma_buf, size);
+}
+
+/** Send command via bulk-only transport with the device lock held. */
+static errno_t usb_massstor_cmd_locked(usbmast_fun_t *mfun, uint32_t tag,
+    scsi_cmd_t *cmd)
 {
 	errno_t rc;
 
@@ -94,17 +121,18 @@ errno_t usb_massstor_cmd(usbmast_fun_t *mfun, uint32_t tag, scsi_cmd_t *cmd)
 
 	MASTLOG("Transferring data.\n");
 	if (cmd->data_in) {
-		size_t act_size;
+		size_t act_size = 0;
 		/* Recieve data from the device. */
-		rc = usb_pipe_read(dpipe, cmd->data_in, cmd->data_in_size,
-		    &act_size);
+		rc = usb_massstor_data_in(mfun->mdev, cmd->data_in,
+		    cmd->data_in_size, &act_size);
 		MASTLOG("Received %zu bytes (%s): %s.\n", act_size,
 		    usb_debug_str_buffer(cmd->data_in, act_size, 0),
 		    str_error(rc));
 	}
 	if (cmd->data_out) {
 		/* Send data to the device. */
-		rc = usb_pipe_write(dpipe, cmd->data_out, cmd->data_out_size);
+		rc = usb_massstor_data_out(mfun->mdev, cmd->data_out,
+		    cmd->data_out_size);
 		MASTLOG("Sent %zu bytes (%s): %s.\n", cmd->data_out_size,
 		    usb_debug_str_buffer(cmd->data_out, cmd->data_out_size, 0),
 		    str_error(rc));
@@ -185,6 +213,26 @@ errno_t usb_massstor_cmd(usbmast_fun_t *mfun, uint32_t tag, scsi_cmd_t *cmd)
 	return rc;
 }
 
+/** Send command via bulk-only transport.
+ *
+ * @param mfun		Mass storage function
+ * @param tag		Command block wrapper tag (automatically compared
+ *			with answer)
+ * @param cmd		SCSI command
+ *
+ * @return		Error code
+ */
+errno_t usb_massstor_cmd(usbmast_fun_t *mfun, uint32_t tag, scsi_cmd_t *cmd)
+{
+	usbmast_dev_t *mdev = mfun->mdev;
+
+	fibril_mutex_lock(&mdev->lock);
+	errno_t rc = usb_massstor_cmd_locked(mfun, tag, cmd);
+	fibril_mutex_unlock(&mdev->lock);
+
+	return rc;
+}
+
 /** Perform bulk-only mass storage reset.
  *
  * @param mfun		Mass storage function
@@ -124,6 +124,8 @@ static errno_t usbmast_device_gone(usb_device_t *dev)
 		mdev->luns[i] = NULL;
 	}
 	free(mdev->luns);
+	if (mdev->dma_buf != NULL)
+		usb_pipe_free_buffer(mdev->bulk_in_pipe, mdev->dma_buf);
 	return EOK;
 }
 
@@ -167,6 +169,7 @@ static errno_t usbmast_device_add(usb_device_t *dev)
 	}
 
 	mdev->usb_dev = dev;
+	fibril_mutex_initialize(&mdev->lock);
 
 	usb_log_info("Initializing mass storage `%s'.",
 	    usb_device_get_name(dev));
@@ -185,6 +188,15 @@ static errno_t usbmast_device_add(usb_device_t *dev)
 
 	mdev->bulk_in_pipe = &epm_in->pipe;
 	mdev->bulk_out_pipe = &epm_out->pipe;
+
+	/* Both bulk pipes are served by the same host controller */
+	mdev->dma_buf = usb_pipe_alloc_buffer(mdev->bulk_in_pipe,
+	    USBMAST_MAX_XFER_SIZE);
+	if (mdev->dma_buf == NULL) {
+		usb_log_warning("Failed allocating DMA buffer, transfers "
+		    "will be slower.");
+	}
+
 	for (i = 0; i < mdev->lun_count; i++) {
 		rc = usbmast_fun_create(mdev, i);
 		if (rc != EOK)
@@ -205,6 +217,8 @@ error:
 		ddf_fun_destroy(mdev->luns[i]);
 	}
 	free(mdev->luns);
+	if (mdev->dma_buf != NULL)
+		usb_pipe_free_buffer(mdev->bulk_in_pipe, mdev->dma_buf);
 	return rc;
 }
 
@@ -276,7 +290,8 @@ static errno_t usbmast_fun_create(usbmast_dev_t *mdev, unsigned lun)
 	    usbmast_scsi_dev_type_str(inquiry.device_type),
 	    inquiry.removable ? "removable" : "non-removable");
 
-	uint32_t nblocks, block_size;
+	uint64_t nblocks;
+	uint32_t block_size;
 
 	rc = usbmast_read_capacity(mfun, &nblocks, &block_size);
 	if (rc != EOK) {
@@ -286,7 +301,7 @@ static errno_t usbmast_fun_create(usbmast_dev_t *mdev, unsigned lun)
 		goto error;
 	}
 
-	usb_log_info("Read Capacity: nblocks=%" PRIu32 ", "
+	usb_log_info("Read Capacity: nblocks=%" PRIu64 ", "
 	    "block_size=%" PRIu32 "\n", nblocks, block_size);
 
 	mfun->nblocks = nblocks;
@@ -40,6 +40,7 @@
 #include <byteorder.h>
 #include <inttypes.h>
 #include <macros.h>
+#include <stddef.h>
 #include <usb/dev/driver.h>
 #include <usb/debug.h>
 #include <errno.h>
@@ -105,7 +106,9 @@ static errno_t usb_massstor_unit_ready(usbmast_fun_t *mfun)
 
 /** Run SCSI command.
  *
- * Run command and repeat in case of unit attention.
+ * Run command and repeat in case of unit attention. Test Unit Ready is
+ * only issued before repeating the command, it would double the latency
+ * of every command otherwise.
  * XXX This is too simplified.
  */
 static errno_t usbmast_run_cmd(usbmast_fun_t *mfun, scsi_cmd_t *cmd)
@@ -115,13 +118,6 @@ static errno_t usbmast_run_cmd(usbmast_fun_t *mfun, scsi_cmd_t *cmd)
 	errno_t rc;
 
 	do {
-		rc = usb_massstor_unit_ready(mfun);
-		if (rc != EOK) {
-			usb_log_error("Inquiry transport failed, device %s: %s.",
-			    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
-			return rc;
-		}
-
 		rc = usb_massstor_cmd(mfun, 0xDEADBEEF, cmd);
 		if (rc != EOK) {
 			usb_log_error("Inquiry transport failed, device %s: %s.",
@@ -149,6 +145,13 @@ static errno_t usbmast_run_cmd(usbmast_fun_t *mfun, scsi_cmd_t *cmd)
 
 		if (sense_key == SCSI_SK_UNIT_ATTENTION) {
 			printf("Got unit attention. Re-trying command.\n");
+
+			rc = usb_massstor_unit_ready(mfun);
+			if (rc != EOK) {
+				usb_log_error("Test Unit Ready failed: %s.",
+				    str_error(rc));
+				return rc;
+			}
 		}
 
 	} while (sense_key == SCSI_SK_UNIT_ATTENTION);
@@ -265,7 +268,63 @@ errno_t usbmast_request_sense(usbmast_fun_t *mfun, void *buf, size_t size)
 	return EOK;
 }
 
+/** Perform SCSI Read Capacity (16) command on USB mass storage device.
+ *
+ * @param mfun		Mass storage function
+ * @param nblocks	Output, number of blocks
+ * @param block_size	Output, block size in bytes
+ *
+ * @return		Error code.
+ */
+static errno_t usbmast_read_capacity_16(usbmast_fun_t *mfun,
+    uint64_t *nblocks, uint32_t *block_size)
+{
+	scsi_cmd_t cmd;
+	scsi_cdb_read_capacity_16_t cdb;
+	scsi_read_capacity_16_data_t data;
+	errno_t rc;
+
+	memset(&cdb, 0, sizeof(cdb));
+	cdb.op_code = SCSI_CMD_READ_CAPACITY_16;
+	cdb.service_action = SCSI_SA_READ_CAPACITY_16;
+	cdb.alloc_len = host2uint32_t_be(sizeof(data));
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.cdb = &cdb;
+	cmd.cdb_size = sizeof(cdb);
+	cmd.data_in = &data;
+	cmd.data_in_size = sizeof(data);
+
+	rc = usbmast_run_cmd(mfun, &cmd);
+
+	if (rc != EOK) {
+		usb_log_error("Read Capacity (16) transport failed, device %s: %s.",
+		    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
+		return rc;
+	}
+
+	if (cmd.status != CMDS_GOOD) {
+		usb_log_error("Read Capacity (16) command failed, device %s.",
+		    usb_device_get_name(mfun->mdev->usb_dev));
+		return EIO;
+	}
+
+	if (cmd.rcvd_size < offsetof(scsi_read_capacity_16_data_t, reserved)) {
+		usb_log_error("SCSI Read Capacity response too short (%zu).",
+		    cmd.rcvd_size);
+		return EIO;
+	}
+
+	*nblocks = uint64_t_be2host(data.last_lba) + 1;
+	*block_size = uint32_t_be2host(data.block_size);
+
+	return EOK;
+}
+
 /** Perform SCSI Read Capacity command on USB mass storage device.
+ *
+ * Read Capacity (16) is used if the device has more blocks than Read
+ * Capacity (10) can report.
  *
  * @param mfun		Mass storage function
  * @param nblocks	Output, number of blocks
@@ -273,7 +332,7 @@ errno_t usbmast_request_sense(usbmast_fun_t *mfun, void *buf, size_t size)
  *
  * @return		Error code.
  */
-errno_t usbmast_read_capacity(usbmast_fun_t *mfun, uint32_t *nblocks,
+errno_t usbmast_read_capacity(usbmast_fun_t *mfun, uint64_t *nblocks,
     uint32_t *block_size)
 {
 	scsi_cmd_t cmd;
@@ -310,53 +369,78 @@ errno_t usbmast_read_capacity(usbmast_fun_t *mfun, uint32_t *nblocks,
 		return EIO;
 	}
 
-	*nblocks = uint32_t_be2host(data.last_lba) + 1;
+	if (uint32_t_be2host(data.last_lba) == UINT32_MAX)
+		return usbmast_read_capacity_16(mfun, nblocks, block_size);
+
+	*nblocks = (uint64_t) uint32_t_be2host(data.last_lba) + 1;
 	*block_size = uint32_t_be2host(data.block_size);
 
 	return EOK;
 }
 
-/** Perform SCSI Read command on USB mass storage device.
+/** Maximum number of blocks transferred by a single command.
+ *
+ * @param mfun		Mass storage function
+ * @return		Number of blocks
+ */
+static size_t usbmast_max_xfer_blocks(usbmast_fun_t *mfun)
+{
+	return max(USBMAST_MAX_XFER_SIZE / mfun->block_size, 1);
+}
+
+/** Perform a single SCSI Read command.
+ *
+ * Read (10) is used if the request can be expressed with it, Read (16)
+ * otherwise.
  *
  * @param mfun		Mass storage function
  * @param ba		Address of first block
  * @param nblocks	Number of blocks to read
+ * @param buf		Buffer for the data
  *
  * @return		Error code
  */
-errno_t usbmast_read(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks, void *buf)
+static errno_t usbmast_read_cmd(usbmast_fun_t *mfun, uint64_t ba,
+    size_t nblocks, void *buf)
 {
 	scsi_cmd_t cmd;
-	scsi_cdb_read_10_t cdb;
+	scsi_cdb_read_10_t cdb10;
+	scsi_cdb_read_16_t cdb16;
 	errno_t rc;
 
-	if (ba > UINT32_MAX)
-		return ELIMIT;
-
-	if (nblocks > UINT16_MAX)
-		return ELIMIT;
+	memset(&cmd, 0, sizeof(cmd));
 
-	memset(&cdb, 0, sizeof(cdb));
-	cdb.op_code = SCSI_CMD_READ_10;
-	cdb.lba = host2uint32_t_be(ba);
-	cdb.xfer_len = host2uint16_t_be(nblocks);
+	if (ba <= UINT32_MAX && nblocks <= UINT16_MAX) {
+		memset(&cdb10, 0, sizeof(cdb10));
+		cdb10.op_code = SCSI_CMD_READ_10;
+		cdb10.lba = host2uint32_t_be(ba);
+		cdb10.xfer_len = host2uint16_t_be(nblocks);
+
+		cmd.cdb = &cdb10;
+		cmd.cdb_size = sizeof(cdb10);
+	} else {
+		memset(&cdb16, 0, sizeof(cdb16));
+		cdb16.op_code = SCSI_CMD_READ_16;
+		cdb16.lba = host2uint64_t_be(ba);
+		cdb16.xfer_len = host2uint32_t_be(nblocks);
+
+		cmd.cdb = &cdb16;
+		cmd.cdb_size = sizeof(cdb16);
+	}
 
-	memset(&cmd, 0, sizeof(cmd));
-	cmd.cdb = &cdb;
-	cmd.cdb_size = sizeof(cdb);
 	cmd.data_in = buf;
 	cmd.data_in_size = nblocks * mfun->block_size;
 
 	rc = usbmast_run_cmd(mfun, &cmd);
 
 	if (rc != EOK) {
-		usb_log_error("Read (10) transport failed, device %s: %s.",
+		usb_log_error("Read transport failed, device %s: %s.",
 		    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
 		return rc;
 	}
 
 	if (cmd.status != CMDS_GOOD) {
-		usb_log_error("Read (10) command failed, device %s.",
+		usb_log_error("Read command failed, device %s.",
 		    usb_device_get_name(mfun->mdev->usb_dev));
 		return EIO;
 	}
@@ -370,49 +454,91 @@ errno_t usbmast_read(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks, void *buf
 	return EOK;
 }
 
-/** Perform SCSI Write command on USB mass storage device.
+/** Perform SCSI Read command on USB mass storage device.
+ *
+ * Large requests are split into commands of at most USBMAST_MAX_XFER_SIZE
+ * bytes.
  *
  * @param mfun		Mass storage function
  * @param ba		Address of first block
  * @param nblocks	Number of blocks to read
- * @param data		Data to write
+ * @param buf		Buffer for the data
  *
  * @return		Error code
  */
-errno_t usbmast_write(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks,
-    const void *data)
+errno_t usbmast_read(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks, void *buf)
 {
-	scsi_cmd_t cmd;
-	scsi_cdb_write_10_t cdb;
+	size_t max_blocks = usbmast_max_xfer_blocks(mfun);
 	errno_t rc;
 
-	if (ba > UINT32_MAX)
-		return ELIMIT;
+	while (nblocks > 0) {
+		size_t n = min(nblocks, max_blocks);
+
+		rc = usbmast_read_cmd(mfun, ba, n, buf);
+		if (rc != EOK)
+			return rc;
 
-	if (nblocks > UINT16_MAX)
-		return ELIMIT;
+		ba += n;
+		nblocks -= n;
+		buf = (uint8_t *) buf + n * mfun->block_size;
+	}
 
-	memset(&cdb, 0, sizeof(cdb));
-	cdb.op_code = SCSI_CMD_WRITE_10;
-	cdb.lba = host2uint32_t_be(ba);
-	cdb.xfer_len = host2uint16_t_be(nblocks);
+	return EOK;
+}
+
+/** Perform a single SCSI Write command.
+ *
+ * Write (10) is used if the request can be expressed with it, Write (16)
+ * otherwise.
+ *
+ * @param mfun		Mass storage function
+ * @param ba		Address of first block
+ * @param nblocks	Number of blocks to write
+ * @param data		Data to write
+ *
+ * @return		Error code
+ */
+static errno_t usbmast_write_cmd(usbmast_fun_t *mfun, uint64_t ba,
+    size_t nblocks, const void *data)
+{
+	scsi_cmd_t cmd;
+	scsi_cdb_write_10_t cdb10;
+	scsi_cdb_write_16_t cdb16;
+	errno_t rc;
 
 	memset(&cmd, 0, sizeof(cmd));
-	cmd.cdb = &cdb;
-	cmd.cdb_size = sizeof(cdb);
+
+	if (ba <= UINT32_MAX && nblocks <= UINT16_MAX) {
+		memset(&cdb10, 0, sizeof(cdb10));
+		cdb10.op_code = SCSI_CMD_WRITE_10;
+		cdb10.lba = host2uint32_t_be(ba);
+		cdb10.xfer_len = host2uint16_t_be(nblocks);
+
+		cmd.cdb = &cdb10;
+		cmd.cdb_size = sizeof(cdb10);
+	} else {
+		memset(&cdb16, 0, sizeof(cdb16));
+		cdb16.op_code = SCSI_CMD_WRITE_16;
+		cdb16.lba = host2uint64_t_be(ba);
+		cdb16.xfer_len = host2uint32_t_be(nblocks);
+
+		cmd.cdb = &cdb16;
+		cmd.cdb_size = sizeof(cdb16);
+	}
+
 	cmd.data_out = data;
 	cmd.data_out_size = nblocks * mfun->block_size;
 
 	rc = usbmast_run_cmd(mfun, &cmd);
 
 	if (rc != EOK) {
-		usb_log_error("Write (10) transport failed, device %s: %s.",
+		usb_log_error("Write transport failed, device %s: %s.",
 		    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
 		return rc;
 	}
 
 	if (cmd.status != CMDS_GOOD) {
-		usb_log_error("Write (10) command failed, device %s.",
+		usb_log_error("Write command failed, device %s.",
 		    usb_device_get_name(mfun->mdev->usb_dev));
 		return EIO;
 	}
@@ -420,44 +546,89 @@ errno_t usbmast_write(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks,
 	return EOK;
 }
 
-/** Perform SCSI Synchronize Cache command on USB mass storage device.
+/** Perform SCSI Write command on USB mass storage device.
+ *
+ * Large requests are split into commands of at most USBMAST_MAX_XFER_SIZE
+ * bytes.
  *
  * @param mfun		Mass storage function
  * @param ba		Address of first block
- * @param nblocks	Number of blocks to read
+ * @param nblocks	Number of blocks to write
  * @param data		Data to write
  *
  * @return		Error code
  */
-errno_t usbmast_sync_cache(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks)
+errno_t usbmast_write(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks,
+    const void *data)
 {
-	if (ba > UINT32_MAX)
-		return ELIMIT;
+	size_t max_blocks = usbmast_max_xfer_blocks(mfun);
+	errno_t rc;
+
+	while (nblocks > 0) {
+		size_t n = min(nblocks, max_blocks);
+
+		rc = usbmast_write_cmd(mfun, ba, n, data);
+		if (rc != EOK)
+			return rc;
 
-	if (nblocks > UINT16_MAX)
-		return ELIMIT;
+		ba += n;
+		nblocks -= n;
+		data = (const uint8_t *) data + n * mfun->block_size;
+	}
 
-	const scsi_cdb_sync_cache_10_t cdb = {
-		.op_code = SCSI_CMD_SYNC_CACHE_10,
-		.lba = host2uint32_t_be(ba),
-		.numlb = host2uint16_t_be(nblocks),
-	};
+	return EOK;
+}
 
-	scsi_cmd_t cmd = {
-		.cdb = &cdb,
-		.cdb_size = sizeof(cdb),
-	};
+/** Perform SCSI Synchronize Cache command on USB mass storage device.
+ *
+ * Synchronize Cache (16) is used if the range cannot be expressed with
+ * Synchronize Cache (10).
+ *
+ * @param mfun		Mass storage function
+ * @param ba		Address of first block
+ * @param nblocks	Number of blocks to synchronize
+ *
+ * @return		Error code
+ */
+errno_t usbmast_sync_cache(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks)
+{
+	scsi_cdb_sync_cache_10_t cdb10;
+	scsi_cdb_sync_cache_16_t cdb16;
+	scsi_cmd_t cmd;
+
+	memset(&cmd, 0, sizeof(cmd));
+
+	if (ba <= UINT32_MAX && nblocks <= UINT16_MAX) {
+		memset(&cdb10, 0, sizeof(cdb10));
+		cdb10.op_code = SCSI_CMD_SYNC_CACHE_10;
+		cdb10.lba = host2uint32_t_be(ba);
+		cdb10.numlb = host2uint16_t_be(nblocks);
+
+		cmd.cdb = &cdb10;
+		cmd.cdb_size = sizeof(cdb10);
+	} else {
+		if (nblocks > UINT32_MAX)
+			return ELIMIT;
+
+		memset(&cdb16, 0, sizeof(cdb16));
+		cdb16.op_code = SCSI_CMD_SYNC_CACHE_16;
+		cdb16.lba = host2uint64_t_be(ba);
+		cdb16.numlb = host2uint32_t_be(nblocks);
+
+		cmd.cdb = &cdb16;
+		cmd.cdb_size = sizeof(cdb16);
+	}
 
 	const errno_t rc = usbmast_run_cmd(mfun, &cmd);
 
 	if (rc != EOK) {
-		usb_log_error("Synchronize Cache (10) transport failed, device %s: %s.",
+		usb_log_error("Synchronize Cache transport failed, device %s: %s.",
 		    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
 		return rc;
 	}
 
 	if (cmd.status != CMDS_GOOD) {
-		usb_log_error("Synchronize Cache (10) command failed, device %s.",
+		usb_log_error("Synchronize Cache command failed, device %s.",
 		    usb_device_get_name(mfun->mdev->usb_dev));
 		return EIO;
 	}
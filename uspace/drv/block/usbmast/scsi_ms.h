@@ -61,7 +61,7 @@ typedef struct {
 
 extern errno_t usbmast_inquiry(usbmast_fun_t *, usbmast_inquiry_data_t *);
 extern errno_t usbmast_request_sense(usbmast_fun_t *, void *, size_t);
-extern errno_t usbmast_read_capacity(usbmast_fun_t *, uint32_t *, uint32_t *);
+extern errno_t usbmast_read_capacity(usbmast_fun_t *, uint64_t *, uint32_t *);
 extern errno_t usbmast_read(usbmast_fun_t *, uint64_t, size_t, void *);
 extern errno_t usbmast_write(usbmast_fun_t *, uint64_t, size_t, const void *);
 extern errno_t usbmast_sync_cache(usbmast_fun_t *, uint64_t, size_t);
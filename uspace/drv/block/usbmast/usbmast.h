@@ -37,10 +37,14 @@
 #define USBMAST_H_
 
 #include <bd_srv.h>
+#include <fibril_synch.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <usb/usb.h>
 
+/** Maximum number of bytes transferred by a single SCSI command */
+#define USBMAST_MAX_XFER_SIZE  (1024 * 1024)
+
 /** Mass storage device. */
 typedef struct usbmast_dev {
 	/** USB device */
@@ -53,6 +57,10 @@ typedef struct usbmast_dev {
 	usb_pipe_t *bulk_in_pipe;
 	/** Data write pipe */
 	usb_pipe_t *bulk_out_pipe;
+	/** Serializes commands, bulk-only transport runs one at a time */
+	fibril_mutex_t lock;
+	/** DMA buffer of USBMAST_MAX_XFER_SIZE bytes for the data stage */
+	void *dma_buf;
 } usbmast_dev_t;
 
 /** Mass storage function.
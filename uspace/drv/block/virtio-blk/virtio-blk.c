@@ -32,6 +32,9 @@
 #include <stdint.h>
 
 #include <as.h>
+#include <byteorder.h>
+#include <macros.h>
+#include <time.h>
 #include <ddf/driver.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -44,10 +47,6 @@
 
 #define NAME	"virtio-blk"
 
-#define VIRTIO_BLK_NUM_QUEUES	1
-
-#define RQ_QUEUE	0
-
 /*
  * VIRTIO_BLK requests need at least two descriptors so that device-read-only
  * buffers are separated from device-writable buffers. For convenience, we
@@ -72,22 +71,32 @@ static driver_t virtio_blk_driver = {
 	.driver_ops = &virtio_blk_driver_ops
 };
 
-static void virtio_blk_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+/** Mark requests used by the device as done and wake up their waiters */
+static void virtio_blk_queue_reap(virtio_blk_t *virtio_blk,
+    virtio_blk_queue_t *q)
 {
-	virtio_blk_t *virtio_blk = (virtio_blk_t *) ddf_dev_data_get(dev);
 	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
 
 	uint16_t descno;
 	uint32_t len;
 
-	while (virtio_virtq_consume_used(vdev, RQ_QUEUE, &descno, &len)) {
+	while (virtio_virtq_consume_used(vdev, q->num, &descno, &len)) {
 		assert(descno < RQ_BUFFERS);
-		fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
-		fibril_condvar_signal(&virtio_blk->completion_cv[descno]);
-		fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
+		fibril_mutex_lock(&q->completion_lock[descno]);
+		q->rq_done[descno] = true;
+		fibril_condvar_signal(&q->completion_cv[descno]);
+		fibril_mutex_unlock(&q->completion_lock[descno]);
 	}
 }
 
+static void virtio_blk_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	virtio_blk_t *virtio_blk = (virtio_blk_t *) ddf_dev_data_get(dev);
+
+	for (unsigned i = 0; i < virtio_blk->num_queues; i++)
+		virtio_blk_queue_reap(virtio_blk, &virtio_blk->queues[i]);
+}
+
 static errno_t virtio_blk_register_interrupt(ddf_dev_t *dev)
 {
 	virtio_blk_t *virtio_blk = (virtio_blk_t *) ddf_dev_data_get(dev);
@@ -157,119 +166,260 @@ static errno_t virtio_blk_bd_close(bd_srv_t *bd)
 	return EOK;
 }
 
-static errno_t virtio_blk_rw_block(virtio_blk_t *virtio_blk, bool read,
-    aoff64_t ba, void *buf)
+/** Allocate a request descriptor
+ *
+ * The allocated descno will determine the header descriptor
+ * (REQ_HEADER_DESC), the buffer descriptor (REQ_BUFFER_DESC) and the
+ * footer (REQ_FOOTER_DESC) descriptor.
+ *
+ * @param wait  Wait for a descriptor to become free if there is none.
+ *
+ * @return  Allocated descriptor or 0xFFFF if none is free and @a wait is
+ *          false.
+ */
+static uint16_t virtio_blk_rq_alloc(virtio_blk_t *virtio_blk,
+    virtio_blk_queue_t *q, bool wait)
 {
 	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
 
-	/*
-	 * Allocate a descriptor.
-	 *
-	 * The allocated descno will determine the header descriptor
-	 * (REQ_HEADER_DESC), the buffer descriptor (REQ_BUFFER_DESC) and the
-	 * footer (REQ_FOOTER_DESC) descriptor.
-	 */
-	fibril_mutex_lock(&virtio_blk->free_lock);
-	uint16_t descno = virtio_alloc_desc(vdev, RQ_QUEUE,
-	    &virtio_blk->rq_free_head);
-	while (descno == (uint16_t) -1U) {
-		fibril_condvar_wait(&virtio_blk->free_cv,
-		    &virtio_blk->free_lock);
-		descno = virtio_alloc_desc(vdev, RQ_QUEUE,
-		    &virtio_blk->rq_free_head);
+	fibril_mutex_lock(&q->free_lock);
+	uint16_t descno = virtio_alloc_desc(vdev, q->num, &q->rq_free_head);
+	while (wait && descno == (uint16_t) -1U) {
+		fibril_condvar_wait(&q->free_cv, &q->free_lock);
+		descno = virtio_alloc_desc(vdev, q->num, &q->rq_free_head);
 	}
-	fibril_mutex_unlock(&virtio_blk->free_lock);
+	if (descno != (uint16_t) -1U)
+		q->rq_inflight++;
+	fibril_mutex_unlock(&q->free_lock);
+
+	assert(descno < RQ_BUFFERS || descno == (uint16_t) -1U);
+	return descno;
+}
+
+/** Free a request descriptor and its buffers */
+static void virtio_blk_rq_free(virtio_blk_t *virtio_blk,
+    virtio_blk_queue_t *q, uint16_t descno)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
 
-	assert(descno < RQ_BUFFERS);
+	fibril_mutex_lock(&q->free_lock);
+	virtio_free_desc(vdev, q->num, &q->rq_free_head, descno);
+	q->rq_inflight--;
+	fibril_condvar_signal(&q->free_cv);
+	fibril_mutex_unlock(&q->free_lock);
+}
+
+/** Submit a request to the device
+ *
+ * @param type  Request type (VIRTIO_BLK_T_*).
+ * @param ba    First block of the request.
+ * @param size  Size of the request buffer, at most RQ_BLOCKS blocks.
+ * @param buf   Data to send to the device, unused for reading.
+ */
+static void virtio_blk_rq_submit(virtio_blk_t *virtio_blk,
+    virtio_blk_queue_t *q, uint16_t descno, uint32_t type, aoff64_t ba,
+    size_t size, const void *buf)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+	bool read = (type == VIRTIO_BLK_T_IN);
+
+	assert(size <= RQ_BLOCKS * VIRTIO_BLK_BLOCK_SIZE);
 
 	/* Setup the request header */
 	virtio_blk_req_header_t *req_header =
-	    (virtio_blk_req_header_t *) virtio_blk->rq_header[descno];
+	    (virtio_blk_req_header_t *) q->rq_header[descno];
 	memset(req_header, 0, sizeof(virtio_blk_req_header_t));
-	pio_write_le32(&req_header->type,
-	    read ? VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT);
+	pio_write_le32(&req_header->type, type);
 	pio_write_le64(&req_header->sector, ba);
 
 	/* Copy write data to the request. */
 	if (!read)
-		memcpy(virtio_blk->rq_buf[descno], buf, VIRTIO_BLK_BLOCK_SIZE);
+		memcpy(q->rq_buf[descno], buf, size);
 
-	fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
+	fibril_mutex_lock(&q->completion_lock[descno]);
+	q->rq_done[descno] = false;
+	fibril_mutex_unlock(&q->completion_lock[descno]);
 
 	/*
 	 * Set the descriptors, chain them in the virtqueue and notify the
 	 * device.
 	 */
-	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_HEADER_DESC(descno),
-	    virtio_blk->rq_header_p[descno], sizeof(virtio_blk_req_header_t),
+	virtio_virtq_desc_set(vdev, q->num, REQ_HEADER_DESC(descno),
+	    q->rq_header_p[descno], sizeof(virtio_blk_req_header_t),
 	    VIRTQ_DESC_F_NEXT, REQ_BUFFER_DESC(descno));
-	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_BUFFER_DESC(descno),
-	    virtio_blk->rq_buf_p[descno], VIRTIO_BLK_BLOCK_SIZE,
+	virtio_virtq_desc_set(vdev, q->num, REQ_BUFFER_DESC(descno),
+	    q->rq_buf_p[descno], size,
 	    VIRTQ_DESC_F_NEXT | (read ? VIRTQ_DESC_F_WRITE : 0),
 	    REQ_FOOTER_DESC(descno));
-	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_FOOTER_DESC(descno),
-	    virtio_blk->rq_footer_p[descno], sizeof(virtio_blk_req_footer_t),
+	virtio_virtq_desc_set(vdev, q->num, REQ_FOOTER_DESC(descno),
+	    q->rq_footer_p[descno], sizeof(virtio_blk_req_footer_t),
 	    VIRTQ_DESC_F_WRITE, 0);
-	virtio_virtq_produce_available(vdev, RQ_QUEUE, descno);
+	virtio_virtq_produce_available(vdev, q->num, descno);
+}
 
-	/*
-	 * Wait for the completion of the request.
-	 */
-	fibril_condvar_wait(&virtio_blk->completion_cv[descno],
-	    &virtio_blk->completion_lock[descno]);
-	fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
+/** Check whether a request is done */
+static bool virtio_blk_rq_done(virtio_blk_queue_t *q, uint16_t descno)
+{
+	fibril_mutex_lock(&q->completion_lock[descno]);
+	bool done = q->rq_done[descno];
+	fibril_mutex_unlock(&q->completion_lock[descno]);
+
+	return done;
+}
+
+/** Poll the used ring for a while instead of waiting for an interrupt
+ *
+ * Polling is worth it only when the device completes requests often enough,
+ * i.e. when many requests are in flight. Interrupts for the virtqueue are
+ * suppressed while anybody polls it.
+ *
+ * @return  True if the request is done, false if the time ran out.
+ */
+static bool virtio_blk_rq_poll(virtio_blk_t *virtio_blk,
+    virtio_blk_queue_t *q, uint16_t descno)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+
+	fibril_mutex_lock(&q->free_lock);
+	if (q->rq_inflight < VIRTIO_BLK_POLL_DEPTH) {
+		fibril_mutex_unlock(&q->free_lock);
+		return false;
+	}
+	if (q->pollers++ == 0)
+		virtio_virtq_interrupt_enable(vdev, q->num, false);
+	fibril_mutex_unlock(&q->free_lock);
+
+	struct timespec deadline;
+	struct timespec now;
+	getuptime(&deadline);
+	ts_add_diff(&deadline, USEC2NSEC(VIRTIO_BLK_POLL_USEC));
+
+	bool done;
+	do {
+		virtio_blk_queue_reap(virtio_blk, q);
+		done = virtio_blk_rq_done(q, descno);
+		if (done)
+			break;
+
+		fibril_yield();
+		getuptime(&now);
+	} while (ts_gt(&deadline, &now));
+
+	fibril_mutex_lock(&q->free_lock);
+	if (--q->pollers == 0)
+		virtio_virtq_interrupt_enable(vdev, q->num, true);
+	fibril_mutex_unlock(&q->free_lock);
+
+	/* Pick up requests completed while interrupts were suppressed */
+	virtio_blk_queue_reap(virtio_blk, q);
+
+	return done;
+}
+
+/** Wait for the completion of a request and return its status */
+static errno_t virtio_blk_rq_wait(virtio_blk_t *virtio_blk,
+    virtio_blk_queue_t *q, uint16_t descno)
+{
+	if (!virtio_blk_rq_poll(virtio_blk, q, descno)) {
+		fibril_mutex_lock(&q->completion_lock[descno]);
+		while (!q->rq_done[descno]) {
+			fibril_condvar_wait(&q->completion_cv[descno],
+			    &q->completion_lock[descno]);
+		}
+		fibril_mutex_unlock(&q->completion_lock[descno]);
+	}
 
-	errno_t rc;
 	virtio_blk_req_footer_t *footer =
-	    (virtio_blk_req_footer_t *) virtio_blk->rq_footer[descno];
+	    (virtio_blk_req_footer_t *) q->rq_footer[descno];
 	switch (footer->status) {
 	case VIRTIO_BLK_S_OK:
-		rc = EOK;
-		break;
+		return EOK;
 	case VIRTIO_BLK_S_IOERR:
-		rc = EIO;
-		break;
+		return EIO;
 	case VIRTIO_BLK_S_UNSUPP:
-		rc = ENOTSUP;
-		break;
+		return ENOTSUP;
 	default:
 		ddf_msg(LVL_DEBUG, "device returned unknown status=%d\n",
 		    (int) footer->status);
-		rc = EIO;
-		break;
+		return EIO;
 	}
+}
 
-	/* Copy read data from the request */
-	if (rc == EOK && read)
-		memcpy(buf, virtio_blk->rq_buf[descno], VIRTIO_BLK_BLOCK_SIZE);
-
-	/* Free the descriptor and buffer */
-	fibril_mutex_lock(&virtio_blk->free_lock);
-	virtio_free_desc(vdev, RQ_QUEUE, &virtio_blk->rq_free_head, descno);
-	fibril_condvar_signal(&virtio_blk->free_cv);
-	fibril_mutex_unlock(&virtio_blk->free_lock);
-
-	return rc;
+/** Pick a request virtqueue, round-robin */
+static virtio_blk_queue_t *virtio_blk_queue_get(virtio_blk_t *virtio_blk)
+{
+	return &virtio_blk->queues[atomic_fetch_add(&virtio_blk->next_queue,
+	    1) % virtio_blk->num_queues];
 }
 
+/** Read or write blocks
+ *
+ * The transfer is split into requests of up to RQ_BLOCKS blocks and as many
+ * of them as there are free descriptors are kept in flight.
+ */
 static errno_t virtio_blk_bd_rw_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
     void *buf, size_t size, bool read)
 {
 	virtio_blk_t *virtio_blk = (virtio_blk_t *) bd->srvs->sarg;
-	aoff64_t i;
-	errno_t rc;
 
 	if (size != cnt * VIRTIO_BLK_BLOCK_SIZE)
 		return EINVAL;
 
-	for (i = 0; i < cnt; i++) {
-		rc = virtio_blk_rw_block(virtio_blk, read, ba + i,
-		    buf + i * VIRTIO_BLK_BLOCK_SIZE);
-		if (rc != EOK)
-			return rc;
+	virtio_blk_queue_t *q = virtio_blk_queue_get(virtio_blk);
+
+	/* Requests in flight in the order of submission */
+	uint16_t order[RQ_BUFFERS];
+	size_t first[RQ_BUFFERS];
+	unsigned head = 0;
+	unsigned inflight = 0;
+
+	size_t next = 0;
+	errno_t rc = EOK;
+
+	while (next < cnt || inflight > 0) {
+		while (next < cnt && rc == EOK) {
+			uint16_t descno = virtio_blk_rq_alloc(virtio_blk, q,
+			    inflight == 0);
+			if (descno == (uint16_t) -1U)
+				break;
+
+			size_t blocks = min(cnt - next, (size_t) RQ_BLOCKS);
+			virtio_blk_rq_submit(virtio_blk, q, descno,
+			    read ? VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT,
+			    ba + next, blocks * VIRTIO_BLK_BLOCK_SIZE,
+			    buf + next * VIRTIO_BLK_BLOCK_SIZE);
+
+			order[(head + inflight) % RQ_BUFFERS] = descno;
+			first[descno] = next;
+			inflight++;
+			next += blocks;
+		}
+
+		if (inflight == 0)
+			break;
+
+		/* Wait for the oldest request */
+		uint16_t descno = order[head];
+		head = (head + 1) % RQ_BUFFERS;
+		inflight--;
+
+		errno_t rrc = virtio_blk_rq_wait(virtio_blk, q, descno);
+
+		/* Copy read data from the request */
+		if (rrc == EOK && rc == EOK && read) {
+			size_t blocks = min(cnt - first[descno],
+			    (size_t) RQ_BLOCKS);
+			memcpy(buf + first[descno] * VIRTIO_BLK_BLOCK_SIZE,
+			    q->rq_buf[descno], blocks * VIRTIO_BLK_BLOCK_SIZE);
+		}
+
+		if (rc == EOK)
+			rc = rrc;
+
+		virtio_blk_rq_free(virtio_blk, q, descno);
 	}
 
-	return EOK;
+	return rc;
 }
 
 static errno_t virtio_blk_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
@@ -284,6 +434,45 @@ static errno_t virtio_blk_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
 	return virtio_blk_bd_rw_blocks(bd, ba, cnt, (void *) buf, size, false);
 }
 
+/** Discard blocks
+ *
+ * The range is split into segments of at most the device's maximum discard
+ * size, which are sent to the device in as few requests as possible.
+ */
+static errno_t virtio_blk_bd_discard(bd_srv_t *bd, aoff64_t ba, size_t cnt)
+{
+	virtio_blk_t *virtio_blk = (virtio_blk_t *) bd->srvs->sarg;
+
+	if (virtio_blk->discard_sectors == 0)
+		return ENOTSUP;
+
+	virtio_blk_queue_t *q = virtio_blk_queue_get(virtio_blk);
+	virtio_blk_discard_seg_t seg[VIRTIO_BLK_DISCARD_SEGS];
+	errno_t rc = EOK;
+
+	while (cnt > 0 && rc == EOK) {
+		unsigned nseg = 0;
+		while (cnt > 0 && nseg < virtio_blk->discard_segs) {
+			size_t n = min(cnt,
+			    (size_t) virtio_blk->discard_sectors);
+			seg[nseg].sector = host2uint64_t_le(ba);
+			seg[nseg].num_sectors = host2uint32_t_le(n);
+			seg[nseg].flags = 0;
+			nseg++;
+			ba += n;
+			cnt -= n;
+		}
+
+		uint16_t descno = virtio_blk_rq_alloc(virtio_blk, q, true);
+		virtio_blk_rq_submit(virtio_blk, q, descno,
+		    VIRTIO_BLK_T_DISCARD, 0, nseg * sizeof(seg[0]), seg);
+		rc = virtio_blk_rq_wait(virtio_blk, q, descno);
+		virtio_blk_rq_free(virtio_blk, q, descno);
+	}
+
+	return rc;
+}
+
 static errno_t virtio_blk_bd_get_block_size(bd_srv_t *bd, size_t *size)
 {
 	*size = VIRTIO_BLK_BLOCK_SIZE;
@@ -305,8 +494,18 @@ bd_ops_t virtio_blk_bd_ops = {
 	.write_blocks = virtio_blk_bd_write_blocks,
 	.get_block_size = virtio_blk_bd_get_block_size,
 	.get_num_blocks = virtio_blk_bd_get_num_blocks,
+	.discard = virtio_blk_bd_discard,
 };
 
+static void virtio_blk_teardown_queues(virtio_blk_t *virtio_blk)
+{
+	for (unsigned q = 0; q < VIRTIO_BLK_MAX_QUEUES; q++) {
+		virtio_teardown_dma_bufs(virtio_blk->queues[q].rq_header);
+		virtio_teardown_dma_bufs(virtio_blk->queues[q].rq_buf);
+		virtio_teardown_dma_bufs(virtio_blk->queues[q].rq_footer);
+	}
+}
+
 static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 {
 	virtio_blk_t *virtio_blk = ddf_dev_data_alloc(dev,
@@ -314,17 +513,23 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 	if (!virtio_blk)
 		return ENOMEM;
 
-	fibril_mutex_initialize(&virtio_blk->free_lock);
-	fibril_condvar_initialize(&virtio_blk->free_cv);
+	for (unsigned q = 0; q < VIRTIO_BLK_MAX_QUEUES; q++) {
+		virtio_blk_queue_t *queue = &virtio_blk->queues[q];
 
-	for (unsigned i = 0; i < RQ_BUFFERS; i++) {
-		fibril_mutex_initialize(&virtio_blk->completion_lock[i]);
-		fibril_condvar_initialize(&virtio_blk->completion_cv[i]);
+		queue->num = q;
+		fibril_mutex_initialize(&queue->free_lock);
+		fibril_condvar_initialize(&queue->free_cv);
+
+		for (unsigned i = 0; i < RQ_BUFFERS; i++) {
+			fibril_mutex_initialize(&queue->completion_lock[i]);
+			fibril_condvar_initialize(&queue->completion_cv[i]);
+		}
 	}
 
 	bd_srvs_init(&virtio_blk->bds);
 	virtio_blk->bds.ops = &virtio_blk_bd_ops;
 	virtio_blk->bds.sarg = virtio_blk;
+	virtio_blk->bds.max_requests = BD_SRV_MAX_REQUESTS;
 
 	errno_t rc = virtio_pci_dev_initialize(dev, &virtio_blk->virtio_dev);
 	if (rc != EOK)
@@ -341,58 +546,86 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 		goto fail;
 
 	/* Reset the device and negotiate the feature bits */
-	rc = virtio_device_setup_start(vdev, 0);
+	rc = virtio_device_setup_start(vdev, 0,
+	    VIRTIO_BLK_F_MQ | VIRTIO_BLK_F_DISCARD);
 	if (rc != EOK)
 		goto fail;
 
 	/* Perform device-specific setup */
 
 	/*
-	 * Discover and configure the virtqueue
+	 * Discover and configure the virtqueues
 	 */
-	uint16_t num_queues = pio_read_le16(&cfg->num_queues);
-	if (num_queues != VIRTIO_BLK_NUM_QUEUES) {
+	uint16_t num_queues = 1;
+	if (vdev->features & VIRTIO_BLK_F_MQ) {
+		virtio_blk_cfg_t *blkcfg = vdev->device_cfg;
+		num_queues = pio_read_le16(&blkcfg->num_queues);
+	}
+
+	if (num_queues == 0 || num_queues > pio_read_le16(&cfg->num_queues)) {
 		ddf_msg(LVL_NOTE, "Unsupported number of virtqueues: %u",
 		    num_queues);
 		rc = ELIMIT;
 		goto fail;
 	}
 
-	vdev->queues = calloc(sizeof(virtq_t), num_queues);
+	virtio_blk->num_queues = min(num_queues, VIRTIO_BLK_MAX_QUEUES);
+	ddf_msg(LVL_NOTE, "Using %u request virtqueue(s)",
+	    virtio_blk->num_queues);
+
+	if (vdev->features & VIRTIO_BLK_F_DISCARD) {
+		virtio_blk_cfg_t *blkcfg = vdev->device_cfg;
+		virtio_blk->discard_sectors =
+		    pio_read_le32(&blkcfg->max_discard_sectors);
+		virtio_blk->discard_segs = min(
+		    pio_read_le32(&blkcfg->max_discard_seg),
+		    VIRTIO_BLK_DISCARD_SEGS);
+		if (virtio_blk->discard_segs == 0)
+			virtio_blk->discard_sectors = 0;
+	}
+
+	vdev->queues = calloc(sizeof(virtq_t), virtio_blk->num_queues);
 	if (!vdev->queues) {
 		rc = ENOMEM;
 		goto fail;
 	}
 
-	/* For each in/out request we need 3 descriptors */
-	rc = virtio_virtq_setup(vdev, RQ_QUEUE, 3 * RQ_BUFFERS);
-	if (rc != EOK)
-		goto fail;
-
-	/*
-	 * Setup DMA buffers
-	 */
-	rc = virtio_setup_dma_bufs(RQ_BUFFERS, sizeof(virtio_blk_req_header_t),
-	    true, virtio_blk->rq_header, virtio_blk->rq_header_p);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_setup_dma_bufs(RQ_BUFFERS, VIRTIO_BLK_BLOCK_SIZE,
-	    true, virtio_blk->rq_buf, virtio_blk->rq_buf_p);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_setup_dma_bufs(RQ_BUFFERS, sizeof(virtio_blk_req_footer_t),
-	    false, virtio_blk->rq_footer, virtio_blk->rq_footer_p);
-	if (rc != EOK)
-		goto fail;
+	for (unsigned q = 0; q < virtio_blk->num_queues; q++) {
+		virtio_blk_queue_t *queue = &virtio_blk->queues[q];
 
-	/*
-	 * Put all request descriptors on a free list. Because of the
-	 * correspondence between the request, buffer and footer descriptors,
-	 * we only need to manage allocations for one set: the request header
-	 * descriptors.
-	 */
-	virtio_create_desc_free_list(vdev, RQ_QUEUE, RQ_BUFFERS,
-	    &virtio_blk->rq_free_head);
+		/* For each in/out request we need 3 descriptors */
+		rc = virtio_virtq_setup(vdev, q, 3 * RQ_BUFFERS);
+		if (rc != EOK)
+			goto fail;
+
+		/*
+		 * Setup DMA buffers
+		 */
+		rc = virtio_setup_dma_bufs(RQ_BUFFERS,
+		    sizeof(virtio_blk_req_header_t), true, queue->rq_header,
+		    queue->rq_header_p);
+		if (rc != EOK)
+			goto fail;
+		rc = virtio_setup_dma_bufs(RQ_BUFFERS,
+		    RQ_BLOCKS * VIRTIO_BLK_BLOCK_SIZE, true, queue->rq_buf,
+		    queue->rq_buf_p);
+		if (rc != EOK)
+			goto fail;
+		rc = virtio_setup_dma_bufs(RQ_BUFFERS,
+		    sizeof(virtio_blk_req_footer_t), false, queue->rq_footer,
+		    queue->rq_footer_p);
+		if (rc != EOK)
+			goto fail;
+
+		/*
+		 * Put all request descriptors on a free list. Because of the
+		 * correspondence between the request, buffer and footer
+		 * descriptors, we only need to manage allocations for one set:
+		 * the request header descriptors.
+		 */
+		virtio_create_desc_free_list(vdev, q, RQ_BUFFERS,
+		    &queue->rq_free_head);
+	}
 
 	/*
 	 * Enable IRQ
@@ -412,9 +645,7 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 	return EOK;
 
 fail:
-	virtio_teardown_dma_bufs(virtio_blk->rq_header);
-	virtio_teardown_dma_bufs(virtio_blk->rq_buf);
-	virtio_teardown_dma_bufs(virtio_blk->rq_footer);
+	virtio_blk_teardown_queues(virtio_blk);
 
 	virtio_device_setup_fail(vdev);
 	virtio_pci_dev_cleanup(vdev);
@@ -425,9 +656,7 @@ static void virtio_blk_uninitialize(ddf_dev_t *dev)
 {
 	virtio_blk_t *virtio_blk = (virtio_blk_t *) ddf_dev_data_get(dev);
 
-	virtio_teardown_dma_bufs(virtio_blk->rq_header);
-	virtio_teardown_dma_bufs(virtio_blk->rq_buf);
-	virtio_teardown_dma_bufs(virtio_blk->rq_footer);
+	virtio_blk_teardown_queues(virtio_blk);
 
 	virtio_device_setup_fail(&virtio_blk->virtio_dev);
 	virtio_pci_dev_cleanup(&virtio_blk->virtio_dev);
@@ -34,22 +34,47 @@
 #include <abi/cap.h>
 
 #include <fibril_synch.h>
+#include <stdatomic.h>
 
 #define VIRTIO_BLK_BLOCK_SIZE	512
 
 /* Operation types. */
 #define VIRTIO_BLK_T_IN		0
 #define VIRTIO_BLK_T_OUT	1
+#define VIRTIO_BLK_T_DISCARD	11
 
 /* Status codes returned by the device. */
 #define VIRTIO_BLK_S_OK		0
 #define VIRTIO_BLK_S_IOERR	1
 #define VIRTIO_BLK_S_UNSUPP	2
 
+/** Number of requests per virtqueue. */
 #define RQ_BUFFERS	32
 
+/** Maximum number of blocks transferred by a single request. */
+#define RQ_BLOCKS	64
+
+/** Maximum number of request virtqueues used. */
+#define VIRTIO_BLK_MAX_QUEUES	4
+
+/**
+ * Waiters poll the used ring for a while before sleeping if at least this
+ * many requests are in flight in the virtqueue.
+ */
+#define VIRTIO_BLK_POLL_DEPTH	8
+
+/** Time spent polling the used ring (in microseconds). */
+#define VIRTIO_BLK_POLL_USEC	50
+
+/** Maximum number of discard segments per request. */
+#define VIRTIO_BLK_DISCARD_SEGS	16
+
 /** Device is read-only. */
 #define VIRTIO_BLK_F_RO		(1U << 5)
+/** Device supports multiple virtqueues. */
+#define VIRTIO_BLK_F_MQ		(1U << 12)
+/** Device supports discarding blocks. */
+#define VIRTIO_BLK_F_DISCARD	(1U << 13)
 
 typedef struct {
 	uint32_t type;
@@ -61,12 +86,36 @@ typedef struct {
 	uint8_t status;
 } virtio_blk_req_footer_t;
 
+typedef struct {
+	uint64_t sector;
+	uint32_t num_sectors;
+	uint32_t flags;
+} virtio_blk_discard_seg_t;
+
 typedef struct {
 	uint64_t capacity;
+	uint32_t size_max;
+	uint32_t seg_max;
+	uint16_t cylinders;
+	uint8_t heads;
+	uint8_t sectors;
+	uint32_t blk_size;
+	uint8_t physical_block_exp;
+	uint8_t alignment_offset;
+	uint16_t min_io_size;
+	uint32_t opt_io_size;
+	uint8_t writeback;
+	uint8_t unused0;
+	uint16_t num_queues;
+	uint32_t max_discard_sectors;
+	uint32_t max_discard_seg;
+	uint32_t discard_sector_alignment;
 } virtio_blk_cfg_t;
 
+/** Request virtqueue */
 typedef struct {
-	virtio_dev_t virtio_dev;
+	/** Index of the virtqueue */
+	uint16_t num;
 
 	void *rq_header[RQ_BUFFERS];
 	uintptr_t rq_header_p[RQ_BUFFERS];
@@ -79,16 +128,38 @@ typedef struct {
 
 	uint16_t rq_free_head;
 
-	int irq;
-	cap_irq_handle_t irq_handle;
+	/** Number of requests in flight */
+	unsigned int rq_inflight;
 
-	bd_srvs_t bds;
+	/** Number of fibrils polling the used ring */
+	unsigned int pollers;
 
 	fibril_mutex_t free_lock;
 	fibril_condvar_t free_cv;
 
+	bool rq_done[RQ_BUFFERS];
 	fibril_mutex_t completion_lock[RQ_BUFFERS];
 	fibril_condvar_t completion_cv[RQ_BUFFERS];
+} virtio_blk_queue_t;
+
+typedef struct {
+	virtio_dev_t virtio_dev;
+
+	virtio_blk_queue_t queues[VIRTIO_BLK_MAX_QUEUES];
+	unsigned int num_queues;
+
+	/** Queue for the next request, used round-robin */
+	atomic_uint next_queue;
+
+	/** Maximum number of blocks in a discard segment, zero if unsupported */
+	uint32_t discard_sectors;
+	/** Maximum number of discard segments per request */
+	unsigned int discard_segs;
+
+	int irq;
+	cap_irq_handle_t irq_handle;
+
+	bd_srvs_t bds;
 } virtio_blk_t;
 
 #endif
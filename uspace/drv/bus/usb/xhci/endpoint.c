@@ -47,6 +47,14 @@
 #include "endpoint.h"
 #include "streams.h"
 
+/**
+ * Number of TRBs on transfer rings of bulk endpoints. Buffers which only
+ * satisfy the required (page-sized) DMA policy are split into a TRB per
+ * page, so a single page-sized segment would limit the transfer size to
+ * about 1 MiB. Mass storage transfers are usually larger.
+ */
+#define XHCI_BULK_RING_SIZE  1024
+
 static errno_t alloc_transfer_ds(xhci_endpoint_t *);
 
 /**
@@ -324,8 +332,12 @@ static errno_t alloc_transfer_ds(xhci_endpoint_t *xhci_ep)
 	xhci_ep->primary_stream_data_array = NULL;
 	xhci_ep->primary_stream_data_size = 0;
 
+	const size_t ring_size =
+	    (xhci_ep->base.transfer_type == USB_TRANSFER_BULK) ?
+	    XHCI_BULK_RING_SIZE : 0;
+
 	errno_t err;
-	if ((err = xhci_trb_ring_init(&xhci_ep->ring, 0))) {
+	if ((err = xhci_trb_ring_init(&xhci_ep->ring, ring_size))) {
 		return err;
 	}
 
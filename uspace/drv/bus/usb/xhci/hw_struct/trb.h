@@ -108,6 +108,7 @@ typedef struct xhci_trb {
 #define TRB_TYPE(trb)           XHCI_DWORD_EXTRACT((trb).control, 15, 10)
 #define TRB_CYCLE(trb)          XHCI_DWORD_EXTRACT((trb).control, 0, 0)
 #define TRB_LINK_TC(trb)        XHCI_DWORD_EXTRACT((trb).control, 1, 1)
+#define TRB_CHAIN(trb)          XHCI_DWORD_EXTRACT((trb).control, 4, 4)
 #define TRB_IOC(trb)            XHCI_DWORD_EXTRACT((trb).control, 5, 5)
 #define TRB_EVENT_DATA(trb)		XHCI_DWORD_EXTRACT((trb).control, 2, 2)
 
@@ -108,7 +108,10 @@ static void trb_segment_free(trb_segment_t *segment)
 }
 
 /**
- * Initializes the ring with one segment.
+ * Initializes the ring with enough segments to hold initial_size TRBs.
+ *
+ * The last TRB of each segment links to the next one, the link in the last
+ * segment toggles the cycle bit and closes the ring.
  *
  * @param[in] initial_size A number of free slots on the ring, 0 leaves the
  * choice on a reasonable default (one page-sized segment).
@@ -133,9 +136,16 @@ errno_t xhci_trb_ring_init(xhci_trb_ring_t *ring, size_t initial_size)
 	}
 
 	trb_segment_t *const segment = get_first_segment(&ring->segments);
-	xhci_trb_t *last = segment_end(segment) - 1;
-	xhci_trb_link_fill(last, segment->phys);
-	TRB_LINK_SET_TC(*last, true);
+	list_foreach(ring->segments, segments_link, trb_segment_t, cur) {
+		link_t *next_link =
+		    list_next(&cur->segments_link, &ring->segments);
+		trb_segment_t *next = next_link ? list_get_instance(next_link,
+		    trb_segment_t, segments_link) : segment;
+
+		xhci_trb_t *last = segment_end(cur) - 1;
+		xhci_trb_link_fill(last, next->phys);
+		TRB_LINK_SET_TC(*last, next_link == NULL);
+	}
 
 	ring->enqueue_segment = segment;
 	ring->enqueue_trb = segment_begin(segment);
@@ -273,6 +283,12 @@ errno_t xhci_trb_ring_enqueue_multiple(xhci_trb_ring_t *ring, xhci_trb_t *first_
 		ring->enqueue_trb++;
 
 		if (TRB_TYPE(*ring->enqueue_trb) == XHCI_TRB_TYPE_LINK) {
+			/*
+			 * A Link TRB inside a TD must be chained as well, or
+			 * the controller ends the TD there (4.11.5.1). Set it
+			 * before handing the Link TRB over with the cycle bit.
+			 */
+			TRB_CTRL_SET_CHAIN(*ring->enqueue_trb, TRB_CHAIN(*trb));
 			TRB_SET_CYCLE(*ring->enqueue_trb, ring->pcs);
 
 			if (TRB_LINK_TC(*ring->enqueue_trb)) {
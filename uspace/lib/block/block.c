@@ -58,6 +58,12 @@
 
 #define MAX_WRITE_RETRIES 10
 
+/** Maximum number of write-back requests in flight */
+#define BLOCK_MAX_REQUESTS 16
+
+/** Maximum number of blocks read by one prefetch request */
+#define BLOCK_PREFETCH_CLUSTER 32
+
 /** Lock protecting the device connection list */
 static FIBRIL_MUTEX_INITIALIZE(dcl_lock);
 /** Device connection list head. */
@@ -69,6 +75,7 @@ typedef struct {
 	unsigned blocks_cluster;  /**< Physical blocks per block_t */
 	unsigned block_count;     /**< Total number of blocks. */
 	unsigned blocks_cached;   /**< Number of cached blocks. */
+	unsigned long evictions;  /**< Number of blocks removed so far. */
 	hash_table_t block_hash;
 	list_t free_list;
 	enum cache_mode mode;
@@ -84,10 +91,12 @@ typedef struct {
 	aoff64_t pblocks;    /**< Number of physical blocks */
 	size_t pblock_size;  /**< Physical block size. */
 	cache_t *cache;
+	bool discard_unsup;  /**< Device does not support discarding blocks */
 } devcon_t;
 
 static errno_t read_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
 static errno_t write_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
+static errno_t write_blocks_wait(devcon_t *, bd_req_t *);
 static aoff64_t ba_ltop(devcon_t *, aoff64_t);
 
 static devcon_t *devcon_search(service_id_t service_id)
@@ -123,6 +132,7 @@ static errno_t devcon_add(service_id_t service_id, async_sess_t *sess,
 	devcon->pblock_size = bsize;
 	devcon->pblocks = dev_size;
 	devcon->cache = NULL;
+	devcon->discard_unsup = false;
 
 	fibril_mutex_lock(&dcl_lock);
 	list_foreach(dcl, link, devcon_t, d) {
@@ -285,6 +295,7 @@ errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
 	cache->lblock_size = size;
 	cache->block_count = blocks;
 	cache->blocks_cached = 0;
+	cache->evictions = 0;
 	cache->mode = mode;
 
 	/* Allow 1:1 or small-to-large block size translation */
@@ -316,34 +327,71 @@ errno_t block_cache_fini(service_id_t service_id)
 		return EOK;
 	cache = devcon->cache;
 
+	/* Write-backs in flight, in the order they were started */
+	bd_req_t reqs[BLOCK_MAX_REQUESTS];
+	size_t head = 0;
+	size_t pending = 0;
+
 	/*
 	 * We are expecting to find all blocks for this device handle on the
 	 * free list, i.e. the block reference count should be zero. Do not
 	 * bother with the cache and block locks because we are single-threaded.
+	 *
+	 * Dirty blocks are written back with several requests in flight. The
+	 * data are transferred when a request is started, so the block can
+	 * be freed right away.
 	 */
 	while (!list_empty(&cache->free_list)) {
 		block_t *b = list_get_instance(list_first(&cache->free_list),
 		    block_t, free_link);
 
-		list_remove(&b->free_link);
 		if (b->dirty) {
-			rc = write_blocks(devcon, b->pba, cache->blocks_cluster,
-			    b->data, b->size);
+			if (pending == BLOCK_MAX_REQUESTS) {
+				rc = write_blocks_wait(devcon, &reqs[head]);
+				head = (head + 1) % BLOCK_MAX_REQUESTS;
+				pending--;
+				if (rc != EOK)
+					goto error;
+			}
+
+			rc = bd_write_blocks_start(devcon->bd, b->pba,
+			    cache->blocks_cluster, b->data, b->size,
+			    &reqs[(head + pending) % BLOCK_MAX_REQUESTS]);
 			if (rc != EOK)
-				return rc;
+				goto error;
+
+			pending++;
 		}
 
+		list_remove(&b->free_link);
 		hash_table_remove_item(&cache->block_hash, &b->hash_link);
 
 		free(b->data);
 		free(b);
 	}
 
+	while (pending > 0) {
+		rc = write_blocks_wait(devcon, &reqs[head]);
+		head = (head + 1) % BLOCK_MAX_REQUESTS;
+		pending--;
+		if (rc != EOK)
+			goto error;
+	}
+
 	hash_table_destroy(&cache->block_hash);
 	devcon->cache = NULL;
 	free(cache);
 
 	return EOK;
+
+error:
+	while (pending > 0) {
+		(void) write_blocks_wait(devcon, &reqs[head]);
+		head = (head + 1) % BLOCK_MAX_REQUESTS;
+		pending--;
+	}
+
+	return rc;
 }
 
 #define CACHE_LO_WATERMARK	10
@@ -528,6 +576,7 @@ retry:
 			 */
 			list_remove(&b->free_link);
 			hash_table_remove_item(&cache->block_hash, &b->hash_link);
+			cache->evictions++;
 		}
 
 		block_initialize(b);
@@ -659,6 +708,7 @@ retry:
 			free(block->data);
 			free(block);
 			cache->blocks_cached--;
+			cache->evictions++;
 			fibril_mutex_unlock(&cache->lock);
 			return rc;
 		}
@@ -683,6 +733,203 @@ retry:
 	return rc;
 }
 
+/** Prefetch request in flight */
+typedef struct {
+	/** Block device request */
+	bd_req_t req;
+	/** Address of the first block (logical) */
+	aoff64_t ba;
+	/** Number of blocks */
+	size_t cnt;
+	/** Buffer receiving the data */
+	void *buf;
+	/** Cache evictions when the request was started */
+	unsigned long evictions;
+} prefetch_req_t;
+
+/** Find out whether a block is present in the cache. */
+static bool block_cached(cache_t *cache, aoff64_t ba)
+{
+	fibril_mutex_lock(&cache->lock);
+	bool cached = hash_table_find(&cache->block_hash, &ba) != NULL;
+	fibril_mutex_unlock(&cache->lock);
+
+	return cached;
+}
+
+/** Insert prefetched blocks into the cache.
+ *
+ * The blocks are put unreferenced at the end of the free list. Blocks
+ * which have been instantiated meanwhile are left alone. If any block was
+ * removed from the cache since the data were requested, it might have
+ * been written back after the data were read, so nothing is inserted.
+ * Insertion stops once the cache reaches CACHE_HI_WATERMARK.
+ *
+ * @param devcon	Device connection.
+ * @param preq		Completed prefetch request.
+ */
+static void block_prefetch_insert(devcon_t *devcon, prefetch_req_t *preq)
+{
+	cache_t *cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+
+	if (cache->evictions != preq->evictions) {
+		fibril_mutex_unlock(&cache->lock);
+		return;
+	}
+
+	for (size_t i = 0; i < preq->cnt; i++) {
+		aoff64_t ba = preq->ba + i;
+
+		if (hash_table_find(&cache->block_hash, &ba) != NULL)
+			continue;
+
+		if (cache->blocks_cached >= CACHE_HI_WATERMARK)
+			break;
+
+		block_t *b = malloc(sizeof(block_t));
+		if (!b)
+			break;
+		b->data = malloc(cache->lblock_size);
+		if (!b->data) {
+			free(b);
+			break;
+		}
+
+		block_initialize(b);
+		b->refcnt = 0;
+		b->service_id = devcon->service_id;
+		b->size = cache->lblock_size;
+		b->lba = ba;
+		b->pba = ba_ltop(devcon, b->lba);
+		memcpy(b->data, preq->buf + i * cache->lblock_size,
+		    cache->lblock_size);
+
+		hash_table_insert(&cache->block_hash, &b->hash_link);
+		list_append(&b->free_link, &cache->free_list);
+		cache->blocks_cached++;
+	}
+
+	fibril_mutex_unlock(&cache->lock);
+}
+
+/** Read blocks into the cache ahead of their use.
+ *
+ * Blocks which are not cached are read from the device using large
+ * requests, several of which are kept in flight. Blocks which are
+ * already cached are not read again. Subsequent block_get() calls for
+ * the prefetched blocks do not need to wait for the device. Prefetching
+ * is merely a hint, block_get() reads any block which is not found in the
+ * cache anyway. At most as many blocks are read as the cache can hold
+ * without exceeding CACHE_HI_WATERMARK, the rest of the range is ignored.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of the first block (logical).
+ * @param cnt		Number of blocks.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_prefetch(service_id_t service_id, aoff64_t ba, size_t cnt)
+{
+	devcon_t *devcon;
+	cache_t *cache;
+	prefetch_req_t reqs[BLOCK_MAX_REQUESTS];
+	size_t head = 0;
+	size_t pending = 0;
+	errno_t rc = EOK;
+
+	devcon = devcon_search(service_id);
+
+	assert(devcon);
+	assert(devcon->cache);
+
+	cache = devcon->cache;
+
+	/* Do not read beyond the end of the device */
+	if (ba_ltop(devcon, ba) >= devcon->pblocks)
+		return EOK;
+
+	aoff64_t avail = (devcon->pblocks - ba_ltop(devcon, ba)) /
+	    cache->blocks_cluster;
+	if (cnt > avail)
+		cnt = avail;
+
+	/*
+	 * Do not read more blocks than the cache can take without growing
+	 * beyond its high watermark, they would only be evicted again.
+	 */
+	fibril_mutex_lock(&cache->lock);
+	size_t room = 0;
+	if (cache->blocks_cached < CACHE_HI_WATERMARK)
+		room = CACHE_HI_WATERMARK - cache->blocks_cached;
+	fibril_mutex_unlock(&cache->lock);
+
+	if (cnt > room)
+		cnt = room;
+
+	while (true) {
+		if (rc == EOK && cnt > 0 && pending < BLOCK_MAX_REQUESTS) {
+			if (block_cached(cache, ba)) {
+				ba++;
+				cnt--;
+				continue;
+			}
+
+			/* Extend the request up to the next cached block */
+			size_t n = 1;
+			while (n < min(cnt, BLOCK_PREFETCH_CLUSTER) &&
+			    !block_cached(cache, ba + n))
+				n++;
+
+			prefetch_req_t *preq =
+			    &reqs[(head + pending) % BLOCK_MAX_REQUESTS];
+
+			preq->buf = malloc(n * cache->lblock_size);
+			if (preq->buf == NULL) {
+				rc = ENOMEM;
+				continue;
+			}
+
+			fibril_mutex_lock(&cache->lock);
+			preq->evictions = cache->evictions;
+			fibril_mutex_unlock(&cache->lock);
+
+			rc = bd_read_blocks_start(devcon->bd,
+			    ba_ltop(devcon, ba), n * cache->blocks_cluster,
+			    preq->buf, n * cache->lblock_size, &preq->req);
+			if (rc != EOK) {
+				free(preq->buf);
+				continue;
+			}
+
+			preq->ba = ba;
+			preq->cnt = n;
+			ba += n;
+			cnt -= n;
+			pending++;
+			continue;
+		}
+
+		if (pending == 0)
+			break;
+
+		prefetch_req_t *preq = &reqs[head];
+		head = (head + 1) % BLOCK_MAX_REQUESTS;
+		pending--;
+
+		errno_t rc2 = bd_req_wait(&preq->req);
+		if (rc2 == EOK)
+			block_prefetch_insert(devcon, preq);
+		else if (rc == EOK)
+			rc = rc2;
+
+		free(preq->buf);
+	}
+
+	return rc;
+}
+
 /** Read sequential data from a block device.
  *
  * @param service_id	Service ID of the block device.
@@ -787,6 +1034,52 @@ errno_t block_write_direct(service_id_t service_id, aoff64_t ba, size_t cnt,
 	return write_blocks(devcon, ba, cnt, (void *)data, devcon->pblock_size * cnt);
 }
 
+/** Forward a data read call to the device (bypass cache).
+ *
+ * The data are transferred from the device directly to the sender of
+ * the data read call.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (physical).
+ * @param cnt		Number of blocks.
+ * @param rcall		Received data read call, answered in any case.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_read_forward(service_id_t service_id, aoff64_t ba, size_t cnt,
+    ipc_call_t *rcall)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return bd_read_blocks_forward(devcon->bd, ba, cnt, rcall);
+}
+
+/** Forward a data write call to the device (bypass cache).
+ *
+ * The data are transferred from the sender of the data write call
+ * directly to the device.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (physical).
+ * @param cnt		Number of blocks.
+ * @param wcall		Received data write call, answered in any case.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_write_forward(service_id_t service_id, aoff64_t ba, size_t cnt,
+    ipc_call_t *wcall)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return bd_write_blocks_forward(devcon->bd, ba, cnt, wcall);
+}
+
 /** Synchronize blocks to persistent storage.
  *
  * @param service_id	Service ID of the block device.
@@ -805,6 +1098,41 @@ errno_t block_sync_cache(service_id_t service_id, aoff64_t ba, size_t cnt)
 	return bd_sync_cache(devcon->bd, ba, cnt);
 }
 
+/** Discard blocks which no longer hold useful data.
+ *
+ * If the device has a block cache, the blocks are given in units of the
+ * cache, otherwise they are physical blocks. Cached copies of the blocks
+ * are not affected. Once the device reports that it does not support
+ * discarding blocks, further requests fail without contacting it.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block.
+ * @param cnt		Number of blocks.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_discard(service_id_t service_id, aoff64_t ba, size_t cnt)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	if (devcon->discard_unsup)
+		return ENOTSUP;
+
+	if (devcon->cache != NULL) {
+		ba = ba_ltop(devcon, ba);
+		cnt *= devcon->cache->blocks_cluster;
+	}
+
+	errno_t rc = bd_discard(devcon->bd, ba, cnt);
+	if (rc == ENOTSUP)
+		devcon->discard_unsup = true;
+
+	return rc;
+}
+
 /** Get device block size.
  *
  * @param service_id	Service ID of the block device.
@@ -960,6 +1288,24 @@ static errno_t write_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt, void *dat
 	return rc;
 }
 
+/** Wait for completion of a write started by bd_write_blocks_start().
+ *
+ * @param devcon	Device connection.
+ * @param req		Write request.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+static errno_t write_blocks_wait(devcon_t *devcon, bd_req_t *req)
+{
+	errno_t rc = bd_req_wait(req);
+	if (rc != EOK) {
+		printf("Error %s writing blocks to device handle %" PRIun "\n",
+		    str_error_name(rc), devcon->service_id);
+	}
+
+	return rc;
+}
+
 /** Convert logical block address to physical block address. */
 static aoff64_t ba_ltop(devcon_t *devcon, aoff64_t lba)
 {
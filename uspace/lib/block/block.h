@@ -109,6 +109,7 @@ extern errno_t block_cache_fini(service_id_t);
 
 extern errno_t block_get(block_t **, service_id_t, aoff64_t, int);
 extern errno_t block_put(block_t *);
+extern errno_t block_prefetch(service_id_t, aoff64_t, size_t);
 
 extern errno_t block_seqread(service_id_t, void *, size_t *, size_t *, aoff64_t *,
     void *, size_t);
@@ -119,7 +120,11 @@ extern errno_t block_read_toc(service_id_t, uint8_t, void *, size_t);
 extern errno_t block_read_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_read_bytes_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_write_direct(service_id_t, aoff64_t, size_t, const void *);
+extern errno_t block_read_forward(service_id_t, aoff64_t, size_t, ipc_call_t *);
+extern errno_t block_write_forward(service_id_t, aoff64_t, size_t,
+    ipc_call_t *);
 extern errno_t block_sync_cache(service_id_t, aoff64_t, size_t);
+extern errno_t block_discard(service_id_t, aoff64_t, size_t);
 
 #endif
 
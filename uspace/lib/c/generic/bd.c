@@ -82,28 +82,52 @@ void bd_close(bd_t *bd)
 	free(bd);
 }
 
-errno_t bd_read_blocks(bd_t *bd, aoff64_t ba, size_t cnt, void *data, size_t size)
+/** Start reading blocks
+ *
+ * The data buffer must not be touched until the request is completed
+ * by bd_req_wait().
+ *
+ * @param bd    Block device
+ * @param ba    First block
+ * @param cnt   Number of blocks
+ * @param data  Buffer for the data
+ * @param size  Size of the buffer in bytes
+ * @param breq  Place to store the request
+ *
+ * @return EOK on success or an error code
+ */
+errno_t bd_read_blocks_start(bd_t *bd, aoff64_t ba, size_t cnt, void *data,
+    size_t size, bd_req_t *breq)
 {
 	async_exch_t *exch = async_exchange_begin(bd->sess);
 
-	ipc_call_t answer;
 	aid_t req = async_send_3(exch, BD_READ_BLOCKS, LOWER32(ba),
-	    UPPER32(ba), cnt, &answer);
-	errno_t rc = async_data_read_start(exch, data, size);
+	    UPPER32(ba), cnt, NULL);
+	aid_t dreq = async_data_read(exch, data, size, NULL);
 	async_exchange_end(exch);
 
-	if (rc != EOK) {
-		async_forget(req);
-		return rc;
+	if (req == 0 || dreq == 0) {
+		if (dreq != 0)
+			async_forget(dreq);
+		if (req != 0)
+			async_forget(req);
+		return ENOMEM;
 	}
 
-	errno_t retval;
-	async_wait_for(req, &retval);
+	breq->req = req;
+	breq->dreq = dreq;
+	return EOK;
+}
 
-	if (retval != EOK)
-		return retval;
+errno_t bd_read_blocks(bd_t *bd, aoff64_t ba, size_t cnt, void *data, size_t size)
+{
+	bd_req_t breq;
 
-	return EOK;
+	errno_t rc = bd_read_blocks_start(bd, ba, cnt, data, size, &breq);
+	if (rc != EOK)
+		return rc;
+
+	return bd_req_wait(&breq);
 }
 
 errno_t bd_read_toc(bd_t *bd, uint8_t session, void *buf, size_t size)
@@ -129,38 +153,244 @@ errno_t bd_read_toc(bd_t *bd, uint8_t session, void *buf, size_t size)
 	return EOK;
 }
 
-errno_t bd_write_blocks(bd_t *bd, aoff64_t ba, size_t cnt, const void *data,
-    size_t size)
+/** Start writing blocks
+ *
+ * The data are transferred to the server before this function returns,
+ * so the buffer can be reused right away.
+ *
+ * @param bd    Block device
+ * @param ba    First block
+ * @param cnt   Number of blocks
+ * @param data  Data to write
+ * @param size  Size of the data in bytes
+ * @param breq  Place to store the request
+ *
+ * @return EOK on success or an error code
+ */
+errno_t bd_write_blocks_start(bd_t *bd, aoff64_t ba, size_t cnt,
+    const void *data, size_t size, bd_req_t *breq)
 {
 	async_exch_t *exch = async_exchange_begin(bd->sess);
 
-	ipc_call_t answer;
 	aid_t req = async_send_3(exch, BD_WRITE_BLOCKS, LOWER32(ba),
-	    UPPER32(ba), cnt, &answer);
+	    UPPER32(ba), cnt, NULL);
 	errno_t rc = async_data_write_start(exch, data, size);
 	async_exchange_end(exch);
 
+	if (req == 0)
+		return ENOMEM;
+
 	if (rc != EOK) {
 		async_forget(req);
 		return rc;
 	}
 
-	errno_t retval;
-	async_wait_for(req, &retval);
-	if (retval != EOK)
-		return retval;
+	breq->req = req;
+	breq->dreq = 0;
+	return EOK;
+}
+
+errno_t bd_write_blocks(bd_t *bd, aoff64_t ba, size_t cnt, const void *data,
+    size_t size)
+{
+	bd_req_t breq;
+
+	errno_t rc = bd_write_blocks_start(bd, ba, cnt, data, size, &breq);
+	if (rc != EOK)
+		return rc;
 
+	return bd_req_wait(&breq);
+}
+
+/** Start synchronizing blocks to persistent storage
+ *
+ * The request covers all writes started on the same session before it,
+ * even if they have not completed yet. Writes started after it are not
+ * ordered against it.
+ *
+ * @param bd    Block device
+ * @param ba    First block
+ * @param cnt   Number of blocks
+ * @param breq  Place to store the request
+ *
+ * @return EOK on success or an error code
+ */
+errno_t bd_sync_cache_start(bd_t *bd, aoff64_t ba, size_t cnt, bd_req_t *breq)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	aid_t req = async_send_3(exch, BD_SYNC_CACHE, LOWER32(ba),
+	    UPPER32(ba), cnt, NULL);
+	async_exchange_end(exch);
+
+	if (req == 0)
+		return ENOMEM;
+
+	breq->req = req;
+	breq->dreq = 0;
 	return EOK;
 }
 
 errno_t bd_sync_cache(bd_t *bd, aoff64_t ba, size_t cnt)
+{
+	bd_req_t breq;
+
+	errno_t rc = bd_sync_cache_start(bd, ba, cnt, &breq);
+	if (rc != EOK)
+		return rc;
+
+	return bd_req_wait(&breq);
+}
+
+/** Start discarding blocks
+ *
+ * Tell the device that the blocks no longer hold useful data, so that
+ * it can release the storage backing them. The contents of discarded
+ * blocks are undefined until they are written again.
+ *
+ * @param bd    Block device
+ * @param ba    First block
+ * @param cnt   Number of blocks
+ * @param breq  Place to store the request
+ *
+ * @return EOK on success or an error code
+ */
+errno_t bd_discard_start(bd_t *bd, aoff64_t ba, size_t cnt, bd_req_t *breq)
 {
 	async_exch_t *exch = async_exchange_begin(bd->sess);
 
-	errno_t rc = async_req_3_0(exch, BD_SYNC_CACHE, LOWER32(ba),
-	    UPPER32(ba), cnt);
+	aid_t req = async_send_3(exch, BD_DISCARD, LOWER32(ba),
+	    UPPER32(ba), cnt, NULL);
+	async_exchange_end(exch);
+
+	if (req == 0)
+		return ENOMEM;
+
+	breq->req = req;
+	breq->dreq = 0;
+	return EOK;
+}
+
+errno_t bd_discard(bd_t *bd, aoff64_t ba, size_t cnt)
+{
+	bd_req_t breq;
+
+	errno_t rc = bd_discard_start(bd, ba, cnt, &breq);
+	if (rc != EOK)
+		return rc;
+
+	return bd_req_wait(&breq);
+}
+
+/** Issue a data transfer request forwarding a received data call
+ *
+ * @param bd      Block device
+ * @param method  BD_READ_BLOCKS or BD_WRITE_BLOCKS
+ * @param ba      First block
+ * @param cnt     Number of blocks
+ * @param dcall   Received data call, answered in any case
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t bd_forward(bd_t *bd, sysarg_t method, aoff64_t ba, size_t cnt,
+    ipc_call_t *dcall)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+	if (exch == NULL) {
+		async_answer_0(dcall, ENOENT);
+		return ENOENT;
+	}
+
+	aid_t req = async_send_3(exch, method, LOWER32(ba), UPPER32(ba), cnt,
+	    NULL);
+	if (req == 0) {
+		async_exchange_end(exch);
+		async_answer_0(dcall, ENOMEM);
+		return ENOMEM;
+	}
+
+	/* The data call is answered by the kernel if forwarding fails */
+	errno_t rc = async_forward_0(dcall, exch, 0, IPC_FF_ROUTE_FROM_ME);
+	if (rc != EOK) {
+		/*
+		 * The server is already waiting for the data call. Send it
+		 * an empty one, which it rejects, so that it answers the
+		 * request and is ready for the next one.
+		 */
+		if (method == BD_READ_BLOCKS)
+			(void) async_data_read_start(exch, NULL, 0);
+		else
+			(void) async_data_write_start(exch, NULL, 0);
+
+		async_exchange_end(exch);
+		async_wait_for(req, NULL);
+		return rc;
+	}
+
 	async_exchange_end(exch);
 
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
+/** Read blocks directly into the buffer of another client
+ *
+ * Forward a data read call received from a client of our own block
+ * device service, so that the data are transferred from the device to
+ * the client without passing through our address space.
+ *
+ * @param bd     Block device
+ * @param ba     First block
+ * @param cnt    Number of blocks
+ * @param rcall  Received data read call, answered in any case
+ *
+ * @return EOK on success or an error code
+ */
+errno_t bd_read_blocks_forward(bd_t *bd, aoff64_t ba, size_t cnt,
+    ipc_call_t *rcall)
+{
+	return bd_forward(bd, BD_READ_BLOCKS, ba, cnt, rcall);
+}
+
+/** Write blocks directly from the buffer of another client
+ *
+ * Forward a data write call received from a client of our own block
+ * device service, so that the data are transferred from the client to
+ * the device without passing through our address space.
+ *
+ * @param bd     Block device
+ * @param ba     First block
+ * @param cnt    Number of blocks
+ * @param wcall  Received data write call, answered in any case
+ *
+ * @return EOK on success or an error code
+ */
+errno_t bd_write_blocks_forward(bd_t *bd, aoff64_t ba, size_t cnt,
+    ipc_call_t *wcall)
+{
+	return bd_forward(bd, BD_WRITE_BLOCKS, ba, cnt, wcall);
+}
+
+/** Wait for completion of a request
+ *
+ * @param breq  Request started by one of the bd_*_start() functions
+ *
+ * @return EOK on success or an error code
+ */
+errno_t bd_req_wait(bd_req_t *breq)
+{
+	errno_t rc = EOK;
+
+	if (breq->dreq != 0)
+		async_wait_for(breq->dreq, &rc);
+
+	errno_t retval;
+	async_wait_for(breq->req, &retval);
+
+	if (retval != EOK)
+		return retval;
+
 	return rc;
 }
 
@@ -33,7 +33,9 @@
  * @file
  * @brief Block device server stub
  */
+#include <assert.h>
 #include <errno.h>
+#include <fibril.h>
 #include <ipc/bd.h>
 #include <macros.h>
 #include <stdlib.h>
@@ -42,23 +44,182 @@
 
 #include <bd_srv.h>
 
-static void bd_read_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
+/** Read, write, sync or discard request */
+typedef struct {
+	bd_srv_t *srv;
+	/** Request call */
+	ipc_call_t call;
+	/** Data read or write call (read or forwarded requests only) */
+	ipc_call_t dcall;
+	/** Forward the data call instead of using a buffer */
+	bool forward;
+	/** Data buffer */
+	void *buf;
+	/** Size of the data buffer */
+	size_t size;
+} bd_srv_req_t;
+
+static void bd_srv_req_process(bd_srv_req_t *req)
 {
+	bd_srv_t *srv = req->srv;
+	ipc_call_t *call = &req->call;
 	aoff64_t ba;
 	size_t cnt;
-	void *buf;
-	size_t size;
 	errno_t rc;
 
 	ba = MERGE_LOUP32(ipc_get_arg1(call), ipc_get_arg2(call));
 	cnt = ipc_get_arg3(call);
 
+	switch (ipc_get_imethod(call)) {
+	case BD_READ_BLOCKS:
+		if (req->forward) {
+			rc = srv->srvs->ops->read_blocks_forward(srv, ba, cnt,
+			    &req->dcall);
+			break;
+		}
+
+		rc = srv->srvs->ops->read_blocks(srv, ba, cnt, req->buf,
+		    req->size);
+		if (rc == EOK)
+			async_data_read_finalize(&req->dcall, req->buf,
+			    req->size);
+		else
+			async_answer_0(&req->dcall, rc);
+		break;
+	case BD_WRITE_BLOCKS:
+		if (req->forward) {
+			rc = srv->srvs->ops->write_blocks_forward(srv, ba, cnt,
+			    &req->dcall);
+			break;
+		}
+
+		rc = srv->srvs->ops->write_blocks(srv, ba, cnt, req->buf,
+		    req->size);
+		break;
+	case BD_SYNC_CACHE:
+		rc = srv->srvs->ops->sync_cache(srv, ba, cnt);
+		break;
+	case BD_DISCARD:
+		rc = srv->srvs->ops->discard(srv, ba, cnt);
+		break;
+	default:
+		assert(false);
+		rc = EINVAL;
+		break;
+	}
+
+	free(req->buf);
+	async_answer_0(call, rc);
+	free(req);
+}
+
+static errno_t bd_srv_req_fibril(void *arg)
+{
+	bd_srv_req_t *req = (bd_srv_req_t *) arg;
+	bd_srv_t *srv = req->srv;
+
+	bd_srv_req_process(req);
+
+	fibril_mutex_lock(&srv->lock);
+	srv->requests--;
+	fibril_condvar_broadcast(&srv->cv);
+	fibril_mutex_unlock(&srv->lock);
+
+	return EOK;
+}
+
+/** Wait until all requests of the session being processed have completed */
+static void bd_srv_drain(bd_srv_t *srv)
+{
+	fibril_mutex_lock(&srv->lock);
+	while (srv->requests > 0)
+		fibril_condvar_wait(&srv->cv, &srv->lock);
+	fibril_mutex_unlock(&srv->lock);
+}
+
+/** Process a request
+ *
+ * Unless the service allows concurrent requests, the request is processed
+ * right away. Otherwise it is processed by a new fibril, so that the
+ * connection fibril can receive further requests and the requests can
+ * complete out of order.
+ */
+static void bd_srv_req_submit(bd_srv_req_t *req)
+{
+	bd_srv_t *srv = req->srv;
+
+	if (srv->srvs->max_requests <= 1) {
+		bd_srv_req_process(req);
+		return;
+	}
+
+	fibril_mutex_lock(&srv->lock);
+	while (srv->requests >= srv->srvs->max_requests)
+		fibril_condvar_wait(&srv->cv, &srv->lock);
+	srv->requests++;
+	fibril_mutex_unlock(&srv->lock);
+
+	fid_t fid = fibril_create(bd_srv_req_fibril, req);
+	if (fid == 0) {
+		(void) bd_srv_req_fibril(req);
+		return;
+	}
+
+	fibril_add_ready(fid);
+}
+
+/** Create request, the data buffer is taken over by the request */
+static bd_srv_req_t *bd_srv_req_create(bd_srv_t *srv, ipc_call_t *call,
+    void *buf, size_t size)
+{
+	bd_srv_req_t *req = calloc(1, sizeof(bd_srv_req_t));
+	if (req == NULL)
+		return NULL;
+
+	req->srv = srv;
+	req->call = *call;
+	req->buf = buf;
+	req->size = size;
+	return req;
+}
+
+/** Create request forwarding the data call */
+static bd_srv_req_t *bd_srv_req_create_forward(bd_srv_t *srv,
+    ipc_call_t *call, ipc_call_t *dcall)
+{
+	bd_srv_req_t *req = bd_srv_req_create(srv, call, NULL, 0);
+	if (req == NULL)
+		return NULL;
+
+	req->dcall = *dcall;
+	req->forward = true;
+	return req;
+}
+
+static void bd_read_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
+{
+	void *buf;
+	size_t size;
+
 	ipc_call_t rcall;
 	if (!async_data_read_receive(&rcall, &size)) {
 		async_answer_0(call, EINVAL);
 		return;
 	}
 
+	if (srv->srvs->ops->read_blocks_forward != NULL) {
+		bd_srv_req_t *req = bd_srv_req_create_forward(srv, call,
+		    &rcall);
+		if (req == NULL) {
+			async_answer_0(&rcall, ENOMEM);
+			async_answer_0(call, ENOMEM);
+			return;
+		}
+
+		bd_srv_req_submit(req);
+		return;
+	}
+
 	buf = malloc(size);
 	if (buf == NULL) {
 		async_answer_0(&rcall, ENOMEM);
@@ -73,18 +234,16 @@ static void bd_read_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 		return;
 	}
 
-	rc = srv->srvs->ops->read_blocks(srv, ba, cnt, buf, size);
-	if (rc != EOK) {
+	bd_srv_req_t *req = bd_srv_req_create(srv, call, buf, size);
+	if (req == NULL) {
 		async_answer_0(&rcall, ENOMEM);
 		async_answer_0(call, ENOMEM);
 		free(buf);
 		return;
 	}
 
-	async_data_read_finalize(&rcall, buf, size);
-
-	free(buf);
-	async_answer_0(call, EOK);
+	req->dcall = rcall;
+	bd_srv_req_submit(req);
 }
 
 static void bd_read_toc_srv(bd_srv_t *srv, ipc_call_t *call)
@@ -132,32 +291,66 @@ static void bd_read_toc_srv(bd_srv_t *srv, ipc_call_t *call)
 
 static void bd_sync_cache_srv(bd_srv_t *srv, ipc_call_t *call)
 {
-	aoff64_t ba;
-	size_t cnt;
-	errno_t rc;
+	if (srv->srvs->ops->sync_cache == NULL) {
+		async_answer_0(call, ENOTSUP);
+		return;
+	}
 
-	ba = MERGE_LOUP32(ipc_get_arg1(call), ipc_get_arg2(call));
-	cnt = ipc_get_arg3(call);
+	bd_srv_req_t *req = bd_srv_req_create(srv, call, NULL, 0);
+	if (req == NULL) {
+		async_answer_0(call, ENOMEM);
+		return;
+	}
 
-	if (srv->srvs->ops->sync_cache == NULL) {
+	/*
+	 * The cache is only synchronized once the writes received before
+	 * the request have completed, so that they are covered by it.
+	 */
+	bd_srv_drain(srv);
+	bd_srv_req_submit(req);
+}
+
+static void bd_discard_srv(bd_srv_t *srv, ipc_call_t *call)
+{
+	if (srv->srvs->ops->discard == NULL) {
 		async_answer_0(call, ENOTSUP);
 		return;
 	}
 
-	rc = srv->srvs->ops->sync_cache(srv, ba, cnt);
-	async_answer_0(call, rc);
+	bd_srv_req_t *req = bd_srv_req_create(srv, call, NULL, 0);
+	if (req == NULL) {
+		async_answer_0(call, ENOMEM);
+		return;
+	}
+
+	bd_srv_req_submit(req);
 }
 
 static void bd_write_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 {
-	aoff64_t ba;
-	size_t cnt;
 	void *data;
 	size_t size;
 	errno_t rc;
 
-	ba = MERGE_LOUP32(ipc_get_arg1(call), ipc_get_arg2(call));
-	cnt = ipc_get_arg3(call);
+	if (srv->srvs->ops->write_blocks_forward != NULL) {
+		ipc_call_t wcall;
+		if (!async_data_write_receive(&wcall, &size)) {
+			async_answer_0(&wcall, EINVAL);
+			async_answer_0(call, EINVAL);
+			return;
+		}
+
+		bd_srv_req_t *req = bd_srv_req_create_forward(srv, call,
+		    &wcall);
+		if (req == NULL) {
+			async_answer_0(&wcall, ENOMEM);
+			async_answer_0(call, ENOMEM);
+			return;
+		}
+
+		bd_srv_req_submit(req);
+		return;
+	}
 
 	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
 	if (rc != EOK) {
@@ -166,13 +359,19 @@ static void bd_write_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 	}
 
 	if (srv->srvs->ops->write_blocks == NULL) {
+		free(data);
 		async_answer_0(call, ENOTSUP);
 		return;
 	}
 
-	rc = srv->srvs->ops->write_blocks(srv, ba, cnt, data, size);
-	free(data);
-	async_answer_0(call, rc);
+	bd_srv_req_t *req = bd_srv_req_create(srv, call, data, size);
+	if (req == NULL) {
+		free(data);
+		async_answer_0(call, ENOMEM);
+		return;
+	}
+
+	bd_srv_req_submit(req);
 }
 
 static void bd_get_block_size_srv(bd_srv_t *srv, ipc_call_t *call)
@@ -212,6 +411,8 @@ static bd_srv_t *bd_srv_create(bd_srvs_t *srvs)
 		return NULL;
 
 	srv->srvs = srvs;
+	fibril_mutex_initialize(&srv->lock);
+	fibril_condvar_initialize(&srv->cv);
 	return srv;
 }
 
@@ -219,6 +420,7 @@ void bd_srvs_init(bd_srvs_t *srvs)
 {
 	srvs->ops = NULL;
 	srvs->sarg = NULL;
+	srvs->max_requests = 1;
 }
 
 errno_t bd_conn(ipc_call_t *icall, bd_srvs_t *srvs)
@@ -273,11 +475,17 @@ errno_t bd_conn(ipc_call_t *icall, bd_srvs_t *srvs)
 		case BD_GET_NUM_BLOCKS:
 			bd_get_num_blocks_srv(srv, &call);
 			break;
+		case BD_DISCARD:
+			bd_discard_srv(srv, &call);
+			break;
 		default:
 			async_answer_0(&call, EINVAL);
 		}
 	}
 
+	/* Wait for requests still being processed */
+	bd_srv_drain(srv);
+
 	rc = srvs->ops->close(srv);
 	free(srv);
 
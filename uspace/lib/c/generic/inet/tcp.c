@@ -39,6 +39,7 @@
 #include <ipc/services.h>
 #include <ipc/tcp.h>
 #include <stdlib.h>
+#include <time.h>
 
 static void tcp_cb_conn(ipc_call_t *, void *);
 static errno_t tcp_conn_fibril(void *);
@@ -588,14 +589,53 @@ errno_t tcp_conn_recv(tcp_conn_t *conn, void *buf, size_t bsize, size_t *nrecv)
  */
 errno_t tcp_conn_recv_wait(tcp_conn_t *conn, void *buf, size_t bsize,
     size_t *nrecv)
+{
+	return tcp_conn_recv_wait_timeout(conn, buf, bsize, nrecv, 0);
+}
+
+/** Read received data from connection with blocking and a timeout.
+ *
+ * Same as tcp_conn_recv_wait(), but gives up with ETIMEOUT if no data
+ * is received within @a timeout microseconds.
+ *
+ * @param conn Connection
+ * @param buf  Buffer
+ * @param bsize Buffer size
+ * @param nrecv Place to store actual number of received bytes
+ * @param timeout Timeout in microseconds, zero to wait forever
+ *
+ * @return EOK on success, ETIMEOUT on timeout or an error code
+ */
+errno_t tcp_conn_recv_wait_timeout(tcp_conn_t *conn, void *buf, size_t bsize,
+    size_t *nrecv, usec_t timeout)
 {
 	async_exch_t *exch;
 	ipc_call_t answer;
+	struct timespec expires;
+
+	if (timeout != 0) {
+		getuptime(&expires);
+		ts_add_diff(&expires, USEC2NSEC(timeout));
+	}
 
 again:
 	fibril_mutex_lock(&conn->lock);
 	while (!conn->data_avail) {
-		fibril_condvar_wait(&conn->cv, &conn->lock);
+		usec_t left = 0;
+
+		if (timeout != 0) {
+			struct timespec now;
+
+			getuptime(&now);
+			left = NSEC2USEC(ts_sub_diff(&expires, &now));
+			if (left <= 0) {
+				fibril_mutex_unlock(&conn->lock);
+				return ETIMEOUT;
+			}
+		}
+
+		(void) fibril_condvar_wait_timeout(&conn->cv, &conn->lock,
+		    left);
 	}
 
 	exch = async_exchange_begin(conn->tcp->sess);
@@ -31,15 +31,20 @@
  * @{
  */
 
+#include <align.h>
 #include <assert.h>
 #include <errno.h>
+#include <fibril.h>
 #include <fibril_synch.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <async.h>
 #include <io/log.h>
 #include <ipc/logger.h>
+#include <macros.h>
 #include <str.h>
 #include <ns.h>
 
@@ -66,6 +71,46 @@ static async_sess_t *logger_session;
 /** Maximum length of a single log message (in bytes). */
 #define MESSAGE_BUFFER_SIZE 4096
 
+/** Number of slots in the message ring (must be a power of two). */
+#define LOG_RING_SIZE 256
+
+/** Slot of the message ring.
+ *
+ * The ring is a bounded multi-producer queue. A slot with sequence
+ * number equal to the producer position is free, a slot with sequence
+ * number one higher holds a message ready to be shipped.
+ */
+typedef struct {
+	atomic_size_t seq;
+	log_t log;
+	log_level_t level;
+	char *message;
+} log_slot_t;
+
+/** Messages waiting to be shipped to the logger. */
+static log_slot_t log_ring[LOG_RING_SIZE];
+
+/** Position of the next slot to be filled by a producer. */
+static atomic_size_t log_ring_tail;
+
+/** Position of the next slot to be shipped (protected by log_flush_lock). */
+static size_t log_ring_head;
+
+/** Buffer for assembling batches (protected by log_flush_lock).
+ *
+ * Allocated once the ring is ready to be used.
+ */
+static uint8_t *log_batch;
+
+/** Serializes shipping of the messages. */
+static FIBRIL_MUTEX_INITIALIZE(log_flush_lock);
+
+/** Wakes up the flushing fibril. */
+static FIBRIL_SEMAPHORE_INITIALIZE(log_flush_sem, 0);
+
+/** Whether the flushing fibril was already woken up. */
+static atomic_bool log_flush_pending;
+
 /** Send formatted message to the logger service.
  *
  * @param session Initialized IPC session with the logger.
@@ -108,6 +153,136 @@ static errno_t logger_message(async_sess_t *session, log_t log, log_level_t leve
 	return reg_msg_rc;
 }
 
+/** Send a batch of messages to the logger service.
+ *
+ * @param session Initialized IPC session with the logger.
+ * @param batch Buffer with logger_batch_hdr_t headers and messages.
+ * @param size Size of the batch.
+ * @return Error code or EOK on success.
+ */
+static errno_t logger_batch(async_sess_t *session, void *batch, size_t size)
+{
+	async_exch_t *exchange = async_exchange_begin(session);
+	if (exchange == NULL)
+		return ENOMEM;
+
+	aid_t reg_msg = async_send_0(exchange, LOGGER_WRITER_MESSAGE_BATCH,
+	    NULL);
+	errno_t rc = async_data_write_start(exchange, batch, size);
+	errno_t reg_msg_rc;
+	async_wait_for(reg_msg, &reg_msg_rc);
+
+	async_exchange_end(exchange);
+
+	if (rc == ENAK)
+		rc = EOK;
+
+	if (rc != EOK)
+		return rc;
+
+	return reg_msg_rc;
+}
+
+/** Put message into the ring.
+ *
+ * Can be called concurrently from any fibril or thread.
+ *
+ * @param log Log to use.
+ * @param level Verbosity level of the message.
+ * @param message The message, ownership is passed to the ring.
+ * @return False if the ring is full.
+ */
+static bool log_ring_push(log_t log, log_level_t level, char *message)
+{
+	size_t pos = atomic_load_explicit(&log_ring_tail, memory_order_relaxed);
+
+	while (true) {
+		log_slot_t *slot = &log_ring[pos % LOG_RING_SIZE];
+		size_t seq = atomic_load_explicit(&slot->seq,
+		    memory_order_acquire);
+		intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&log_ring_tail,
+			    &pos, pos + 1, memory_order_relaxed,
+			    memory_order_relaxed)) {
+				slot->log = log;
+				slot->level = level;
+				slot->message = message;
+				atomic_store_explicit(&slot->seq, pos + 1,
+				    memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = atomic_load_explicit(&log_ring_tail,
+			    memory_order_relaxed);
+		}
+	}
+}
+
+/** Ship all messages from the ring to the logger.
+ *
+ * The messages are packed into as few batches as possible.
+ */
+void log_flush(void)
+{
+	if ((logger_session == NULL) || (log_batch == NULL))
+		return;
+
+	fibril_mutex_lock(&log_flush_lock);
+
+	size_t size = 0;
+
+	while (true) {
+		log_slot_t *slot = &log_ring[log_ring_head % LOG_RING_SIZE];
+		if (atomic_load_explicit(&slot->seq, memory_order_acquire) !=
+		    log_ring_head + 1)
+			break;
+
+		size_t msize = str_size(slot->message) + 1;
+		size_t rsize = sizeof(logger_batch_hdr_t) +
+		    ALIGN_UP(msize, sizeof(sysarg_t));
+
+		if (size + rsize > LOGGER_BATCH_SIZE) {
+			logger_batch(logger_session, log_batch, size);
+			size = 0;
+		}
+
+		logger_batch_hdr_t *hdr = (logger_batch_hdr_t *)
+		    (log_batch + size);
+		hdr->log = (slot->log == LOG_DEFAULT) ? default_log_id :
+		    slot->log;
+		hdr->level = slot->level;
+		hdr->size = msize;
+		memcpy(hdr + 1, slot->message, msize);
+		size += rsize;
+
+		free(slot->message);
+		atomic_store_explicit(&slot->seq, log_ring_head + LOG_RING_SIZE,
+		    memory_order_release);
+		log_ring_head++;
+	}
+
+	if (size > 0)
+		logger_batch(logger_session, log_batch, size);
+
+	fibril_mutex_unlock(&log_flush_lock);
+}
+
+/** Fibril shipping messages in the background. */
+static errno_t log_flush_fibril(void *arg)
+{
+	while (true) {
+		fibril_semaphore_down(&log_flush_sem);
+		atomic_store(&log_flush_pending, false);
+		log_flush();
+	}
+
+	return EOK;
+}
+
 /** Get name of the log level.
  *
  * @param level The log level.
@@ -174,6 +349,29 @@ errno_t log_init(const char *prog_name)
 
 	default_log_id = log_create(prog_name, LOG_NO_PARENT);
 
+	for (size_t i = 0; i < LOG_RING_SIZE; i++)
+		atomic_init(&log_ring[i].seq, i);
+
+	/*
+	 * Until the batch buffer is allocated, messages are sent
+	 * synchronously.
+	 */
+	uint8_t *batch = malloc(LOGGER_BATCH_SIZE);
+	if (batch == NULL)
+		return ENOMEM;
+
+	fid_t fid = fibril_create(log_flush_fibril, NULL);
+	if (fid == 0) {
+		free(batch);
+		return ENOMEM;
+	}
+
+	log_batch = batch;
+	fibril_add_ready(fid);
+
+	/* Do not lose messages still in the ring on exit. */
+	atexit(log_flush);
+
 	return EOK;
 }
 
@@ -229,6 +427,10 @@ void log_msg(log_t ctx, log_level_t level, const char *fmt, ...)
 }
 
 /** Write an entry to the log (va_list variant).
+ *
+ * The message is queued and shipped to the logger in a batch by
+ * a background fibril. Messages of level LVL_ERROR and more severe
+ * are shipped before returning.
  *
  * @param ctx Log to use (use LOG_DEFAULT if you have no idea what it means).
  * @param level Severity level of the message.
@@ -239,13 +441,52 @@ void log_msgv(log_t ctx, log_level_t level, const char *fmt, va_list args)
 {
 	assert(level < LVL_LIMIT);
 
-	char *message_buffer = malloc(MESSAGE_BUFFER_SIZE);
-	if (message_buffer == NULL)
+	/* Format the message into a buffer of just the right size */
+	va_list args_copy;
+	va_copy(args_copy, args);
+	int len = vsnprintf(NULL, 0, fmt, args_copy);
+	va_end(args_copy);
+	if (len < 0)
+		return;
+
+	size_t size = min((size_t) len + 1, (size_t) MESSAGE_BUFFER_SIZE);
+	char *message = malloc(size);
+	if (message == NULL)
 		return;
 
-	vsnprintf(message_buffer, MESSAGE_BUFFER_SIZE, fmt, args);
-	logger_message(logger_session, ctx, level, message_buffer);
-	free(message_buffer);
+	vsnprintf(message, size, fmt, args);
+
+	// FIXME: remove when all USB drivers use libc logging explicitly
+	str_rtrim(message, '\n');
+
+	if (log_batch == NULL) {
+		logger_message(logger_session, ctx, level, message);
+		free(message);
+		return;
+	}
+
+	if (!log_ring_push(ctx, level, message)) {
+		/* Make room in the ring ourselves. */
+		log_flush();
+
+		if (!log_ring_push(ctx, level, message)) {
+			logger_message(logger_session, ctx, level, message);
+			free(message);
+			return;
+		}
+	}
+
+	/*
+	 * Errors are shipped immediately so that they are not lost
+	 * if the task crashes.
+	 */
+	if (level <= LVL_ERROR) {
+		log_flush();
+		return;
+	}
+
+	if (!atomic_exchange(&log_flush_pending, true))
+		fibril_semaphore_up(&log_flush_sem);
 }
 
 /** @}
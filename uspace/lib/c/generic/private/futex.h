@@ -41,12 +41,10 @@
 #include <libc.h>
 #include <time.h>
 #include <fibril.h>
-#include <abi/cap.h>
 #include <abi/synch.h>
 
 typedef struct futex {
 	volatile atomic_int val;
-	volatile cap_waitq_handle_t whandle;
 
 #ifdef CONFIG_DEBUG_FUTEX
 	_Atomic(fibril_t *) owner;
@@ -55,15 +53,22 @@ typedef struct futex {
 
 extern errno_t futex_initialize(futex_t *futex, int value);
 
+/** Destroy a futex.
+ *
+ * The kernel wait queue is keyed by the address of the futex counter.
+ * It is freed by the kernel as soon as no thread uses it, but it may still
+ * hold wakeups which did not find any sleeper. These are discarded here,
+ * so that a futex initialized later at the same address starts afresh.
+ *
+ * @param futex Futex.
+ *
+ * @return EOK on success.
+ * @return EBUSY if a thread is still using the futex.
+ *
+ */
 static inline errno_t futex_destroy(futex_t *futex)
 {
-	if (futex->whandle) {
-		errno_t rc;
-		rc = __SYSCALL1(SYS_WAITQ_DESTROY, (sysarg_t) futex->whandle);
-		futex->whandle = CAP_NIL;
-		return rc;
-	}
-	return EOK;
+	return __SYSCALL1(SYS_FUTEX_DESTROY, (sysarg_t) &futex->val);
 }
 
 #ifdef CONFIG_DEBUG_FUTEX
@@ -95,11 +100,6 @@ void __futex_give_to(futex_t *, void *, const char *);
 
 #endif
 
-static inline errno_t futex_allocate_waitq(futex_t *futex)
-{
-	return __SYSCALL1(SYS_WAITQ_CREATE, (sysarg_t) &futex->whandle);
-}
-
 /** Down the futex with timeout, composably.
  *
  * This means that when the operation fails due to a timeout or being
@@ -121,8 +121,6 @@ static inline errno_t futex_down_composable(futex_t *futex,
 {
 	// TODO: Add tests for this.
 
-	assert(futex->whandle != CAP_NIL);
-
 	if (atomic_fetch_sub_explicit(&futex->val, 1, memory_order_acquire) > 0)
 		return EOK;
 
@@ -147,7 +145,7 @@ static inline errno_t futex_down_composable(futex_t *futex,
 		assert(timeout > 0);
 	}
 
-	return __SYSCALL3(SYS_WAITQ_SLEEP, (sysarg_t) futex->whandle,
+	return __SYSCALL3(SYS_FUTEX_SLEEP, (sysarg_t) &futex->val,
 	    (sysarg_t) timeout, (sysarg_t) SYNCH_FLAGS_FUTEX);
 }
 
@@ -163,7 +161,7 @@ static inline errno_t futex_down_composable(futex_t *futex,
 static inline errno_t futex_up(futex_t *futex)
 {
 	if (atomic_fetch_add_explicit(&futex->val, 1, memory_order_release) < 0)
-		return __SYSCALL1(SYS_WAITQ_WAKEUP, (sysarg_t) futex->whandle);
+		return __SYSCALL1(SYS_FUTEX_WAKEUP, (sysarg_t) &futex->val);
 
 	return EOK;
 }
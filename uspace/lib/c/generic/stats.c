@@ -35,13 +35,28 @@
 
 #include <stats.h>
 #include <sysinfo.h>
+#include <as.h>
+#include <barrier.h>
+#include <ddi.h>
 #include <errno.h>
+#include <fibril_synch.h>
 #include <stdio.h>
 #include <inttypes.h>
 #include <stdlib.h>
 
 #define SYSINFO_STATS_MAX_PATH  64
 
+/** Number of attempts to read a consistent entry of the shared page */
+#define STATS_PAGE_RETRIES  1000
+
+/** Shared task statistics page (NULL if not mapped) */
+static stats_page_t *stats_page = NULL;
+
+/** Mapping of the shared task statistics page has been attempted */
+static bool stats_page_probed = false;
+
+static FIBRIL_MUTEX_INITIALIZE(stats_page_mutex);
+
 /** Thread states
  *
  */
@@ -104,7 +119,103 @@ stats_physmem_t *stats_get_physmem(void)
 	return stats_physmem;
 }
 
+/** Map the shared task statistics page
+ *
+ * The mapping is attempted only once and kept for the lifetime
+ * of the task.
+ *
+ * @return Shared task statistics page or NULL if not available.
+ *
+ */
+static stats_page_t *stats_page_map(void)
+{
+	fibril_mutex_lock(&stats_page_mutex);
+
+	if (!stats_page_probed) {
+		stats_page_probed = true;
+
+		sysarg_t faddr;
+		sysarg_t pages;
+		void *addr = AS_AREA_ANY;
+
+		if ((sysinfo_get_value("stats.faddr", &faddr) == EOK) &&
+		    (sysinfo_get_value("stats.pages", &pages) == EOK) &&
+		    (physmem_map(faddr, pages, AS_AREA_READ | AS_AREA_CACHEABLE,
+		    &addr) == EOK)) {
+			if (((stats_page_t *) addr)->magic == STATS_PAGE_MAGIC)
+				stats_page = addr;
+			else
+				physmem_unmap(addr);
+		}
+	}
+
+	fibril_mutex_unlock(&stats_page_mutex);
+	return stats_page;
+}
+
+static int stats_task_cmp(const void *a, const void *b)
+{
+	const stats_task_t *ta = a;
+	const stats_task_t *tb = b;
+
+	if (ta->task_id != tb->task_id)
+		return (ta->task_id < tb->task_id) ? -1 : 1;
+
+	return 0;
+}
+
+/** Get task statistics from the shared task statistics page
+ *
+ * @param page  Shared task statistics page.
+ * @param count Number of records returned.
+ *
+ * @return Array of stats_task_t structures sorted by task ID or NULL
+ *         if the page does not cover all tasks.
+ *
+ */
+static stats_task_t *stats_page_get_tasks(stats_page_t *page, size_t *count)
+{
+	size_t used = page->used;
+	if ((page->overflow != 0) || (used == 0) || (used > page->entries))
+		return NULL;
+
+	stats_task_t *stats_tasks = malloc(used * sizeof(stats_task_t));
+	if (stats_tasks == NULL)
+		return NULL;
+
+	size_t n = 0;
+	for (size_t i = 0; i < used; i++) {
+		stats_page_entry_t *entry = &page->tasks[i];
+		unsigned int retries = 0;
+		uint32_t seq;
+
+		do {
+			if (retries++ == STATS_PAGE_RETRIES) {
+				/* Fall back to sysinfo */
+				free(stats_tasks);
+				return NULL;
+			}
+
+			seq = entry->seq;
+			read_barrier();
+			stats_tasks[n] = entry->task;
+			read_barrier();
+		} while (((seq & 1) != 0) || (seq != entry->seq));
+
+		if (stats_tasks[n].task_id != 0)
+			n++;
+	}
+
+	qsort(stats_tasks, n, sizeof(stats_task_t), stats_task_cmp);
+
+	*count = n;
+	return stats_tasks;
+}
+
 /** Get task statistics
+ *
+ * The statistics are read from the shared task statistics page if
+ * possible, which avoids gathering them in the kernel on each call.
  *
  * @param count Number of records returned.
  *
@@ -115,6 +226,13 @@ stats_physmem_t *stats_get_physmem(void)
  */
 stats_task_t *stats_get_tasks(size_t *count)
 {
+	stats_page_t *page = stats_page_map();
+	if (page != NULL) {
+		stats_task_t *stats_tasks = stats_page_get_tasks(page, count);
+		if (stats_tasks != NULL)
+			return stats_tasks;
+	}
+
 	size_t size = 0;
 	stats_task_t *stats_tasks =
 	    (stats_task_t *) sysinfo_get_data("system.tasks", &size);
@@ -44,17 +44,19 @@
 #define DPRINTF(...) dummy_printf(__VA_ARGS__)
 
 /** Initialize futex counter.
+ *
+ * No kernel object needs to be allocated, the kernel creates the wait
+ * queue for the futex on demand when a thread needs to sleep in it.
  *
  * @param futex Futex.
  * @param val   Initialization value.
  *
- * @return      Error code.
+ * @return      EOK.
  */
 errno_t futex_initialize(futex_t *futex, int val)
 {
 	atomic_store_explicit(&futex->val, val, memory_order_relaxed);
-	futex->whandle = CAP_NIL;
-	return futex_allocate_waitq(futex);
+	return EOK;
 }
 
 #ifdef CONFIG_DEBUG_FUTEX
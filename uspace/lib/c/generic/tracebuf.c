@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Kernel trace buffer.
+ */
+
+#include <as.h>
+#include <ddi.h>
+#include <libc.h>
+#include <sysinfo.h>
+#include <tracebuf.h>
+
+/** Enable or disable recording of kernel trace events
+ *
+ * @param mask          Events to record (TRACEBUF_MASK bits), zero
+ *                      disables recording.
+ * @param sample_ticks  Clock ticks between program counter samples or zero
+ *                      for the kernel default.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t tracebuf_control(unsigned int mask, unsigned int sample_ticks)
+{
+	return (errno_t) __SYSCALL2(SYS_TRACEBUF_CONTROL, (sysarg_t) mask,
+	    (sysarg_t) sample_ticks);
+}
+
+/** Map the kernel trace buffer
+ *
+ * @param[out] rhdr   Place to store the address of the trace buffer.
+ * @param[out] rsize  Place to store the size of the trace buffer in bytes.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t tracebuf_map(tracebuf_header_t **rhdr, size_t *rsize)
+{
+	sysarg_t faddr;
+	errno_t rc = sysinfo_get_value("tracebuf.faddr", &faddr);
+	if (rc != EOK)
+		return rc;
+
+	sysarg_t pages;
+	rc = sysinfo_get_value("tracebuf.pages", &pages);
+	if (rc != EOK)
+		return rc;
+
+	void *addr = AS_AREA_ANY;
+	rc = physmem_map(faddr, pages, AS_AREA_READ | AS_AREA_CACHEABLE,
+	    &addr);
+	if (rc != EOK)
+		return rc;
+
+	tracebuf_header_t *hdr = addr;
+	if (hdr->magic != TRACEBUF_MAGIC) {
+		physmem_unmap(addr);
+		return EINVAL;
+	}
+
+	*rhdr = hdr;
+	*rsize = pages * PAGE_SIZE;
+	return EOK;
+}
+
+/** Unmap the kernel trace buffer
+ *
+ * @param hdr  Trace buffer mapped by tracebuf_map().
+ */
+void tracebuf_unmap(tracebuf_header_t *hdr)
+{
+	physmem_unmap(hdr);
+}
+
+/** @}
+ */
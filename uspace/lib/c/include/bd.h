@@ -42,12 +42,34 @@ typedef struct {
 	async_sess_t *sess;
 } bd_t;
 
+/** Block device request in progress
+ *
+ * Requests are started by bd_*_start() and completed by bd_req_wait(),
+ * possibly in a different order than they were started.
+ */
+typedef struct {
+	/** Request message */
+	aid_t req;
+	/** Data read message (read requests only) */
+	aid_t dreq;
+} bd_req_t;
+
 extern errno_t bd_open(async_sess_t *, bd_t **);
 extern void bd_close(bd_t *);
 extern errno_t bd_read_blocks(bd_t *, aoff64_t, size_t, void *, size_t);
 extern errno_t bd_read_toc(bd_t *, uint8_t, void *, size_t);
 extern errno_t bd_write_blocks(bd_t *, aoff64_t, size_t, const void *, size_t);
 extern errno_t bd_sync_cache(bd_t *, aoff64_t, size_t);
+extern errno_t bd_read_blocks_start(bd_t *, aoff64_t, size_t, void *, size_t,
+    bd_req_t *);
+extern errno_t bd_write_blocks_start(bd_t *, aoff64_t, size_t, const void *,
+    size_t, bd_req_t *);
+extern errno_t bd_sync_cache_start(bd_t *, aoff64_t, size_t, bd_req_t *);
+extern errno_t bd_discard(bd_t *, aoff64_t, size_t);
+extern errno_t bd_discard_start(bd_t *, aoff64_t, size_t, bd_req_t *);
+extern errno_t bd_read_blocks_forward(bd_t *, aoff64_t, size_t, ipc_call_t *);
+extern errno_t bd_write_blocks_forward(bd_t *, aoff64_t, size_t, ipc_call_t *);
+extern errno_t bd_req_wait(bd_req_t *);
 extern errno_t bd_get_block_size(bd_t *, size_t *);
 extern errno_t bd_get_num_blocks(bd_t *, aoff64_t *);
 
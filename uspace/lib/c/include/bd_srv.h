@@ -41,12 +41,23 @@
 #include <stdbool.h>
 #include <offset.h>
 
+/** Suggested number of concurrent requests per client session */
+#define BD_SRV_MAX_REQUESTS  32
+
 typedef struct bd_ops bd_ops_t;
 
 /** Service setup (per sevice) */
 typedef struct {
 	bd_ops_t *ops;
 	void *sarg;
+	/**
+	 * Maximum number of read, write, sync and discard requests of one
+	 * client session processed concurrently, each in its own fibril.
+	 * With the default of one, requests are processed one after another.
+	 * A sync request is only started once all requests received before
+	 * it have completed.
+	 */
+	unsigned int max_requests;
 } bd_srvs_t;
 
 /** Server structure (per client session) */
@@ -54,6 +65,12 @@ typedef struct {
 	bd_srvs_t *srvs;
 	async_sess_t *client_sess;
 	void *carg;
+	/** Protects @c requests */
+	fibril_mutex_t lock;
+	/** Signalled when a request finishes */
+	fibril_condvar_t cv;
+	/** Number of requests being processed */
+	unsigned int requests;
 } bd_srv_t;
 
 struct bd_ops {
@@ -65,6 +82,17 @@ struct bd_ops {
 	errno_t (*write_blocks)(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
 	errno_t (*get_block_size)(bd_srv_t *, size_t *);
 	errno_t (*get_num_blocks)(bd_srv_t *, aoff64_t *);
+	errno_t (*discard)(bd_srv_t *, aoff64_t, size_t);
+	/**
+	 * Optional, used instead of read_blocks and write_blocks. The data
+	 * read or write call is passed over instead of a buffer and must be
+	 * forwarded or answered in any case, e.g. by bd_read_blocks_forward()
+	 * or bd_write_blocks_forward().
+	 */
+	errno_t (*read_blocks_forward)(bd_srv_t *, aoff64_t, size_t,
+	    ipc_call_t *);
+	errno_t (*write_blocks_forward)(bd_srv_t *, aoff64_t, size_t,
+	    ipc_call_t *);
 };
 
 extern void bd_srvs_init(bd_srvs_t *);
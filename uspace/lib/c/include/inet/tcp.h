@@ -116,6 +116,8 @@ extern errno_t tcp_conn_reset(tcp_conn_t *);
 
 extern errno_t tcp_conn_recv(tcp_conn_t *, void *, size_t, size_t *);
 extern errno_t tcp_conn_recv_wait(tcp_conn_t *, void *, size_t, size_t *);
+extern errno_t tcp_conn_recv_wait_timeout(tcp_conn_t *, void *, size_t,
+    size_t *, usec_t);
 
 #endif
 
@@ -61,6 +61,7 @@ extern log_t log_create(const char *, log_t);
 extern void log_msg(log_t, log_level_t, const char *, ...)
     _HELENOS_PRINTF_ATTRIBUTE(3, 4);
 extern void log_msgv(log_t, log_level_t, const char *, va_list);
+extern void log_flush(void);
 
 #endif
 
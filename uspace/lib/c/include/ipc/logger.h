@@ -71,9 +71,33 @@ typedef enum {
 	 * Returns: error code
 	 * Followed by: string with the message.
 	 */
-	LOGGER_WRITER_MESSAGE
+	LOGGER_WRITER_MESSAGE,
+	/** Write several messages at once.
+	 *
+	 * Returns: error code
+	 * Followed by: buffer with a sequence of logger_batch_hdr_t
+	 * headers, each followed by the message string.
+	 */
+	LOGGER_WRITER_MESSAGE_BATCH
 } logger_writer_request_t;
 
+/** Maximum size of a LOGGER_WRITER_MESSAGE_BATCH buffer. */
+#define LOGGER_BATCH_SIZE  16384
+
+/** Header of a message in a LOGGER_WRITER_MESSAGE_BATCH buffer.
+ *
+ * The header is followed by the nul-terminated message and padding
+ * to the alignment of the next header.
+ */
+typedef struct {
+	/** Log id */
+	sysarg_t log;
+	/** Message severity level (log_level_t) */
+	sysarg_t level;
+	/** Size of the message including the terminating nul */
+	sysarg_t size;
+} logger_batch_hdr_t;
+
 #endif
 
 /** @}
@@ -0,0 +1,1162 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file
+ * @brief Implementation of deflate compression
+ *
+ * A streaming deflate compressor (producing data in the format
+ * described by RFC 1951).
+ *
+ * The LZ77 matching uses hash chains over a 64 KB window (allowing
+ * back references up to 32 KB) with greedy match selection. The
+ * amount of work spent searching the hash chains is given by the
+ * compression level.
+ *
+ * The symbols are collected into blocks and each block is emitted
+ * either as a stored block, a block with fixed Huffman codes or
+ * a block with dynamic Huffman codes, whichever is the shortest.
+ * At level 0 all blocks are stored.
+ *
+ * The caller feeds the uncompressed input in arbitrarily sized
+ * chunks and drains the compressed output into arbitrarily sized
+ * buffers, thus the memory usage is bounded by the size of the
+ * deflate stream structure.
+ *
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include "deflate.h"
+
+/** Maximum bits in the Huffman code */
+#define MAX_HUFFMAN_BIT  15
+/** Maximum bits in the code length code */
+#define MAX_CODELEN_BIT  7
+
+/** Number of length codes */
+#define MAX_LEN           29
+/** Number of distance codes */
+#define MAX_DIST          30
+/** Number of order codes */
+#define MAX_ORDER         19
+/** Number of literal/length codes */
+#define MAX_LITLEN        286
+/** Number of fixed literal/length codes */
+#define MAX_FIXED_LITLEN  288
+
+/** End-of-block symbol */
+#define END_OF_BLOCK  256
+
+/** Maximum distance of a back reference */
+#define MAX_BACKREF  32768
+
+/** Match length bounds */
+#define MIN_MATCH  3
+#define MAX_MATCH  258
+
+/** Minimal lookahead for finding the longest match */
+#define MIN_LOOKAHEAD  (MAX_MATCH + MIN_MATCH + 1)
+
+/** Minimal matches which are too far to be worth encoding */
+#define TOO_FAR  4096
+
+/** Size of the window (half of the window buffer) */
+#define WINDOW_SIZE  32768
+#define WINDOW_MASK  (WINDOW_SIZE - 1)
+
+/** Hash table size */
+#define HASH_BITS  15
+#define HASH_SIZE  (1 << HASH_BITS)
+
+/** Empty hash chain (window position 0 is never matched) */
+#define NIL  0
+
+/** Maximum number of symbols in a block */
+#define MAX_SYMBOLS  16384
+
+/** Maximum size of a stored block */
+#define MAX_STORED  65535
+
+/** Size of the pending output buffer (fits a whole stored block) */
+#define PENDING_SIZE  (2 * WINDOW_SIZE + 64)
+
+/** Block types */
+#define BLOCK_STORED   0
+#define BLOCK_FIXED    1
+#define BLOCK_DYNAMIC  2
+
+/** Huffman code for encoding
+ *
+ */
+typedef struct {
+	/** Bit-reversed codes */
+	uint16_t code[MAX_FIXED_LITLEN];
+	/** Code lengths */
+	uint16_t length[MAX_FIXED_LITLEN];
+} huffman_code_t;
+
+/** Compression level parameters
+ *
+ */
+typedef struct {
+	/** Maximum number of hash chain entries to examine */
+	unsigned int max_chain;
+	/** Stop searching when a match of this length is found */
+	unsigned int nice_len;
+} deflate_level_t;
+
+/** Deflate stream
+ *
+ */
+struct deflate_stream {
+	unsigned int max_chain;  /**< Hash chain search limit */
+	unsigned int nice_len;   /**< Good enough match length */
+	bool finished;           /**< The last block has been emitted */
+
+	size_t strstart;         /**< Current position in the window */
+	size_t lookahead;        /**< Number of bytes ahead of strstart */
+	size_t block_start;      /**< Start of the current block */
+
+	/** Literals or match lengths of the current block */
+	uint16_t sym_len[MAX_SYMBOLS];
+	/** Match distances of the current block (zero for literals) */
+	uint16_t sym_dist[MAX_SYMBOLS];
+	/** Number of symbols in the current block */
+	size_t sym_count;
+
+	uint16_t len_freq[MAX_FIXED_LITLEN];  /**< Literal/length frequencies */
+	uint16_t dist_freq[MAX_DIST];         /**< Distance frequencies */
+
+	huffman_code_t fixed_len;   /**< Fixed literal/length code */
+	huffman_code_t fixed_dist;  /**< Fixed distance code */
+	huffman_code_t dyn_len;     /**< Dynamic literal/length code */
+	huffman_code_t dyn_dist;    /**< Dynamic distance code */
+	huffman_code_t codelen;     /**< Code length code */
+
+	/** Run-length encoded code lengths */
+	uint8_t rle_sym[MAX_LITLEN + MAX_DIST];
+	uint8_t rle_extra[MAX_LITLEN + MAX_DIST];
+	size_t rle_count;
+
+	uint64_t bitbuf;            /**< Output bit buffer */
+	unsigned int bitlen;        /**< Number of bits in the bit buffer */
+
+	size_t pending_out;         /**< Position in the pending output */
+	size_t pending_len;         /**< Size of the pending output */
+
+	uint8_t len_symbol[MAX_MATCH + 1];  /**< Match length to symbol */
+	uint8_t dist_symbol[512];           /**< Distance to symbol */
+
+	uint16_t head[HASH_SIZE];            /**< Hash chain heads */
+	uint16_t prev[WINDOW_SIZE];          /**< Hash chain links */
+	uint8_t window[2 * WINDOW_SIZE];     /**< Window buffer */
+	uint8_t pending[PENDING_SIZE];       /**< Pending output */
+};
+
+/** Compression levels
+ *
+ */
+static const deflate_level_t levels[DEFLATE_MAX_LEVEL + 1] = {
+	{ 0, 0 },
+	{ 4, 8 },
+	{ 8, 16 },
+	{ 16, 32 },
+	{ 32, 64 },
+	{ 64, 128 },
+	{ 128, 128 },
+	{ 256, MAX_MATCH },
+	{ 1024, MAX_MATCH },
+	{ 4096, MAX_MATCH }
+};
+
+/** Length codes
+ *
+ */
+static const uint16_t lens[MAX_LEN] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+/** Extended length codes
+ *
+ */
+static const uint16_t lens_ext[MAX_LEN] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/** Distance codes
+ *
+ */
+static const uint16_t dists[MAX_DIST] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+
+/** Extended distance codes
+ *
+ */
+static const uint16_t dists_ext[MAX_DIST] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+	12, 12, 13, 13
+};
+
+/** Order codes
+ *
+ */
+static const uint8_t order[MAX_ORDER] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/** Extra bits of the code length repeat codes
+ *
+ */
+static const uint8_t codelen_ext[MAX_ORDER] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 7
+};
+
+/** Write bits to the pending output
+ *
+ * @param stream Deflate stream.
+ * @param val    Bits to write (starting with the least significant bit).
+ * @param cnt    Number of bits to write (at most 16).
+ *
+ */
+static inline void put_bits(deflate_stream_t *stream, uint32_t val,
+    unsigned int cnt)
+{
+	stream->bitbuf |= ((uint64_t) val) << stream->bitlen;
+	stream->bitlen += cnt;
+
+	if (stream->bitlen >= 32) {
+		uint8_t *dest = stream->pending + stream->pending_len;
+
+		dest[0] = (uint8_t) stream->bitbuf;
+		dest[1] = (uint8_t) (stream->bitbuf >> 8);
+		dest[2] = (uint8_t) (stream->bitbuf >> 16);
+		dest[3] = (uint8_t) (stream->bitbuf >> 24);
+
+		stream->pending_len += 4;
+		stream->bitbuf >>= 32;
+		stream->bitlen -= 32;
+	}
+}
+
+/** Flush the bit buffer up to the byte boundary
+ *
+ * @param stream Deflate stream.
+ *
+ */
+static void put_align(deflate_stream_t *stream)
+{
+	while (stream->bitlen > 0) {
+		stream->pending[stream->pending_len] = (uint8_t) stream->bitbuf;
+		stream->pending_len++;
+
+		stream->bitbuf >>= 8;
+		stream->bitlen -= min(stream->bitlen, 8);
+	}
+}
+
+/** Reverse the order of bits in a code
+ *
+ * @param code Code to reverse.
+ * @param len  Number of bits in the code.
+ *
+ * @return Reversed code.
+ *
+ */
+static uint16_t reverse_bits(uint16_t code, size_t len)
+{
+	uint16_t rev = 0;
+
+	while (len > 0) {
+		rev = (rev << 1) | (code & 1);
+		code >>= 1;
+		len--;
+	}
+
+	return rev;
+}
+
+/** Compare sort keys
+ *
+ */
+static int key_cmp(const void *a, const void *b)
+{
+	uint32_t ka = *((const uint32_t *) a);
+	uint32_t kb = *((const uint32_t *) b);
+
+	if (ka < kb)
+		return -1;
+
+	if (ka > kb)
+		return 1;
+
+	return 0;
+}
+
+/** Compute length-limited Huffman code lengths
+ *
+ * The Huffman tree is built using the two-queue method on the
+ * symbols sorted by frequency. Code lengths exceeding the limit
+ * are then clamped and the Kraft inequality is restored by moving
+ * the shorter codes deeper into the tree.
+ *
+ * At least two symbols always get non-zero code length, since
+ * some decoders reject codes consisting of a single symbol.
+ *
+ * @param freq     Symbol frequencies.
+ * @param n        Number of symbols.
+ * @param max_bits Maximum code length.
+ * @param length   Computed code lengths.
+ *
+ */
+static void huffman_lengths(const uint16_t *freq, size_t n,
+    unsigned int max_bits, uint16_t *length)
+{
+	/* Sort keys (frequency and symbol) of the leaves */
+	uint32_t keys[MAX_FIXED_LITLEN];
+
+	/* Weights and parents of the leaves and the internal nodes */
+	uint32_t weight[2 * MAX_FIXED_LITLEN];
+	uint16_t parent[2 * MAX_FIXED_LITLEN];
+
+	size_t leaves = 0;
+	size_t symbol;
+
+	for (symbol = 0; symbol < n; symbol++) {
+		length[symbol] = 0;
+
+		if (freq[symbol] != 0) {
+			keys[leaves] = (((uint32_t) freq[symbol]) << 9) | symbol;
+			leaves++;
+		}
+	}
+
+	/* Add dummy symbols to make sure the code has at least two codes */
+	for (symbol = 0; (leaves < 2) && (symbol < n); symbol++) {
+		if (freq[symbol] == 0) {
+			keys[leaves] = symbol;
+			leaves++;
+		}
+	}
+
+	qsort(keys, leaves, sizeof(uint32_t), key_cmp);
+
+	for (size_t i = 0; i < leaves; i++)
+		weight[i] = keys[i] >> 9;
+
+	/* Build the tree */
+	size_t next_leaf = 0;
+	size_t next_node = leaves;
+	size_t nodes = leaves;
+
+	for (size_t i = 0; i + 1 < leaves; i++) {
+		size_t child[2];
+
+		for (size_t j = 0; j < 2; j++) {
+			if ((next_leaf < leaves) && ((next_node == nodes) ||
+			    (weight[next_leaf] <= weight[next_node]))) {
+				child[j] = next_leaf;
+				next_leaf++;
+			} else {
+				child[j] = next_node;
+				next_node++;
+			}
+		}
+
+		weight[nodes] = weight[child[0]] + weight[child[1]];
+		parent[child[0]] = nodes;
+		parent[child[1]] = nodes;
+		nodes++;
+	}
+
+	/* Compute depths (reusing the weights), parents follow children */
+	uint16_t bl_count[MAX_HUFFMAN_BIT + 1];
+	for (size_t len = 0; len <= max_bits; len++)
+		bl_count[len] = 0;
+
+	weight[nodes - 1] = 0;
+	for (size_t i = nodes - 1; i > 0; i--) {
+		weight[i - 1] = weight[parent[i - 1]] + 1;
+
+		if (i - 1 < leaves)
+			bl_count[min(weight[i - 1], max_bits)]++;
+	}
+
+	/* Restore the Kraft inequality after clamping */
+	uint32_t total = 0;
+	for (size_t len = 1; len <= max_bits; len++)
+		total += ((uint32_t) bl_count[len]) << (max_bits - len);
+
+	while (total > (UINT32_C(1) << max_bits)) {
+		bl_count[max_bits]--;
+
+		for (size_t len = max_bits - 1; len > 0; len--) {
+			if (bl_count[len] != 0) {
+				bl_count[len]--;
+				bl_count[len + 1] += 2;
+				break;
+			}
+		}
+
+		total--;
+	}
+
+	/* Assign the longest codes to the least frequent symbols */
+	size_t i = 0;
+	for (size_t len = max_bits; len > 0; len--) {
+		for (size_t j = 0; j < bl_count[len]; j++) {
+			length[keys[i] & 0x1ff] = len;
+			i++;
+		}
+	}
+}
+
+/** Compute canonical Huffman codes
+ *
+ * @param huffman Huffman code with the code lengths filled in.
+ * @param n       Number of symbols.
+ *
+ */
+static void huffman_codes(huffman_code_t *huffman, size_t n)
+{
+	uint16_t bl_count[MAX_HUFFMAN_BIT + 1];
+	uint16_t next_code[MAX_HUFFMAN_BIT + 1];
+	size_t len;
+	size_t symbol;
+
+	for (len = 0; len <= MAX_HUFFMAN_BIT; len++)
+		bl_count[len] = 0;
+
+	for (symbol = 0; symbol < n; symbol++)
+		bl_count[huffman->length[symbol]]++;
+
+	uint16_t code = 0;
+	bl_count[0] = 0;
+
+	for (len = 1; len <= MAX_HUFFMAN_BIT; len++) {
+		code = (code + bl_count[len - 1]) << 1;
+		next_code[len] = code;
+	}
+
+	for (symbol = 0; symbol < n; symbol++) {
+		len = huffman->length[symbol];
+		if (len != 0) {
+			huffman->code[symbol] = reverse_bits(next_code[len], len);
+			next_code[len]++;
+		}
+	}
+}
+
+/** Get distance symbol
+ *
+ * @param stream Deflate stream.
+ * @param dist   Match distance.
+ *
+ * @return Distance symbol.
+ *
+ */
+static inline unsigned int dist_symbol(deflate_stream_t *stream, size_t dist)
+{
+	dist--;
+
+	if (dist < 256)
+		return stream->dist_symbol[dist];
+
+	return stream->dist_symbol[256 + (dist >> 7)];
+}
+
+/** Compute the size of the symbols of the current block
+ *
+ * @param stream    Deflate stream.
+ * @param len_code  Huffman code for literal/length.
+ * @param dist_code Huffman code for distance.
+ *
+ * @return Size in bits.
+ *
+ */
+static size_t block_cost(deflate_stream_t *stream,
+    const huffman_code_t *len_code, const huffman_code_t *dist_code)
+{
+	size_t cost = 0;
+	size_t symbol;
+
+	for (symbol = 0; symbol <= END_OF_BLOCK; symbol++)
+		cost += stream->len_freq[symbol] * len_code->length[symbol];
+
+	for (symbol = 0; symbol < MAX_LEN; symbol++) {
+		cost += stream->len_freq[257 + symbol] *
+		    (len_code->length[257 + symbol] + lens_ext[symbol]);
+	}
+
+	for (symbol = 0; symbol < MAX_DIST; symbol++) {
+		cost += stream->dist_freq[symbol] *
+		    (dist_code->length[symbol] + dists_ext[symbol]);
+	}
+
+	return cost;
+}
+
+/** Run-length encode the dynamic code lengths
+ *
+ * @param stream  Deflate stream.
+ * @param lengths Concatenated literal/length and distance code lengths.
+ * @param n       Number of code lengths.
+ * @param freq    Frequencies of the code length symbols.
+ *
+ */
+static void rle_lengths(deflate_stream_t *stream, const uint16_t *lengths,
+    size_t n, uint16_t *freq)
+{
+	size_t i = 0;
+
+	stream->rle_count = 0;
+
+	while (i < n) {
+		uint16_t cur = lengths[i];
+		size_t run = 1;
+
+		while ((i + run < n) && (lengths[i + run] == cur))
+			run++;
+
+		i += run;
+
+		if (cur != 0) {
+			/* Emit the length and repeat it */
+			stream->rle_sym[stream->rle_count] = cur;
+			stream->rle_extra[stream->rle_count] = 0;
+			stream->rle_count++;
+			freq[cur]++;
+			run--;
+
+			while (run >= 3) {
+				size_t cnt = min(run, 6);
+				stream->rle_sym[stream->rle_count] = 16;
+				stream->rle_extra[stream->rle_count] = cnt - 3;
+				stream->rle_count++;
+				freq[16]++;
+				run -= cnt;
+			}
+		} else {
+			/* Emit zero runs */
+			while (run >= 11) {
+				size_t cnt = min(run, 138);
+				stream->rle_sym[stream->rle_count] = 18;
+				stream->rle_extra[stream->rle_count] = cnt - 11;
+				stream->rle_count++;
+				freq[18]++;
+				run -= cnt;
+			}
+
+			if (run >= 3) {
+				stream->rle_sym[stream->rle_count] = 17;
+				stream->rle_extra[stream->rle_count] = run - 3;
+				stream->rle_count++;
+				freq[17]++;
+				run = 0;
+			}
+		}
+
+		while (run > 0) {
+			stream->rle_sym[stream->rle_count] = cur;
+			stream->rle_extra[stream->rle_count] = 0;
+			stream->rle_count++;
+			freq[cur]++;
+			run--;
+		}
+	}
+}
+
+/** Write the symbols of the current block
+ *
+ * @param stream    Deflate stream.
+ * @param len_code  Huffman code for literal/length.
+ * @param dist_code Huffman code for distance.
+ *
+ */
+static void write_symbols(deflate_stream_t *stream,
+    const huffman_code_t *len_code, const huffman_code_t *dist_code)
+{
+	for (size_t i = 0; i < stream->sym_count; i++) {
+		uint16_t len = stream->sym_len[i];
+		uint16_t dist = stream->sym_dist[i];
+
+		if (dist == 0) {
+			/* Literal */
+			put_bits(stream, len_code->code[len],
+			    len_code->length[len]);
+			continue;
+		}
+
+		unsigned int symbol = stream->len_symbol[len];
+		put_bits(stream, len_code->code[257 + symbol],
+		    len_code->length[257 + symbol]);
+		put_bits(stream, len - lens[symbol], lens_ext[symbol]);
+
+		symbol = dist_symbol(stream, dist);
+		put_bits(stream, dist_code->code[symbol],
+		    dist_code->length[symbol]);
+		put_bits(stream, dist - dists[symbol], dists_ext[symbol]);
+	}
+
+	put_bits(stream, len_code->code[END_OF_BLOCK],
+	    len_code->length[END_OF_BLOCK]);
+}
+
+/** Emit the current block
+ *
+ * The block is written into the pending output (which must be
+ * empty) using the shortest of the possible encodings, or as
+ * stored blocks at level 0.
+ *
+ * @param stream Deflate stream.
+ * @param last   Whether this is the last block of the stream.
+ *
+ */
+static void deflate_block(deflate_stream_t *stream, bool last)
+{
+	size_t raw = stream->strstart - stream->block_start;
+	size_t symbol;
+
+	assert(stream->pending_len == 0);
+
+	stream->len_freq[END_OF_BLOCK]++;
+
+	/* Dynamic Huffman codes */
+	huffman_lengths(stream->len_freq, MAX_LITLEN, MAX_HUFFMAN_BIT,
+	    stream->dyn_len.length);
+	huffman_codes(&stream->dyn_len, MAX_LITLEN);
+
+	huffman_lengths(stream->dist_freq, MAX_DIST, MAX_HUFFMAN_BIT,
+	    stream->dyn_dist.length);
+	huffman_codes(&stream->dyn_dist, MAX_DIST);
+
+	size_t nlen = MAX_LITLEN;
+	while ((nlen > 257) && (stream->dyn_len.length[nlen - 1] == 0))
+		nlen--;
+
+	size_t ndist = MAX_DIST;
+	while ((ndist > 1) && (stream->dyn_dist.length[ndist - 1] == 0))
+		ndist--;
+
+	uint16_t lengths[MAX_LITLEN + MAX_DIST];
+	memcpy(lengths, stream->dyn_len.length, nlen * sizeof(uint16_t));
+	memcpy(lengths + nlen, stream->dyn_dist.length,
+	    ndist * sizeof(uint16_t));
+
+	uint16_t codelen_freq[MAX_ORDER];
+	for (symbol = 0; symbol < MAX_ORDER; symbol++)
+		codelen_freq[symbol] = 0;
+
+	rle_lengths(stream, lengths, nlen + ndist, codelen_freq);
+
+	huffman_lengths(codelen_freq, MAX_ORDER, MAX_CODELEN_BIT,
+	    stream->codelen.length);
+	huffman_codes(&stream->codelen, MAX_ORDER);
+
+	size_t ncode = MAX_ORDER;
+	while ((ncode > 4) && (stream->codelen.length[order[ncode - 1]] == 0))
+		ncode--;
+
+	size_t dyn_cost = 3 + 5 + 5 + 4 + 3 * ncode +
+	    block_cost(stream, &stream->dyn_len, &stream->dyn_dist);
+
+	for (symbol = 0; symbol < MAX_ORDER; symbol++) {
+		dyn_cost += codelen_freq[symbol] *
+		    (stream->codelen.length[symbol] + codelen_ext[symbol]);
+	}
+
+	/* Fixed Huffman codes */
+	size_t fixed_cost = 3 +
+	    block_cost(stream, &stream->fixed_len, &stream->fixed_dist);
+
+	/* Stored blocks */
+	size_t chunks = max((raw + MAX_STORED - 1) / MAX_STORED, 1);
+	size_t stored_cost = chunks * (3 + 32) + 8 * raw + (chunks - 1) * 5 +
+	    (8 - (stream->bitlen + 3) % 8) % 8;
+
+	if ((stream->max_chain == 0) ||
+	    ((stored_cost <= fixed_cost) && (stored_cost <= dyn_cost))) {
+		size_t pos = stream->block_start;
+
+		do {
+			size_t len = min(raw, MAX_STORED);
+			raw -= len;
+
+			put_bits(stream, ((last && (raw == 0)) ? 1 : 0) |
+			    (BLOCK_STORED << 1), 3);
+			put_align(stream);
+
+			uint8_t *dest = stream->pending + stream->pending_len;
+			dest[0] = (uint8_t) len;
+			dest[1] = (uint8_t) (len >> 8);
+			dest[2] = (uint8_t) ~len;
+			dest[3] = (uint8_t) (~len >> 8);
+
+			memcpy(dest + 4, stream->window + pos, len);
+			stream->pending_len += len + 4;
+			pos += len;
+		} while (raw > 0);
+	} else if (fixed_cost <= dyn_cost) {
+		put_bits(stream, (last ? 1 : 0) | (BLOCK_FIXED << 1), 3);
+		write_symbols(stream, &stream->fixed_len, &stream->fixed_dist);
+	} else {
+		put_bits(stream, (last ? 1 : 0) | (BLOCK_DYNAMIC << 1), 3);
+		put_bits(stream, nlen - 257, 5);
+		put_bits(stream, ndist - 1, 5);
+		put_bits(stream, ncode - 4, 4);
+
+		for (size_t i = 0; i < ncode; i++)
+			put_bits(stream, stream->codelen.length[order[i]], 3);
+
+		for (size_t i = 0; i < stream->rle_count; i++) {
+			symbol = stream->rle_sym[i];
+			put_bits(stream, stream->codelen.code[symbol],
+			    stream->codelen.length[symbol]);
+			put_bits(stream, stream->rle_extra[i],
+			    codelen_ext[symbol]);
+		}
+
+		write_symbols(stream, &stream->dyn_len, &stream->dyn_dist);
+	}
+
+	/* Start a new block */
+	for (symbol = 0; symbol < MAX_FIXED_LITLEN; symbol++)
+		stream->len_freq[symbol] = 0;
+
+	for (symbol = 0; symbol < MAX_DIST; symbol++)
+		stream->dist_freq[symbol] = 0;
+
+	stream->sym_count = 0;
+	stream->block_start = stream->strstart;
+}
+
+/** Compute hash of three bytes
+ *
+ * @param data Data to hash.
+ *
+ * @return Hash value.
+ *
+ */
+static inline size_t hash3(const uint8_t *data)
+{
+	uint32_t val = (((uint32_t) data[0]) << 16) |
+	    (((uint32_t) data[1]) << 8) | data[2];
+
+	return (val * UINT32_C(2654435761)) >> (32 - HASH_BITS);
+}
+
+/** Insert window position into the hash chains
+ *
+ * @param stream Deflate stream.
+ * @param pos    Window position (with at least MIN_MATCH bytes ahead).
+ * @param hash   Hash of the bytes at the window position.
+ *
+ */
+static inline void insert_pos(deflate_stream_t *stream, size_t pos,
+    size_t hash)
+{
+	stream->prev[pos & WINDOW_MASK] = stream->head[hash];
+	stream->head[hash] = pos;
+}
+
+/** Find the longest match for the current position
+ *
+ * @param stream Deflate stream.
+ * @param hash   Hash of the bytes at the current position.
+ * @param rdist  Place to store the match distance.
+ *
+ * @return Match length (less than MIN_MATCH if no match was found).
+ *
+ */
+static size_t longest_match(deflate_stream_t *stream, size_t hash,
+    size_t *rdist)
+{
+	size_t pos = stream->strstart;
+	size_t limit = min(stream->lookahead, MAX_MATCH);
+	const uint8_t *scan = stream->window + pos;
+
+	size_t best = MIN_MATCH - 1;
+	size_t cand = stream->head[hash];
+	unsigned int chain = stream->max_chain;
+
+	while ((cand != NIL) && (chain > 0)) {
+		if ((cand >= pos) || (pos - cand > MAX_BACKREF))
+			break;
+
+		const uint8_t *match = stream->window + cand;
+
+		if ((match[best] == scan[best]) && (match[0] == scan[0]) &&
+		    (match[1] == scan[1])) {
+			size_t len = 2;
+			while ((len < limit) && (match[len] == scan[len]))
+				len++;
+
+			if (len > best) {
+				best = len;
+				*rdist = pos - cand;
+
+				if (len >= stream->nice_len)
+					break;
+			}
+		}
+
+		size_t next = stream->prev[cand & WINDOW_MASK];
+		if (next >= cand)
+			break;
+
+		cand = next;
+		chain--;
+	}
+
+	return best;
+}
+
+/** Record a symbol of the current block
+ *
+ * @param stream Deflate stream.
+ * @param len    Literal or match length.
+ * @param dist   Match distance (zero for literals).
+ *
+ */
+static inline void record_symbol(deflate_stream_t *stream, size_t len,
+    size_t dist)
+{
+	stream->sym_len[stream->sym_count] = len;
+	stream->sym_dist[stream->sym_count] = dist;
+	stream->sym_count++;
+
+	if (dist == 0) {
+		stream->len_freq[len]++;
+	} else {
+		stream->len_freq[257 + stream->len_symbol[len]]++;
+		stream->dist_freq[dist_symbol(stream, dist)]++;
+	}
+}
+
+/** Compress the data in the window
+ *
+ * @param stream Deflate stream.
+ * @param flush  Compress all the data (no more input will follow).
+ *
+ * @return True if a block has been emitted.
+ *
+ */
+static bool deflate_compress(deflate_stream_t *stream, bool flush)
+{
+	while ((stream->lookahead >= MIN_LOOKAHEAD) ||
+	    ((flush) && (stream->lookahead > 0))) {
+		size_t pos = stream->strstart;
+		size_t len = 0;
+		size_t dist = 0;
+
+		if (stream->lookahead >= MIN_MATCH) {
+			size_t hash = hash3(stream->window + pos);
+
+			if (stream->max_chain > 0)
+				len = longest_match(stream, hash, &dist);
+
+			insert_pos(stream, pos, hash);
+		}
+
+		if ((len >= MIN_MATCH) &&
+		    ((len > MIN_MATCH) || (dist <= TOO_FAR))) {
+			record_symbol(stream, len, dist);
+
+			/* Insert the positions covered by the match */
+			for (size_t i = 1; (i < len) &&
+			    (stream->lookahead - i >= MIN_MATCH); i++)
+				insert_pos(stream, pos + i,
+				    hash3(stream->window + pos + i));
+
+			stream->strstart += len;
+			stream->lookahead -= len;
+		} else {
+			record_symbol(stream, stream->window[pos], 0);
+			stream->strstart++;
+			stream->lookahead--;
+		}
+
+		if (stream->sym_count == MAX_SYMBOLS) {
+			deflate_block(stream, false);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Slide the window
+ *
+ * Move the upper half of the window buffer to the lower half
+ * and update the hash chains.
+ *
+ * @param stream Deflate stream.
+ *
+ */
+static void deflate_slide(deflate_stream_t *stream)
+{
+	assert(stream->block_start >= WINDOW_SIZE);
+	assert(stream->strstart >= WINDOW_SIZE);
+
+	memcpy(stream->window, stream->window + WINDOW_SIZE, WINDOW_SIZE);
+	stream->strstart -= WINDOW_SIZE;
+	stream->block_start -= WINDOW_SIZE;
+
+	for (size_t i = 0; i < HASH_SIZE; i++) {
+		stream->head[i] = (stream->head[i] >= WINDOW_SIZE) ?
+		    stream->head[i] - WINDOW_SIZE : NIL;
+	}
+
+	for (size_t i = 0; i < WINDOW_SIZE; i++) {
+		stream->prev[i] = (stream->prev[i] >= WINDOW_SIZE) ?
+		    stream->prev[i] - WINDOW_SIZE : NIL;
+	}
+}
+
+/** Create deflate stream
+ *
+ * @param level   Compression level (0 to DEFLATE_MAX_LEVEL, level 0
+ *                stores the data without compression).
+ * @param rstream Place to store pointer to the new stream.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t deflate_stream_create(unsigned int level, deflate_stream_t **rstream)
+{
+	if (level > DEFLATE_MAX_LEVEL)
+		return EINVAL;
+
+	deflate_stream_t *stream = calloc(1, sizeof(deflate_stream_t));
+	if (stream == NULL)
+		return ENOMEM;
+
+	stream->max_chain = levels[level].max_chain;
+	stream->nice_len = levels[level].nice_len;
+
+	/* Build the length and distance symbol lookup tables */
+	size_t symbol;
+	for (symbol = 0; symbol < MAX_LEN; symbol++) {
+		for (size_t i = 0; i < (1U << lens_ext[symbol]); i++) {
+			if (lens[symbol] + i <= MAX_MATCH)
+				stream->len_symbol[lens[symbol] + i] = symbol;
+		}
+	}
+
+	for (symbol = 0; symbol < MAX_DIST; symbol++) {
+		for (size_t i = 0; i < (1U << dists_ext[symbol]); i++) {
+			size_t dist = dists[symbol] - 1 + i;
+
+			if (dist < 256)
+				stream->dist_symbol[dist] = symbol;
+			else
+				stream->dist_symbol[256 + (dist >> 7)] = symbol;
+		}
+	}
+
+	/* Construct the fixed codes */
+	for (symbol = 0; symbol < 144; symbol++)
+		stream->fixed_len.length[symbol] = 8;
+	for (; symbol < 256; symbol++)
+		stream->fixed_len.length[symbol] = 9;
+	for (; symbol < 280; symbol++)
+		stream->fixed_len.length[symbol] = 7;
+	for (; symbol < MAX_FIXED_LITLEN; symbol++)
+		stream->fixed_len.length[symbol] = 8;
+
+	huffman_codes(&stream->fixed_len, MAX_FIXED_LITLEN);
+
+	for (symbol = 0; symbol < MAX_DIST; symbol++)
+		stream->fixed_dist.length[symbol] = 5;
+
+	huffman_codes(&stream->fixed_dist, MAX_DIST);
+
+	*rstream = stream;
+	return EOK;
+}
+
+/** Destroy deflate stream
+ *
+ * @param stream Deflate stream.
+ *
+ */
+void deflate_stream_destroy(deflate_stream_t *stream)
+{
+	free(stream);
+}
+
+/** Compress a chunk of data
+ *
+ * Consume as much of the input chunk and produce as much of the
+ * output as possible. The function returns when the input chunk
+ * has been exhausted or the output buffer is full.
+ *
+ * If @a finish is true, the input chunk is the last one. In that
+ * case the caller should keep calling the function (with the rest
+ * of the input chunk, if any) until deflate_stream_done() returns
+ * true.
+ *
+ * @param stream   Deflate stream.
+ * @param src      Source data buffer.
+ * @param srclen   Source buffer size (bytes).
+ * @param srcused  Place to store the number of bytes consumed.
+ * @param dest     Destination data buffer.
+ * @param destlen  Destination buffer size (bytes).
+ * @param destused Place to store the number of bytes produced.
+ * @param finish   This is the last input chunk.
+ *
+ * @return EOK on success.
+ *
+ */
+errno_t deflate_stream_encode(deflate_stream_t *stream, const void *src,
+    size_t srclen, size_t *srcused, void *dest, size_t destlen,
+    size_t *destused, bool finish)
+{
+	size_t srccnt = 0;
+	size_t destcnt = 0;
+
+	while (true) {
+		/* Drain the pending output */
+		size_t cnt = min(stream->pending_len - stream->pending_out,
+		    destlen - destcnt);
+
+		memcpy((uint8_t *) dest + destcnt,
+		    stream->pending + stream->pending_out, cnt);
+		stream->pending_out += cnt;
+		destcnt += cnt;
+
+		if (stream->pending_out < stream->pending_len)
+			break;
+
+		stream->pending_out = 0;
+		stream->pending_len = 0;
+
+		if (stream->finished)
+			break;
+
+		/* Slide the window if needed (the block must not span it) */
+		if (stream->strstart >= 2 * WINDOW_SIZE - MIN_LOOKAHEAD) {
+			if (stream->block_start < stream->strstart) {
+				deflate_block(stream, false);
+				continue;
+			}
+
+			deflate_slide(stream);
+		}
+
+		/* Fill the window */
+		size_t end = stream->strstart + stream->lookahead;
+		cnt = min(srclen - srccnt, 2 * WINDOW_SIZE - end);
+
+		memcpy(stream->window + end, (const uint8_t *) src + srccnt,
+		    cnt);
+		srccnt += cnt;
+		stream->lookahead += cnt;
+
+		bool flush = (finish) && (srccnt == srclen);
+		if (deflate_compress(stream, flush))
+			continue;
+
+		if (!flush) {
+			/* Need more input (or sliding the window) */
+			if (srccnt == srclen)
+				break;
+
+			continue;
+		}
+
+		/* Emit the last block */
+		deflate_block(stream, true);
+		put_align(stream);
+		stream->finished = true;
+	}
+
+	*srcused = srccnt;
+	*destused = destcnt;
+	return EOK;
+}
+
+/** Check for the end of the deflate stream
+ *
+ * @param stream Deflate stream.
+ *
+ * @return True if the last block has been emitted and all
+ *         the compressed data have been drained.
+ *
+ */
+bool deflate_stream_done(deflate_stream_t *stream)
+{
+	return (stream->finished) &&
+	    (stream->pending_out == stream->pending_len);
+}
+
+/** Deflate data
+ *
+ * @param src      Source data buffer.
+ * @param srclen   Source buffer size (bytes).
+ * @param dest     Destination data buffer.
+ * @param destlen  Destination buffer size (bytes).
+ * @param destused Place to store the size of the compressed data (bytes).
+ * @param level    Compression level.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM on output buffer overrun or if out of memory.
+ *
+ */
+errno_t deflate(void *src, size_t srclen, void *dest, size_t destlen,
+    size_t *destused, unsigned int level)
+{
+	deflate_stream_t *stream;
+	size_t srcused;
+
+	errno_t rc = deflate_stream_create(level, &stream);
+	if (rc != EOK)
+		return rc;
+
+	rc = deflate_stream_encode(stream, src, srclen, &srcused, dest,
+	    destlen, destused, true);
+	if ((rc == EOK) && (!deflate_stream_done(stream)))
+		rc = ENOMEM;
+
+	deflate_stream_destroy(stream);
+	return rc;
+}
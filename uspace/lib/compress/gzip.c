@@ -26,12 +26,16 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <adt/checksum.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <errno.h>
+#include <macros.h>
 #include <mem.h>
 #include <byteorder.h>
 #include <stdlib.h>
+#include "deflate.h"
 #include "gzip.h"
 #include "inflate.h"
 
@@ -46,6 +50,11 @@
 #define GZIP_FLAG_FNAME     UINT8_C(1 << 3)
 #define GZIP_FLAG_FCOMMENT  UINT8_C(1 << 4)
 
+#define GZIP_XFL_MAX   UINT8_C(2)
+#define GZIP_XFL_FAST  UINT8_C(4)
+
+#define GZIP_OS_UNKNOWN  UINT8_C(255)
+
 typedef struct {
 	uint8_t id1;
 	uint8_t id2;
@@ -61,6 +70,62 @@ typedef struct {
 	uint32_t size;
 } __attribute__((packed)) gzip_footer_t;
 
+/** GZIP decoder states
+ *
+ */
+typedef enum {
+	/** Fixed header */
+	GZIP_DEC_HEADER,
+	/** Length of the extra field */
+	GZIP_DEC_EXTRA_LEN,
+	/** Extra field */
+	GZIP_DEC_EXTRA,
+	/** Original file name */
+	GZIP_DEC_NAME,
+	/** Comment */
+	GZIP_DEC_COMMENT,
+	/** Header CRC */
+	GZIP_DEC_HCRC,
+	/** Compressed data */
+	GZIP_DEC_DATA,
+	/** Footer */
+	GZIP_DEC_FOOTER,
+	/** End of the stream */
+	GZIP_DEC_DONE
+} gzip_dec_state_t;
+
+/** GZIP streaming decoder
+ *
+ */
+struct gzip_dec {
+	gzip_dec_state_t state;   /**< Decoder state */
+	inflate_stream_t *inflate; /**< Inflate stream */
+
+	gzip_header_t header;     /**< Decoded header */
+	gzip_footer_t footer;     /**< Decoded footer */
+	uint8_t buf[sizeof(gzip_header_t)];  /**< Partially received field */
+	size_t bufcnt;            /**< Number of bytes in the field buffer */
+	size_t skip;              /**< Number of bytes to skip */
+
+	uint32_t crc32;           /**< CRC of the decompressed data */
+	uint32_t size;            /**< Size of the decompressed data */
+};
+
+/** GZIP streaming encoder
+ *
+ */
+struct gzip_enc {
+	deflate_stream_t *deflate; /**< Deflate stream */
+
+	uint8_t buf[sizeof(gzip_header_t)];  /**< Pending header or footer */
+	size_t bufout;            /**< Position in the pending buffer */
+	size_t buflen;            /**< Size of the pending buffer */
+	bool footer;              /**< Footer has been emitted */
+
+	uint32_t crc32;           /**< CRC of the uncompressed data */
+	uint32_t size;            /**< Size of the uncompressed data */
+};
+
 /** Expand GZIP compressed data
  *
  * The routine allocates the output buffer based
@@ -175,9 +240,417 @@ errno_t gzip_expand(void *src, size_t srclen, void **dest, size_t *destlen)
 
 	errno_t ret = inflate(stream, stream_length, *dest, *destlen);
 	if (ret != EOK) {
-		free(dest);
+		free(*dest);
 		return ret;
 	}
 
 	return EOK;
 }
+
+/** Create GZIP streaming decoder
+ *
+ * Only a single GZIP member is decoded, any data following
+ * the footer of the first member is not consumed.
+ *
+ * @param rdec Place to store pointer to the new decoder.
+ *
+ * @return EOK on success.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t gzip_dec_create(gzip_dec_t **rdec)
+{
+	gzip_dec_t *dec = calloc(1, sizeof(gzip_dec_t));
+	if (dec == NULL)
+		return ENOMEM;
+
+	errno_t rc = inflate_stream_create(&dec->inflate);
+	if (rc != EOK) {
+		free(dec);
+		return rc;
+	}
+
+	dec->state = GZIP_DEC_HEADER;
+	*rdec = dec;
+	return EOK;
+}
+
+/** Destroy GZIP streaming decoder
+ *
+ * @param dec GZIP decoder.
+ *
+ */
+void gzip_dec_destroy(gzip_dec_t *dec)
+{
+	if (dec == NULL)
+		return;
+
+	inflate_stream_destroy(dec->inflate);
+	free(dec);
+}
+
+/** Collect a fixed-size field
+ *
+ * @param dec    GZIP decoder.
+ * @param src    Source data buffer.
+ * @param srclen Source buffer size (bytes).
+ * @param srccnt Position in the source buffer (updated).
+ * @param size   Size of the field.
+ *
+ * @return True if the field is complete.
+ *
+ */
+static bool gzip_dec_field(gzip_dec_t *dec, const uint8_t *src,
+    size_t srclen, size_t *srccnt, size_t size)
+{
+	size_t cnt = min(size - dec->bufcnt, srclen - *srccnt);
+
+	memcpy(dec->buf + dec->bufcnt, src + *srccnt, cnt);
+	dec->bufcnt += cnt;
+	*srccnt += cnt;
+
+	if (dec->bufcnt < size)
+		return false;
+
+	dec->bufcnt = 0;
+	return true;
+}
+
+/** Skip a zero-terminated field
+ *
+ * @param src    Source data buffer.
+ * @param srclen Source buffer size (bytes).
+ * @param srccnt Position in the source buffer (updated).
+ *
+ * @return True if the terminating zero has been skipped.
+ *
+ */
+static bool gzip_dec_string(const uint8_t *src, size_t srclen,
+    size_t *srccnt)
+{
+	while (*srccnt < srclen) {
+		uint8_t c = src[*srccnt];
+		(*srccnt)++;
+
+		if (c == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/** Get the next header state
+ *
+ * @param dec   GZIP decoder.
+ * @param state Current header state.
+ *
+ * @return Next state according to the header flags.
+ *
+ */
+static gzip_dec_state_t gzip_dec_next(gzip_dec_t *dec,
+    gzip_dec_state_t state)
+{
+	switch (state) {
+	case GZIP_DEC_HEADER:
+		if ((dec->header.flags & GZIP_FLAG_FEXTRA) != 0)
+			return GZIP_DEC_EXTRA_LEN;
+		/* Fallthrough */
+	case GZIP_DEC_EXTRA_LEN:
+	case GZIP_DEC_EXTRA:
+		if ((dec->header.flags & GZIP_FLAG_FNAME) != 0)
+			return GZIP_DEC_NAME;
+		/* Fallthrough */
+	case GZIP_DEC_NAME:
+		if ((dec->header.flags & GZIP_FLAG_FCOMMENT) != 0)
+			return GZIP_DEC_COMMENT;
+		/* Fallthrough */
+	case GZIP_DEC_COMMENT:
+		if ((dec->header.flags & GZIP_FLAG_FHCRC) != 0)
+			return GZIP_DEC_HCRC;
+		/* Fallthrough */
+	default:
+		return GZIP_DEC_DATA;
+	}
+}
+
+/** Decompress a chunk of GZIP stream
+ *
+ * Consume as much of the input chunk and produce as much of the
+ * output as possible. The function returns when the input chunk
+ * has been exhausted, the output buffer is full or the end of
+ * the stream has been reached.
+ *
+ * @param dec      GZIP decoder.
+ * @param src      Source data buffer.
+ * @param srclen   Source buffer size (bytes).
+ * @param srcused  Place to store the number of bytes consumed.
+ * @param dest     Destination data buffer.
+ * @param destlen  Destination buffer size (bytes).
+ * @param destused Place to store the number of bytes produced.
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code, invalid deflate data,
+ *                   invalid compression method, invalid stream
+ *                   or checksum mismatch.
+ *
+ */
+errno_t gzip_dec_process(gzip_dec_t *dec, const void *src, size_t srclen,
+    size_t *srcused, void *dest, size_t destlen, size_t *destused)
+{
+	const uint8_t *sp = (const uint8_t *) src;
+	size_t srccnt = 0;
+	size_t destcnt = 0;
+	size_t used;
+	size_t produced;
+	errno_t rc = EOK;
+
+	while ((rc == EOK) && (dec->state != GZIP_DEC_DONE)) {
+		if ((srccnt == srclen) && (dec->state != GZIP_DEC_DATA))
+			break;
+
+		switch (dec->state) {
+		case GZIP_DEC_HEADER:
+			if (!gzip_dec_field(dec, sp, srclen, &srccnt,
+			    sizeof(gzip_header_t)))
+				break;
+
+			memcpy(&dec->header, dec->buf, sizeof(gzip_header_t));
+
+			if ((dec->header.id1 != GZIP_ID1) ||
+			    (dec->header.id2 != GZIP_ID2) ||
+			    (dec->header.method != GZIP_METHOD_DEFLATE) ||
+			    ((dec->header.flags & (~GZIP_FLAGS_MASK)) != 0)) {
+				rc = EINVAL;
+				break;
+			}
+
+			dec->state = gzip_dec_next(dec, dec->state);
+			break;
+		case GZIP_DEC_EXTRA_LEN:
+			if (!gzip_dec_field(dec, sp, srclen, &srccnt, 2))
+				break;
+
+			dec->skip = dec->buf[0] | (dec->buf[1] << 8);
+			dec->state = GZIP_DEC_EXTRA;
+			break;
+		case GZIP_DEC_EXTRA:
+			if (dec->skip > 0) {
+				size_t cnt = min(dec->skip, srclen - srccnt);
+				srccnt += cnt;
+				dec->skip -= cnt;
+				break;
+			}
+
+			dec->state = gzip_dec_next(dec, dec->state);
+			break;
+		case GZIP_DEC_NAME:
+		case GZIP_DEC_COMMENT:
+			if (gzip_dec_string(sp, srclen, &srccnt))
+				dec->state = gzip_dec_next(dec, dec->state);
+			break;
+		case GZIP_DEC_HCRC:
+			if (gzip_dec_field(dec, sp, srclen, &srccnt, 2))
+				dec->state = GZIP_DEC_DATA;
+			break;
+		case GZIP_DEC_DATA:
+			rc = inflate_stream_decode(dec->inflate, sp + srccnt,
+			    srclen - srccnt, &used, (uint8_t *) dest + destcnt,
+			    destlen - destcnt, &produced);
+
+			dec->crc32 = compute_crc32_seed((uint8_t *) dest + destcnt,
+			    produced, dec->crc32);
+			dec->size += produced;
+			srccnt += used;
+			destcnt += produced;
+
+			if (rc != EOK)
+				break;
+
+			if (inflate_stream_done(dec->inflate)) {
+				dec->state = GZIP_DEC_FOOTER;
+				break;
+			}
+
+			/* Input exhausted or output buffer full */
+			*srcused = srccnt;
+			*destused = destcnt;
+			return EOK;
+		case GZIP_DEC_FOOTER:
+			if (!gzip_dec_field(dec, sp, srclen, &srccnt,
+			    sizeof(gzip_footer_t)))
+				break;
+
+			memcpy(&dec->footer, dec->buf, sizeof(gzip_footer_t));
+
+			if ((uint32_t_le2host(dec->footer.crc32) != dec->crc32) ||
+			    (uint32_t_le2host(dec->footer.size) != dec->size)) {
+				rc = EINVAL;
+				break;
+			}
+
+			dec->state = GZIP_DEC_DONE;
+			break;
+		case GZIP_DEC_DONE:
+			break;
+		}
+	}
+
+	*srcused = srccnt;
+	*destused = destcnt;
+	return rc;
+}
+
+/** Check for the end of GZIP stream
+ *
+ * @param dec GZIP decoder.
+ *
+ * @return True if the whole stream has been decompressed and
+ *         the checksum has been verified.
+ *
+ */
+bool gzip_dec_done(gzip_dec_t *dec)
+{
+	return dec->state == GZIP_DEC_DONE;
+}
+
+/** Create GZIP streaming encoder
+ *
+ * @param level Compression level (0 to DEFLATE_MAX_LEVEL).
+ * @param renc  Place to store pointer to the new encoder.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t gzip_enc_create(unsigned int level, gzip_enc_t **renc)
+{
+	gzip_enc_t *enc = calloc(1, sizeof(gzip_enc_t));
+	if (enc == NULL)
+		return ENOMEM;
+
+	errno_t rc = deflate_stream_create(level, &enc->deflate);
+	if (rc != EOK) {
+		free(enc);
+		return rc;
+	}
+
+	gzip_header_t header;
+
+	header.id1 = GZIP_ID1;
+	header.id2 = GZIP_ID2;
+	header.method = GZIP_METHOD_DEFLATE;
+	header.flags = 0;
+	header.mtime = 0;
+	header.extra_flags = (level == DEFLATE_MAX_LEVEL) ? GZIP_XFL_MAX :
+	    ((level <= 1) ? GZIP_XFL_FAST : 0);
+	header.os = GZIP_OS_UNKNOWN;
+
+	memcpy(enc->buf, &header, sizeof(header));
+	enc->buflen = sizeof(header);
+
+	*renc = enc;
+	return EOK;
+}
+
+/** Destroy GZIP streaming encoder
+ *
+ * @param enc GZIP encoder.
+ *
+ */
+void gzip_enc_destroy(gzip_enc_t *enc)
+{
+	if (enc == NULL)
+		return;
+
+	deflate_stream_destroy(enc->deflate);
+	free(enc);
+}
+
+/** Compress a chunk of data into GZIP stream
+ *
+ * Consume as much of the input chunk and produce as much of the
+ * output as possible. If @a finish is true, the input chunk is the
+ * last one and the caller should keep calling the function until
+ * gzip_enc_done() returns true.
+ *
+ * @param enc      GZIP encoder.
+ * @param src      Source data buffer.
+ * @param srclen   Source buffer size (bytes).
+ * @param srcused  Place to store the number of bytes consumed.
+ * @param dest     Destination data buffer.
+ * @param destlen  Destination buffer size (bytes).
+ * @param destused Place to store the number of bytes produced.
+ * @param finish   This is the last input chunk.
+ *
+ * @return EOK on success.
+ *
+ */
+errno_t gzip_enc_process(gzip_enc_t *enc, const void *src, size_t srclen,
+    size_t *srcused, void *dest, size_t destlen, size_t *destused,
+    bool finish)
+{
+	uint8_t *dp = (uint8_t *) dest;
+	size_t srccnt = 0;
+	size_t destcnt = 0;
+	errno_t rc = EOK;
+
+	while (true) {
+		/* Drain the pending header or footer */
+		size_t cnt = min(enc->buflen - enc->bufout, destlen - destcnt);
+
+		memcpy(dp + destcnt, enc->buf + enc->bufout, cnt);
+		enc->bufout += cnt;
+		destcnt += cnt;
+
+		if ((enc->bufout < enc->buflen) || (enc->footer))
+			break;
+
+		size_t used;
+		size_t produced;
+
+		rc = deflate_stream_encode(enc->deflate,
+		    (const uint8_t *) src + srccnt, srclen - srccnt, &used,
+		    dp + destcnt, destlen - destcnt, &produced, finish);
+		if (rc != EOK)
+			break;
+
+		enc->crc32 = compute_crc32_seed((uint8_t *) src + srccnt, used,
+		    enc->crc32);
+		enc->size += used;
+		srccnt += used;
+		destcnt += produced;
+
+		if (!deflate_stream_done(enc->deflate))
+			break;
+
+		/* Emit the footer */
+		gzip_footer_t footer;
+
+		footer.crc32 = host2uint32_t_le(enc->crc32);
+		footer.size = host2uint32_t_le(enc->size);
+
+		memcpy(enc->buf, &footer, sizeof(footer));
+		enc->bufout = 0;
+		enc->buflen = sizeof(footer);
+		enc->footer = true;
+	}
+
+	*srcused = srccnt;
+	*destused = destcnt;
+	return rc;
+}
+
+/** Check for the end of GZIP stream
+ *
+ * @param enc GZIP encoder.
+ *
+ * @return True if the whole stream including the footer has
+ *         been produced.
+ *
+ */
+bool gzip_enc_done(gzip_enc_t *enc)
+{
+	return (enc->footer) && (enc->bufout == enc->buflen);
+}
@@ -29,8 +29,28 @@
 #ifndef LIBCOMPRESS_GZIP_H_
 #define LIBCOMPRESS_GZIP_H_
 
+#include <errno.h>
+#include <stdbool.h>
 #include <stddef.h>
 
+/** GZIP streaming decoder (opaque) */
+typedef struct gzip_dec gzip_dec_t;
+
+/** GZIP streaming encoder (opaque) */
+typedef struct gzip_enc gzip_enc_t;
+
 extern errno_t gzip_expand(void *, size_t, void **, size_t *);
 
+extern errno_t gzip_dec_create(gzip_dec_t **);
+extern void gzip_dec_destroy(gzip_dec_t *);
+extern errno_t gzip_dec_process(gzip_dec_t *, const void *, size_t, size_t *,
+    void *, size_t, size_t *);
+extern bool gzip_dec_done(gzip_dec_t *);
+
+extern errno_t gzip_enc_create(unsigned int, gzip_enc_t **);
+extern void gzip_enc_destroy(gzip_enc_t *);
+extern errno_t gzip_enc_process(gzip_enc_t *, const void *, size_t, size_t *,
+    void *, size_t, size_t *, bool);
+extern bool gzip_enc_done(gzip_enc_t *);
+
 #endif
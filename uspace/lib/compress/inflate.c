@@ -30,12 +30,18 @@
 /** @file
  * @brief Implementation of inflate decompression
  *
- * A simple inflate implementation (decompression of `deflate' stream as
- * described by RFC 1951) based on puff.c by Mark Adler. This code is
- * currently not optimized for speed but for readability.
+ * An inflate implementation (decompression of `deflate' stream as
+ * described by RFC 1951) originally based on puff.c by Mark Adler.
  *
- * All dynamically allocated memory memory is taken from the stack. The
- * stack usage should be typically bounded by 2 KB.
+ * The decoder is a resumable state machine. The caller feeds the
+ * compressed input in arbitrarily sized chunks and drains the
+ * decompressed output into arbitrarily sized buffers, thus the memory
+ * usage is bounded by the size of the inflate stream structure (which
+ * holds the 64 KB sliding window) regardless of the size of the data.
+ *
+ * Huffman codes are decoded using a lookup table indexed by the next
+ * FAST_BITS bits of the input. Only the codes longer than FAST_BITS
+ * (which are rare in practice) are decoded bit-by-bit.
  *
  * Original copyright notice:
  *
@@ -63,10 +69,14 @@
  *
  */
 
+
+#include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <errno.h>
+#include <macros.h>
 #include <mem.h>
 #include "inflate.h"
 
@@ -85,41 +95,128 @@
 #define MAX_FIXED_LITLEN  288
 
 /** Number of all codes */
-#define MAX_CODE  (MAX_LITLEN + MAX_DIST)
+#define MAX_CODE  (MAX_FIXED_LITLEN + MAX_DIST)
+
+/** End-of-block symbol */
+#define END_OF_BLOCK  256
 
-/** Check for input buffer overrun condition */
-#define CHECK_OVERRUN(state) \
-	do { \
-		if ((state).overrun) \
-			return ELIMIT; \
-	} while (false)
+/** Maximum distance of a back reference */
+#define MAX_BACKREF  32768
 
-/** Inflate algorithm state
+/** Size of the sliding window
+ *
+ * The window holds both the history needed for resolving the
+ * back references and the decompressed data which has not been
+ * drained by the caller yet. Must be a power of two and at least
+ * twice the maximum back reference distance.
  *
  */
-typedef struct {
-	uint8_t *dest;    /**< Output buffer */
-	size_t destlen;   /**< Output buffer size */
-	size_t destcnt;   /**< Position in the output buffer */
+#define WINDOW_SIZE  65536
+#define WINDOW_MASK  (WINDOW_SIZE - 1)
 
-	uint8_t *src;     /**< Input buffer */
-	size_t srclen;    /**< Input buffer size */
-	size_t srccnt;    /**< Position in the input buffer */
-
-	uint16_t bitbuf;  /**< Bit buffer */
-	size_t bitlen;    /**< Number of bits in the bit buffer */
-
-	bool overrun;     /**< Overrun condition */
-} inflate_state_t;
+/** Number of bits used for indexing the fast decoding table */
+#define FAST_BITS   9
+#define FAST_SIZE   (1 << FAST_BITS)
+#define FAST_SHIFT  12
+#define FAST_MASK   ((1 << FAST_SHIFT) - 1)
 
 /** Huffman code description
  *
  */
 typedef struct {
-	uint16_t *count;   /**< Array of symbol counts */
-	uint16_t *symbol;  /**< Array of symbols */
+	/** Array of symbol counts */
+	uint16_t count[MAX_HUFFMAN_BIT + 1];
+
+	/** Array of symbols */
+	uint16_t symbol[MAX_FIXED_LITLEN];
+
+	/** Fast decoding table
+	 *
+	 * Each entry is indexed by the next FAST_BITS input bits and
+	 * contains the code length shifted by FAST_SHIFT combined with
+	 * the decoded symbol. Zero entries denote codes longer than
+	 * FAST_BITS (or invalid codes).
+	 *
+	 */
+	uint16_t fast[FAST_SIZE];
 } huffman_t;
 
+/** Inflate decoder states
+ *
+ */
+typedef enum {
+	/** Block header */
+	INFLATE_HEADER,
+	/** Stored block length and its complement */
+	INFLATE_STORED,
+	/** Stored block data */
+	INFLATE_COPY,
+	/** Dynamic block table sizes */
+	INFLATE_TABLE,
+	/** Code length code lengths */
+	INFLATE_LENLENS,
+	/** Literal/length and distance code lengths */
+	INFLATE_CODELENS,
+	/** Repeated code lengths */
+	INFLATE_REPEAT,
+	/** Literal/length symbol */
+	INFLATE_LEN,
+	/** Extra bits of the length */
+	INFLATE_LENEXT,
+	/** Distance symbol */
+	INFLATE_DIST,
+	/** Extra bits of the distance */
+	INFLATE_DISTEXT,
+	/** Copying the back reference */
+	INFLATE_MATCH,
+	/** End of the last block */
+	INFLATE_DONE
+} inflate_mode_t;
+
+/** Inflate stream
+ *
+ */
+struct inflate_stream {
+	inflate_mode_t mode;  /**< Decoder state */
+	bool last;            /**< Decoding the last block */
+	errno_t error;        /**< Sticky error */
+
+	const uint8_t *src;   /**< Current input chunk */
+	size_t srclen;        /**< Current input chunk size */
+	size_t srccnt;        /**< Position in the current input chunk */
+
+	uint64_t bitbuf;      /**< Bit buffer */
+	unsigned int bitlen;  /**< Number of bits in the bit buffer */
+
+	uint64_t wpos;        /**< Number of decompressed bytes */
+	uint64_t rpos;        /**< Number of drained bytes */
+
+	size_t length;        /**< Remaining stored or back reference length */
+	size_t dist;          /**< Back reference distance */
+	uint16_t symbol;      /**< Symbol awaiting extra bits */
+
+	uint16_t nlen;        /**< Number of literal/length code lengths */
+	uint16_t ndist;       /**< Number of distance code lengths */
+	uint16_t ncode;       /**< Number of code length code lengths */
+	uint16_t index;       /**< Index of the next code length */
+
+	/** Code lengths of the dynamic block */
+	uint16_t lengths[MAX_CODE];
+
+	/** Huffman code for literal/length of the current block */
+	const huffman_t *len_code;
+	/** Huffman code for distance of the current block */
+	const huffman_t *dist_code;
+
+	huffman_t fixed_len;  /**< Fixed literal/length code */
+	huffman_t fixed_dist; /**< Fixed distance code */
+	huffman_t dyn_len;    /**< Dynamic literal/length code */
+	huffman_t dyn_dist;   /**< Dynamic distance code */
+
+	/** Sliding window */
+	uint8_t window[WINDOW_SIZE];
+};
+
 /** Length codes
  *
  */
@@ -161,197 +258,74 @@ static const short order[MAX_ORDER] = {
 	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
 };
 
-/** Static length symbol counts
- *
- */
-static uint16_t len_count[MAX_HUFFMAN_BIT + 1] = {
-	0, 0, 0, 0, 0, 0, 0, 24, 152, 112, 0, 0, 0, 0, 0, 0
-};
-
-/** Static length symbols
+/** Make sure the bit buffer contains at least the given number of bits
  *
- */
-static uint16_t len_symbol[MAX_FIXED_LITLEN] = {
-	256, 257, 258, 259, 260, 261, 262, 263, 264, 265, 266, 267, 268,
-	269, 270, 271, 272, 273, 274, 275, 276, 277, 278, 279, 0, 1, 2,
-	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
-	21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
-	37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52,
-	53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68,
-	69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84,
-	85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100,
-	101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113,
-	114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126,
-	127, 128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139,
-	140, 141, 142, 143, 280, 281, 282, 283, 284, 285, 286, 287, 144,
-	145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157,
-	158, 159, 160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170,
-	171, 172, 173, 174, 175, 176, 177, 178, 179, 180, 181, 182, 183,
-	184, 185, 186, 187, 188, 189, 190, 191, 192, 193, 194, 195, 196,
-	197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207, 208, 209,
-	210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222,
-	223, 224, 225, 226, 227, 228, 229, 230, 231, 232, 233, 234, 235,
-	236, 237, 238, 239, 240, 241, 242, 243, 244, 245, 246, 247, 248,
-	249, 250, 251, 252, 253, 254, 255
-};
-
-/** Static distance symbol counts
+ * Only the input bytes which are actually needed are moved into
+ * the bit buffer, thus at most 7 bits remain in the bit buffer
+ * after the requested bits are consumed.
  *
- */
-static uint16_t dist_count[MAX_HUFFMAN_BIT + 1] = {
-	0, 0, 0, 0, 0, 30, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
-
-/** Static distance symbols
+ * @param stream Inflate stream.
+ * @param cnt    Number of bits needed (at most 32).
  *
- */
-static uint16_t dist_symbol[MAX_DIST] = {
-	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
-	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29
-};
-
-/** Huffman code for lengths
+ * @return True if the bits are available.
+ * @return False if the input chunk has been exhausted.
  *
  */
-static huffman_t len_code = {
-	.count = len_count,
-	.symbol = len_symbol
-};
-
-/** Huffman code for distances
- *
- */
-static huffman_t dist_code = {
-	.count = dist_count,
-	.symbol = dist_symbol
-};
-
-/** Get bits from the bit buffer
- *
- * @param state Inflate state.
- * @param cnt   Number of bits to return (at most 16).
- *
- * @return Returned bits.
- *
- */
-static inline uint16_t get_bits(inflate_state_t *state, size_t cnt)
+static inline bool need_bits(inflate_stream_t *stream, unsigned int cnt)
 {
-	/* Bit accumulator for at least 20 bits */
-	uint32_t val = state->bitbuf;
-
-	while (state->bitlen < cnt) {
-		if (state->srccnt == state->srclen) {
-			state->overrun = true;
-			return 0;
-		}
-
-		/* Load 8 more bits */
-		val |= ((uint32_t) state->src[state->srccnt]) << state->bitlen;
-		state->srccnt++;
-		state->bitlen += 8;
+	while (stream->bitlen < cnt) {
+		if (stream->srccnt == stream->srclen)
+			return false;
+
+		stream->bitbuf |=
+		    ((uint64_t) stream->src[stream->srccnt]) << stream->bitlen;
+		stream->srccnt++;
+		stream->bitlen += 8;
 	}
 
-	/* Update bits in the buffer */
-	state->bitbuf = (uint16_t) (val >> cnt);
-	state->bitlen -= cnt;
-
-	return ((uint16_t) (val & ((1 << cnt) - 1)));
+	return true;
 }
 
-/** Decode `stored' block
+/** Get bits from the bit buffer
  *
- * @param state Inflate state.
+ * The bits must have been made available by need_bits().
  *
- * @return EOK on success.
- * @return ELIMIT on input buffer overrun.
- * @return ENOMEM on output buffer overrun.
- * @return EINVAL on invalid data.
+ * @param stream Inflate stream.
+ * @param cnt    Number of bits to return (at most 32).
+ *
+ * @return Returned bits.
  *
  */
-static errno_t inflate_stored(inflate_state_t *state)
+static inline uint32_t get_bits(inflate_stream_t *stream, unsigned int cnt)
 {
-	/* Discard bits in the bit buffer */
-	state->bitbuf = 0;
-	state->bitlen = 0;
-
-	if (state->srccnt + 4 > state->srclen)
-		return ELIMIT;
-
-	uint16_t len =
-	    state->src[state->srccnt] | (state->src[state->srccnt + 1] << 8);
-	uint16_t len_compl =
-	    state->src[state->srccnt + 2] | (state->src[state->srccnt + 3] << 8);
-
-	/* Check block length and its complement */
-	if (((int16_t) len) != ~((int16_t) len_compl))
-		return EINVAL;
-
-	state->srccnt += 4;
+	assert(stream->bitlen >= cnt);
 
-	/* Check input buffer size */
-	if (state->srccnt + len > state->srclen)
-		return ELIMIT;
+	uint32_t val = (uint32_t) (stream->bitbuf & ((UINT64_C(1) << cnt) - 1));
+	stream->bitbuf >>= cnt;
+	stream->bitlen -= cnt;
 
-	/* Check output buffer size */
-	if (state->destcnt + len > state->destlen)
-		return ENOMEM;
-
-	/* Copy data */
-	memcpy(state->dest + state->destcnt, state->src + state->srccnt, len);
-	state->srccnt += len;
-	state->destcnt += len;
-
-	return EOK;
+	return val;
 }
 
-/** Decode a symbol using the Huffman code
+/** Reverse the order of bits in a code
  *
- * @param state   Inflate state.
- * @param huffman Huffman code.
- * @param symbol  Decoded symbol.
+ * @param code Code to reverse.
+ * @param len  Number of bits in the code.
  *
- * @param EOK on success.
- * @param EINVAL on invalid Huffman code.
+ * @return Reversed code.
  *
  */
-static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
-    uint16_t *symbol)
+static uint16_t reverse_bits(uint16_t code, size_t len)
 {
-	/* Decode bits */
-	uint16_t code = 0;
+	uint16_t rev = 0;
 
-	/* First code of the given length */
-	size_t first = 0;
-
-	/*
-	 * Index of the first code of the given length
-	 * in the symbol table
-	 */
-	size_t index = 0;
-
-	/* Current number of bits in the code */
-	size_t len;
-
-	for (len = 1; len <= MAX_HUFFMAN_BIT; len++) {
-		/* Get next bit */
-		code |= get_bits(state, 1);
-		CHECK_OVERRUN(*state);
-
-		uint16_t count = huffman->count[len];
-		if (code < first + count) {
-			/* Return decoded symbol */
-			*symbol = huffman->symbol[index + code - first];
-			return EOK;
-		}
-
-		/* Update for next length */
-		index += count;
-		first += count;
-		first <<= 1;
-		code <<= 1;
+	while (len > 0) {
+		rev = (rev << 1) | (code & 1);
+		code >>= 1;
+		len--;
 	}
 
-	return EINVAL;
+	return rev;
 }
 
 /** Construct Huffman tables from canonical Huffman code
@@ -365,13 +339,16 @@ static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
  * @return Positive value for an incomplete code set.
  *
  */
-static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
+static int16_t huffman_construct(huffman_t *huffman, const uint16_t *length,
+    size_t n)
 {
 	/* Count number of codes for each length */
 	size_t len;
 	for (len = 0; len <= MAX_HUFFMAN_BIT; len++)
 		huffman->count[len] = 0;
 
+	memset(huffman->fast, 0, sizeof(huffman->fast));
+
 	/* We assume that the lengths are within bounds */
 	size_t symbol;
 	for (symbol = 0; symbol < n; symbol++)
@@ -407,268 +384,655 @@ static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
 		}
 	}
 
+	/*
+	 * Fill in the fast decoding table. The canonical codes are
+	 * assigned in the order of the symbol table. Since the codes
+	 * are stored in the input starting with the most significant
+	 * bit, the table is indexed by the reversed codes and each
+	 * short code occupies all the entries sharing its prefix.
+	 */
+	uint16_t code = 0;
+	size_t index = 0;
+
+	for (len = 1; len <= FAST_BITS; len++) {
+		for (size_t i = 0; i < huffman->count[len]; i++) {
+			uint16_t entry = (len << FAST_SHIFT) |
+			    huffman->symbol[index];
+			uint16_t rev = reverse_bits(code, len);
+
+			for (size_t fill = rev; fill < FAST_SIZE;
+			    fill += 1 << len)
+				huffman->fast[fill] = entry;
+
+			index++;
+			code++;
+		}
+
+		code <<= 1;
+	}
+
 	return left;
 }
 
-/** Decode literal/length and distance codes
+/** Decode a symbol using the Huffman code
  *
- * Decode until end-of-block code.
+ * Input bytes are consumed only if the bits already present in
+ * the bit buffer are not sufficient for decoding the symbol.
  *
- * @param state     Inflate state.
- * @param len_code  Huffman code for literal/length.
- * @param dist_code Huffman code for distance.
+ * @param stream  Inflate stream.
+ * @param huffman Huffman code.
+ * @param symbol  Decoded symbol.
  *
  * @return EOK on success.
- * @return ENOENT on distance too large.
+ * @return ELIMIT if the input chunk has been exhausted.
  * @return EINVAL on invalid Huffman code.
- * @return ELIMIT on input buffer overrun.
- * @return ENOMEM on output buffer overrun.
  *
  */
-static errno_t inflate_codes(inflate_state_t *state, huffman_t *len_code,
-    huffman_t *dist_code)
+static errno_t huffman_decode(inflate_stream_t *stream,
+    const huffman_t *huffman, uint16_t *symbol)
 {
-	uint16_t symbol;
-
-	do {
-		errno_t err = huffman_decode(state, len_code, &symbol);
-		if (err != EOK) {
-			/* Error decoding */
-			return err;
-		}
-
-		if (symbol < 256) {
-			/* Write out literal */
-			if (state->destcnt == state->destlen)
-				return ENOMEM;
+	while (true) {
+		uint16_t entry = huffman->fast[stream->bitbuf & (FAST_SIZE - 1)];
+		unsigned int len = entry >> FAST_SHIFT;
+
+		if (len != 0) {
+			if (len <= stream->bitlen) {
+				/* Fast path */
+				stream->bitbuf >>= len;
+				stream->bitlen -= len;
+				*symbol = entry & FAST_MASK;
+				return EOK;
+			}
+		} else {
+			/* Decode a long code bit-by-bit */
+			uint16_t code = 0;
+			size_t first = 0;
+			size_t index = 0;
+
+			for (len = 1; len <= MAX_HUFFMAN_BIT; len++) {
+				if (len > stream->bitlen)
+					break;
+
+				code |= (stream->bitbuf >> (len - 1)) & 1;
+
+				uint16_t count = huffman->count[len];
+				if (code < first + count) {
+					stream->bitbuf >>= len;
+					stream->bitlen -= len;
+					*symbol = huffman->symbol[index + code - first];
+					return EOK;
+				}
+
+				/* Update for next length */
+				index += count;
+				first += count;
+				first <<= 1;
+				code <<= 1;
+			}
 
-			state->dest[state->destcnt] = (uint8_t) symbol;
-			state->destcnt++;
-		} else if (symbol > 256) {
-			/* Compute length */
-			symbol -= 257;
-			if (symbol >= 29)
+			if (len > MAX_HUFFMAN_BIT)
 				return EINVAL;
+		}
 
-			size_t len = lens[symbol] + get_bits(state, lens_ext[symbol]);
-			CHECK_OVERRUN(*state);
+		/* Load 8 more bits */
+		if (!need_bits(stream, stream->bitlen + 1))
+			return ELIMIT;
+	}
+}
 
-			/* Get distance */
-			err = huffman_decode(state, dist_code, &symbol);
-			if (err != EOK)
-				return err;
+/** Get free space in the sliding window
+ *
+ * @param stream Inflate stream.
+ *
+ * @return Number of bytes which can be decompressed without
+ *         overwriting data which has not been drained yet.
+ *
+ */
+static inline size_t window_space(inflate_stream_t *stream)
+{
+	return WINDOW_SIZE - (size_t) (stream->wpos - stream->rpos);
+}
 
-			size_t dist = dists[symbol] + get_bits(state, dists_ext[symbol]);
-			if (dist > state->destcnt)
-				return ENOENT;
+/** Copy back reference within the sliding window
+ *
+ * @param stream Inflate stream.
+ * @param len    Number of bytes to copy (must fit into the window).
+ *
+ */
+static void window_match(inflate_stream_t *stream, size_t len)
+{
+	size_t to = stream->wpos & WINDOW_MASK;
+	size_t from = (stream->wpos - stream->dist) & WINDOW_MASK;
 
-			if (state->destcnt + len > state->destlen)
-				return ENOMEM;
+	stream->wpos += len;
 
-			while (len > 0) {
-				/* Copy len bytes from distance bytes back */
-				state->dest[state->destcnt] =
-				    state->dest[state->destcnt - dist];
-				state->destcnt++;
-				len--;
-			}
-		}
-	} while (symbol != 256);
+	if ((stream->dist >= len) && (to + len <= WINDOW_SIZE) &&
+	    (from + len <= WINDOW_SIZE)) {
+		/* Non-overlapping copy without wrap-around */
+		memcpy(stream->window + to, stream->window + from, len);
+		return;
+	}
 
-	return EOK;
+	while (len > 0) {
+		stream->window[to] = stream->window[from];
+		to = (to + 1) & WINDOW_MASK;
+		from = (from + 1) & WINDOW_MASK;
+		len--;
+	}
 }
 
-/** Decode `fixed codes' block
+/** Build Huffman codes of the dynamic block
  *
- * @param state     Inflate state.
- * @param len_code  Huffman code for literal/length.
- * @param dist_code Huffman code for distance.
+ * @param stream Inflate stream.
  *
  * @return EOK on success.
- * @return ENOENT on distance too large.
- * @return EINVAL on invalid Huffman code.
- * @return ELIMIT on input buffer overrun.
- * @return ENOMEM on output buffer overrun.
+ * @return EINVAL on invalid code lengths.
  *
  */
-static errno_t inflate_fixed(inflate_state_t *state, huffman_t *len_code,
-    huffman_t *dist_code)
+static errno_t inflate_dynamic_codes(inflate_stream_t *stream)
 {
-	return inflate_codes(state, len_code, dist_code);
+	/* Check for end-of-block code */
+	if (stream->lengths[END_OF_BLOCK] == 0)
+		return EINVAL;
+
+	/* Build Huffman tables for literal/length codes */
+	int16_t rc = huffman_construct(&stream->dyn_len, stream->lengths,
+	    stream->nlen);
+	if ((rc < 0) ||
+	    ((rc > 0) && (stream->dyn_len.count[0] + 1 != stream->nlen)))
+		return EINVAL;
+
+	/* Build Huffman tables for distance codes */
+	rc = huffman_construct(&stream->dyn_dist,
+	    stream->lengths + stream->nlen, stream->ndist);
+	if ((rc < 0) ||
+	    ((rc > 0) && (stream->dyn_dist.count[0] + 1 != stream->ndist)))
+		return EINVAL;
+
+	stream->len_code = &stream->dyn_len;
+	stream->dist_code = &stream->dyn_dist;
+
+	return EOK;
 }
 
-/** Decode `dynamic codes' block
+/** Run the decoder
  *
- * @param state     Inflate state.
+ * Decode the current input chunk into the sliding window until
+ * the input chunk is exhausted, the window is full or the last
+ * block is decoded.
  *
- * @return EOK on success.
+ * @param stream Inflate stream.
+ *
+ * @return EOK if the window is full or the last block has been decoded.
+ * @return ELIMIT if the input chunk has been exhausted.
  * @return ENOENT on distance too large.
- * @return EINVAL on invalid Huffman code.
- * @return ELIMIT on input buffer overrun.
- * @return ENOMEM on output buffer overrun.
+ * @return EINVAL on invalid Huffman code or invalid deflate data.
  *
  */
-static errno_t inflate_dynamic(inflate_state_t *state)
+static errno_t inflate_run(inflate_stream_t *stream)
 {
-	uint16_t length[MAX_CODE];
-	uint16_t dyn_len_count[MAX_HUFFMAN_BIT + 1];
-	uint16_t dyn_len_symbol[MAX_LITLEN];
-	uint16_t dyn_dist_count[MAX_HUFFMAN_BIT + 1];
-	uint16_t dyn_dist_symbol[MAX_DIST];
-	huffman_t dyn_len_code;
-	huffman_t dyn_dist_code;
+	errno_t rc;
+	uint16_t symbol;
+	size_t cnt;
+
+	while (true) {
+		switch (stream->mode) {
+		case INFLATE_HEADER:
+			if (stream->last) {
+				stream->mode = INFLATE_DONE;
+				break;
+			}
 
-	dyn_len_code.count = dyn_len_count;
-	dyn_len_code.symbol = dyn_len_symbol;
+			if (!need_bits(stream, 3))
+				return ELIMIT;
+
+			/* Last block is indicated by a non-zero bit */
+			stream->last = get_bits(stream, 1) != 0;
+
+			/* Block type */
+			switch (get_bits(stream, 2)) {
+			case 0:
+				/* Discard bits up to the byte boundary */
+				get_bits(stream, stream->bitlen % 8);
+				assert(stream->bitlen == 0);
+				stream->mode = INFLATE_STORED;
+				break;
+			case 1:
+				stream->len_code = &stream->fixed_len;
+				stream->dist_code = &stream->fixed_dist;
+				stream->mode = INFLATE_LEN;
+				break;
+			case 2:
+				stream->mode = INFLATE_TABLE;
+				break;
+			default:
+				return EINVAL;
+			}
+			break;
+		case INFLATE_STORED:
+			if (!need_bits(stream, 32))
+				return ELIMIT;
 
-	dyn_dist_code.count = dyn_dist_count;
-	dyn_dist_code.symbol = dyn_dist_symbol;
+			uint16_t len = get_bits(stream, 16);
+			uint16_t len_compl = get_bits(stream, 16);
 
-	/* Get number of bits in each table */
-	uint16_t nlen = get_bits(state, 5) + 257;
-	CHECK_OVERRUN(*state);
+			/* Check block length and its complement */
+			if ((len ^ len_compl) != UINT16_MAX)
+				return EINVAL;
 
-	uint16_t ndist = get_bits(state, 5) + 1;
-	CHECK_OVERRUN(*state);
+			stream->length = len;
+			stream->mode = INFLATE_COPY;
+			break;
+		case INFLATE_COPY:
+			while (stream->length > 0) {
+				size_t to = stream->wpos & WINDOW_MASK;
+
+				cnt = min(stream->length, window_space(stream));
+				cnt = min(cnt, stream->srclen - stream->srccnt);
+				cnt = min(cnt, WINDOW_SIZE - to);
+
+				if (cnt == 0) {
+					if (window_space(stream) == 0)
+						return EOK;
+
+					return ELIMIT;
+				}
+
+				memcpy(stream->window + to,
+				    stream->src + stream->srccnt, cnt);
+				stream->srccnt += cnt;
+				stream->wpos += cnt;
+				stream->length -= cnt;
+			}
 
-	uint16_t ncode = get_bits(state, 4) + 4;
-	CHECK_OVERRUN(*state);
+			stream->mode = INFLATE_HEADER;
+			break;
+		case INFLATE_TABLE:
+			if (!need_bits(stream, 14))
+				return ELIMIT;
 
-	if ((nlen > MAX_LITLEN) || (ndist > MAX_DIST) ||
-	    (ncode > MAX_ORDER))
-		return EINVAL;
+			/* Get number of bits in each table */
+			stream->nlen = get_bits(stream, 5) + 257;
+			stream->ndist = get_bits(stream, 5) + 1;
+			stream->ncode = get_bits(stream, 4) + 4;
 
-	/* Read code length code lengths */
-	uint16_t index;
-	for (index = 0; index < ncode; index++) {
-		length[order[index]] = get_bits(state, 3);
-		CHECK_OVERRUN(*state);
-	}
+			if ((stream->nlen > MAX_LITLEN) ||
+			    (stream->ndist > MAX_DIST))
+				return EINVAL;
 
-	/* Set missing lengths to zero */
-	for (index = ncode; index < MAX_ORDER; index++)
-		length[order[index]] = 0;
+			stream->index = 0;
+			stream->mode = INFLATE_LENLENS;
+			break;
+		case INFLATE_LENLENS:
+			/* Read code length code lengths */
+			while (stream->index < stream->ncode) {
+				if (!need_bits(stream, 3))
+					return ELIMIT;
+
+				stream->lengths[order[stream->index]] =
+				    get_bits(stream, 3);
+				stream->index++;
+			}
 
-	/* Build Huffman code */
-	int16_t rc = huffman_construct(&dyn_len_code, length, MAX_ORDER);
-	if (rc != 0)
-		return EINVAL;
+			/* Set missing lengths to zero */
+			while (stream->index < MAX_ORDER) {
+				stream->lengths[order[stream->index]] = 0;
+				stream->index++;
+			}
 
-	/* Read length/literal and distance code length tables */
-	index = 0;
-	while (index < nlen + ndist) {
-		uint16_t symbol;
-		errno_t err = huffman_decode(state, &dyn_len_code, &symbol);
-		if (err != EOK)
-			return EOK;
+			/* Build Huffman code */
+			if (huffman_construct(&stream->dyn_len, stream->lengths,
+			    MAX_ORDER) != 0)
+				return EINVAL;
 
-		if (symbol < 16) {
-			length[index] = symbol;
-			index++;
-		} else {
-			uint16_t len = 0;
-
-			if (symbol == 16) {
-				if (index == 0)
-					return EINVAL;
-
-				len = length[index - 1];
-				symbol = get_bits(state, 2) + 3;
-				CHECK_OVERRUN(*state);
-			} else if (symbol == 17) {
-				symbol = get_bits(state, 3) + 3;
-				CHECK_OVERRUN(*state);
+			stream->index = 0;
+			stream->mode = INFLATE_CODELENS;
+			break;
+		case INFLATE_CODELENS:
+			/* Read length/literal and distance code length tables */
+			if (stream->index == stream->nlen + stream->ndist) {
+				rc = inflate_dynamic_codes(stream);
+				if (rc != EOK)
+					return rc;
+
+				stream->mode = INFLATE_LEN;
+				break;
+			}
+
+			rc = huffman_decode(stream, &stream->dyn_len, &symbol);
+			if (rc != EOK)
+				return rc;
+
+			if (symbol < 16) {
+				stream->lengths[stream->index] = symbol;
+				stream->index++;
+				break;
+			}
+
+			if ((symbol == 16) && (stream->index == 0))
+				return EINVAL;
+
+			stream->symbol = symbol;
+			stream->mode = INFLATE_REPEAT;
+			break;
+		case INFLATE_REPEAT:
+			if (stream->symbol == 16) {
+				if (!need_bits(stream, 2))
+					return ELIMIT;
+
+				cnt = get_bits(stream, 2) + 3;
+				symbol = stream->lengths[stream->index - 1];
+			} else if (stream->symbol == 17) {
+				if (!need_bits(stream, 3))
+					return ELIMIT;
+
+				cnt = get_bits(stream, 3) + 3;
+				symbol = 0;
 			} else {
-				symbol = get_bits(state, 7) + 11;
-				CHECK_OVERRUN(*state);
+				if (!need_bits(stream, 7))
+					return ELIMIT;
+
+				cnt = get_bits(stream, 7) + 11;
+				symbol = 0;
 			}
 
-			if (index + symbol > nlen + ndist)
+			if (stream->index + cnt > stream->nlen + stream->ndist)
 				return EINVAL;
 
-			while (symbol > 0) {
-				length[index] = len;
-				index++;
-				symbol--;
+			while (cnt > 0) {
+				stream->lengths[stream->index] = symbol;
+				stream->index++;
+				cnt--;
+			}
+
+			stream->mode = INFLATE_CODELENS;
+			break;
+		case INFLATE_LEN:
+			/* Decode literals as long as possible */
+			while (true) {
+				if (window_space(stream) == 0)
+					return EOK;
+
+				rc = huffman_decode(stream, stream->len_code,
+				    &symbol);
+				if (rc != EOK)
+					return rc;
+
+				if (symbol >= 256)
+					break;
+
+				/* Write out literal */
+				stream->window[stream->wpos & WINDOW_MASK] =
+				    (uint8_t) symbol;
+				stream->wpos++;
 			}
+
+			if (symbol == END_OF_BLOCK) {
+				stream->mode = INFLATE_HEADER;
+				break;
+			}
+
+			symbol -= 257;
+			if (symbol >= MAX_LEN)
+				return EINVAL;
+
+			stream->symbol = symbol;
+			stream->mode = INFLATE_LENEXT;
+			break;
+		case INFLATE_LENEXT:
+			if (!need_bits(stream, lens_ext[stream->symbol]))
+				return ELIMIT;
+
+			stream->length = lens[stream->symbol] +
+			    get_bits(stream, lens_ext[stream->symbol]);
+			stream->mode = INFLATE_DIST;
+			break;
+		case INFLATE_DIST:
+			rc = huffman_decode(stream, stream->dist_code, &symbol);
+			if (rc != EOK)
+				return rc;
+
+			if (symbol >= MAX_DIST)
+				return EINVAL;
+
+			stream->symbol = symbol;
+			stream->mode = INFLATE_DISTEXT;
+			break;
+		case INFLATE_DISTEXT:
+			if (!need_bits(stream, dists_ext[stream->symbol]))
+				return ELIMIT;
+
+			stream->dist = dists[stream->symbol] +
+			    get_bits(stream, dists_ext[stream->symbol]);
+			if (stream->dist > stream->wpos)
+				return ENOENT;
+
+			stream->mode = INFLATE_MATCH;
+			break;
+		case INFLATE_MATCH:
+			cnt = min(stream->length, window_space(stream));
+			if (cnt == 0)
+				return EOK;
+
+			window_match(stream, cnt);
+			stream->length -= cnt;
+
+			if (stream->length == 0)
+				stream->mode = INFLATE_LEN;
+			break;
+		case INFLATE_DONE:
+			return EOK;
 		}
 	}
+}
 
-	/* Check for end-of-block code */
-	if (length[256] == 0)
-		return EINVAL;
+/** Drain decompressed data from the sliding window
+ *
+ * @param stream  Inflate stream.
+ * @param dest    Destination buffer.
+ * @param destlen Destination buffer size (bytes).
+ *
+ * @return Number of bytes drained.
+ *
+ */
+static size_t inflate_drain(inflate_stream_t *stream, uint8_t *dest,
+    size_t destlen)
+{
+	size_t total = 0;
 
-	/* Build Huffman tables for literal/length codes */
-	rc = huffman_construct(&dyn_len_code, length, nlen);
-	if ((rc < 0) || ((rc > 0) && (dyn_len_code.count[0] + 1 != nlen)))
-		return EINVAL;
+	while ((total < destlen) && (stream->rpos < stream->wpos)) {
+		size_t from = stream->rpos & WINDOW_MASK;
+		size_t cnt = min(destlen - total,
+		    (size_t) (stream->wpos - stream->rpos));
+		cnt = min(cnt, WINDOW_SIZE - from);
 
-	/* Build Huffman tables for distance codes */
-	rc = huffman_construct(&dyn_dist_code, length + nlen, ndist);
-	if ((rc < 0) || ((rc > 0) && (dyn_dist_code.count[0] + 1 != ndist)))
-		return EINVAL;
+		memcpy(dest + total, stream->window + from, cnt);
+		stream->rpos += cnt;
+		total += cnt;
+	}
 
-	return inflate_codes(state, &dyn_len_code, &dyn_dist_code);
+	return total;
 }
 
-/** Inflate data
+/** Create inflate stream
+ *
+ * @param rstream Place to store pointer to the new stream.
+ *
+ * @return EOK on success.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t inflate_stream_create(inflate_stream_t **rstream)
+{
+	inflate_stream_t *stream = malloc(sizeof(inflate_stream_t));
+	if (stream == NULL)
+		return ENOMEM;
+
+	stream->mode = INFLATE_HEADER;
+	stream->last = false;
+	stream->error = EOK;
+
+	stream->src = NULL;
+	stream->srclen = 0;
+	stream->srccnt = 0;
+
+	stream->bitbuf = 0;
+	stream->bitlen = 0;
+
+	stream->wpos = 0;
+	stream->rpos = 0;
+
+	stream->len_code = NULL;
+	stream->dist_code = NULL;
+
+	/* Construct the fixed codes */
+	size_t symbol;
+	for (symbol = 0; symbol < 144; symbol++)
+		stream->lengths[symbol] = 8;
+	for (; symbol < 256; symbol++)
+		stream->lengths[symbol] = 9;
+	for (; symbol < 280; symbol++)
+		stream->lengths[symbol] = 7;
+	for (; symbol < MAX_FIXED_LITLEN; symbol++)
+		stream->lengths[symbol] = 8;
+
+	(void) huffman_construct(&stream->fixed_len, stream->lengths,
+	    MAX_FIXED_LITLEN);
+
+	for (symbol = 0; symbol < MAX_DIST; symbol++)
+		stream->lengths[symbol] = 5;
+
+	(void) huffman_construct(&stream->fixed_dist, stream->lengths,
+	    MAX_DIST);
+
+	*rstream = stream;
+	return EOK;
+}
+
+/** Destroy inflate stream
+ *
+ * @param stream Inflate stream.
+ *
+ */
+void inflate_stream_destroy(inflate_stream_t *stream)
+{
+	free(stream);
+}
+
+/** Decompress a chunk of data
+ *
+ * Consume as much of the input chunk and produce as much of the
+ * output as possible. The function returns when the input chunk
+ * has been exhausted, the output buffer is full or the end of
+ * the deflate stream has been reached and all the decompressed
+ * data have been drained.
+ *
+ * Input bytes beyond the end of the deflate stream are never
+ * consumed, thus the caller can process any trailing data
+ * starting at the position indicated by @a srcused.
  *
+ * @param stream  Inflate stream.
  * @param src     Source data buffer.
  * @param srclen  Source buffer size (bytes).
+ * @param srcused Place to store the number of bytes consumed.
  * @param dest    Destination data buffer.
  * @param destlen Destination buffer size (bytes).
+ * @param destused Place to store the number of bytes produced.
  *
  * @return EOK on success.
  * @return ENOENT on distance too large.
  * @return EINVAL on invalid Huffman code or invalid deflate data.
- * @return ELIMIT on input buffer overrun.
- * @return ENOMEM on output buffer overrun.
  *
  */
-errno_t inflate(void *src, size_t srclen, void *dest, size_t destlen)
+errno_t inflate_stream_decode(inflate_stream_t *stream, const void *src,
+    size_t srclen, size_t *srcused, void *dest, size_t destlen,
+    size_t *destused)
 {
-	/* Initialize the state */
-	inflate_state_t state;
+	size_t total = 0;
+	errno_t rc = stream->error;
 
-	state.dest = (uint8_t *) dest;
-	state.destlen = destlen;
-	state.destcnt = 0;
+	stream->src = (const uint8_t *) src;
+	stream->srclen = srclen;
+	stream->srccnt = 0;
 
-	state.src = (uint8_t *) src;
-	state.srclen = srclen;
-	state.srccnt = 0;
+	while (rc == EOK) {
+		total += inflate_drain(stream, (uint8_t *) dest + total,
+		    destlen - total);
 
-	state.bitbuf = 0;
-	state.bitlen = 0;
+		if ((stream->mode == INFLATE_DONE) || (window_space(stream) == 0))
+			break;
 
-	state.overrun = false;
+		rc = inflate_run(stream);
+		if (rc == ELIMIT) {
+			/* Input chunk exhausted */
+			total += inflate_drain(stream, (uint8_t *) dest + total,
+			    destlen - total);
+			rc = EOK;
+			break;
+		}
+	}
 
-	uint16_t last;
-	errno_t ret = EOK;
+	stream->error = rc;
 
-	do {
-		/* Last block is indicated by a non-zero bit */
-		last = get_bits(&state, 1);
-		CHECK_OVERRUN(state);
+	*srcused = stream->srccnt;
+	*destused = total;
 
-		/* Block type */
-		uint16_t type = get_bits(&state, 2);
-		CHECK_OVERRUN(state);
+	stream->src = NULL;
+	stream->srclen = 0;
+	stream->srccnt = 0;
 
-		switch (type) {
-		case 0:
-			ret = inflate_stored(&state);
-			break;
-		case 1:
-			ret = inflate_fixed(&state, &len_code, &dist_code);
-			break;
-		case 2:
-			ret = inflate_dynamic(&state);
-			break;
-		default:
-			ret = EINVAL;
-		}
-	} while ((!last) && (ret == 0));
+	return rc;
+}
+
+/** Check for the end of the inflate stream
+ *
+ * @param stream Inflate stream.
+ *
+ * @return True if the last block has been decoded and all
+ *         the decompressed data have been drained.
+ *
+ */
+bool inflate_stream_done(inflate_stream_t *stream)
+{
+	return (stream->mode == INFLATE_DONE) &&
+	    (stream->rpos == stream->wpos);
+}
+
+/** Inflate data
+ *
+ * @param src     Source data buffer.
+ * @param srclen  Source buffer size (bytes).
+ * @param dest    Destination data buffer.
+ * @param destlen Destination buffer size (bytes).
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code or invalid deflate data.
+ * @return ELIMIT on input buffer overrun.
+ * @return ENOMEM on output buffer overrun or if out of memory.
+ *
+ */
+errno_t inflate(void *src, size_t srclen, void *dest, size_t destlen)
+{
+	inflate_stream_t *stream;
+	size_t srcused;
+	size_t destused;
+
+	errno_t rc = inflate_stream_create(&stream);
+	if (rc != EOK)
+		return rc;
+
+	rc = inflate_stream_decode(stream, src, srclen, &srcused, dest,
+	    destlen, &destused);
+	if ((rc == EOK) && (!inflate_stream_done(stream))) {
+		if ((destused == destlen) &&
+		    ((stream->mode == INFLATE_DONE) || (srcused < srclen) ||
+		    (stream->rpos < stream->wpos)))
+			rc = ENOMEM;
+		else
+			rc = ELIMIT;
+	}
 
-	return ret;
+	inflate_stream_destroy(stream);
+	return rc;
 }
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../deflate.h"
+#include "../gzip.h"
+#include "../inflate.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(compress);
+
+/** Text compressed by an external deflate implementation */
+static const char hello_text[] =
+    "Hello, HelenOS! Hello, HelenOS! Hello, HelenOS!\n";
+
+static uint8_t hello_deflate[] = {
+	0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0xd7, 0x51, 0xf0, 0x48, 0xcd, 0x49,
+	0xcd, 0xf3, 0x0f, 0x56, 0x04, 0x31, 0xf0, 0xf1, 0xb9, 0x00
+};
+
+/** Generate compressible test data */
+static void gen_data(uint8_t *data, size_t size)
+{
+	uint32_t seed = 1;
+
+	for (size_t i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+
+		if ((i > 64) && ((seed >> 16) % 4 != 0))
+			data[i] = data[i - 1 - (seed >> 20) % 64];
+		else
+			data[i] = 'a' + (seed >> 16) % 8;
+	}
+}
+
+/** Inflate data compressed by an external implementation */
+PCUT_TEST(inflate_external)
+{
+	char buf[sizeof(hello_text) - 1];
+	errno_t rc;
+
+	rc = inflate(hello_deflate, sizeof(hello_deflate), buf, sizeof(buf));
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(buf, hello_text, sizeof(buf)));
+}
+
+/** Inflate into too small output buffer and from truncated input */
+PCUT_TEST(inflate_overrun)
+{
+	char buf[sizeof(hello_text) - 1];
+	errno_t rc;
+
+	rc = inflate(hello_deflate, sizeof(hello_deflate), buf,
+	    sizeof(buf) - 1);
+	PCUT_ASSERT_ERRNO_VAL(ENOMEM, rc);
+
+	rc = inflate(hello_deflate, sizeof(hello_deflate) - 2, buf,
+	    sizeof(buf));
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+}
+
+/** Inflate one byte at a time */
+PCUT_TEST(inflate_stream_bytes)
+{
+	inflate_stream_t *stream;
+	char buf[sizeof(hello_text) - 1];
+	size_t srccnt = 0;
+	size_t destcnt = 0;
+	size_t used;
+	size_t produced;
+	errno_t rc;
+
+	rc = inflate_stream_create(&stream);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	while (!inflate_stream_done(stream)) {
+		PCUT_ASSERT_TRUE(srccnt <= sizeof(hello_deflate));
+
+		rc = inflate_stream_decode(stream, hello_deflate + srccnt,
+		    min(sizeof(hello_deflate) - srccnt, 1), &used,
+		    buf + destcnt, min(sizeof(buf) - destcnt, 1), &produced);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+		srccnt += used;
+		destcnt += produced;
+	}
+
+	PCUT_ASSERT_INT_EQUALS(sizeof(hello_deflate), srccnt);
+	PCUT_ASSERT_INT_EQUALS(sizeof(buf), destcnt);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(buf, hello_text, sizeof(buf)));
+
+	inflate_stream_destroy(stream);
+}
+
+/** Compress and decompress data at all compression levels */
+PCUT_TEST(deflate_roundtrip)
+{
+	size_t size = 200000;
+	uint8_t *data = malloc(size);
+	uint8_t *cdata = malloc(size + size / 8);
+	uint8_t *ddata = malloc(size);
+	size_t csize;
+	errno_t rc;
+
+	PCUT_ASSERT_NOT_NULL(data);
+	PCUT_ASSERT_NOT_NULL(cdata);
+	PCUT_ASSERT_NOT_NULL(ddata);
+
+	gen_data(data, size);
+
+	for (unsigned int level = 0; level <= DEFLATE_MAX_LEVEL; level++) {
+		rc = deflate(data, size, cdata, size + size / 8, &csize, level);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+		if (level > 0)
+			PCUT_ASSERT_TRUE(csize < size / 2);
+
+		rc = inflate(cdata, csize, ddata, size);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		PCUT_ASSERT_INT_EQUALS(0, memcmp(data, ddata, size));
+	}
+
+	free(data);
+	free(cdata);
+	free(ddata);
+}
+
+/** Compress and decompress GZIP stream in small chunks */
+PCUT_TEST(gzip_stream_roundtrip)
+{
+	size_t size = 100000;
+	uint8_t *data = malloc(size);
+	uint8_t *cdata = malloc(size + size / 8);
+	uint8_t *ddata = malloc(size);
+	gzip_enc_t *enc;
+	gzip_dec_t *dec;
+	size_t srccnt = 0;
+	size_t destcnt = 0;
+	size_t used;
+	size_t produced;
+	errno_t rc;
+
+	PCUT_ASSERT_NOT_NULL(data);
+	PCUT_ASSERT_NOT_NULL(cdata);
+	PCUT_ASSERT_NOT_NULL(ddata);
+
+	gen_data(data, size);
+
+	rc = gzip_enc_create(DEFLATE_DEFAULT_LEVEL, &enc);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	while (!gzip_enc_done(enc)) {
+		size_t chunk = min(size - srccnt, 777);
+
+		rc = gzip_enc_process(enc, data + srccnt, chunk, &used,
+		    cdata + destcnt, min(size + size / 8 - destcnt, 333),
+		    &produced, srccnt + chunk == size);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+		srccnt += used;
+		destcnt += produced;
+	}
+
+	gzip_enc_destroy(enc);
+
+	size_t csize = destcnt;
+	srccnt = 0;
+	destcnt = 0;
+
+	rc = gzip_dec_create(&dec);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	while (!gzip_dec_done(dec)) {
+		PCUT_ASSERT_TRUE(destcnt <= size);
+
+		rc = gzip_dec_process(dec, cdata + srccnt,
+		    min(csize - srccnt, 100), &used, ddata + destcnt,
+		    min(size - destcnt, 1000), &produced);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+		srccnt += used;
+		destcnt += produced;
+	}
+
+	gzip_dec_destroy(dec);
+
+	PCUT_ASSERT_INT_EQUALS(csize, srccnt);
+	PCUT_ASSERT_INT_EQUALS(size, destcnt);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, ddata, size));
+
+	free(data);
+	free(cdata);
+	free(ddata);
+}
+
+/** Detect corrupted GZIP stream */
+PCUT_TEST(gzip_stream_checksum)
+{
+	uint8_t cdata[256];
+	char ddata[sizeof(hello_text)];
+	gzip_enc_t *enc;
+	gzip_dec_t *dec;
+	size_t used;
+	size_t csize;
+	size_t dsize;
+	errno_t rc;
+
+	rc = gzip_enc_create(DEFLATE_DEFAULT_LEVEL, &enc);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = gzip_enc_process(enc, hello_text, sizeof(hello_text) - 1, &used,
+	    cdata, sizeof(cdata), &csize, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(gzip_enc_done(enc));
+
+	gzip_enc_destroy(enc);
+
+	/* Corrupt the CRC in the footer */
+	cdata[csize - 8] ^= 1;
+
+	rc = gzip_dec_create(&dec);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = gzip_dec_process(dec, cdata, csize, &used, ddata, sizeof(ddata),
+	    &dsize);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+	PCUT_ASSERT_FALSE(gzip_dec_done(dec));
+
+	gzip_dec_destroy(dec);
+}
+
+PCUT_EXPORT(compress);
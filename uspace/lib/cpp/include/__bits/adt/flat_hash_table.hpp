@@ -0,0 +1,672 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBCPP_BITS_ADT_FLAT_HASH_TABLE
+#define LIBCPP_BITS_ADT_FLAT_HASH_TABLE
+
+#include <__bits/adt/flat_hash_table_iterators.hpp>
+#include <__bits/adt/key_extractors.hpp>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <utility>
+
+namespace std::aux
+{
+    /**
+     * Open addressing counterpart of hash_table. Values are
+     * stored directly in one array of slots and collisions are
+     * resolved by linear probing with the robin hood heuristic
+     * (an element being inserted takes the slot of an element
+     * that is closer to its home slot) and backward shift
+     * deletion, which keeps probe sequences short without
+     * the need of tombstones.
+     *
+     * Next to the slots we keep a compact array of probe distances
+     * (distance from home slot plus one, zero marks an empty
+     * slot), so a lookup scans a couple of neighbouring distances
+     * and then, typically, compares a single slot.
+     *
+     * The slot array is not circular, elements that probe past
+     * the last home slot continue into an overflow area at the
+     * end of the array which grows on demand. This means that
+     * backward shift never moves an element from the beginning
+     * of the array to its end, so erasing while iterating visits
+     * every element exactly once.
+     *
+     * The price is that, unlike with the node based hash_table,
+     * references and iterators to elements are invalidated by
+     * every insertion and erasure, which is why this table is not
+     * used by the standard unordered containers and only backs
+     * the flat_unordered_map and flat_unordered_set extensions.
+     * Only unique keys are supported.
+     */
+    template<
+        class Value, class Key, class KeyExtractor,
+        class Hasher, class KeyEq, class Size,
+        class Iterator, class ConstIterator
+    >
+    class flat_hash_table
+    {
+        public:
+            using value_type     = Value;
+            using key_type       = Key;
+            using size_type      = Size;
+            using key_equal      = KeyEq;
+            using hasher         = Hasher;
+            using key_extract    = KeyExtractor;
+
+            using iterator       = Iterator;
+            using const_iterator = ConstIterator;
+
+            using dist_type      = flat_hash_table_dist_t;
+
+            flat_hash_table(size_type count = size_type{},
+                            const hasher& hf = hasher{},
+                            const key_equal& eql = key_equal{},
+                            float max_load_factor = default_max_load_factor_)
+                : dist_{nullptr}, slots_{nullptr}, capacity_{}, total_{},
+                  size_{}, hasher_{hf}, key_eq_{eql}, key_extractor_{},
+                  max_load_factor_{max_load_factor}
+            {
+                if (count > 0)
+                    rehash(count);
+            }
+
+            flat_hash_table(const flat_hash_table& other)
+                : flat_hash_table{size_type{}, other.hasher_, other.key_eq_,
+                                  other.max_load_factor_}
+            {
+                reserve(other.size_);
+
+                for (size_type i = 0; i < other.total_; ++i)
+                {
+                    if (other.dist_[i] != 0)
+                        insert_unique_(other.slots_[i]);
+                }
+            }
+
+            flat_hash_table(flat_hash_table&& other)
+                : dist_{other.dist_}, slots_{other.slots_},
+                  capacity_{other.capacity_}, total_{other.total_},
+                  size_{other.size_}, hasher_{move(other.hasher_)},
+                  key_eq_{move(other.key_eq_)},
+                  key_extractor_{move(other.key_extractor_)},
+                  max_load_factor_{other.max_load_factor_}
+            {
+                other.dist_ = nullptr;
+                other.slots_ = nullptr;
+                other.capacity_ = size_type{};
+                other.total_ = size_type{};
+                other.size_ = size_type{};
+            }
+
+            flat_hash_table& operator=(const flat_hash_table& other)
+            {
+                flat_hash_table tmp{other};
+                tmp.swap(*this);
+
+                return *this;
+            }
+
+            flat_hash_table& operator=(flat_hash_table&& other)
+            {
+                flat_hash_table tmp{move(other)};
+                tmp.swap(*this);
+
+                return *this;
+            }
+
+            ~flat_hash_table()
+            {
+                clear();
+                release_(dist_, slots_);
+            }
+
+            bool empty() const noexcept
+            {
+                return size_ == 0;
+            }
+
+            size_type size() const noexcept
+            {
+                return size_;
+            }
+
+            size_type max_size() const noexcept
+            {
+                return numeric_limits<size_type>::max() /
+                       (sizeof(value_type) + sizeof(dist_type));
+            }
+
+            iterator begin() noexcept
+            {
+                return make_iterator_(first_filled_());
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return cbegin();
+            }
+
+            iterator end() noexcept
+            {
+                return make_iterator_(total_);
+            }
+
+            const_iterator end() const noexcept
+            {
+                return cend();
+            }
+
+            const_iterator cbegin() const noexcept
+            {
+                return make_const_iterator_(first_filled_());
+            }
+
+            const_iterator cend() const noexcept
+            {
+                return make_const_iterator_(total_);
+            }
+
+            template<class... Args>
+            pair<iterator, bool> emplace(Args&&... args)
+            {
+                /**
+                 * Note: We need the key to find out if the
+                 *       value is already present, so we construct
+                 *       the value on the side first.
+                 */
+                alignas(value_type) unsigned char buffer[sizeof(value_type)];
+                auto val = new(buffer) value_type(forward<Args>(args)...);
+
+                auto idx = find_idx_(key_extractor_(*val));
+                if (idx == total_)
+                    idx = insert_unique_(move(*val));
+                else
+                {
+                    val->~value_type();
+
+                    return make_pair(make_iterator_(idx), false);
+                }
+                val->~value_type();
+
+                return make_pair(make_iterator_(idx), true);
+            }
+
+            /**
+             * Constructs the value from the key and the remaining
+             * arguments only if the key is not already present.
+             */
+            template<class K, class... Args>
+            pair<iterator, bool> try_emplace(K&& key, Args&&... args)
+            {
+                auto idx = find_idx_(key);
+                if (idx != total_)
+                    return make_pair(make_iterator_(idx), false);
+
+                idx = insert_unique_(value_type(
+                    forward<K>(key), forward<Args>(args)...
+                ));
+
+                return make_pair(make_iterator_(idx), true);
+            }
+
+            pair<iterator, bool> insert(const value_type& val)
+            {
+                auto idx = find_idx_(key_extractor_(val));
+                if (idx != total_)
+                    return make_pair(make_iterator_(idx), false);
+
+                return make_pair(make_iterator_(insert_unique_(val)), true);
+            }
+
+            pair<iterator, bool> insert(value_type&& val)
+            {
+                auto idx = find_idx_(key_extractor_(val));
+                if (idx != total_)
+                    return make_pair(make_iterator_(idx), false);
+
+                return make_pair(make_iterator_(insert_unique_(move(val))), true);
+            }
+
+            size_type erase(const key_type& key)
+            {
+                auto idx = find_idx_(key);
+                if (idx == total_)
+                    return 0;
+
+                erase_idx_(idx);
+
+                return 1;
+            }
+
+            iterator erase(const_iterator it)
+            {
+                if (it.is_end())
+                    return end();
+
+                /**
+                 * Note: Backward shift moves the following elements
+                 *       one slot back, so the erased slot now holds
+                 *       the next element that has not been visited yet
+                 *       (if any).
+                 */
+                auto idx = it.idx();
+                erase_idx_(idx);
+
+                auto res = make_iterator_(idx);
+                if (dist_[idx] == 0)
+                    ++res;
+
+                return res;
+            }
+
+            void clear() noexcept
+            {
+                for (size_type i = 0; i < total_; ++i)
+                {
+                    if (dist_[i] != 0)
+                    {
+                        slots_[i].~value_type();
+                        dist_[i] = 0;
+                    }
+                }
+
+                size_ = size_type{};
+            }
+
+            void swap(flat_hash_table& other)
+                noexcept(noexcept(std::swap(declval<Hasher&>(), declval<Hasher&>())) &&
+                         noexcept(std::swap(declval<KeyEq&>(), declval<KeyEq&>())))
+            {
+                std::swap(dist_, other.dist_);
+                std::swap(slots_, other.slots_);
+                std::swap(capacity_, other.capacity_);
+                std::swap(total_, other.total_);
+                std::swap(size_, other.size_);
+                std::swap(hasher_, other.hasher_);
+                std::swap(key_eq_, other.key_eq_);
+                std::swap(max_load_factor_, other.max_load_factor_);
+            }
+
+            hasher hash_function() const
+            {
+                return hasher_;
+            }
+
+            key_equal key_eq() const
+            {
+                return key_eq_;
+            }
+
+            iterator make_iterator(const_iterator it)
+            {
+                if (it.is_end())
+                    return end();
+
+                return make_iterator_(it.idx());
+            }
+
+            iterator find(const key_type& key)
+            {
+                return make_iterator_(find_idx_(key));
+            }
+
+            const_iterator find(const key_type& key) const
+            {
+                return make_const_iterator_(find_idx_(key));
+            }
+
+            size_type count(const key_type& key) const
+            {
+                return find_idx_(key) != total_ ? 1 : 0;
+            }
+
+            size_type bucket_count() const noexcept
+            {
+                return capacity_;
+            }
+
+            float load_factor() const noexcept
+            {
+                if (capacity_ == 0)
+                    return 0.f;
+
+                return size_ / static_cast<float>(capacity_);
+            }
+
+            float max_load_factor() const noexcept
+            {
+                return max_load_factor_;
+            }
+
+            void max_load_factor(float factor)
+            {
+                /**
+                 * Note: Robin hood probing degrades quickly
+                 *       when the table gets (almost) full, so
+                 *       we do not allow the load factor to get
+                 *       too close to one.
+                 */
+                if (factor > 0.f && factor <= max_max_load_factor_)
+                    max_load_factor_ = factor;
+
+                if (size_ > max_load_factor_ * capacity_)
+                    reserve(size_);
+            }
+
+            void rehash(size_type count)
+            {
+                auto min_count = static_cast<size_type>(size_ / max_load_factor_) + 1;
+                if (count < min_count)
+                    count = min_count;
+
+                size_type new_capacity{min_capacity_};
+                while (new_capacity < count)
+                    new_capacity *= 2;
+
+                if (new_capacity == capacity_)
+                    return;
+
+                auto old_dist = dist_;
+                auto old_slots = slots_;
+                auto old_total = total_;
+
+                capacity_ = new_capacity;
+                total_ = new_capacity + initial_overflow_(new_capacity);
+                allocate_(dist_, slots_, total_);
+                size_ = size_type{};
+
+                for (size_type i = 0; i < old_total; ++i)
+                {
+                    if (old_dist[i] != 0)
+                    {
+                        insert_unique_(move(old_slots[i]));
+                        old_slots[i].~value_type();
+                    }
+                }
+
+                release_(old_dist, old_slots);
+            }
+
+            void reserve(size_type count)
+            {
+                rehash(static_cast<size_type>(count / max_load_factor_) + 1);
+            }
+
+            bool is_eq_to(const flat_hash_table& other) const
+            {
+                if (size_ != other.size_)
+                    return false;
+
+                for (size_type i = 0; i < total_; ++i)
+                {
+                    if (dist_[i] == 0)
+                        continue;
+
+                    auto idx = other.find_idx_(key_extractor_(slots_[i]));
+                    if (idx == other.total_ || !(slots_[i] == other.slots_[idx]))
+                        return false;
+                }
+
+                return true;
+            }
+
+        private:
+            dist_type* dist_;
+            value_type* slots_;
+
+            /**
+             * Number of home slots (a power of two)
+             * and the number of all slots including
+             * the overflow area.
+             */
+            size_type capacity_;
+            size_type total_;
+
+            size_type size_;
+            hasher hasher_;
+            key_equal key_eq_;
+            key_extract key_extractor_;
+            float max_load_factor_;
+
+            static constexpr float default_max_load_factor_{0.8f};
+            static constexpr float max_max_load_factor_{0.95f};
+            static constexpr size_type min_capacity_{16};
+
+            /**
+             * Note: The standard hashes of integral types are
+             *       identities, which would map consecutive keys
+             *       to consecutive slots and cluster badly. We
+             *       therefore scramble the hash with Fibonacci
+             *       hashing and take its top bits.
+             */
+            size_type home_(const key_type& key) const
+            {
+                auto h = static_cast<uint64_t>(hasher_(key));
+                h *= 0x9E3779B97F4A7C15ULL;
+
+                return static_cast<size_type>(h >> 32) & (capacity_ - 1);
+            }
+
+            size_type find_idx_(const key_type& key) const
+            {
+                if (size_ == 0)
+                    return total_;
+
+                auto idx = home_(key);
+                dist_type d{1};
+
+                /**
+                 * Robin hood invariant: once we reach a slot whose
+                 * element is closer to its home than we are to ours,
+                 * the key cannot be further in the table.
+                 */
+                while (idx < total_ && dist_[idx] >= d)
+                {
+                    if (dist_[idx] == d && key_eq_(key, key_extractor_(slots_[idx])))
+                        return idx;
+
+                    ++idx;
+                    ++d;
+                }
+
+                return total_;
+            }
+
+            /**
+             * Inserts a value the key of which is known not
+             * to be present in the table and returns the index
+             * it ended up at.
+             */
+            template<class V>
+            size_type insert_unique_(V&& val)
+            {
+                if (capacity_ == 0 || size_ + 1 > max_load_factor_ * capacity_)
+                    rehash(capacity_ * 2);
+
+                alignas(value_type) unsigned char buffer[sizeof(value_type)];
+                auto carry = new(buffer) value_type(forward<V>(val));
+
+                auto idx = home_(key_extractor_(*carry));
+                size_type res{};
+                bool placed{false};
+                dist_type d{1};
+
+                while (true)
+                {
+                    if (idx == total_)
+                    {
+                        /**
+                         * Note: Growing the overflow area does not
+                         *       move elements between slots, so both
+                         *       idx and res stay valid.
+                         */
+                        grow_overflow_();
+                    }
+
+                    if (dist_[idx] == 0)
+                    {
+                        new(&slots_[idx]) value_type(move(*carry));
+                        carry->~value_type();
+                        dist_[idx] = d;
+                        ++size_;
+
+                        return placed ? res : idx;
+                    }
+
+                    if (dist_[idx] < d)
+                    {
+                        /**
+                         * Take the slot from the richer element
+                         * and continue inserting that one.
+                         */
+                        value_type tmp(move(slots_[idx]));
+                        slots_[idx].~value_type();
+                        new(&slots_[idx]) value_type(move(*carry));
+                        carry->~value_type();
+                        new(carry) value_type(move(tmp));
+                        tmp.~value_type();
+
+                        std::swap(dist_[idx], d);
+                        if (!placed)
+                        {
+                            res = idx;
+                            placed = true;
+                        }
+                    }
+
+                    ++idx;
+                    ++d;
+                }
+            }
+
+            void erase_idx_(size_type idx)
+            {
+                slots_[idx].~value_type();
+                dist_[idx] = 0;
+                --size_;
+
+                auto next = idx + 1;
+                while (next < total_ && dist_[next] > 1)
+                {
+                    new(&slots_[idx]) value_type(move(slots_[next]));
+                    slots_[next].~value_type();
+                    dist_[idx] = dist_[next] - 1;
+                    dist_[next] = 0;
+
+                    idx = next++;
+                }
+            }
+
+            iterator make_iterator_(size_type idx)
+            {
+                return iterator{dist_, slots_, idx, total_};
+            }
+
+            const_iterator make_const_iterator_(size_type idx) const
+            {
+                return const_iterator{dist_, slots_, idx, total_};
+            }
+
+            size_type first_filled_() const
+            {
+                size_type res{};
+                while (res < total_ && dist_[res] == 0)
+                    ++res;
+
+                return res;
+            }
+
+            static size_type initial_overflow_(size_type capacity)
+            {
+                /**
+                 * With a reasonable hash function probe sequences
+                 * are logarithmic in the number of elements.
+                 */
+                size_type res{8};
+                while (capacity > 1)
+                {
+                    capacity /= 2;
+                    ++res;
+                }
+
+                return res;
+            }
+
+            void grow_overflow_()
+            {
+                auto new_total = capacity_ + 2 * (total_ - capacity_);
+
+                dist_type* new_dist{};
+                value_type* new_slots{};
+                allocate_(new_dist, new_slots, new_total);
+
+                for (size_type i = 0; i < total_; ++i)
+                {
+                    if (dist_[i] != 0)
+                    {
+                        new(&new_slots[i]) value_type(move(slots_[i]));
+                        slots_[i].~value_type();
+                        new_dist[i] = dist_[i];
+                    }
+                }
+
+                release_(dist_, slots_);
+
+                dist_ = new_dist;
+                slots_ = new_slots;
+                total_ = new_total;
+            }
+
+            static void allocate_(dist_type*& dist, value_type*& slots, size_type count)
+            {
+                dist = static_cast<dist_type*>(
+                    ::operator new(count * sizeof(dist_type))
+                );
+                slots = static_cast<value_type*>(
+                    ::operator new(count * sizeof(value_type))
+                );
+
+                std::memset(dist, 0, count * sizeof(dist_type));
+            }
+
+            static void release_(dist_type* dist, value_type* slots)
+            {
+                if (dist)
+                    ::operator delete(static_cast<void*>(dist));
+                if (slots)
+                    ::operator delete(static_cast<void*>(slots));
+            }
+    };
+}
+
+#endif
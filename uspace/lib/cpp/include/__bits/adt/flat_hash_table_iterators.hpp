@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBCPP_BITS_ADT_FLAT_HASH_TABLE_ITERATORS
+#define LIBCPP_BITS_ADT_FLAT_HASH_TABLE_ITERATORS
+
+#include <__bits/iterator_helpers.hpp>
+#include <cstdint>
+#include <iterator>
+
+namespace std::aux
+{
+    /**
+     * Probe distance of an element plus one,
+     * zero marks an empty slot.
+     */
+    using flat_hash_table_dist_t = uint32_t;
+
+    /**
+     * Iterators of the flat hash table are just indices
+     * into its slot array, empty slots (those with zero
+     * probe distance) are skipped when incrementing.
+     */
+    template<class Value, class Reference, class Pointer, class Size>
+    class flat_hash_table_iterator
+    {
+        public:
+            using value_type      = Value;
+            using size_type       = Size;
+            using reference       = Reference;
+            using pointer         = Pointer;
+            using difference_type = ptrdiff_t;
+
+            using iterator_category = forward_iterator_tag;
+
+            flat_hash_table_iterator(const flat_hash_table_dist_t* dist = nullptr,
+                                     value_type* slots = nullptr,
+                                     size_type idx = size_type{},
+                                     size_type cap = size_type{})
+                : dist_{dist}, slots_{slots}, idx_{idx}, cap_{cap}
+            { /* DUMMY BODY */ }
+
+            flat_hash_table_iterator(const flat_hash_table_iterator&) = default;
+            flat_hash_table_iterator& operator=(const flat_hash_table_iterator&) = default;
+
+            reference operator*() const
+            {
+                return slots_[idx_];
+            }
+
+            pointer operator->() const
+            {
+                return &slots_[idx_];
+            }
+
+            flat_hash_table_iterator& operator++()
+            {
+                while (++idx_ < cap_ && dist_[idx_] == 0)
+                { /* DUMMY BODY */ }
+
+                return *this;
+            }
+
+            flat_hash_table_iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++(*this);
+
+                return tmp;
+            }
+
+            size_type idx() const
+            {
+                return idx_;
+            }
+
+            bool is_end() const
+            {
+                return idx_ >= cap_;
+            }
+
+        private:
+            const flat_hash_table_dist_t* dist_;
+            value_type* slots_;
+            size_type idx_;
+            size_type cap_;
+
+            template<class V, class CR, class CP, class S>
+            friend class flat_hash_table_const_iterator;
+    };
+
+    template<class Value, class Ref, class Ptr, class Size>
+    bool operator==(const flat_hash_table_iterator<Value, Ref, Ptr, Size>& lhs,
+                    const flat_hash_table_iterator<Value, Ref, Ptr, Size>& rhs)
+    {
+        /**
+         * Note: All end iterators are equal, including the
+         *       default constructed one.
+         */
+        if (lhs.is_end() || rhs.is_end())
+            return lhs.is_end() && rhs.is_end();
+
+        return lhs.operator->() == rhs.operator->();
+    }
+
+    template<class Value, class Ref, class Ptr, class Size>
+    bool operator!=(const flat_hash_table_iterator<Value, Ref, Ptr, Size>& lhs,
+                    const flat_hash_table_iterator<Value, Ref, Ptr, Size>& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    template<class Value, class ConstReference, class ConstPointer, class Size>
+    class flat_hash_table_const_iterator
+    {
+        using non_const_iterator_type = flat_hash_table_iterator<
+            Value, get_non_const_ref_t<ConstReference>,
+            get_non_const_ptr_t<ConstPointer>, Size
+        >;
+
+        public:
+            using value_type      = Value;
+            using size_type       = Size;
+            using const_reference = ConstReference;
+            using const_pointer   = ConstPointer;
+            using reference       = ConstReference;
+            using pointer         = ConstPointer;
+            using difference_type = ptrdiff_t;
+
+            using iterator_category = forward_iterator_tag;
+
+            flat_hash_table_const_iterator(const flat_hash_table_dist_t* dist = nullptr,
+                                           const value_type* slots = nullptr,
+                                           size_type idx = size_type{},
+                                           size_type cap = size_type{})
+                : dist_{dist}, slots_{slots}, idx_{idx}, cap_{cap}
+            { /* DUMMY BODY */ }
+
+            flat_hash_table_const_iterator(const flat_hash_table_const_iterator&) = default;
+            flat_hash_table_const_iterator& operator=(const flat_hash_table_const_iterator&) = default;
+
+            flat_hash_table_const_iterator(const non_const_iterator_type& other)
+                : dist_{other.dist_}, slots_{other.slots_},
+                  idx_{other.idx_}, cap_{other.cap_}
+            { /* DUMMY BODY */ }
+
+            flat_hash_table_const_iterator& operator=(const non_const_iterator_type& other)
+            {
+                dist_ = other.dist_;
+                slots_ = other.slots_;
+                idx_ = other.idx_;
+                cap_ = other.cap_;
+
+                return *this;
+            }
+
+            const_reference operator*() const
+            {
+                return slots_[idx_];
+            }
+
+            const_pointer operator->() const
+            {
+                return &slots_[idx_];
+            }
+
+            flat_hash_table_const_iterator& operator++()
+            {
+                while (++idx_ < cap_ && dist_[idx_] == 0)
+                { /* DUMMY BODY */ }
+
+                return *this;
+            }
+
+            flat_hash_table_const_iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++(*this);
+
+                return tmp;
+            }
+
+            size_type idx() const
+            {
+                return idx_;
+            }
+
+            bool is_end() const
+            {
+                return idx_ >= cap_;
+            }
+
+        private:
+            const flat_hash_table_dist_t* dist_;
+            const value_type* slots_;
+            size_type idx_;
+            size_type cap_;
+    };
+
+    template<class Value, class CRef, class CPtr, class Size>
+    bool operator==(const flat_hash_table_const_iterator<Value, CRef, CPtr, Size>& lhs,
+                    const flat_hash_table_const_iterator<Value, CRef, CPtr, Size>& rhs)
+    {
+        if (lhs.is_end() || rhs.is_end())
+            return lhs.is_end() && rhs.is_end();
+
+        return lhs.operator->() == rhs.operator->();
+    }
+
+    template<class Value, class CRef, class CPtr, class Size>
+    bool operator!=(const flat_hash_table_const_iterator<Value, CRef, CPtr, Size>& lhs,
+                    const flat_hash_table_const_iterator<Value, CRef, CPtr, Size>& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    template<class Value, class Ref, class Ptr, class CRef, class CPtr, class Size>
+    bool operator==(const flat_hash_table_iterator<Value, Ref, Ptr, Size>& lhs,
+                    const flat_hash_table_const_iterator<Value, CRef, CPtr, Size>& rhs)
+    {
+        return flat_hash_table_const_iterator<Value, CRef, CPtr, Size>{lhs} == rhs;
+    }
+
+    template<class Value, class Ref, class Ptr, class CRef, class CPtr, class Size>
+    bool operator!=(const flat_hash_table_iterator<Value, Ref, Ptr, Size>& lhs,
+                    const flat_hash_table_const_iterator<Value, CRef, CPtr, Size>& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    template<class Value, class CRef, class CPtr, class Ref, class Ptr, class Size>
+    bool operator==(const flat_hash_table_const_iterator<Value, CRef, CPtr, Size>& lhs,
+                    const flat_hash_table_iterator<Value, Ref, Ptr, Size>& rhs)
+    {
+        return lhs == flat_hash_table_const_iterator<Value, CRef, CPtr, Size>{rhs};
+    }
+
+    template<class Value, class CRef, class CPtr, class Ref, class Ptr, class Size>
+    bool operator!=(const flat_hash_table_const_iterator<Value, CRef, CPtr, Size>& lhs,
+                    const flat_hash_table_iterator<Value, Ref, Ptr, Size>& rhs)
+    {
+        return !(lhs == rhs);
+    }
+}
+
+#endif
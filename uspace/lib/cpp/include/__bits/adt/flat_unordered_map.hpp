@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBCPP_BITS_ADT_FLAT_UNORDERED_MAP
+#define LIBCPP_BITS_ADT_FLAT_UNORDERED_MAP
+
+#include <__bits/adt/flat_hash_table.hpp>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace std::aux
+{
+    /**
+     * Non-standard associative container with the interface
+     * of unordered_map (minus the bucket interface and node
+     * handles) built on top of the open addressing flat_hash_table.
+     * Unlike unordered_map it does not allocate per element and
+     * lookups do not chase pointers, but insertions and erasures
+     * invalidate all iterators, references and pointers into
+     * the container.
+     */
+    template<
+        class Key, class Value,
+        class Hash = std::hash<Key>,
+        class Pred = std::equal_to<Key>
+    >
+    class flat_unordered_map
+    {
+        public:
+            using key_type        = Key;
+            using mapped_type     = Value;
+            using value_type      = pair<const key_type, mapped_type>;
+            using hasher          = Hash;
+            using key_equal       = Pred;
+            using pointer         = value_type*;
+            using const_pointer   = const value_type*;
+            using reference       = value_type&;
+            using const_reference = const value_type&;
+            using size_type       = size_t;
+            using difference_type = ptrdiff_t;
+
+            using iterator        = flat_hash_table_iterator<
+                value_type, reference, pointer, size_type
+            >;
+            using const_iterator  = flat_hash_table_const_iterator<
+                value_type, const_reference, const_pointer, size_type
+            >;
+
+            flat_unordered_map()
+                : flat_unordered_map(size_type{})
+            { /* DUMMY BODY */ }
+
+            explicit flat_unordered_map(size_type bucket_count,
+                                        const hasher& hf = hasher{},
+                                        const key_equal& eql = key_equal{})
+                : table_{bucket_count, hf, eql}
+            { /* DUMMY BODY */ }
+
+            template<class InputIterator>
+            flat_unordered_map(InputIterator first, InputIterator last,
+                               size_type bucket_count = size_type{},
+                               const hasher& hf = hasher{},
+                               const key_equal& eql = key_equal{})
+                : flat_unordered_map{bucket_count, hf, eql}
+            {
+                insert(first, last);
+            }
+
+            flat_unordered_map(initializer_list<value_type> init,
+                               size_type bucket_count = size_type{},
+                               const hasher& hf = hasher{},
+                               const key_equal& eql = key_equal{})
+                : flat_unordered_map{bucket_count, hf, eql}
+            {
+                insert(init.begin(), init.end());
+            }
+
+            flat_unordered_map(const flat_unordered_map&) = default;
+            flat_unordered_map(flat_unordered_map&&) = default;
+            flat_unordered_map& operator=(const flat_unordered_map&) = default;
+            flat_unordered_map& operator=(flat_unordered_map&&) = default;
+
+            flat_unordered_map& operator=(initializer_list<value_type> init)
+            {
+                table_.clear();
+                table_.reserve(init.size());
+
+                insert(init.begin(), init.end());
+
+                return *this;
+            }
+
+            bool empty() const noexcept
+            {
+                return table_.empty();
+            }
+
+            size_type size() const noexcept
+            {
+                return table_.size();
+            }
+
+            size_type max_size() const noexcept
+            {
+                return table_.max_size();
+            }
+
+            iterator begin() noexcept
+            {
+                return table_.begin();
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return table_.begin();
+            }
+
+            iterator end() noexcept
+            {
+                return table_.end();
+            }
+
+            const_iterator end() const noexcept
+            {
+                return table_.end();
+            }
+
+            const_iterator cbegin() const noexcept
+            {
+                return table_.cbegin();
+            }
+
+            const_iterator cend() const noexcept
+            {
+                return table_.cend();
+            }
+
+            template<class... Args>
+            pair<iterator, bool> emplace(Args&&... args)
+            {
+                return table_.emplace(forward<Args>(args)...);
+            }
+
+            template<class... Args>
+            pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+            {
+                return table_.try_emplace(key, mapped_type(forward<Args>(args)...));
+            }
+
+            template<class... Args>
+            pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+            {
+                return table_.try_emplace(move(key), mapped_type(forward<Args>(args)...));
+            }
+
+            pair<iterator, bool> insert(const value_type& val)
+            {
+                return table_.insert(val);
+            }
+
+            pair<iterator, bool> insert(value_type&& val)
+            {
+                return table_.insert(forward<value_type>(val));
+            }
+
+            template<class T>
+            enable_if_t<is_constructible_v<value_type, T&&>, pair<iterator, bool>>
+            insert(T&& val)
+            {
+                return emplace(forward<T>(val));
+            }
+
+            template<class InputIterator>
+            void insert(InputIterator first, InputIterator last)
+            {
+                while (first != last)
+                    insert(*first++);
+            }
+
+            void insert(initializer_list<value_type> init)
+            {
+                insert(init.begin(), init.end());
+            }
+
+            template<class T>
+            pair<iterator, bool> insert_or_assign(const key_type& key, T&& val)
+            {
+                auto res = table_.try_emplace(key, forward<T>(val));
+                if (!res.second)
+                    res.first->second = forward<T>(val);
+
+                return res;
+            }
+
+            template<class T>
+            pair<iterator, bool> insert_or_assign(key_type&& key, T&& val)
+            {
+                auto res = table_.try_emplace(move(key), forward<T>(val));
+                if (!res.second)
+                    res.first->second = forward<T>(val);
+
+                return res;
+            }
+
+            iterator erase(const_iterator position)
+            {
+                return table_.erase(position);
+            }
+
+            size_type erase(const key_type& key)
+            {
+                return table_.erase(key);
+            }
+
+            iterator erase(const_iterator first, const_iterator last)
+            {
+                /**
+                 * Note: Erasure shifts the following elements, so
+                 *       last might not point to the same element
+                 *       after the first erase, but the relative order
+                 *       of elements does not change.
+                 */
+                auto count = distance(first, last);
+                while (count-- > 0)
+                    first = table_.erase(first);
+
+                return table_.make_iterator(first);
+            }
+
+            void clear() noexcept
+            {
+                table_.clear();
+            }
+
+            void swap(flat_unordered_map& other)
+                noexcept(noexcept(std::swap(declval<hasher&>(), declval<hasher&>())) &&
+                         noexcept(std::swap(declval<key_equal&>(), declval<key_equal&>())))
+            {
+                table_.swap(other.table_);
+            }
+
+            hasher hash_function() const
+            {
+                return table_.hash_function();
+            }
+
+            key_equal key_eq() const
+            {
+                return table_.key_eq();
+            }
+
+            iterator find(const key_type& key)
+            {
+                return table_.find(key);
+            }
+
+            const_iterator find(const key_type& key) const
+            {
+                return table_.find(key);
+            }
+
+            size_type count(const key_type& key) const
+            {
+                return table_.count(key);
+            }
+
+            pair<iterator, iterator> equal_range(const key_type& key)
+            {
+                auto it = find(key);
+                if (it == end())
+                    return make_pair(it, it);
+
+                auto next = it;
+                return make_pair(it, ++next);
+            }
+
+            pair<const_iterator, const_iterator> equal_range(const key_type& key) const
+            {
+                auto it = find(key);
+                if (it == end())
+                    return make_pair(it, it);
+
+                auto next = it;
+                return make_pair(it, ++next);
+            }
+
+            mapped_type& operator[](const key_type& key)
+            {
+                return table_.try_emplace(key, mapped_type{}).first->second;
+            }
+
+            mapped_type& operator[](key_type&& key)
+            {
+                return table_.try_emplace(move(key), mapped_type{}).first->second;
+            }
+
+            mapped_type& at(const key_type& key)
+            {
+                auto it = find(key);
+
+                // TODO: throw out_of_range if it == end()
+                return it->second;
+            }
+
+            const mapped_type& at(const key_type& key) const
+            {
+                auto it = find(key);
+
+                // TODO: throw out_of_range if it == end()
+                return it->second;
+            }
+
+            size_type bucket_count() const noexcept
+            {
+                return table_.bucket_count();
+            }
+
+            float load_factor() const noexcept
+            {
+                return table_.load_factor();
+            }
+
+            float max_load_factor() const noexcept
+            {
+                return table_.max_load_factor();
+            }
+
+            void max_load_factor(float factor)
+            {
+                table_.max_load_factor(factor);
+            }
+
+            void rehash(size_type bucket_count)
+            {
+                table_.rehash(bucket_count);
+            }
+
+            void reserve(size_type count)
+            {
+                table_.reserve(count);
+            }
+
+            bool is_eq_to(const flat_unordered_map& other) const
+            {
+                return table_.is_eq_to(other.table_);
+            }
+
+        private:
+            using table_type = flat_hash_table<
+                value_type, key_type,
+                key_value_key_extractor<key_type, mapped_type>,
+                hasher, key_equal, size_type,
+                iterator, const_iterator
+            >;
+
+            table_type table_;
+    };
+
+    template<class Key, class Value, class Hash, class Pred>
+    void swap(flat_unordered_map<Key, Value, Hash, Pred>& lhs,
+              flat_unordered_map<Key, Value, Hash, Pred>& rhs)
+        noexcept(noexcept(lhs.swap(rhs)))
+    {
+        lhs.swap(rhs);
+    }
+
+    template<class Key, class Value, class Hash, class Pred>
+    bool operator==(const flat_unordered_map<Key, Value, Hash, Pred>& lhs,
+                    const flat_unordered_map<Key, Value, Hash, Pred>& rhs)
+    {
+        return lhs.is_eq_to(rhs);
+    }
+
+    template<class Key, class Value, class Hash, class Pred>
+    bool operator!=(const flat_unordered_map<Key, Value, Hash, Pred>& lhs,
+                    const flat_unordered_map<Key, Value, Hash, Pred>& rhs)
+    {
+        return !(lhs == rhs);
+    }
+}
+
+#endif
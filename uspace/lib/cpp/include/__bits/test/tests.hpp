@@ -205,6 +205,7 @@ namespace std::test
             void test_histogram();
             void test_emplace_insert();
             void test_multi();
+            void test_flat();
     };
 
     class unordered_set_test: public test_suite
@@ -217,6 +218,7 @@ namespace std::test
             void test_constructors_and_assignment();
             void test_emplace_insert();
             void test_multi();
+            void test_flat();
     };
 
     class numeric_test: public test_suite
@@ -308,6 +310,17 @@ namespace std::test
             void test_packaged_task();
             void test_shared_future();
     };
+
+    class thread_test: public test_suite
+    {
+        public:
+            bool run(bool) override;
+            const char* name() override;
+        private:
+            void test_join_detach();
+            void test_pool();
+            void test_speedup();
+    };
 }
 
 #endif
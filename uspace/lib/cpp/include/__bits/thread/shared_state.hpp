@@ -38,6 +38,7 @@
 #include <__bits/functional/invoke.hpp>
 #include <__bits/refcount_obj.hpp>
 #include <__bits/thread/future_common.hpp>
+#include <__bits/thread/thread_pool.hpp>
 #include <__bits/thread/threading.hpp>
 #include <cerrno>
 #include <thread>
@@ -269,43 +270,44 @@ namespace std::aux
      * R template parameter and void.
      */
 
+    /**
+     * Async states are executed by the thread pool instead
+     * of a dedicated thread, so that std::async does not pay
+     * for thread creation on every call. If the task is still
+     * queued when somebody waits for it, it is run inline
+     * by the waiter.
+     */
     template<class R, class F, class... Args>
-    class async_shared_state: public shared_state<R>
+    class async_shared_state: public shared_state<R>, public pool_task
     {
         public:
             async_shared_state(F&& f, Args&&... args)
-                : shared_state<R>{}, thread_{}
+                : shared_state<R>{}, pool_task{}, func_{forward<F>(f)},
+                  args_{forward<Args>(args)...}
             {
-                thread_ = thread{
-                    [=](){
-                        try
-                        {
-                            if constexpr (!is_same_v<R, void>)
-                                this->set_value(invoke(f, args...));
-                            else
-                            {
-                                invoke(f, args...);
-                                this->mark_set(true);
-                            }
-                        }
-                        catch(const exception& __exception)
-                        {
-                            this->set_exception(make_exception_ptr(__exception));
-                        }
-                    }
-                };
+                thread_pool::instance().submit(this);
+            }
+
+            void run() override
+            {
+                invoke_(make_index_sequence<sizeof...(Args)>{});
             }
 
             void destroy() override
             {
-                if (!this->is_set())
-                    thread_.join();
+                wait();
             }
 
             void wait() const override
             {
-                if (!this->is_set())
-                    const_cast<thread&>(thread_).join();
+                auto self = const_cast<
+                    async_shared_state<R, F, Args...>*
+                >(this);
+
+                if (thread_pool::instance().cancel(self))
+                    self->run();
+                else
+                    shared_state_base::wait();
             }
 
             ~async_shared_state() override
@@ -314,21 +316,53 @@ namespace std::aux
             }
 
         protected:
-            future_status timed_wait_(aux::time_unit_t time) const override
+            decay_t<F> func_;
+            tuple<decay_t<Args>...> args_;
+
+            template<size_t... Is>
+            void invoke_(index_sequence<Is...>)
             {
+                try
+                {
+                    if constexpr (!is_same_v<R, void>)
+                    {
+                        auto res = invoke(move(func_), get<Is>(move(args_))...);
+
+                        aux::threading::mutex::lock(this->mutex_);
+                        this->value_ = move(res);
+                    }
+                    else
+                    {
+                        invoke(move(func_), get<Is>(move(args_))...);
+
+                        aux::threading::mutex::lock(this->mutex_);
+                    }
+                }
+                catch(const exception& __exception)
+                {
+                    aux::threading::mutex::lock(this->mutex_);
+                    this->set_exception(make_exception_ptr(__exception));
+                }
+
                 /**
-                 * Note: Currently we have no timed join, but this
-                 *       behaviour should be compliant.
+                 * Note: The broadcast is done with the mutex held,
+                 *       the waiter is free to destroy the state as
+                 *       soon as it sees it marked as set.
                  */
-                aux::threading::time::sleep(time);
+                this->mark_set(true);
+                aux::threading::condvar::broadcast(this->condvar_);
+                aux::threading::mutex::unlock(this->mutex_);
+            }
+
+            future_status timed_wait_(aux::time_unit_t time) const override
+            {
+                shared_state_base::timed_wait_(time);
+
                 if (this->value_set_)
                     return future_status::ready;
                 else
                     return future_status::timeout;
             }
-
-        private:
-            thread thread_;
     };
 
     template<class R, class F, class... Args>
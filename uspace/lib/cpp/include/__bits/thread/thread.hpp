@@ -70,9 +70,21 @@ namespace std
                     return finished_;
                 }
 
-                void detach()
+                /**
+                 * Returns true if the thread has already
+                 * finished, in which case the caller is
+                 * responsible for deleting the wrapper.
+                 * Otherwise, the thread will delete it once
+                 * it finishes.
+                 */
+                bool detach()
                 {
+                    aux::threading::mutex::lock(join_mtx_);
+                    bool finished = finished_;
                     detached_ = true;
+                    aux::threading::mutex::unlock(join_mtx_);
+
+                    return finished;
                 }
 
                 bool detached() const
@@ -80,6 +92,8 @@ namespace std
                     return detached_;
                 }
 
+                virtual ~joinable_wrapper() = default;
+
             protected:
                 aux::mutex_t join_mtx_;
                 aux::condvar_t join_cv_;
@@ -95,15 +109,26 @@ namespace std
                     : joinable_wrapper{}, callable_{forward<Callable>(clbl)}
                 { /* DUMMY BODY */ }
 
-                void operator()()
+                /**
+                 * Returns true if the thread was detached
+                 * and the wrapper should be deleted by it.
+                 */
+                bool operator()()
                 {
                     callable_();
 
+                    /**
+                     * Note: The broadcast is done with the mutex
+                     *       held, because the joiner is free to
+                     *       delete the wrapper once it sees finished_.
+                     */
                     aux::threading::mutex::lock(join_mtx_);
                     finished_ = true;
+                    bool detached = detached_;
+                    aux::threading::condvar::broadcast(join_cv_);
                     aux::threading::mutex::unlock(join_mtx_);
 
-                    aux::threading::condvar::broadcast(join_cv_);
+                    return detached;
                 }
 
             private:
@@ -194,9 +219,7 @@ namespace std
                 return 1;
 
             auto callable = static_cast<CallablePtr>(clbl);
-            (*callable)();
-
-            if (callable->detached())
+            if ((*callable)())
                 delete callable;
 
             return 0;
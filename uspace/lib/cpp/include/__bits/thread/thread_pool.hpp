@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBCPP_BITS_THREAD_THREAD_POOL
+#define LIBCPP_BITS_THREAD_THREAD_POOL
+
+#include <__bits/thread/threading.hpp>
+
+namespace std::aux
+{
+    /**
+     * Unit of work executed by the thread pool. The pool
+     * links the tasks intrusively so that submitting a task
+     * does not require any allocation.
+     */
+    class pool_task
+    {
+        public:
+            virtual void run() = 0;
+
+            virtual ~pool_task() = default;
+
+        private:
+            pool_task* next_{nullptr};
+            pool_task* prev_{nullptr};
+            bool queued_{false};
+
+            friend class thread_pool;
+    };
+
+    /**
+     * Bounded pool of worker threads executing the tasks
+     * created by std::async with the std::launch::async
+     * policy. Workers are spawned lazily (up to a limit
+     * derived from the number of processors) and are never
+     * destroyed, idle workers simply wait for more work.
+     */
+    class thread_pool
+    {
+        public:
+            static thread_pool& instance();
+
+            void submit(pool_task* task);
+
+            /**
+             * Removes a task from the queue if no worker
+             * picked it up yet, in which case the caller is
+             * responsible for running it. This is used to
+             * run tasks inline when they are waited for,
+             * which prevents deadlocks when all workers are
+             * waiting for tasks still sitting in the queue.
+             */
+            bool cancel(pool_task* task);
+
+            unsigned max_workers() const noexcept
+            {
+                return max_workers_;
+            }
+
+        private:
+            thread_pool();
+
+            pool_task* pop_();
+            void worker_();
+
+            static int worker_main_(void*);
+
+            mutex_t mtx_;
+            condvar_t cv_;
+
+            pool_task* head_;
+            pool_task* tail_;
+
+            unsigned workers_;
+            unsigned idle_;
+            unsigned max_workers_;
+    };
+}
+
+#endif
@@ -209,13 +209,44 @@ namespace std::aux
         };
     };
 
+    /**
+     * Number of online processors, always at least one.
+     */
+    unsigned hardware_concurrency() noexcept;
+
+    /**
+     * Makes sure the fibril runtime has more than one runner
+     * thread so that ready fibrils can be executed in parallel.
+     * Only the first call has any effect.
+     */
+    void ensure_runners() noexcept;
+
+    /**
+     * Fibrils themselves are executed by kernel threads (runners)
+     * and the fibril synchronization primitives work across them,
+     * so the only thing the thread policy has to add is to make sure
+     * there are enough runners for the created fibrils to actually
+     * run on all processors.
+     */
     template<>
-    struct threading_policy<thread_tag>
+    struct threading_policy<thread_tag>: threading_policy<fibril_tag>
     {
-        // TODO:
+        struct thread: threading_policy<fibril_tag>::thread
+        {
+            static void start(thread_type thr)
+            {
+                ensure_runners();
+                threading_policy<fibril_tag>::thread::start(thr);
+            }
+
+            static unsigned concurrency()
+            {
+                return hardware_concurrency();
+            }
+        };
     };
 
-    using default_tag = fibril_tag;
+    using default_tag = thread_tag;
     using threading = threading_policy<default_tag>;
 
     using thread_t       = typename threading::thread_type;
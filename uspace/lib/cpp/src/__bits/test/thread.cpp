@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <__bits/test/tests.hpp>
+#include <__bits/thread/thread_pool.hpp>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /**
+     * CPU-bound workload that cannot be optimized away,
+     * the result depends on every iteration.
+     */
+    unsigned long long spin(unsigned long long seed, unsigned long long iters)
+    {
+        auto x = seed;
+        for (unsigned long long i = 0; i < iters; ++i)
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+
+        return x;
+    }
+
+    constexpr unsigned long long spin_iters{20'000'000ULL};
+}
+
+namespace std::test
+{
+    bool thread_test::run(bool report)
+    {
+        report_ = report;
+        start();
+
+        test_join_detach();
+        test_pool();
+        test_speedup();
+
+        return end();
+    }
+
+    const char* thread_test::name()
+    {
+        return "thread";
+    }
+
+    void thread_test::test_join_detach()
+    {
+        std::thread t1{};
+        test("default constructed not joinable", !t1.joinable());
+
+        int x{};
+        std::thread t2{
+            [&x](){
+                x = 42;
+            }
+        };
+        test("running thread joinable", t2.joinable());
+
+        t2.join();
+        test("joined thread not joinable", !t2.joinable());
+        test_eq("join waits for the thread", x, 42);
+
+        std::thread t3{
+            [](){
+                std::this_thread::yield();
+            }
+        };
+        t3.detach();
+        test("detached thread not joinable", !t3.joinable());
+
+        std::thread t4{
+            [&x](){
+                x = 1337;
+            }
+        };
+        std::thread t5{std::move(t4)};
+        test("move construction source not joinable", !t4.joinable());
+        test("move construction destination joinable", t5.joinable());
+
+        t5.join();
+        test_eq("moved thread joined", x, 1337);
+
+        test("hardware_concurrency nonzero", std::thread::hardware_concurrency() > 0);
+    }
+
+    void thread_test::test_pool()
+    {
+        /**
+         * More tasks than there are workers, the ones
+         * still queued when waited for are run inline.
+         */
+        auto count = std::aux::thread_pool::instance().max_workers() * 2;
+
+        std::vector<std::future<int>> futures{};
+        for (unsigned i = 0; i < count; ++i)
+        {
+            futures.push_back(std::async(
+                std::launch::async, [i](){
+                    return static_cast<int>(i);
+                }
+            ));
+        }
+
+        bool ok{true};
+        for (unsigned i = 0; i < count; ++i)
+            ok &= futures[i].get() == static_cast<int>(i);
+        test("pool runs more tasks than workers", ok);
+
+        /**
+         * The outer task blocks a worker while waiting for
+         * the inner one, which must not deadlock the pool.
+         */
+        auto outer = std::async(
+            std::launch::async, [](){
+                auto inner = std::async(
+                    std::launch::async, [](){
+                        return 21;
+                    }
+                );
+
+                return inner.get() * 2;
+            }
+        );
+        test_eq("nested async", outer.get(), 42);
+    }
+
+    void thread_test::test_speedup()
+    {
+        auto workers = std::thread::hardware_concurrency();
+
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long serial{};
+        for (unsigned i = 0; i < workers; ++i)
+            serial ^= spin(i, spin_iters);
+        auto serial_time = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        std::vector<std::future<unsigned long long>> futures{};
+        for (unsigned i = 0; i < workers; ++i)
+        {
+            futures.push_back(std::async(
+                std::launch::async, [i](){
+                    return spin(i, spin_iters);
+                }
+            ));
+        }
+
+        unsigned long long parallel{};
+        for (auto& f: futures)
+            parallel ^= f.get();
+        auto parallel_time = std::chrono::steady_clock::now() - start;
+
+        test_eq("parallel result matches serial", parallel, serial);
+
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        auto serial_us = duration_cast<microseconds>(serial_time).count();
+        auto parallel_us = duration_cast<microseconds>(parallel_time).count();
+
+        /**
+         * Note: The speedup is only reported, the timing depends
+         *       too much on the load of the (possibly emulated)
+         *       machine to be tested.
+         */
+        if (report_)
+        {
+            std::printf("[%s] %u workers: serial %lld us, parallel %lld us\n",
+                        name(), workers, static_cast<long long>(serial_us),
+                        static_cast<long long>(parallel_us));
+        }
+    }
+}
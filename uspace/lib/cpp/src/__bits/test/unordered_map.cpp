@@ -44,6 +44,7 @@ namespace std::test
         test_histogram();
         test_emplace_insert();
         test_multi();
+        test_flat();
 
         return end();
     }
@@ -263,4 +264,85 @@ namespace std::test
         test_eq("multi erase by iterator pt1", res7->first, 7);
         test_eq("multi erase by iterator pt2", mmap.count(7), 1U);
     }
+
+    void unordered_map_test::test_flat()
+    {
+        std::aux::flat_unordered_map<int, int> map{};
+        test("flat default constructed empty", map.empty());
+
+        auto res1 = map.emplace(1, 10);
+        test("flat emplace inserts", res1.second);
+        test_eq("flat emplace iterator", res1.first->second, 10);
+
+        auto res2 = map.emplace(1, 20);
+        test("flat duplicit emplace does not insert", !res2.second);
+        test_eq("flat duplicit emplace keeps value", map[1], 10);
+
+        map[2] = 20;
+        test_eq("flat operator[] inserts", map.at(2), 20);
+
+        auto res3 = map.insert_or_assign(2, 42);
+        test("flat insert_or_assign existing", !res3.second);
+        test_eq("flat insert_or_assign assigns", map[2], 42);
+
+        /**
+         * Enough elements to force several rehashes and
+         * long probe sequences.
+         */
+        constexpr int count{5000};
+        for (int i = 0; i < count; ++i)
+            map[i] = i * 2;
+        test_eq("flat size after growth", map.size(), static_cast<size_t>(count));
+
+        bool ok{true};
+        for (int i = 0; i < count; ++i)
+            ok &= map.count(i) == 1 && map.at(i) == i * 2;
+        test("flat lookup after growth", ok);
+        test("flat missing key", map.find(count) == map.end());
+
+        size_t visited{};
+        for (const auto& x: map)
+            visited += (x.second == x.first * 2) ? 1 : 0;
+        test_eq("flat iteration", visited, map.size());
+
+        for (int i = 0; i < count; i += 2)
+            map.erase(i);
+        test_eq("flat size after erase", map.size(), static_cast<size_t>(count / 2));
+
+        ok = true;
+        for (int i = 0; i < count; ++i)
+            ok &= map.count(i) == static_cast<size_t>(i % 2);
+        test("flat lookup after erase", ok);
+
+        size_t erased{};
+        for (auto it = map.begin(); it != map.end();)
+        {
+            if (it->first % 3 == 0)
+            {
+                it = map.erase(it);
+                ++erased;
+            }
+            else
+                ++it;
+        }
+
+        ok = true;
+        for (const auto& x: map)
+            ok &= x.first % 3 != 0;
+        test("flat erase while iterating", ok);
+        test_eq("flat erase while iterating count", map.size() + erased,
+                static_cast<size_t>(count / 2));
+
+        auto copy = map;
+        test("flat copy equal", copy == map);
+
+        copy.erase(copy.begin(), copy.end());
+        test("flat range erase", copy.empty());
+
+        std::aux::flat_unordered_map<std::string, int> smap{
+            {"one", 1}, {"two", 2}, {"three", 3}
+        };
+        test_eq("flat string keys", smap["two"], 2);
+        test_eq("flat string keys size", smap.size(), 3U);
+    }
 }
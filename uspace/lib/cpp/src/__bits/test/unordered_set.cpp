@@ -42,6 +42,7 @@ namespace std::test
         test_constructors_and_assignment();
         test_emplace_insert();
         test_multi();
+        test_flat();
 
         return end();
     }
@@ -211,4 +212,42 @@ namespace std::test
         test_eq("multi erase by iterator pt1", *res7, 7);
         test_eq("multi erase by iterator pt2", mset.count(7), 1U);
     }
+
+    void unordered_set_test::test_flat()
+    {
+        auto check = {1, 2, 3, 4, 5, 6, 7};
+        std::aux::flat_unordered_set<int> set{check};
+        test_contains("flat initializer list", check.begin(), check.end(), set);
+        test_eq("flat size", set.size(), 7U);
+
+        auto res1 = set.insert(4);
+        test("flat duplicit insert", !res1.second);
+        test_eq("flat duplicit insert iterator", *res1.first, 4);
+
+        auto res2 = set.emplace(8);
+        test("flat unique emplace", res2.second);
+        test_eq("flat unique emplace iterator", *res2.first, 8);
+
+        test_eq("flat erase by key", set.erase(1), 1U);
+        test_eq("flat erase missing key", set.erase(1), 0U);
+        test("flat erased key missing", set.find(1) == set.end());
+
+        constexpr int count{10000};
+        for (int i = 0; i < count; ++i)
+            set.insert(i * 7);
+
+        bool ok{true};
+        for (int i = 0; i < count; ++i)
+            ok &= set.count(i * 7) == 1;
+        test("flat lookup after growth", ok);
+
+        std::aux::flat_unordered_set<int> other{set};
+        test("flat copy equal", other == set);
+
+        other.erase(0);
+        test("flat copy independent", other != set);
+
+        other.clear();
+        test("flat clear", other.empty() && other.begin() == other.end());
+    }
 }
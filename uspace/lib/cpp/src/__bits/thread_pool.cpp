@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <__bits/thread/thread_pool.hpp>
+#include <__bits/thread/threading.hpp>
+
+namespace std::aux
+{
+    thread_pool& thread_pool::instance()
+    {
+        static thread_pool pool{};
+
+        return pool;
+    }
+
+    thread_pool::thread_pool()
+        : mtx_{}, cv_{}, head_{nullptr}, tail_{nullptr},
+          workers_{}, idle_{}, max_workers_{}
+    {
+        threading::mutex::init(mtx_);
+        threading::condvar::init(cv_);
+
+        /**
+         * Note: Workers blocked in a task keep their slot,
+         *       so we allow more workers than there are processors
+         *       to keep the pool usable for tasks that wait for
+         *       something else than other tasks.
+         */
+        max_workers_ = 4 * threading::thread::concurrency();
+        if (max_workers_ < 8)
+            max_workers_ = 8;
+    }
+
+    void thread_pool::submit(pool_task* task)
+    {
+        threading::mutex::lock(mtx_);
+
+        task->next_ = nullptr;
+        task->prev_ = tail_;
+        task->queued_ = true;
+
+        if (tail_)
+            tail_->next_ = task;
+        else
+            head_ = task;
+        tail_ = task;
+
+        bool spawn = idle_ == 0 && workers_ < max_workers_;
+        if (spawn)
+            ++workers_;
+
+        threading::mutex::unlock(mtx_);
+
+        if (spawn)
+        {
+            auto thr = threading::thread::create(worker_main_, *this);
+            if (thr != thread_t{})
+                threading::thread::start(thr);
+            else
+            {
+                /**
+                 * The task stays queued, it will be either picked
+                 * up by an existing worker or run by its waiter.
+                 */
+                threading::mutex::lock(mtx_);
+                --workers_;
+                threading::mutex::unlock(mtx_);
+            }
+        }
+
+        threading::condvar::signal(cv_);
+    }
+
+    bool thread_pool::cancel(pool_task* task)
+    {
+        threading::mutex::lock(mtx_);
+
+        bool queued = task->queued_;
+        if (queued)
+        {
+            if (task->prev_)
+                task->prev_->next_ = task->next_;
+            else
+                head_ = task->next_;
+
+            if (task->next_)
+                task->next_->prev_ = task->prev_;
+            else
+                tail_ = task->prev_;
+
+            task->next_ = nullptr;
+            task->prev_ = nullptr;
+            task->queued_ = false;
+        }
+
+        threading::mutex::unlock(mtx_);
+
+        return queued;
+    }
+
+    pool_task* thread_pool::pop_()
+    {
+        auto task = head_;
+
+        head_ = task->next_;
+        if (head_)
+            head_->prev_ = nullptr;
+        else
+            tail_ = nullptr;
+
+        task->next_ = nullptr;
+        task->queued_ = false;
+
+        return task;
+    }
+
+    void thread_pool::worker_()
+    {
+        while (true)
+        {
+            threading::mutex::lock(mtx_);
+
+            ++idle_;
+            while (!head_)
+                threading::condvar::wait(cv_, mtx_);
+            --idle_;
+
+            auto task = pop_();
+
+            threading::mutex::unlock(mtx_);
+
+            /**
+             * Note: The task may be destroyed by its waiter
+             *       as soon as it finishes, so we must not
+             *       touch it after run() returns.
+             */
+            task->run();
+        }
+    }
+
+    int thread_pool::worker_main_(void* arg)
+    {
+        static_cast<thread_pool*>(arg)->worker_();
+
+        return 0;
+    }
+}
@@ -32,6 +32,9 @@
 #include <thread>
 #include <utility>
 
+#include <fibril.h>
+#include <sysinfo.h>
+
 namespace std
 {
     thread::thread() noexcept
@@ -45,12 +48,13 @@ namespace std
         if (joinable() && false)
             std::terminate();
 
-        // TODO: check for finished too?
-        // TODO: WAIT! if it's not detached, then
-        //       we are joinable and std::terminate was called?
-        // TODO: review this entire thing
-        if (joinable_wrapper_ && !joinable_wrapper_->detached())
-            delete joinable_wrapper_;
+        /**
+         * Until we can terminate here, a thread that is
+         * still joinable gets detached so that its wrapper
+         * is not deleted under its feet.
+         */
+        if (joinable())
+            detach();
     }
 
     thread::thread(thread&& other) noexcept
@@ -87,8 +91,18 @@ namespace std
 
     void thread::join()
     {
-        if (joinable() && joinable_wrapper_)
+        if (!joinable())
+            return;
+
+        if (joinable_wrapper_)
+        {
             joinable_wrapper_->join();
+
+            delete joinable_wrapper_;
+            joinable_wrapper_ = nullptr;
+        }
+
+        id_ = aux::thread_t{};
     }
 
     void thread::detach()
@@ -97,7 +111,8 @@ namespace std
 
         if (joinable_wrapper_)
         {
-            joinable_wrapper_->detach();
+            if (joinable_wrapper_->detach())
+                delete joinable_wrapper_;
             joinable_wrapper_ = nullptr;
         }
     }
@@ -119,9 +134,55 @@ namespace std
 
     unsigned thread::hardware_concurrency() noexcept
     {
-        // TODO:
-        __unimplemented();
-        return 0;
+        return aux::hardware_concurrency();
+    }
+
+    namespace aux
+    {
+        unsigned hardware_concurrency() noexcept
+        {
+            static unsigned count{};
+
+            auto res = __atomic_load_n(&count, __ATOMIC_RELAXED);
+            if (res != 0)
+                return res;
+
+            size_t size{};
+            auto cpus = static_cast<stats_cpu_t*>(
+                ::helenos::sysinfo_get_data("system.cpus", &size)
+            );
+
+            res = 0;
+            if (cpus && (size % sizeof(stats_cpu_t)) == 0)
+            {
+                for (size_t i = 0; i < size / sizeof(stats_cpu_t); ++i)
+                {
+                    if (cpus[i].active)
+                        ++res;
+                }
+            }
+            std::free(cpus);
+
+            if (res == 0)
+                res = 1;
+            __atomic_store_n(&count, res, __ATOMIC_RELAXED);
+
+            return res;
+        }
+
+        void ensure_runners() noexcept
+        {
+            static bool spawned{false};
+
+            if (__atomic_exchange_n(&spawned, true, __ATOMIC_ACQ_REL))
+                return;
+
+            /**
+             * Uses the default number of runners of libc,
+             * the main thread of the task is already one of them.
+             */
+            ::helenos::fibril_enable_multithreaded();
+        }
     }
 
     void swap(thread& x, thread& y) noexcept
@@ -28,9 +28,15 @@
 
 /** @file aes.c
  *
- * Implementation of AES-128 symmetric cipher cryptographic algorithm.
+ * Implementation of AES symmetric cipher cryptographic algorithm
+ * (128, 192 and 256 bit keys) and its CTR, GCM and CCM modes.
  *
- * Based on FIPS 197.
+ * The key schedule is computed once per key by aes_init(). The
+ * rounds are computed using precomputed T-tables combining the
+ * SubBytes, ShiftRows and MixColumns transformations. On amd64
+ * the AES-NI instructions are used if the processor supports them.
+ *
+ * Based on FIPS 197, NIST SP 800-38A, SP 800-38C and SP 800-38D.
  */
 
 #include <stdbool.h>
@@ -38,159 +44,230 @@
 #include <mem.h>
 #include "crypto.h"
 
-/* Number of elements in rows/columns in AES arrays. */
-#define ELEMS  4
+/* Number of AES-NI capable blocks processed at once in CTR mode. */
+#define CTR_BATCH  4
 
-/* Number of elements (words) in cipher. */
-#define CIPHER_ELEMS  4
+/* CPUID leaf 1 ECX bit indicating AES-NI support. */
+#define CPUID_ECX_AES  (1 << 25)
 
-/* Length of AES block. */
-#define BLOCK_LEN  16
+/** Precomputed values for AES sub_byte transformation. */
+static const uint8_t sbox[256] = {
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+	0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+	0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+	0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+	0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+	0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+	0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+	0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+	0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+	0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+	0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+	0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+	0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+	0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+	0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+	0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+	0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
 
-/* Number of iterations in AES algorithm. */
-#define ROUNDS  10
+/** Precomputed values for AES inv_sub_byte transformation. */
+static const uint8_t inv_sbox[256] = {
+	0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38,
+	0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+	0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
+	0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+	0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d,
+	0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+	0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2,
+	0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+	0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
+	0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+	0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda,
+	0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+	0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a,
+	0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+	0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
+	0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+	0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea,
+	0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+	0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85,
+	0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+	0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
+	0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+	0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20,
+	0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+	0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31,
+	0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+	0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
+	0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+	0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0,
+	0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+	0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26,
+	0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
+};
 
-/** Irreducible polynomial used in AES algorithm.
+/** Encryption T-table.
  *
- * NOTE: x^8 + x^4 + x^3 + x + 1.
+ * Each entry combines the substitution of a byte with the
+ * multiplication by the MixColumns matrix column (2, 1, 1, 3).
+ * The tables for the other rows are obtained by rotation.
  *
  */
-#define AES_IP  0x1b
-
-/** Precomputed values for AES sub_byte transformation. */
-static const uint8_t sbox[BLOCK_LEN][BLOCK_LEN] = {
-	{
-		0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
-		0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76
-	},
-	{
-		0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
-		0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0
-	},
-	{
-		0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
-		0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15
-	},
-	{
-		0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
-		0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75
-	},
-	{
-		0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
-		0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84
-	},
-	{
-		0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
-		0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf
-	},
-	{
-		0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
-		0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8
-	},
-	{
-		0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
-		0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2
-	},
-	{
-		0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
-		0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73
-	},
-	{
-		0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
-		0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb
-	},
-	{
-		0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
-		0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79
-	},
-	{
-		0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
-		0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08
-	},
-	{
-		0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
-		0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a
-	},
-	{
-		0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
-		0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e
-	},
-	{
-		0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
-		0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf
-	},
-	{
-		0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
-		0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
-	}
+static const uint32_t te0[256] = {
+	0xc66363a5, 0xf87c7c84, 0xee777799, 0xf67b7b8d,
+	0xfff2f20d, 0xd66b6bbd, 0xde6f6fb1, 0x91c5c554,
+	0x60303050, 0x02010103, 0xce6767a9, 0x562b2b7d,
+	0xe7fefe19, 0xb5d7d762, 0x4dababe6, 0xec76769a,
+	0x8fcaca45, 0x1f82829d, 0x89c9c940, 0xfa7d7d87,
+	0xeffafa15, 0xb25959eb, 0x8e4747c9, 0xfbf0f00b,
+	0x41adadec, 0xb3d4d467, 0x5fa2a2fd, 0x45afafea,
+	0x239c9cbf, 0x53a4a4f7, 0xe4727296, 0x9bc0c05b,
+	0x75b7b7c2, 0xe1fdfd1c, 0x3d9393ae, 0x4c26266a,
+	0x6c36365a, 0x7e3f3f41, 0xf5f7f702, 0x83cccc4f,
+	0x6834345c, 0x51a5a5f4, 0xd1e5e534, 0xf9f1f108,
+	0xe2717193, 0xabd8d873, 0x62313153, 0x2a15153f,
+	0x0804040c, 0x95c7c752, 0x46232365, 0x9dc3c35e,
+	0x30181828, 0x379696a1, 0x0a05050f, 0x2f9a9ab5,
+	0x0e070709, 0x24121236, 0x1b80809b, 0xdfe2e23d,
+	0xcdebeb26, 0x4e272769, 0x7fb2b2cd, 0xea75759f,
+	0x1209091b, 0x1d83839e, 0x582c2c74, 0x341a1a2e,
+	0x361b1b2d, 0xdc6e6eb2, 0xb45a5aee, 0x5ba0a0fb,
+	0xa45252f6, 0x763b3b4d, 0xb7d6d661, 0x7db3b3ce,
+	0x5229297b, 0xdde3e33e, 0x5e2f2f71, 0x13848497,
+	0xa65353f5, 0xb9d1d168, 0x00000000, 0xc1eded2c,
+	0x40202060, 0xe3fcfc1f, 0x79b1b1c8, 0xb65b5bed,
+	0xd46a6abe, 0x8dcbcb46, 0x67bebed9, 0x7239394b,
+	0x944a4ade, 0x984c4cd4, 0xb05858e8, 0x85cfcf4a,
+	0xbbd0d06b, 0xc5efef2a, 0x4faaaae5, 0xedfbfb16,
+	0x864343c5, 0x9a4d4dd7, 0x66333355, 0x11858594,
+	0x8a4545cf, 0xe9f9f910, 0x04020206, 0xfe7f7f81,
+	0xa05050f0, 0x783c3c44, 0x259f9fba, 0x4ba8a8e3,
+	0xa25151f3, 0x5da3a3fe, 0x804040c0, 0x058f8f8a,
+	0x3f9292ad, 0x219d9dbc, 0x70383848, 0xf1f5f504,
+	0x63bcbcdf, 0x77b6b6c1, 0xafdada75, 0x42212163,
+	0x20101030, 0xe5ffff1a, 0xfdf3f30e, 0xbfd2d26d,
+	0x81cdcd4c, 0x180c0c14, 0x26131335, 0xc3ecec2f,
+	0xbe5f5fe1, 0x359797a2, 0x884444cc, 0x2e171739,
+	0x93c4c457, 0x55a7a7f2, 0xfc7e7e82, 0x7a3d3d47,
+	0xc86464ac, 0xba5d5de7, 0x3219192b, 0xe6737395,
+	0xc06060a0, 0x19818198, 0x9e4f4fd1, 0xa3dcdc7f,
+	0x44222266, 0x542a2a7e, 0x3b9090ab, 0x0b888883,
+	0x8c4646ca, 0xc7eeee29, 0x6bb8b8d3, 0x2814143c,
+	0xa7dede79, 0xbc5e5ee2, 0x160b0b1d, 0xaddbdb76,
+	0xdbe0e03b, 0x64323256, 0x743a3a4e, 0x140a0a1e,
+	0x924949db, 0x0c06060a, 0x4824246c, 0xb85c5ce4,
+	0x9fc2c25d, 0xbdd3d36e, 0x43acacef, 0xc46262a6,
+	0x399191a8, 0x319595a4, 0xd3e4e437, 0xf279798b,
+	0xd5e7e732, 0x8bc8c843, 0x6e373759, 0xda6d6db7,
+	0x018d8d8c, 0xb1d5d564, 0x9c4e4ed2, 0x49a9a9e0,
+	0xd86c6cb4, 0xac5656fa, 0xf3f4f407, 0xcfeaea25,
+	0xca6565af, 0xf47a7a8e, 0x47aeaee9, 0x10080818,
+	0x6fbabad5, 0xf0787888, 0x4a25256f, 0x5c2e2e72,
+	0x381c1c24, 0x57a6a6f1, 0x73b4b4c7, 0x97c6c651,
+	0xcbe8e823, 0xa1dddd7c, 0xe874749c, 0x3e1f1f21,
+	0x964b4bdd, 0x61bdbddc, 0x0d8b8b86, 0x0f8a8a85,
+	0xe0707090, 0x7c3e3e42, 0x71b5b5c4, 0xcc6666aa,
+	0x904848d8, 0x06030305, 0xf7f6f601, 0x1c0e0e12,
+	0xc26161a3, 0x6a35355f, 0xae5757f9, 0x69b9b9d0,
+	0x17868691, 0x99c1c158, 0x3a1d1d27, 0x279e9eb9,
+	0xd9e1e138, 0xebf8f813, 0x2b9898b3, 0x22111133,
+	0xd26969bb, 0xa9d9d970, 0x078e8e89, 0x339494a7,
+	0x2d9b9bb6, 0x3c1e1e22, 0x15878792, 0xc9e9e920,
+	0x87cece49, 0xaa5555ff, 0x50282878, 0xa5dfdf7a,
+	0x038c8c8f, 0x59a1a1f8, 0x09898980, 0x1a0d0d17,
+	0x65bfbfda, 0xd7e6e631, 0x844242c6, 0xd06868b8,
+	0x824141c3, 0x299999b0, 0x5a2d2d77, 0x1e0f0f11,
+	0x7bb0b0cb, 0xa85454fc, 0x6dbbbbd6, 0x2c16163a
 };
 
-/** Precomputed values for AES inv_sub_byte transformation. */
-static uint8_t inv_sbox[BLOCK_LEN][BLOCK_LEN] = {
-	{
-		0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38,
-		0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb
-	},
-	{
-		0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
-		0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb
-	},
-	{
-		0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d,
-		0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e
-	},
-	{
-		0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2,
-		0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25
-	},
-	{
-		0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
-		0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92
-	},
-	{
-		0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda,
-		0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84
-	},
-	{
-		0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a,
-		0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06
-	},
-	{
-		0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
-		0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b
-	},
-	{
-		0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea,
-		0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73
-	},
-	{
-		0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85,
-		0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e
-	},
-	{
-		0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
-		0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b
-	},
-	{
-		0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20,
-		0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4
-	},
-	{
-		0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31,
-		0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f
-	},
-	{
-		0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
-		0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef
-	},
-	{
-		0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0,
-		0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61
-	},
-	{
-		0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26,
-		0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
-	}
+/** Decryption T-table.
+ *
+ * Each entry combines the inverse substitution of a byte with the
+ * multiplication by the InvMixColumns matrix column (14, 9, 13, 11).
+ * The tables for the other rows are obtained by rotation.
+ *
+ */
+static const uint32_t td0[256] = {
+	0x51f4a750, 0x7e416553, 0x1a17a4c3, 0x3a275e96,
+	0x3bab6bcb, 0x1f9d45f1, 0xacfa58ab, 0x4be30393,
+	0x2030fa55, 0xad766df6, 0x88cc7691, 0xf5024c25,
+	0x4fe5d7fc, 0xc52acbd7, 0x26354480, 0xb562a38f,
+	0xdeb15a49, 0x25ba1b67, 0x45ea0e98, 0x5dfec0e1,
+	0xc32f7502, 0x814cf012, 0x8d4697a3, 0x6bd3f9c6,
+	0x038f5fe7, 0x15929c95, 0xbf6d7aeb, 0x955259da,
+	0xd4be832d, 0x587421d3, 0x49e06929, 0x8ec9c844,
+	0x75c2896a, 0xf48e7978, 0x99583e6b, 0x27b971dd,
+	0xbee14fb6, 0xf088ad17, 0xc920ac66, 0x7dce3ab4,
+	0x63df4a18, 0xe51a3182, 0x97513360, 0x62537f45,
+	0xb16477e0, 0xbb6bae84, 0xfe81a01c, 0xf9082b94,
+	0x70486858, 0x8f45fd19, 0x94de6c87, 0x527bf8b7,
+	0xab73d323, 0x724b02e2, 0xe31f8f57, 0x6655ab2a,
+	0xb2eb2807, 0x2fb5c203, 0x86c57b9a, 0xd33708a5,
+	0x302887f2, 0x23bfa5b2, 0x02036aba, 0xed16825c,
+	0x8acf1c2b, 0xa779b492, 0xf307f2f0, 0x4e69e2a1,
+	0x65daf4cd, 0x0605bed5, 0xd134621f, 0xc4a6fe8a,
+	0x342e539d, 0xa2f355a0, 0x058ae132, 0xa4f6eb75,
+	0x0b83ec39, 0x4060efaa, 0x5e719f06, 0xbd6e1051,
+	0x3e218af9, 0x96dd063d, 0xdd3e05ae, 0x4de6bd46,
+	0x91548db5, 0x71c45d05, 0x0406d46f, 0x605015ff,
+	0x1998fb24, 0xd6bde997, 0x894043cc, 0x67d99e77,
+	0xb0e842bd, 0x07898b88, 0xe7195b38, 0x79c8eedb,
+	0xa17c0a47, 0x7c420fe9, 0xf8841ec9, 0x00000000,
+	0x09808683, 0x322bed48, 0x1e1170ac, 0x6c5a724e,
+	0xfd0efffb, 0x0f853856, 0x3daed51e, 0x362d3927,
+	0x0a0fd964, 0x685ca621, 0x9b5b54d1, 0x24362e3a,
+	0x0c0a67b1, 0x9357e70f, 0xb4ee96d2, 0x1b9b919e,
+	0x80c0c54f, 0x61dc20a2, 0x5a774b69, 0x1c121a16,
+	0xe293ba0a, 0xc0a02ae5, 0x3c22e043, 0x121b171d,
+	0x0e090d0b, 0xf28bc7ad, 0x2db6a8b9, 0x141ea9c8,
+	0x57f11985, 0xaf75074c, 0xee99ddbb, 0xa37f60fd,
+	0xf701269f, 0x5c72f5bc, 0x44663bc5, 0x5bfb7e34,
+	0x8b432976, 0xcb23c6dc, 0xb6edfc68, 0xb8e4f163,
+	0xd731dcca, 0x42638510, 0x13972240, 0x84c61120,
+	0x854a247d, 0xd2bb3df8, 0xaef93211, 0xc729a16d,
+	0x1d9e2f4b, 0xdcb230f3, 0x0d8652ec, 0x77c1e3d0,
+	0x2bb3166c, 0xa970b999, 0x119448fa, 0x47e96422,
+	0xa8fc8cc4, 0xa0f03f1a, 0x567d2cd8, 0x223390ef,
+	0x87494ec7, 0xd938d1c1, 0x8ccaa2fe, 0x98d40b36,
+	0xa6f581cf, 0xa57ade28, 0xdab78e26, 0x3fadbfa4,
+	0x2c3a9de4, 0x5078920d, 0x6a5fcc9b, 0x547e4662,
+	0xf68d13c2, 0x90d8b8e8, 0x2e39f75e, 0x82c3aff5,
+	0x9f5d80be, 0x69d0937c, 0x6fd52da9, 0xcf2512b3,
+	0xc8ac993b, 0x10187da7, 0xe89c636e, 0xdb3bbb7b,
+	0xcd267809, 0x6e5918f4, 0xec9ab701, 0x834f9aa8,
+	0xe6956e65, 0xaaffe67e, 0x21bccf08, 0xef15e8e6,
+	0xbae79bd9, 0x4a6f36ce, 0xea9f09d4, 0x29b07cd6,
+	0x31a4b2af, 0x2a3f2331, 0xc6a59430, 0x35a266c0,
+	0x744ebc37, 0xfc82caa6, 0xe090d0b0, 0x33a7d815,
+	0xf104984a, 0x41ecdaf7, 0x7fcd500e, 0x1791f62f,
+	0x764dd68d, 0x43efb04d, 0xccaa4d54, 0xe49604df,
+	0x9ed1b5e3, 0x4c6a881b, 0xc12c1fb8, 0x4665517f,
+	0x9d5eea04, 0x018c355d, 0xfa877473, 0xfb0b412e,
+	0xb3671d5a, 0x92dbd252, 0xe9105633, 0x6dd64713,
+	0x9ad7618c, 0x37a10c7a, 0x59f8148e, 0xeb133c89,
+	0xcea927ee, 0xb761c935, 0xe11ce5ed, 0x7a47b13c,
+	0x9cd2df59, 0x55f2733f, 0x1814ce79, 0x73c737bf,
+	0x53f7cdea, 0x5ffdaa5b, 0xdf3d6f14, 0x7844db86,
+	0xcaaff381, 0xb968c43e, 0x3824342c, 0xc2a3405f,
+	0x161dc372, 0xbce2250c, 0x283c498b, 0xff0d9541,
+	0x39a80171, 0x080cb3de, 0xd8b4e49c, 0x6456c190,
+	0x7bcb8461, 0xd532b670, 0x486c5c74, 0xd0b85742
 };
 
 /** Precomputed values of powers of 2 in GF(2^8) left shifted by 24b. */
@@ -200,254 +277,1106 @@ static const uint32_t r_con_array[] = {
 	0x1b000000, 0x36000000
 };
 
-/** Perform substitution transformation on given byte.
+
+/** Reduction constants for the 4-bit GHASH multiplication. */
+static const uint64_t ghash_last4[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+static inline uint32_t load_be32(const uint8_t *data)
+{
+	return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) |
+	    ((uint32_t) data[2] << 8) | (uint32_t) data[3];
+}
+
+static inline void store_be32(uint8_t *data, uint32_t val)
+{
+	data[0] = val >> 24;
+	data[1] = val >> 16;
+	data[2] = val >> 8;
+	data[3] = val;
+}
+
+static inline uint64_t load_be64(const uint8_t *data)
+{
+	return ((uint64_t) load_be32(data) << 32) | load_be32(data + 4);
+}
+
+static inline void store_be64(uint8_t *data, uint64_t val)
+{
+	store_be32(data, val >> 32);
+	store_be32(data + 4, val);
+}
+
+/** Apply sub_byte transformation on each byte of a word.
  *
- * @param byte Input byte.
- * @param inv  Flag indicating whether to use inverse table.
+ * @param word Input word.
  *
- * @return Substituted value.
+ * @return Substituted word.
  *
  */
-static uint8_t sub_byte(uint8_t byte, bool inv)
+static uint32_t sub_word(uint32_t word)
 {
-	uint8_t i = byte >> 4;
-	uint8_t j = byte & 0xF;
-
-	if (!inv)
-		return sbox[i][j];
+	return ((uint32_t) sbox[word >> 24] << 24) |
+	    ((uint32_t) sbox[(word >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[(word >> 8) & 0xff] << 8) |
+	    (uint32_t) sbox[word & 0xff];
+}
 
-	return inv_sbox[i][j];
+/** Apply InvMixColumns transformation on a round key word.
+ *
+ * @param word Input word.
+ *
+ * @return Transformed word.
+ *
+ */
+static uint32_t inv_mix_word(uint32_t word)
+{
+	return td0[sbox[word >> 24]] ^
+	    rotr_uint32(td0[sbox[(word >> 16) & 0xff]], 8) ^
+	    rotr_uint32(td0[sbox[(word >> 8) & 0xff]], 16) ^
+	    rotr_uint32(td0[sbox[word & 0xff]], 24);
 }
 
-/** Perform substitution transformation on state table.
+/** Key expansion procedure for AES algorithm.
  *
- * @param state State table to be modified.
- * @param inv   Flag indicating whether to use inverse table.
+ * Computes both the encryption round keys and the round keys of the
+ * equivalent inverse cipher (FIPS 197, section 5.3.5).
+ *
+ * @param ctx     AES context.
+ * @param key     Input key.
+ * @param key_len Key length in bytes (16, 24 or 32).
  *
  */
-static void sub_bytes(uint8_t state[ELEMS][ELEMS], bool inv)
+static void key_expansion(aes_ctx_t *ctx, const uint8_t *key, size_t key_len)
 {
-	uint8_t val;
+	size_t nk = key_len / 4;
+	size_t words = 4 * (ctx->rounds + 1);
+	uint32_t *ek = ctx->enc_key;
+	uint32_t *dk = ctx->dec_key;
+
+	for (size_t i = 0; i < nk; i++)
+		ek[i] = load_be32(key + 4 * i);
 
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++) {
-			val = state[i][j];
-			state[i][j] = sub_byte(val, inv);
+	for (size_t i = nk; i < words; i++) {
+		uint32_t temp = ek[i - 1];
+
+		if (i % nk == 0)
+			temp = sub_word(rotl_uint32(temp, 8)) ^ r_con_array[i / nk - 1];
+		else if ((nk > 6) && (i % nk == 4))
+			temp = sub_word(temp);
+
+		ek[i] = ek[i - nk] ^ temp;
+	}
+
+	for (size_t r = 0; r <= ctx->rounds; r++) {
+		for (size_t j = 0; j < 4; j++) {
+			uint32_t word = ek[4 * (ctx->rounds - r) + j];
+
+			if ((r > 0) && (r < ctx->rounds))
+				word = inv_mix_word(word);
+
+			dk[4 * r + j] = word;
 		}
 	}
+
+	for (size_t i = 0; i < words; i++) {
+		store_be32(ctx->enc_bytes + 4 * i, ek[i]);
+		store_be32(ctx->dec_bytes + 4 * i, dk[i]);
+	}
 }
 
-/** Perform shift rows transformation on state table.
+/** Encrypt a block using T-tables.
  *
- * @param state State table to be modified.
+ * @param ctx    AES context.
+ * @param input  Input block.
+ * @param output Output block.
  *
  */
-static void shift_rows(uint8_t state[ELEMS][ELEMS])
+static void table_encrypt_block(const aes_ctx_t *ctx, const uint8_t *input,
+    uint8_t *output)
 {
-	uint8_t temp[ELEMS];
+	const uint32_t *rk = ctx->enc_key;
+
+	uint32_t s0 = load_be32(input) ^ rk[0];
+	uint32_t s1 = load_be32(input + 4) ^ rk[1];
+	uint32_t s2 = load_be32(input + 8) ^ rk[2];
+	uint32_t s3 = load_be32(input + 12) ^ rk[3];
+
+	for (unsigned int r = 1; r < ctx->rounds; r++) {
+		rk += 4;
+
+		uint32_t t0 = te0[s0 >> 24] ^
+		    rotr_uint32(te0[(s1 >> 16) & 0xff], 8) ^
+		    rotr_uint32(te0[(s2 >> 8) & 0xff], 16) ^
+		    rotr_uint32(te0[s3 & 0xff], 24) ^ rk[0];
+		uint32_t t1 = te0[s1 >> 24] ^
+		    rotr_uint32(te0[(s2 >> 16) & 0xff], 8) ^
+		    rotr_uint32(te0[(s3 >> 8) & 0xff], 16) ^
+		    rotr_uint32(te0[s0 & 0xff], 24) ^ rk[1];
+		uint32_t t2 = te0[s2 >> 24] ^
+		    rotr_uint32(te0[(s3 >> 16) & 0xff], 8) ^
+		    rotr_uint32(te0[(s0 >> 8) & 0xff], 16) ^
+		    rotr_uint32(te0[s1 & 0xff], 24) ^ rk[2];
+		uint32_t t3 = te0[s3 >> 24] ^
+		    rotr_uint32(te0[(s0 >> 16) & 0xff], 8) ^
+		    rotr_uint32(te0[(s1 >> 8) & 0xff], 16) ^
+		    rotr_uint32(te0[s2 & 0xff], 24) ^ rk[3];
 
-	for (size_t i = 1; i < ELEMS; i++) {
-		memcpy(temp, state[i], i);
-		memmove(state[i], state[i] + i, ELEMS - i);
-		memcpy(state[i] + ELEMS - i, temp, i);
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
 	}
+
+	rk += 4;
+
+	/* Final round without MixColumns. */
+	store_be32(output, (((uint32_t) sbox[s0 >> 24] << 24) |
+	    ((uint32_t) sbox[(s1 >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[(s2 >> 8) & 0xff] << 8) |
+	    (uint32_t) sbox[s3 & 0xff]) ^ rk[0]);
+	store_be32(output + 4, (((uint32_t) sbox[s1 >> 24] << 24) |
+	    ((uint32_t) sbox[(s2 >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[(s3 >> 8) & 0xff] << 8) |
+	    (uint32_t) sbox[s0 & 0xff]) ^ rk[1]);
+	store_be32(output + 8, (((uint32_t) sbox[s2 >> 24] << 24) |
+	    ((uint32_t) sbox[(s3 >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[(s0 >> 8) & 0xff] << 8) |
+	    (uint32_t) sbox[s1 & 0xff]) ^ rk[2]);
+	store_be32(output + 12, (((uint32_t) sbox[s3 >> 24] << 24) |
+	    ((uint32_t) sbox[(s0 >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[(s1 >> 8) & 0xff] << 8) |
+	    (uint32_t) sbox[s2 & 0xff]) ^ rk[3]);
 }
 
-/** Perform inverted shift rows transformation on state table.
+/** Decrypt a block using T-tables.
  *
- * @param state State table to be modified.
+ * @param ctx    AES context.
+ * @param input  Input block.
+ * @param output Output block.
  *
  */
-static void inv_shift_rows(uint8_t state[ELEMS][ELEMS])
+static void table_decrypt_block(const aes_ctx_t *ctx, const uint8_t *input,
+    uint8_t *output)
 {
-	uint8_t temp[ELEMS];
+	const uint32_t *rk = ctx->dec_key;
+
+	uint32_t s0 = load_be32(input) ^ rk[0];
+	uint32_t s1 = load_be32(input + 4) ^ rk[1];
+	uint32_t s2 = load_be32(input + 8) ^ rk[2];
+	uint32_t s3 = load_be32(input + 12) ^ rk[3];
+
+	for (unsigned int r = 1; r < ctx->rounds; r++) {
+		rk += 4;
+
+		uint32_t t0 = td0[s0 >> 24] ^
+		    rotr_uint32(td0[(s3 >> 16) & 0xff], 8) ^
+		    rotr_uint32(td0[(s2 >> 8) & 0xff], 16) ^
+		    rotr_uint32(td0[s1 & 0xff], 24) ^ rk[0];
+		uint32_t t1 = td0[s1 >> 24] ^
+		    rotr_uint32(td0[(s0 >> 16) & 0xff], 8) ^
+		    rotr_uint32(td0[(s3 >> 8) & 0xff], 16) ^
+		    rotr_uint32(td0[s2 & 0xff], 24) ^ rk[1];
+		uint32_t t2 = td0[s2 >> 24] ^
+		    rotr_uint32(td0[(s1 >> 16) & 0xff], 8) ^
+		    rotr_uint32(td0[(s0 >> 8) & 0xff], 16) ^
+		    rotr_uint32(td0[s3 & 0xff], 24) ^ rk[2];
+		uint32_t t3 = td0[s3 >> 24] ^
+		    rotr_uint32(td0[(s2 >> 16) & 0xff], 8) ^
+		    rotr_uint32(td0[(s1 >> 8) & 0xff], 16) ^
+		    rotr_uint32(td0[s0 & 0xff], 24) ^ rk[3];
 
-	for (size_t i = 1; i < ELEMS; i++) {
-		memcpy(temp, state[i], ELEMS - i);
-		memmove(state[i], state[i] + ELEMS - i, i);
-		memcpy(state[i] + i, temp, ELEMS - i);
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
 	}
+
+	rk += 4;
+
+	/* Final round without InvMixColumns. */
+	store_be32(output, (((uint32_t) inv_sbox[s0 >> 24] << 24) |
+	    ((uint32_t) inv_sbox[(s3 >> 16) & 0xff] << 16) |
+	    ((uint32_t) inv_sbox[(s2 >> 8) & 0xff] << 8) |
+	    (uint32_t) inv_sbox[s1 & 0xff]) ^ rk[0]);
+	store_be32(output + 4, (((uint32_t) inv_sbox[s1 >> 24] << 24) |
+	    ((uint32_t) inv_sbox[(s0 >> 16) & 0xff] << 16) |
+	    ((uint32_t) inv_sbox[(s3 >> 8) & 0xff] << 8) |
+	    (uint32_t) inv_sbox[s2 & 0xff]) ^ rk[1]);
+	store_be32(output + 8, (((uint32_t) inv_sbox[s2 >> 24] << 24) |
+	    ((uint32_t) inv_sbox[(s1 >> 16) & 0xff] << 16) |
+	    ((uint32_t) inv_sbox[(s0 >> 8) & 0xff] << 8) |
+	    (uint32_t) inv_sbox[s3 & 0xff]) ^ rk[2]);
+	store_be32(output + 12, (((uint32_t) inv_sbox[s3 >> 24] << 24) |
+	    ((uint32_t) inv_sbox[(s2 >> 16) & 0xff] << 16) |
+	    ((uint32_t) inv_sbox[(s1 >> 8) & 0xff] << 8) |
+	    (uint32_t) inv_sbox[s0 & 0xff]) ^ rk[3]);
 }
 
-/** Multiplication in GF(2^8).
+#ifdef UARCH_amd64
+
+/** Encrypt a block using AES-NI instructions.
  *
- * @param x First factor.
- * @param y Second factor.
+ * @param ctx    AES context.
+ * @param input  Input block.
+ * @param output Output block.
  *
- * @return Multiplication of given factors in GF(2^8).
+ */
+static void aesni_encrypt_block(const aes_ctx_t *ctx, const uint8_t *input,
+    uint8_t *output)
+{
+	const uint8_t *rk = ctx->enc_bytes;
+	size_t rounds = ctx->rounds - 1;
+
+	asm volatile (
+	    "movdqu (%[input]), %%xmm0\n"
+	    "movdqu (%[rk]), %%xmm1\n"
+	    "pxor %%xmm1, %%xmm0\n"
+	    "1:\n"
+	    "add $16, %[rk]\n"
+	    "movdqu (%[rk]), %%xmm1\n"
+	    "aesenc %%xmm1, %%xmm0\n"
+	    "dec %[rounds]\n"
+	    "jnz 1b\n"
+	    "movdqu 16(%[rk]), %%xmm1\n"
+	    "aesenclast %%xmm1, %%xmm0\n"
+	    "movdqu %%xmm0, (%[output])\n"
+	    : [rk] "+r" (rk), [rounds] "+r" (rounds)
+	    : [input] "r" (input), [output] "r" (output)
+	    : "xmm0", "xmm1", "memory", "cc"
+	);
+}
+
+/** Decrypt a block using AES-NI instructions.
+ *
+ * @param ctx    AES context.
+ * @param input  Input block.
+ * @param output Output block.
+ *
+ */
+static void aesni_decrypt_block(const aes_ctx_t *ctx, const uint8_t *input,
+    uint8_t *output)
+{
+	const uint8_t *rk = ctx->dec_bytes;
+	size_t rounds = ctx->rounds - 1;
+
+	asm volatile (
+	    "movdqu (%[input]), %%xmm0\n"
+	    "movdqu (%[rk]), %%xmm1\n"
+	    "pxor %%xmm1, %%xmm0\n"
+	    "1:\n"
+	    "add $16, %[rk]\n"
+	    "movdqu (%[rk]), %%xmm1\n"
+	    "aesdec %%xmm1, %%xmm0\n"
+	    "dec %[rounds]\n"
+	    "jnz 1b\n"
+	    "movdqu 16(%[rk]), %%xmm1\n"
+	    "aesdeclast %%xmm1, %%xmm0\n"
+	    "movdqu %%xmm0, (%[output])\n"
+	    : [rk] "+r" (rk), [rounds] "+r" (rounds)
+	    : [input] "r" (input), [output] "r" (output)
+	    : "xmm0", "xmm1", "memory", "cc"
+	);
+}
+
+/** Encrypt four independent blocks using AES-NI instructions.
+ *
+ * Interleaving the blocks hides the latency of the aesenc instruction.
+ *
+ * @param ctx    AES context.
+ * @param input  Input blocks.
+ * @param output Output blocks.
  *
  */
-static uint8_t galois_mult(uint8_t x, uint8_t y)
+static void aesni_encrypt_4blocks(const aes_ctx_t *ctx, const uint8_t *input,
+    uint8_t *output)
 {
-	uint8_t result = 0;
-	uint8_t f_bith;
+	const uint8_t *rk = ctx->enc_bytes;
+	size_t rounds = ctx->rounds - 1;
+
+	asm volatile (
+	    "movdqu (%[rk]), %%xmm4\n"
+	    "movdqu 0(%[input]), %%xmm0\n"
+	    "movdqu 16(%[input]), %%xmm1\n"
+	    "movdqu 32(%[input]), %%xmm2\n"
+	    "movdqu 48(%[input]), %%xmm3\n"
+	    "pxor %%xmm4, %%xmm0\n"
+	    "pxor %%xmm4, %%xmm1\n"
+	    "pxor %%xmm4, %%xmm2\n"
+	    "pxor %%xmm4, %%xmm3\n"
+	    "1:\n"
+	    "add $16, %[rk]\n"
+	    "movdqu (%[rk]), %%xmm4\n"
+	    "aesenc %%xmm4, %%xmm0\n"
+	    "aesenc %%xmm4, %%xmm1\n"
+	    "aesenc %%xmm4, %%xmm2\n"
+	    "aesenc %%xmm4, %%xmm3\n"
+	    "dec %[rounds]\n"
+	    "jnz 1b\n"
+	    "movdqu 16(%[rk]), %%xmm4\n"
+	    "aesenclast %%xmm4, %%xmm0\n"
+	    "aesenclast %%xmm4, %%xmm1\n"
+	    "aesenclast %%xmm4, %%xmm2\n"
+	    "aesenclast %%xmm4, %%xmm3\n"
+	    "movdqu %%xmm0, 0(%[output])\n"
+	    "movdqu %%xmm1, 16(%[output])\n"
+	    "movdqu %%xmm2, 32(%[output])\n"
+	    "movdqu %%xmm3, 48(%[output])\n"
+	    : [rk] "+r" (rk), [rounds] "+r" (rounds)
+	    : [input] "r" (input), [output] "r" (output)
+	    : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "memory", "cc"
+	);
+}
+
+#endif
 
-	for (size_t i = 0; i < 8; i++) {
-		if (y & 1)
-			result ^= x;
+/** Check whether the CPU supports AES instructions.
+ *
+ * @return True if hardware AES is available.
+ *
+ */
+bool aes_hw_available(void)
+{
+#ifdef UARCH_amd64
+	/* CPUID may trap into a hypervisor, query it only once. */
+	static int available = -1;
 
-		f_bith = (x & 0x80);
-		x <<= 1;
+	if (available < 0) {
+		uint32_t eax = 1;
+		uint32_t ebx;
+		uint32_t ecx = 0;
+		uint32_t edx;
 
-		if (f_bith)
-			x ^= AES_IP;
+		asm volatile (
+		    "cpuid\n"
+		    : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx)
+		);
 
-		y >>= 1;
+		available = ((ecx & CPUID_ECX_AES) != 0) ? 1 : 0;
 	}
 
-	return result;
+	return available > 0;
+#else
+	return false;
+#endif
 }
 
-/** Perform mix columns transformation on state table.
+/** Encrypt a single block using the prepared key schedule.
  *
- * @param state State table to be modified.
+ * @param ctx    AES context initialized by aes_init().
+ * @param input  Input block (AES_CIPHER_LENGTH bytes).
+ * @param output Output block (may be the same as input).
  *
  */
-static void mix_columns(uint8_t state[ELEMS][ELEMS])
+void aes_encrypt_block(const aes_ctx_t *ctx, const uint8_t *input,
+    uint8_t *output)
 {
-	uint8_t orig_state[ELEMS][ELEMS];
-	memcpy(orig_state, state, BLOCK_LEN);
+#ifdef UARCH_amd64
+	if (ctx->aesni) {
+		aesni_encrypt_block(ctx, input, output);
+		return;
+	}
+#endif
 
-	for (size_t j = 0; j < ELEMS; j++) {
-		state[0][j] =
-		    galois_mult(0x2, orig_state[0][j]) ^
-		    galois_mult(0x3, orig_state[1][j]) ^
-		    orig_state[2][j] ^
-		    orig_state[3][j];
-		state[1][j] =
-		    orig_state[0][j] ^
-		    galois_mult(0x2, orig_state[1][j]) ^
-		    galois_mult(0x3, orig_state[2][j]) ^
-		    orig_state[3][j];
-		state[2][j] =
-		    orig_state[0][j] ^
-		    orig_state[1][j] ^
-		    galois_mult(0x2, orig_state[2][j]) ^
-		    galois_mult(0x3, orig_state[3][j]);
-		state[3][j] =
-		    galois_mult(0x3, orig_state[0][j]) ^
-		    orig_state[1][j] ^
-		    orig_state[2][j] ^
-		    galois_mult(0x2, orig_state[3][j]);
+	table_encrypt_block(ctx, input, output);
+}
+
+/** Decrypt a single block using the prepared key schedule.
+ *
+ * @param ctx    AES context initialized by aes_init().
+ * @param input  Input block (AES_CIPHER_LENGTH bytes).
+ * @param output Output block (may be the same as input).
+ *
+ */
+void aes_decrypt_block(const aes_ctx_t *ctx, const uint8_t *input,
+    uint8_t *output)
+{
+#ifdef UARCH_amd64
+	if (ctx->aesni) {
+		aesni_decrypt_block(ctx, input, output);
+		return;
 	}
+#endif
+
+	table_decrypt_block(ctx, input, output);
 }
 
-/** Perform inverted mix columns transformation on state table.
- *
- * @param state State table to be modified.
- *
- */
-static void inv_mix_columns(uint8_t state[ELEMS][ELEMS])
-{
-	uint8_t orig_state[ELEMS][ELEMS];
-	memcpy(orig_state, state, BLOCK_LEN);
-
-	for (size_t j = 0; j < ELEMS; j++) {
-		state[0][j] =
-		    galois_mult(0x0e, orig_state[0][j]) ^
-		    galois_mult(0x0b, orig_state[1][j]) ^
-		    galois_mult(0x0d, orig_state[2][j]) ^
-		    galois_mult(0x09, orig_state[3][j]);
-		state[1][j] =
-		    galois_mult(0x09, orig_state[0][j]) ^
-		    galois_mult(0x0e, orig_state[1][j]) ^
-		    galois_mult(0x0b, orig_state[2][j]) ^
-		    galois_mult(0x0d, orig_state[3][j]);
-		state[2][j] =
-		    galois_mult(0x0d, orig_state[0][j]) ^
-		    galois_mult(0x09, orig_state[1][j]) ^
-		    galois_mult(0x0e, orig_state[2][j]) ^
-		    galois_mult(0x0b, orig_state[3][j]);
-		state[3][j] =
-		    galois_mult(0x0b, orig_state[0][j]) ^
-		    galois_mult(0x0d, orig_state[1][j]) ^
-		    galois_mult(0x09, orig_state[2][j]) ^
-		    galois_mult(0x0e, orig_state[3][j]);
+/** Encrypt several consecutive blocks.
+ *
+ * @param ctx    AES context.
+ * @param input  Input blocks.
+ * @param output Output blocks.
+ * @param count  Number of blocks (at most CTR_BATCH).
+ *
+ */
+static void encrypt_blocks(const aes_ctx_t *ctx, const uint8_t *input,
+    uint8_t *output, size_t count)
+{
+#ifdef UARCH_amd64
+	if ((ctx->aesni) && (count == CTR_BATCH)) {
+		aesni_encrypt_4blocks(ctx, input, output);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; i++) {
+		aes_encrypt_block(ctx, input + i * AES_CIPHER_LENGTH,
+		    output + i * AES_CIPHER_LENGTH);
+	}
+}
+
+/** Increment the low bytes of a counter block as a big-endian number.
+ *
+ * @param counter Counter block.
+ * @param width   Number of trailing bytes forming the counter.
+ *
+ */
+static void ctr_inc(uint8_t *counter, size_t width)
+{
+	for (size_t i = AES_CIPHER_LENGTH; i > AES_CIPHER_LENGTH - width; i--) {
+		if (++counter[i - 1] != 0)
+			break;
 	}
 }
 
-/** Perform round key transformation on state table.
+/** Counter mode keystream application.
  *
- * @param state     State table to be modified.
- * @param round_key Round key to be applied on state table.
+ * @param ctx     AES context.
+ * @param counter Counter block, advanced past the used blocks.
+ * @param width   Number of trailing bytes of the counter block to increment.
+ * @param input   Input data.
+ * @param output  Output data (may be the same as input).
+ * @param length  Data length.
  *
  */
-static void add_round_key(uint8_t state[ELEMS][ELEMS], uint32_t *round_key)
+static void ctr_crypt(const aes_ctx_t *ctx, uint8_t *counter, size_t width,
+    const uint8_t *input, uint8_t *output, size_t length)
 {
-	uint8_t byte_round;
-	uint8_t shift;
-	uint32_t mask = 0xff;
+	uint8_t blocks[CTR_BATCH * AES_CIPHER_LENGTH];
+	uint8_t stream[CTR_BATCH * AES_CIPHER_LENGTH];
+
+	while (length > 0) {
+		size_t count = (length + AES_CIPHER_LENGTH - 1) / AES_CIPHER_LENGTH;
+		if (count > CTR_BATCH)
+			count = CTR_BATCH;
 
-	for (size_t j = 0; j < ELEMS; j++) {
-		for (size_t i = 0; i < ELEMS; i++) {
-			shift = 24 - 8 * i;
-			byte_round = (round_key[j] & (mask << shift)) >> shift;
-			state[i][j] = state[i][j] ^ byte_round;
+		for (size_t i = 0; i < count; i++) {
+			memcpy(blocks + i * AES_CIPHER_LENGTH, counter,
+			    AES_CIPHER_LENGTH);
+			ctr_inc(counter, width);
 		}
+
+		encrypt_blocks(ctx, blocks, stream, count);
+
+		size_t size = count * AES_CIPHER_LENGTH;
+		if (size > length)
+			size = length;
+
+		for (size_t i = 0; i < size; i++)
+			output[i] = input[i] ^ stream[i];
+
+		input += size;
+		output += size;
+		length -= size;
 	}
 }
 
-/** Perform substitution transformation on given word.
+/** Compare two byte sequences in constant time.
  *
- * @param byte Input word.
+ * @param a    First sequence.
+ * @param b    Second sequence.
+ * @param size Length of the sequences.
  *
- * @return Substituted word.
+ * @return True if the sequences are equal.
  *
  */
-static uint32_t sub_word(uint32_t word)
+static bool const_time_equal(const uint8_t *a, const uint8_t *b, size_t size)
 {
-	uint32_t temp = word;
-	uint8_t *start = (uint8_t *) &temp;
+	uint8_t diff = 0;
 
-	for (size_t i = 0; i < 4; i++)
-		*(start + i) = sub_byte(*(start + i), false);
+	for (size_t i = 0; i < size; i++)
+		diff |= a[i] ^ b[i];
 
-	return temp;
+	return diff == 0;
 }
 
-/** Perform left rotation by one byte on given word.
+/** Prepare the GHASH multiplication table for the hash subkey.
  *
- * @param byte Input word.
+ * Uses the 4-bit table method by V. Shoup.
  *
- * @return Rotated word.
+ * @param ctx AES context with the key schedule ready.
  *
  */
-static uint32_t rot_word(uint32_t word)
+static void ghash_init(aes_ctx_t *ctx)
 {
-	return (word << 8 | word >> 24);
+	uint8_t h[AES_CIPHER_LENGTH];
+
+	memset(h, 0, AES_CIPHER_LENGTH);
+	aes_encrypt_block(ctx, h, h);
+
+	uint64_t vh = load_be64(h);
+	uint64_t vl = load_be64(h + 8);
+
+	ctx->ghash_hi[0] = 0;
+	ctx->ghash_lo[0] = 0;
+	ctx->ghash_hi[8] = vh;
+	ctx->ghash_lo[8] = vl;
+
+	for (size_t i = 4; i > 0; i >>= 1) {
+		uint64_t carry = (vl & 1) ? UINT64_C(0xe100000000000000) : 0;
+		vl = (vh << 63) | (vl >> 1);
+		vh = (vh >> 1) ^ carry;
+
+		ctx->ghash_hi[i] = vh;
+		ctx->ghash_lo[i] = vl;
+	}
+
+	for (size_t i = 2; i < 16; i <<= 1) {
+		for (size_t j = 1; j < i; j++) {
+			ctx->ghash_hi[i + j] = ctx->ghash_hi[i] ^ ctx->ghash_hi[j];
+			ctx->ghash_lo[i + j] = ctx->ghash_lo[i] ^ ctx->ghash_lo[j];
+		}
+	}
 }
 
-/** Key expansion procedure for AES algorithm.
+/** Multiply a block by the hash subkey in GF(2^128).
  *
- * @param key     Input key.
- * @param key_exp Result key expansion.
+ * @param ctx AES context.
+ * @param x   Block to multiply in place.
  *
  */
-static void key_expansion(uint8_t *key, uint32_t *key_exp)
+static void ghash_mult(const aes_ctx_t *ctx, uint8_t *x)
 {
-	uint32_t temp;
+	uint8_t lo = x[15] & 0x0f;
+	uint64_t zh = ctx->ghash_hi[lo];
+	uint64_t zl = ctx->ghash_lo[lo];
+
+	for (int i = 15; i >= 0; i--) {
+		lo = x[i] & 0x0f;
+		uint8_t hi = x[i] >> 4;
+
+		if (i != 15) {
+			uint8_t rem = zl & 0x0f;
+			zl = (zh << 60) | (zl >> 4);
+			zh = (zh >> 4) ^ (ghash_last4[rem] << 48);
+			zh ^= ctx->ghash_hi[lo];
+			zl ^= ctx->ghash_lo[lo];
+		}
 
-	for (size_t i = 0; i < CIPHER_ELEMS; i++) {
-		key_exp[i] =
-		    (key[4 * i] << 24) +
-		    (key[4 * i + 1] << 16) +
-		    (key[4 * i + 2] << 8) +
-		    (key[4 * i + 3]);
+		uint8_t rem = zl & 0x0f;
+		zl = (zh << 60) | (zl >> 4);
+		zh = (zh >> 4) ^ (ghash_last4[rem] << 48);
+		zh ^= ctx->ghash_hi[hi];
+		zl ^= ctx->ghash_lo[hi];
 	}
 
-	for (size_t i = CIPHER_ELEMS; i < ELEMS * (ROUNDS + 1); i++) {
-		temp = key_exp[i - 1];
+	store_be64(x, zh);
+	store_be64(x + 8, zl);
+}
+
+/** Absorb data into the GHASH state.
+ *
+ * The last partial block is padded with zeros.
+ *
+ * @param ctx    AES context.
+ * @param y      GHASH state.
+ * @param data   Data to absorb.
+ * @param length Data length.
+ *
+ */
+static void ghash_update(const aes_ctx_t *ctx, uint8_t *y, const uint8_t *data,
+    size_t length)
+{
+	while (length > 0) {
+		size_t size = (length < AES_CIPHER_LENGTH) ?
+		    length : AES_CIPHER_LENGTH;
+
+		for (size_t i = 0; i < size; i++)
+			y[i] ^= data[i];
+
+		ghash_mult(ctx, y);
+		data += size;
+		length -= size;
+	}
+}
+
+/** Derive the pre-counter block J0 of GCM.
+ *
+ * @param ctx    AES context.
+ * @param iv     Initialization vector.
+ * @param iv_len Initialization vector length.
+ * @param j0     Output pre-counter block.
+ *
+ */
+static void gcm_j0(const aes_ctx_t *ctx, const uint8_t *iv, size_t iv_len,
+    uint8_t *j0)
+{
+	memset(j0, 0, AES_CIPHER_LENGTH);
+
+	if (iv_len == 12) {
+		memcpy(j0, iv, iv_len);
+		j0[15] = 1;
+		return;
+	}
+
+	uint8_t len_block[AES_CIPHER_LENGTH];
+	memset(len_block, 0, AES_CIPHER_LENGTH);
+	store_be64(len_block + 8, (uint64_t) iv_len * 8);
+
+	ghash_update(ctx, j0, iv, iv_len);
+	ghash_update(ctx, j0, len_block, AES_CIPHER_LENGTH);
+}
+
+/** Compute the GCM authentication tag.
+ *
+ * @param ctx        AES context.
+ * @param j0         Pre-counter block.
+ * @param aad        Additional authenticated data.
+ * @param aad_len    Additional authenticated data length.
+ * @param ciphertext Ciphertext.
+ * @param length     Ciphertext length.
+ * @param tag        Output full-length tag.
+ *
+ */
+static void gcm_tag(const aes_ctx_t *ctx, const uint8_t *j0,
+    const uint8_t *aad, size_t aad_len, const uint8_t *ciphertext,
+    size_t length, uint8_t *tag)
+{
+	uint8_t y[AES_CIPHER_LENGTH];
+	uint8_t len_block[AES_CIPHER_LENGTH];
+
+	memset(y, 0, AES_CIPHER_LENGTH);
+	ghash_update(ctx, y, aad, aad_len);
+	ghash_update(ctx, y, ciphertext, length);
+
+	store_be64(len_block, (uint64_t) aad_len * 8);
+	store_be64(len_block + 8, (uint64_t) length * 8);
+	ghash_update(ctx, y, len_block, AES_CIPHER_LENGTH);
+
+	aes_encrypt_block(ctx, j0, tag);
+	for (size_t i = 0; i < AES_CIPHER_LENGTH; i++)
+		tag[i] ^= y[i];
+}
 
-		if ((i % CIPHER_ELEMS) == 0) {
-			temp = sub_word(rot_word(temp)) ^
-			    r_con_array[i / CIPHER_ELEMS - 1];
+/** Check GCM parameters.
+ *
+ * @return EINVAL if the parameters are not valid, otherwise EOK.
+ *
+ */
+static errno_t gcm_check(const uint8_t *iv, size_t iv_len, size_t tag_len)
+{
+	if ((!iv) || (iv_len == 0))
+		return EINVAL;
+
+	if ((tag_len < 4) || (tag_len > AES_CIPHER_LENGTH))
+		return EINVAL;
+
+	return EOK;
+}
+
+/** Check CCM parameters.
+ *
+ * @return EINVAL if the parameters are not valid, otherwise EOK.
+ *
+ */
+static errno_t ccm_check(const uint8_t *nonce, size_t nonce_len,
+    size_t aad_len, size_t length, size_t tag_len)
+{
+	if ((!nonce) || (nonce_len < 7) || (nonce_len > 13))
+		return EINVAL;
+
+	if ((tag_len < 4) || (tag_len > AES_CIPHER_LENGTH) || (tag_len % 2))
+		return EINVAL;
+
+	/* Message length must fit into the length field. */
+	size_t len_size = 15 - nonce_len;
+	if ((len_size < sizeof(size_t)) && ((length >> (8 * len_size)) != 0))
+		return EINVAL;
+
+	if ((uint64_t) aad_len > UINT32_MAX)
+		return EINVAL;
+
+	return EOK;
+}
+
+/** Absorb data into a CBC-MAC state.
+ *
+ * @param ctx    AES context.
+ * @param x      CBC-MAC state.
+ * @param pos    Number of bytes absorbed into the current block.
+ * @param data   Data to absorb.
+ * @param length Data length.
+ *
+ */
+static void cbc_mac_update(const aes_ctx_t *ctx, uint8_t *x, size_t *pos,
+    const uint8_t *data, size_t length)
+{
+	while (length > 0) {
+		if ((*pos == 0) && (length >= AES_CIPHER_LENGTH)) {
+			for (size_t i = 0; i < AES_CIPHER_LENGTH; i++)
+				x[i] ^= data[i];
+
+			aes_encrypt_block(ctx, x, x);
+			data += AES_CIPHER_LENGTH;
+			length -= AES_CIPHER_LENGTH;
+			continue;
 		}
 
-		key_exp[i] = key_exp[i - CIPHER_ELEMS] ^ temp;
+		x[(*pos)++] ^= *data++;
+		length--;
+
+		if (*pos == AES_CIPHER_LENGTH) {
+			aes_encrypt_block(ctx, x, x);
+			*pos = 0;
+		}
+	}
+}
+
+/** Pad the current CBC-MAC block with zeros.
+ *
+ * @param ctx AES context.
+ * @param x   CBC-MAC state.
+ * @param pos Number of bytes absorbed into the current block.
+ *
+ */
+static void cbc_mac_pad(const aes_ctx_t *ctx, uint8_t *x, size_t *pos)
+{
+	if (*pos > 0) {
+		aes_encrypt_block(ctx, x, x);
+		*pos = 0;
+	}
+}
+
+/** Compute the CCM authentication value (RFC 3610).
+ *
+ * @param ctx       AES context.
+ * @param nonce     Nonce.
+ * @param nonce_len Nonce length.
+ * @param aad       Additional authenticated data.
+ * @param aad_len   Additional authenticated data length.
+ * @param plaintext Plaintext.
+ * @param length    Plaintext length.
+ * @param tag_len   Tag length.
+ * @param mac       Output CBC-MAC (full block).
+ *
+ */
+static void ccm_mac(const aes_ctx_t *ctx, const uint8_t *nonce,
+    size_t nonce_len, const uint8_t *aad, size_t aad_len,
+    const uint8_t *plaintext, size_t length, size_t tag_len, uint8_t *mac)
+{
+	size_t len_size = 15 - nonce_len;
+	size_t pos = 0;
+
+	mac[0] = ((aad_len > 0) ? 0x40 : 0) | (((tag_len - 2) / 2) << 3) |
+	    (len_size - 1);
+	memcpy(mac + 1, nonce, nonce_len);
+
+	uint64_t val = length;
+	for (size_t i = AES_CIPHER_LENGTH; i > 1 + nonce_len; i--) {
+		mac[i - 1] = val & 0xff;
+		val >>= 8;
+	}
+
+	aes_encrypt_block(ctx, mac, mac);
+
+	if (aad_len > 0) {
+		uint8_t hdr[6];
+		size_t hdr_len;
+
+		if (aad_len < 0xff00) {
+			hdr[0] = aad_len >> 8;
+			hdr[1] = aad_len;
+			hdr_len = 2;
+		} else {
+			hdr[0] = 0xff;
+			hdr[1] = 0xfe;
+			store_be32(hdr + 2, aad_len);
+			hdr_len = 6;
+		}
+
+		cbc_mac_update(ctx, mac, &pos, hdr, hdr_len);
+		cbc_mac_update(ctx, mac, &pos, aad, aad_len);
+		cbc_mac_pad(ctx, mac, &pos);
+	}
+
+	cbc_mac_update(ctx, mac, &pos, plaintext, length);
+	cbc_mac_pad(ctx, mac, &pos);
+}
+
+/** Prepare the CCM counter block A0.
+ *
+ * @param nonce     Nonce.
+ * @param nonce_len Nonce length.
+ * @param counter   Output counter block.
+ *
+ */
+static void ccm_counter(const uint8_t *nonce, size_t nonce_len,
+    uint8_t *counter)
+{
+	memset(counter, 0, AES_CIPHER_LENGTH);
+	counter[0] = 14 - nonce_len;
+	memcpy(counter + 1, nonce, nonce_len);
+}
+
+/** Compute the key schedule.
+ *
+ * @param ctx     AES context to initialize.
+ * @param key     Input key.
+ * @param key_len Key length in bytes (16, 24 or 32).
+ *
+ * @return EINVAL when key length is invalid, otherwise EOK.
+ *
+ */
+static errno_t aes_setup(aes_ctx_t *ctx, const uint8_t *key, size_t key_len)
+{
+	switch (key_len) {
+	case 16:
+		ctx->rounds = 10;
+		break;
+	case 24:
+		ctx->rounds = 12;
+		break;
+	case 32:
+		ctx->rounds = 14;
+		break;
+	default:
+		return EINVAL;
+	}
+
+	key_expansion(ctx, key, key_len);
+	ctx->aesni = aes_hw_available();
+	return EOK;
+}
+
+/** Prepare AES context for the given key.
+ *
+ * AES-NI instructions are used if the CPU supports them. The caller
+ * may clear the aesni member afterwards to force the table based
+ * implementation.
+ *
+ * @param ctx     AES context to initialize.
+ * @param key     Input key.
+ * @param key_len Key length in bytes (16, 24 or 32).
+ *
+ * @return EINVAL when key not specified or of invalid length,
+ *         otherwise EOK.
+ *
+ */
+errno_t aes_init(aes_ctx_t *ctx, const uint8_t *key, size_t key_len)
+{
+	if ((!ctx) || (!key))
+		return EINVAL;
+
+	errno_t rc = aes_setup(ctx, key, key_len);
+	if (rc != EOK)
+		return rc;
+
+	ghash_init(ctx);
+	return EOK;
+}
+
+/** AES encryption/decryption in counter (CTR) mode.
+ *
+ * The whole counter block is incremented as a 128 bit big-endian
+ * number. On return it holds the next unused counter value, so
+ * consecutive calls with lengths that are multiples of the block
+ * size produce a continuous keystream.
+ *
+ * @param ctx     AES context initialized by aes_init().
+ * @param counter Counter block (AES_CIPHER_LENGTH bytes).
+ * @param input   Input data.
+ * @param output  Output data (may be the same as input).
+ * @param length  Data length.
+ *
+ */
+void aes_ctr(const aes_ctx_t *ctx, uint8_t *counter, const uint8_t *input,
+    uint8_t *output, size_t length)
+{
+	ctr_crypt(ctx, counter, AES_CIPHER_LENGTH, input, output, length);
+}
+
+/** AES authenticated encryption in Galois/Counter mode (GCM).
+ *
+ * @param ctx     AES context initialized by aes_init().
+ * @param iv      Initialization vector.
+ * @param iv_len  Initialization vector length (12 recommended).
+ * @param aad     Additional authenticated data.
+ * @param aad_len Additional authenticated data length.
+ * @param input   Plaintext.
+ * @param output  Ciphertext (may be the same as input).
+ * @param length  Data length.
+ * @param tag     Output authentication tag.
+ * @param tag_len Authentication tag length (4 to 16).
+ *
+ * @return EINVAL when parameters are not valid, otherwise EOK.
+ *
+ */
+errno_t aes_gcm_encrypt(const aes_ctx_t *ctx, const uint8_t *iv,
+    size_t iv_len, const uint8_t *aad, size_t aad_len, const uint8_t *input,
+    uint8_t *output, size_t length, uint8_t *tag, size_t tag_len)
+{
+	errno_t rc = gcm_check(iv, iv_len, tag_len);
+	if (rc != EOK)
+		return rc;
+
+	uint8_t j0[AES_CIPHER_LENGTH];
+	uint8_t counter[AES_CIPHER_LENGTH];
+	uint8_t full_tag[AES_CIPHER_LENGTH];
+
+	gcm_j0(ctx, iv, iv_len, j0);
+
+	memcpy(counter, j0, AES_CIPHER_LENGTH);
+	ctr_inc(counter, 4);
+	ctr_crypt(ctx, counter, 4, input, output, length);
+
+	gcm_tag(ctx, j0, aad, aad_len, output, length, full_tag);
+	memcpy(tag, full_tag, tag_len);
+
+	return EOK;
+}
+
+/** AES authenticated decryption in Galois/Counter mode (GCM).
+ *
+ * The tag is verified before any plaintext is produced.
+ *
+ * @param ctx     AES context initialized by aes_init().
+ * @param iv      Initialization vector.
+ * @param iv_len  Initialization vector length.
+ * @param aad     Additional authenticated data.
+ * @param aad_len Additional authenticated data length.
+ * @param input   Ciphertext.
+ * @param output  Plaintext (may be the same as input).
+ * @param length  Data length.
+ * @param tag     Authentication tag to verify.
+ * @param tag_len Authentication tag length (4 to 16).
+ *
+ * @return EINVAL when parameters are not valid or the authentication
+ *         fails, otherwise EOK.
+ *
+ */
+errno_t aes_gcm_decrypt(const aes_ctx_t *ctx, const uint8_t *iv,
+    size_t iv_len, const uint8_t *aad, size_t aad_len, const uint8_t *input,
+    uint8_t *output, size_t length, const uint8_t *tag, size_t tag_len)
+{
+	errno_t rc = gcm_check(iv, iv_len, tag_len);
+	if (rc != EOK)
+		return rc;
+
+	uint8_t j0[AES_CIPHER_LENGTH];
+	uint8_t counter[AES_CIPHER_LENGTH];
+	uint8_t full_tag[AES_CIPHER_LENGTH];
+
+	gcm_j0(ctx, iv, iv_len, j0);
+	gcm_tag(ctx, j0, aad, aad_len, input, length, full_tag);
+
+	if (!const_time_equal(full_tag, tag, tag_len))
+		return EINVAL;
+
+	memcpy(counter, j0, AES_CIPHER_LENGTH);
+	ctr_inc(counter, 4);
+	ctr_crypt(ctx, counter, 4, input, output, length);
+
+	return EOK;
+}
+
+/** AES authenticated encryption in CCM mode (RFC 3610).
+ *
+ * @param ctx       AES context initialized by aes_init().
+ * @param nonce     Nonce.
+ * @param nonce_len Nonce length (7 to 13).
+ * @param aad       Additional authenticated data.
+ * @param aad_len   Additional authenticated data length.
+ * @param input     Plaintext.
+ * @param output    Ciphertext (may be the same as input).
+ * @param length    Data length.
+ * @param tag       Output authentication tag.
+ * @param tag_len   Authentication tag length (even, 4 to 16).
+ *
+ * @return EINVAL when parameters are not valid, otherwise EOK.
+ *
+ */
+errno_t aes_ccm_encrypt(const aes_ctx_t *ctx, const uint8_t *nonce,
+    size_t nonce_len, const uint8_t *aad, size_t aad_len, const uint8_t *input,
+    uint8_t *output, size_t length, uint8_t *tag, size_t tag_len)
+{
+	errno_t rc = ccm_check(nonce, nonce_len, aad_len, length, tag_len);
+	if (rc != EOK)
+		return rc;
+
+	uint8_t mac[AES_CIPHER_LENGTH];
+	uint8_t counter[AES_CIPHER_LENGTH];
+	uint8_t s0[AES_CIPHER_LENGTH];
+
+	ccm_mac(ctx, nonce, nonce_len, aad, aad_len, input, length, tag_len,
+	    mac);
+
+	ccm_counter(nonce, nonce_len, counter);
+	aes_encrypt_block(ctx, counter, s0);
+	ctr_inc(counter, 15 - nonce_len);
+	ctr_crypt(ctx, counter, 15 - nonce_len, input, output, length);
+
+	for (size_t i = 0; i < tag_len; i++)
+		tag[i] = mac[i] ^ s0[i];
+
+	return EOK;
+}
+
+/** AES authenticated decryption in CCM mode (RFC 3610).
+ *
+ * On authentication failure the output is cleared.
+ *
+ * @param ctx       AES context initialized by aes_init().
+ * @param nonce     Nonce.
+ * @param nonce_len Nonce length (7 to 13).
+ * @param aad       Additional authenticated data.
+ * @param aad_len   Additional authenticated data length.
+ * @param input     Ciphertext.
+ * @param output    Plaintext (may be the same as input).
+ * @param length    Data length.
+ * @param tag       Authentication tag to verify.
+ * @param tag_len   Authentication tag length (even, 4 to 16).
+ *
+ * @return EINVAL when parameters are not valid or the authentication
+ *         fails, otherwise EOK.
+ *
+ */
+errno_t aes_ccm_decrypt(const aes_ctx_t *ctx, const uint8_t *nonce,
+    size_t nonce_len, const uint8_t *aad, size_t aad_len, const uint8_t *input,
+    uint8_t *output, size_t length, const uint8_t *tag, size_t tag_len)
+{
+	errno_t rc = ccm_check(nonce, nonce_len, aad_len, length, tag_len);
+	if (rc != EOK)
+		return rc;
+
+	uint8_t mac[AES_CIPHER_LENGTH];
+	uint8_t counter[AES_CIPHER_LENGTH];
+	uint8_t s0[AES_CIPHER_LENGTH];
+
+	ccm_counter(nonce, nonce_len, counter);
+	aes_encrypt_block(ctx, counter, s0);
+	ctr_inc(counter, 15 - nonce_len);
+	ctr_crypt(ctx, counter, 15 - nonce_len, input, output, length);
+
+	ccm_mac(ctx, nonce, nonce_len, aad, aad_len, output, length, tag_len,
+	    mac);
+
+	for (size_t i = 0; i < tag_len; i++)
+		mac[i] ^= s0[i];
+
+	if (!const_time_equal(mac, tag, tag_len)) {
+		memset(output, 0, length);
+		return EINVAL;
 	}
+
+	return EOK;
 }
 
 /** AES-128 encryption algorithm.
+ *
+ * Expands the key on every call; use aes_init() and
+ * aes_encrypt_block() when encrypting more blocks with the same key.
  *
  * @param key    Input key.
  * @param input  Input data sequence to be encrypted.
@@ -466,40 +1395,19 @@ errno_t aes_encrypt(uint8_t *key, uint8_t *input, uint8_t *output)
 	if (!output)
 		return ENOMEM;
 
-	/* Create key expansion. */
-	uint32_t key_exp[ELEMS * (ROUNDS + 1)];
-	key_expansion(key, key_exp);
-
-	/* Copy input into state array. */
-	uint8_t state[ELEMS][ELEMS];
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			state[i][j] = input[i + ELEMS * j];
-	}
-
-	/* Processing loop. */
-	add_round_key(state, key_exp);
-
-	for (size_t k = 1; k <= ROUNDS; k++) {
-		sub_bytes(state, false);
-		shift_rows(state);
-
-		if (k < ROUNDS)
-			mix_columns(state);
-
-		add_round_key(state, key_exp + k * ELEMS);
-	}
-
-	/* Copy state array into output. */
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			output[i + j * ELEMS] = state[i][j];
-	}
+	aes_ctx_t ctx;
+	errno_t rc = aes_setup(&ctx, key, AES_CIPHER_LENGTH);
+	if (rc != EOK)
+		return rc;
 
+	aes_encrypt_block(&ctx, input, output);
 	return EOK;
 }
 
 /** AES-128 decryption algorithm.
+ *
+ * Expands the key on every call; use aes_init() and
+ * aes_decrypt_block() when decrypting more blocks with the same key.
  *
  * @param key    Input key.
  * @param input  Input data sequence to be decrypted.
@@ -518,34 +1426,11 @@ errno_t aes_decrypt(uint8_t *key, uint8_t *input, uint8_t *output)
 	if (!output)
 		return ENOMEM;
 
-	/* Create key expansion. */
-	uint32_t key_exp[ELEMS * (ROUNDS + 1)];
-	key_expansion(key, key_exp);
-
-	/* Copy input into state array. */
-	uint8_t state[ELEMS][ELEMS];
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			state[i][j] = input[i + ELEMS * j];
-	}
-
-	/* Processing loop. */
-	add_round_key(state, key_exp + ROUNDS * ELEMS);
-
-	for (int k = ROUNDS - 1; k >= 0; k--) {
-		inv_shift_rows(state);
-		sub_bytes(state, true);
-		add_round_key(state, key_exp + k * ELEMS);
-
-		if (k > 0)
-			inv_mix_columns(state);
-	}
-
-	/* Copy state array into output. */
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			output[i + j * ELEMS] = state[i][j];
-	}
+	aes_ctx_t ctx;
+	errno_t rc = aes_setup(&ctx, key, AES_CIPHER_LENGTH);
+	if (rc != EOK)
+		return rc;
 
+	aes_decrypt_block(&ctx, input, output);
 	return EOK;
 }
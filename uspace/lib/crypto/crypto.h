@@ -30,12 +30,16 @@
 #define LIBCRYPTO_H
 
 #include <errno.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #define AES_CIPHER_LENGTH  16
 #define PBKDF2_KEY_LENGTH  32
 
+/* Maximum number of AES rounds (for 256 bit keys). */
+#define AES_MAX_ROUNDS  14
+
 /* Left rotation for uint32_t. */
 #define rotl_uint32(val, shift) \
 	(((val) << shift) | ((val) >> (32 - shift)))
@@ -44,6 +48,29 @@
 #define rotr_uint32(val, shift) \
 	(((val) >> shift) | ((val) << (32 - shift)))
 
+/** AES key context.
+ *
+ * Holds the key schedule computed by aes_init(), so that the key
+ * expansion is done only once per key.
+ */
+typedef struct {
+	/** Number of rounds (10, 12 or 14). */
+	unsigned int rounds;
+	/** Use AES-NI instructions (if available). */
+	bool aesni;
+	/** Encryption round keys. */
+	uint32_t enc_key[4 * (AES_MAX_ROUNDS + 1)];
+	/** Decryption round keys (for the equivalent inverse cipher). */
+	uint32_t dec_key[4 * (AES_MAX_ROUNDS + 1)];
+	/** Encryption round keys in byte order (for AES-NI). */
+	uint8_t enc_bytes[AES_CIPHER_LENGTH * (AES_MAX_ROUNDS + 1)];
+	/** Decryption round keys in byte order (for AES-NI). */
+	uint8_t dec_bytes[AES_CIPHER_LENGTH * (AES_MAX_ROUNDS + 1)];
+	/** GHASH multiplication table for the hash subkey (GCM). */
+	uint64_t ghash_hi[16];
+	uint64_t ghash_lo[16];
+} aes_ctx_t;
+
 /** Hash function selector and also result hash length indicator. */
 typedef enum {
 	HASH_MD5 =  16,
@@ -53,6 +80,24 @@ typedef enum {
 extern errno_t rc4(uint8_t *, size_t, uint8_t *, size_t, size_t, uint8_t *);
 extern errno_t aes_encrypt(uint8_t *, uint8_t *, uint8_t *);
 extern errno_t aes_decrypt(uint8_t *, uint8_t *, uint8_t *);
+extern errno_t aes_init(aes_ctx_t *, const uint8_t *, size_t);
+extern bool aes_hw_available(void);
+extern void aes_encrypt_block(const aes_ctx_t *, const uint8_t *, uint8_t *);
+extern void aes_decrypt_block(const aes_ctx_t *, const uint8_t *, uint8_t *);
+extern void aes_ctr(const aes_ctx_t *, uint8_t *, const uint8_t *, uint8_t *,
+    size_t);
+extern errno_t aes_gcm_encrypt(const aes_ctx_t *, const uint8_t *, size_t,
+    const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t, uint8_t *,
+    size_t);
+extern errno_t aes_gcm_decrypt(const aes_ctx_t *, const uint8_t *, size_t,
+    const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t,
+    const uint8_t *, size_t);
+extern errno_t aes_ccm_encrypt(const aes_ctx_t *, const uint8_t *, size_t,
+    const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t, uint8_t *,
+    size_t);
+extern errno_t aes_ccm_decrypt(const aes_ctx_t *, const uint8_t *, size_t,
+    const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t,
+    const uint8_t *, size_t);
 extern errno_t create_hash(uint8_t *, size_t, uint8_t *, hash_func_t);
 extern errno_t hmac(uint8_t *, size_t, uint8_t *, size_t, uint8_t *, hash_func_t);
 extern errno_t pbkdf2(uint8_t *, size_t, uint8_t *, size_t, uint8_t *);
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include "../crypto.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(aes);
+
+/** FIPS 197, appendix C plaintext */
+static const uint8_t fips_plain[16] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+
+/** FIPS 197, appendix C ciphertexts for 128, 192 and 256 bit keys */
+static const uint8_t fips_cipher[3][16] = {
+	{
+		0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+		0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+	},
+	{
+		0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0,
+		0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91
+	},
+	{
+		0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf,
+		0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89
+	}
+};
+
+/** NIST SP 800-38A, F.5.1 key */
+static const uint8_t ctr_key[16] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const uint8_t ctr_plain[64] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+	0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+	0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+	0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+	0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+	0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+	0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+	0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+static const uint8_t ctr_cipher[64] = {
+	0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+	0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+	0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff,
+	0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+	0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e,
+	0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+	0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1,
+	0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee
+};
+
+/** GCM specification, test case 4 */
+static const uint8_t gcm_key[16] = {
+	0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08
+};
+
+static const uint8_t gcm_iv[12] = {
+	0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	0xde, 0xca, 0xf8, 0x88
+};
+
+static const uint8_t gcm_aad[20] = {
+	0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+	0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+	0xab, 0xad, 0xda, 0xd2
+};
+
+static const uint8_t gcm_plain[60] = {
+	0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+	0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+	0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+	0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+	0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+	0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+	0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+	0xba, 0x63, 0x7b, 0x39
+};
+
+static const uint8_t gcm_cipher[60] = {
+	0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24,
+	0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+	0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0,
+	0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+	0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c,
+	0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+	0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97,
+	0x3d, 0x58, 0xe0, 0x91
+};
+
+static const uint8_t gcm_tag[16] = {
+	0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb,
+	0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47
+};
+
+/** RFC 3610, packet vector #1 */
+static const uint8_t ccm_nonce[13] = {
+	0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xa0,
+	0xa1, 0xa2, 0xa3, 0xa4, 0xa5
+};
+
+static const uint8_t ccm_cipher[23] = {
+	0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+	0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+	0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84
+};
+
+static const uint8_t ccm_tag[8] = {
+	0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0
+};
+
+/** Encrypt and decrypt the FIPS 197 vectors with all key sizes */
+PCUT_TEST(block_vectors)
+{
+	uint8_t key[32];
+	uint8_t block[16];
+	aes_ctx_t ctx;
+
+	for (size_t i = 0; i < 32; i++)
+		key[i] = i;
+
+	for (size_t k = 0; k < 3; k++) {
+		errno_t rc = aes_init(&ctx, key, 16 + 8 * k);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+		for (int hw = 0; hw < 2; hw++) {
+			ctx.aesni = (hw != 0) && aes_hw_available();
+
+			aes_encrypt_block(&ctx, fips_plain, block);
+			PCUT_ASSERT_INT_EQUALS(0, memcmp(block, fips_cipher[k], 16));
+
+			aes_decrypt_block(&ctx, block, block);
+			PCUT_ASSERT_INT_EQUALS(0, memcmp(block, fips_plain, 16));
+		}
+	}
+}
+
+/** Single block API without key context */
+PCUT_TEST(block_legacy)
+{
+	uint8_t key[16];
+	uint8_t input[16];
+	uint8_t block[16];
+
+	for (size_t i = 0; i < 16; i++)
+		key[i] = i;
+
+	memcpy(input, fips_plain, 16);
+	errno_t rc = aes_encrypt(key, input, block);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(block, fips_cipher[0], 16));
+
+	rc = aes_decrypt(key, block, input);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(input, fips_plain, 16));
+}
+
+/** Counter mode, also continued across calls */
+PCUT_TEST(ctr_vector)
+{
+	uint8_t counter[16];
+	uint8_t data[64];
+	aes_ctx_t ctx;
+
+	errno_t rc = aes_init(&ctx, ctr_key, sizeof(ctr_key));
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	for (size_t i = 0; i < 16; i++)
+		counter[i] = 0xf0 + i;
+
+	aes_ctr(&ctx, counter, ctr_plain, data, 16);
+	aes_ctr(&ctx, counter, ctr_plain + 16, data + 16, 48);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, ctr_cipher, 64));
+
+	for (size_t i = 0; i < 16; i++)
+		counter[i] = 0xf0 + i;
+
+	ctx.aesni = false;
+	aes_ctr(&ctx, counter, data, data, 64);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, ctr_plain, 64));
+}
+
+/** Galois/Counter mode encryption, decryption and tag verification */
+PCUT_TEST(gcm_vector)
+{
+	uint8_t data[60];
+	uint8_t tag[16];
+	aes_ctx_t ctx;
+
+	errno_t rc = aes_init(&ctx, gcm_key, sizeof(gcm_key));
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = aes_gcm_encrypt(&ctx, gcm_iv, sizeof(gcm_iv), gcm_aad,
+	    sizeof(gcm_aad), gcm_plain, data, sizeof(data), tag, sizeof(tag));
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, gcm_cipher, sizeof(data)));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(tag, gcm_tag, sizeof(tag)));
+
+	rc = aes_gcm_decrypt(&ctx, gcm_iv, sizeof(gcm_iv), gcm_aad,
+	    sizeof(gcm_aad), data, data, sizeof(data), tag, sizeof(tag));
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, gcm_plain, sizeof(data)));
+
+	tag[15] ^= 1;
+	rc = aes_gcm_decrypt(&ctx, gcm_iv, sizeof(gcm_iv), gcm_aad,
+	    sizeof(gcm_aad), gcm_cipher, data, sizeof(data), tag, sizeof(tag));
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+}
+
+/** CCM mode encryption, decryption and tag verification */
+PCUT_TEST(ccm_vector)
+{
+	uint8_t key[16];
+	uint8_t aad[8];
+	uint8_t plain[23];
+	uint8_t data[23];
+	uint8_t tag[8];
+	aes_ctx_t ctx;
+
+	for (size_t i = 0; i < sizeof(key); i++)
+		key[i] = 0xc0 + i;
+
+	for (size_t i = 0; i < sizeof(aad); i++)
+		aad[i] = i;
+
+	for (size_t i = 0; i < sizeof(plain); i++)
+		plain[i] = 8 + i;
+
+	errno_t rc = aes_init(&ctx, key, sizeof(key));
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = aes_ccm_encrypt(&ctx, ccm_nonce, sizeof(ccm_nonce), aad,
+	    sizeof(aad), plain, data, sizeof(data), tag, sizeof(tag));
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, ccm_cipher, sizeof(data)));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(tag, ccm_tag, sizeof(tag)));
+
+	rc = aes_ccm_decrypt(&ctx, ccm_nonce, sizeof(ccm_nonce), aad,
+	    sizeof(aad), data, data, sizeof(data), tag, sizeof(tag));
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(data, plain, sizeof(data)));
+
+	tag[0] ^= 1;
+	rc = aes_ccm_decrypt(&ctx, ccm_nonce, sizeof(ccm_nonce), aad,
+	    sizeof(aad), ccm_cipher, data, sizeof(data), tag, sizeof(tag));
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	/* Odd tag length is not allowed. */
+	rc = aes_ccm_encrypt(&ctx, ccm_nonce, sizeof(ccm_nonce), aad,
+	    sizeof(aad), plain, data, sizeof(data), tag, 5);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+}
+
+PCUT_EXPORT(aes);
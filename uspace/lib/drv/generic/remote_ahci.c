@@ -36,7 +36,10 @@
 #include <async.h>
 #include <devman.h>
 #include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <macros.h>
 #include <str.h>
 #include "ahci_iface.h"
@@ -47,7 +50,8 @@ typedef enum {
 	IPC_M_AHCI_GET_NUM_BLOCKS,
 	IPC_M_AHCI_GET_BLOCK_SIZE,
 	IPC_M_AHCI_READ_BLOCKS,
-	IPC_M_AHCI_WRITE_BLOCKS
+	IPC_M_AHCI_WRITE_BLOCKS,
+	IPC_M_AHCI_DISCARD_BLOCKS
 } ahci_iface_funcs_t;
 
 #define MAX_NAME_LENGTH  1024
@@ -181,11 +185,30 @@ errno_t ahci_write_blocks(async_sess_t *sess, uint64_t blocknum, size_t count,
 	return rc;
 }
 
+errno_t ahci_discard_blocks(async_sess_t *sess, uint64_t blocknum,
+    size_t count)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	if (!exch)
+		return EINVAL;
+
+	aid_t req = async_send_4(exch, DEV_IFACE_ID(AHCI_DEV_IFACE),
+	    IPC_M_AHCI_DISCARD_BLOCKS, HI(blocknum), LO(blocknum), count, NULL);
+
+	async_exchange_end(exch);
+
+	errno_t rc;
+	async_wait_for(req, &rc);
+
+	return rc;
+}
+
 static void remote_ahci_get_sata_device_name(ddf_fun_t *, void *, ipc_call_t *);
 static void remote_ahci_get_num_blocks(ddf_fun_t *, void *, ipc_call_t *);
 static void remote_ahci_get_block_size(ddf_fun_t *, void *, ipc_call_t *);
 static void remote_ahci_read_blocks(ddf_fun_t *, void *, ipc_call_t *);
 static void remote_ahci_write_blocks(ddf_fun_t *, void *, ipc_call_t *);
+static void remote_ahci_discard_blocks(ddf_fun_t *, void *, ipc_call_t *);
 
 /** Remote AHCI interface operations. */
 static const remote_iface_func_ptr_t remote_ahci_iface_ops [] = {
@@ -193,7 +216,8 @@ static const remote_iface_func_ptr_t remote_ahci_iface_ops [] = {
 	[IPC_M_AHCI_GET_NUM_BLOCKS] = remote_ahci_get_num_blocks,
 	[IPC_M_AHCI_GET_BLOCK_SIZE] = remote_ahci_get_block_size,
 	[IPC_M_AHCI_READ_BLOCKS] = remote_ahci_read_blocks,
-	[IPC_M_AHCI_WRITE_BLOCKS] = remote_ahci_write_blocks
+	[IPC_M_AHCI_WRITE_BLOCKS] = remote_ahci_write_blocks,
+	[IPC_M_AHCI_DISCARD_BLOCKS] = remote_ahci_discard_blocks
 };
 
 /** Remote AHCI interface structure.
@@ -274,6 +298,106 @@ static void remote_ahci_get_block_size(ddf_fun_t *fun, void *iface,
 		async_answer_1(call, EOK, blocks);
 }
 
+/** Maximum number of requests being processed at the same time */
+#define REMOTE_AHCI_MAX_REQUESTS  32
+
+/** Block transfer or discard request being processed by its own fibril */
+typedef struct {
+	ddf_fun_t *fun;
+	const ahci_iface_t *iface;
+	ahci_iface_funcs_t method;
+	ipc_call_t call;
+	void *buf;
+} remote_ahci_req_t;
+
+/** Protects @c remote_ahci_requests */
+static FIBRIL_MUTEX_INITIALIZE(remote_ahci_lock);
+
+/** Signalled when a request completes */
+static FIBRIL_CONDVAR_INITIALIZE(remote_ahci_cv);
+
+/** Number of requests being processed */
+static unsigned int remote_ahci_requests = 0;
+
+static void remote_ahci_req_process(remote_ahci_req_t *req)
+{
+	const ahci_iface_t *ahci_iface = req->iface;
+	ipc_call_t *call = &req->call;
+
+	const uint64_t blocknum =
+	    (((uint64_t) (DEV_IPC_GET_ARG1(*call))) << 32) |
+	    (((uint64_t) (DEV_IPC_GET_ARG2(*call))) & 0xffffffff);
+	const size_t cnt = (size_t) DEV_IPC_GET_ARG3(*call);
+
+	errno_t ret;
+	switch (req->method) {
+	case IPC_M_AHCI_READ_BLOCKS:
+		ret = ahci_iface->read_blocks(req->fun, blocknum, cnt,
+		    req->buf);
+		break;
+	case IPC_M_AHCI_WRITE_BLOCKS:
+		ret = ahci_iface->write_blocks(req->fun, blocknum, cnt,
+		    req->buf);
+		break;
+	default:
+		ret = ahci_iface->discard_blocks(req->fun, blocknum, cnt);
+		break;
+	}
+
+	async_answer_0(call, ret);
+	free(req);
+}
+
+static errno_t remote_ahci_req_fibril(void *arg)
+{
+	remote_ahci_req_process((remote_ahci_req_t *) arg);
+
+	fibril_mutex_lock(&remote_ahci_lock);
+	remote_ahci_requests--;
+	fibril_condvar_broadcast(&remote_ahci_cv);
+	fibril_mutex_unlock(&remote_ahci_lock);
+
+	return EOK;
+}
+
+/** Process a block transfer or discard request
+ *
+ * The request is processed by a new fibril, so that the connection fibril
+ * can receive further requests and the device can work on several of them
+ * at the same time. Once REMOTE_AHCI_MAX_REQUESTS requests are being
+ * processed, the connection fibril waits for one of them to complete.
+ */
+static void remote_ahci_req_submit(ddf_fun_t *fun,
+    const ahci_iface_t *ahci_iface, ahci_iface_funcs_t method,
+    ipc_call_t *call, void *buf)
+{
+	remote_ahci_req_t *req = malloc(sizeof(remote_ahci_req_t));
+	if (req == NULL) {
+		async_answer_0(call, ENOMEM);
+		return;
+	}
+
+	req->fun = fun;
+	req->iface = ahci_iface;
+	req->method = method;
+	req->call = *call;
+	req->buf = buf;
+
+	fibril_mutex_lock(&remote_ahci_lock);
+	while (remote_ahci_requests >= REMOTE_AHCI_MAX_REQUESTS)
+		fibril_condvar_wait(&remote_ahci_cv, &remote_ahci_lock);
+	remote_ahci_requests++;
+	fibril_mutex_unlock(&remote_ahci_lock);
+
+	fid_t fid = fibril_create(remote_ahci_req_fibril, req);
+	if (fid == 0) {
+		(void) remote_ahci_req_fibril(req);
+		return;
+	}
+
+	fibril_add_ready(fid);
+}
+
 void remote_ahci_read_blocks(ddf_fun_t *fun, void *iface, ipc_call_t *call)
 {
 	const ahci_iface_t *ahci_iface = (ahci_iface_t *) iface;
@@ -291,21 +415,15 @@ void remote_ahci_read_blocks(ddf_fun_t *fun, void *iface, ipc_call_t *call)
 	void *buf;
 	async_share_out_finalize(&data, &buf);
 
-	const uint64_t blocknum =
-	    (((uint64_t) (DEV_IPC_GET_ARG1(*call))) << 32) |
-	    (((uint64_t) (DEV_IPC_GET_ARG2(*call))) & 0xffffffff);
-	const size_t cnt = (size_t) DEV_IPC_GET_ARG3(*call);
-
-	const errno_t ret = ahci_iface->read_blocks(fun, blocknum, cnt, buf);
-
-	async_answer_0(call, ret);
+	remote_ahci_req_submit(fun, ahci_iface, IPC_M_AHCI_READ_BLOCKS, call,
+	    buf);
 }
 
 void remote_ahci_write_blocks(ddf_fun_t *fun, void *iface, ipc_call_t *call)
 {
 	const ahci_iface_t *ahci_iface = (ahci_iface_t *) iface;
 
-	if (ahci_iface->read_blocks == NULL) {
+	if (ahci_iface->write_blocks == NULL) {
 		async_answer_0(call, ENOTSUP);
 		return;
 	}
@@ -318,14 +436,21 @@ void remote_ahci_write_blocks(ddf_fun_t *fun, void *iface, ipc_call_t *call)
 	void *buf;
 	async_share_out_finalize(&data, &buf);
 
-	const uint64_t blocknum =
-	    (((uint64_t)(DEV_IPC_GET_ARG1(*call))) << 32) |
-	    (((uint64_t)(DEV_IPC_GET_ARG2(*call))) & 0xffffffff);
-	const size_t cnt = (size_t) DEV_IPC_GET_ARG3(*call);
+	remote_ahci_req_submit(fun, ahci_iface, IPC_M_AHCI_WRITE_BLOCKS, call,
+	    buf);
+}
 
-	const errno_t ret = ahci_iface->write_blocks(fun, blocknum, cnt, buf);
+void remote_ahci_discard_blocks(ddf_fun_t *fun, void *iface, ipc_call_t *call)
+{
+	const ahci_iface_t *ahci_iface = (ahci_iface_t *) iface;
 
-	async_answer_0(call, ret);
+	if (ahci_iface->discard_blocks == NULL) {
+		async_answer_0(call, ENOTSUP);
+		return;
+	}
+
+	remote_ahci_req_submit(fun, ahci_iface, IPC_M_AHCI_DISCARD_BLOCKS,
+	    call, NULL);
 }
 
 /**
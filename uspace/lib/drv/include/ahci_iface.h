@@ -46,6 +46,7 @@ extern errno_t ahci_get_num_blocks(async_sess_t *, uint64_t *);
 extern errno_t ahci_get_block_size(async_sess_t *, size_t *);
 extern errno_t ahci_read_blocks(async_sess_t *, uint64_t, size_t, void *);
 extern errno_t ahci_write_blocks(async_sess_t *, uint64_t, size_t, void *);
+extern errno_t ahci_discard_blocks(async_sess_t *, uint64_t, size_t);
 
 /** AHCI device communication interface. */
 typedef struct {
@@ -54,6 +55,7 @@ typedef struct {
 	errno_t (*get_block_size)(ddf_fun_t *, size_t *);
 	errno_t (*read_blocks)(ddf_fun_t *, uint64_t, size_t, void *);
 	errno_t (*write_blocks)(ddf_fun_t *, uint64_t, size_t, void *);
+	errno_t (*discard_blocks)(ddf_fun_t *, uint64_t, size_t);
 } ahci_iface_t;
 
 #endif
@@ -42,6 +42,7 @@
 
 extern errno_t ext4_filesystem_probe(service_id_t, ext4_fs_probe_info_t *);
 extern errno_t ext4_filesystem_create(ext4_cfg_t *, service_id_t);
+extern errno_t ext4_filesystem_check(service_id_t, ext4_check_t *);
 extern errno_t ext4_filesystem_open(ext4_instance_t *, service_id_t,
     enum cache_mode, aoff64_t *, ext4_filesystem_t **);
 extern errno_t ext4_filesystem_close(ext4_filesystem_t *);
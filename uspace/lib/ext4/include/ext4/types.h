@@ -35,7 +35,10 @@
 #ifndef LIBEXT4_TYPES_H_
 #define LIBEXT4_TYPES_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <block.h>
+#include <fibril_synch.h>
 
 /*
  * Structure of the super block
@@ -232,6 +235,21 @@ typedef struct ext4_filesystem {
 	ext4_superblock_t *superblock;
 	aoff64_t inode_block_limits[4];
 	aoff64_t inode_blocks_per_level[4];
+
+	/* Freed blocks waiting to be discarded */
+	fibril_mutex_t discard_lock;
+	uint32_t discard_first;
+	uint32_t discard_count;
+
+	/* Cached block group and i-node references */
+	fibril_mutex_t ref_lock;
+	hash_table_t bg_refs;
+	hash_table_t inode_refs;
+	list_t bg_lru;                 /* Unused block group references */
+	list_t inode_lru;              /* Unused i-node references */
+	unsigned int bg_lru_count;
+	unsigned int inode_lru_count;
+	bool ref_retain;               /* Keep unused references cached */
 } ext4_filesystem_t;
 
 /** Size of buffer for volume name. To hold 16 latin-1 chars encoded as UTF-8
@@ -243,6 +261,30 @@ typedef struct {
 	char vol_name[EXT4_VOL_NAME_BYTES];
 } ext4_fs_probe_info_t;
 
+/** Results of a file system consistency check */
+typedef struct {
+	/** State of the file system (EXT4_SUPERBLOCK_STATE_*) */
+	uint16_t state;
+	/** Number of block groups */
+	uint32_t groups;
+	/** Block group descriptors with bad checksum or metadata location */
+	uint32_t bad_descriptors;
+	/** Block groups whose free blocks count disagrees with the bitmap */
+	uint32_t bad_free_blocks;
+	/** Block groups whose free i-nodes count disagrees with the bitmap */
+	uint32_t bad_free_inodes;
+	/** I-nodes with links which are marked free in the i-node bitmap */
+	uint32_t lost_inodes;
+	/** Free blocks according to the block bitmaps */
+	uint64_t free_blocks;
+	/** Free i-nodes according to the i-node bitmaps */
+	uint32_t free_inodes;
+	/** Free blocks according to the superblock */
+	uint64_t sb_free_blocks;
+	/** Free i-nodes according to the superblock */
+	uint32_t sb_free_inodes;
+} ext4_check_t;
+
 #define EXT4_BLOCK_GROUP_INODE_UNINIT   0x0001  /* Inode table/bitmap not in use */
 #define EXT4_BLOCK_GROUP_BLOCK_UNINIT   0x0002  /* Block bitmap not in use */
 #define EXT4_BLOCK_GROUP_ITABLE_ZEROED  0x0004  /* On-disk itable initialized to zero */
@@ -278,6 +320,9 @@ typedef struct ext4_block_group_ref {
 	ext4_filesystem_t *fs;
 	uint32_t index;
 	bool dirty;
+	unsigned int refcnt;              /* Number of users of this reference */
+	ht_link_t link;                   /* Link in the reference cache */
+	link_t lru_link;                  /* Link in the list of unused refs */
 } ext4_block_group_ref_t;
 
 #define EXT4_MIN_BLOCK_GROUP_DESCRIPTOR_SIZE  32
@@ -393,6 +438,9 @@ typedef struct ext4_inode_ref {
 	ext4_filesystem_t *fs;
 	uint32_t index;         /* Index number of this inode */
 	bool dirty;
+	unsigned int refcnt;    /* Number of users of this reference */
+	ht_link_t link;         /* Link in the reference cache */
+	link_t lru_link;        /* Link in the list of unused references */
 } ext4_inode_ref_t;
 
 #define EXT4_DIRECTORY_FILENAME_LEN  255
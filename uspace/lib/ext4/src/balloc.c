@@ -35,7 +35,9 @@
  * @brief Physical block allocator.
  */
 
+#include <assert.h>
 #include <errno.h>
+#include <fibril_synch.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include "ext4/balloc.h"
@@ -46,6 +48,63 @@
 #include "ext4/superblock.h"
 #include "ext4/types.h"
 
+static void ext4_balloc_discard_flush_locked(ext4_filesystem_t *fs)
+{
+	assert(fibril_mutex_is_locked(&fs->discard_lock));
+
+	if (fs->discard_count == 0)
+		return;
+
+	/* Discarding is only a hint for the device, ignore errors */
+	(void) block_discard(fs->device, fs->discard_first,
+	    fs->discard_count);
+	fs->discard_count = 0;
+}
+
+/** Discard blocks freed so far.
+ *
+ * Freed blocks are collected into a contiguous range, which is discarded
+ * with a single request. This has to be called before any freed block
+ * can be allocated again.
+ *
+ * @param fs Filesystem
+ *
+ */
+void ext4_balloc_discard_flush(ext4_filesystem_t *fs)
+{
+	fibril_mutex_lock(&fs->discard_lock);
+	ext4_balloc_discard_flush_locked(fs);
+	fibril_mutex_unlock(&fs->discard_lock);
+}
+
+/** Add freed blocks to the range waiting to be discarded.
+ *
+ * @param fs    Filesystem
+ * @param first First freed block
+ * @param count Number of freed blocks
+ *
+ */
+static void ext4_balloc_discard_add(ext4_filesystem_t *fs, uint32_t first,
+    uint32_t count)
+{
+	fibril_mutex_lock(&fs->discard_lock);
+
+	if (fs->discard_count != 0 &&
+	    first == fs->discard_first + fs->discard_count) {
+		fs->discard_count += count;
+	} else if (fs->discard_count != 0 &&
+	    first + count == fs->discard_first) {
+		fs->discard_first = first;
+		fs->discard_count += count;
+	} else {
+		ext4_balloc_discard_flush_locked(fs);
+		fs->discard_first = first;
+		fs->discard_count = count;
+	}
+
+	fibril_mutex_unlock(&fs->discard_lock);
+}
+
 /** Free block.
  *
  * @param inode_ref  Inode, where the block is allocated
@@ -92,6 +151,8 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 		return rc;
 	}
 
+	ext4_balloc_discard_add(fs, block_addr, 1);
+
 	uint32_t block_size = ext4_superblock_get_block_size(sb);
 
 	/* Update superblock free blocks count */
@@ -165,6 +226,8 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 		return rc;
 	}
 
+	ext4_balloc_discard_add(fs, first, count);
+
 	uint32_t block_size = ext4_superblock_get_block_size(sb);
 
 	/* Update superblock free blocks count */
@@ -354,6 +417,9 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	uint32_t goal;
 	uint32_t block_size;
 
+	/* Freed blocks must be discarded before they can be reused */
+	ext4_balloc_discard_flush(inode_ref->fs);
+
 	/* Find GOAL */
 	errno_t rc = ext4_balloc_find_goal(inode_ref, &goal);
 	if (rc != EOK)
@@ -631,6 +697,9 @@ errno_t ext4_balloc_try_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t fblock
 	ext4_filesystem_t *fs = inode_ref->fs;
 	ext4_superblock_t *sb = fs->superblock;
 
+	/* Freed blocks must be discarded before they can be reused */
+	ext4_balloc_discard_flush(fs);
+
 	/* Compute indexes */
 	uint32_t block_group = ext4_filesystem_blockaddr2group(sb, fblock);
 	uint32_t index_in_group =
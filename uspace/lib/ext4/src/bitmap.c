@@ -155,6 +155,46 @@ bool ext4_bitmap_is_free_bit(uint8_t *bitmap, uint32_t index)
 		return true;
 }
 
+/** Count free bits in bitmap.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param count  Number of bits to examine
+ *
+ * @return Number of free bits
+ *
+ */
+uint32_t ext4_bitmap_count_free_bits(uint8_t *bitmap, uint32_t count)
+{
+	uint32_t free = 0;
+	uint32_t idx = 0;
+
+	/* Whole bytes are mostly either all free or all used */
+	while (count - idx >= 8) {
+		uint8_t byte = bitmap[idx / 8];
+
+		if (byte == 0) {
+			free += 8;
+		} else if (byte != 0xff) {
+			for (unsigned int i = 0; i < 8; i++) {
+				if ((byte & (1 << i)) == 0)
+					free++;
+			}
+		}
+
+		idx += 8;
+	}
+
+	/* Remaining bits */
+	while (idx < count) {
+		if (ext4_bitmap_is_free_bit(bitmap, idx))
+			free++;
+
+		idx++;
+	}
+
+	return free;
+}
+
 /** Try to find free byte and set the first bit as used.
  *
  * Walk through bitmap and try to find free byte (equal to 0).
@@ -40,6 +40,7 @@
 #include <errno.h>
 #include <mem.h>
 #include <align.h>
+#include <assert.h>
 #include <crypto.h>
 #include <ipc/vfs.h>
 #include <libfs.h>
@@ -58,28 +59,166 @@
 
 static errno_t ext4_filesystem_check_features(ext4_filesystem_t *, bool *);
 static errno_t ext4_filesystem_init_block_groups(ext4_filesystem_t *);
+static errno_t ext4_filesystem_prefetch_gdt(ext4_filesystem_t *);
+static uint16_t ext4_filesystem_bg_checksum(ext4_superblock_t *, uint32_t,
+    ext4_block_group_t *);
 static errno_t ext4_filesystem_alloc_this_inode(ext4_filesystem_t *,
     uint32_t, ext4_inode_ref_t **, int);
 static uint32_t ext4_filesystem_inodes_per_block(ext4_superblock_t *);
 
+/** Maximum number of unused block group references kept cached */
+#define EXT4_BG_REF_CACHE_SIZE     4
+/** Maximum number of unused i-node references kept cached */
+#define EXT4_INODE_REF_CACHE_SIZE  8
+
+static size_t bg_refs_key_hash(const void *key)
+{
+	const uint32_t *index = key;
+	return *index;
+}
+
+static size_t bg_refs_hash(const ht_link_t *item)
+{
+	ext4_block_group_ref_t *ref =
+	    hash_table_get_inst(item, ext4_block_group_ref_t, link);
+	return ref->index;
+}
+
+static bool bg_refs_key_equal(const void *key, const ht_link_t *item)
+{
+	const uint32_t *index = key;
+	ext4_block_group_ref_t *ref =
+	    hash_table_get_inst(item, ext4_block_group_ref_t, link);
+	return ref->index == *index;
+}
+
+static hash_table_ops_t bg_refs_ops = {
+	.hash = bg_refs_hash,
+	.key_hash = bg_refs_key_hash,
+	.key_equal = bg_refs_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t inode_refs_key_hash(const void *key)
+{
+	const uint32_t *index = key;
+	return *index;
+}
+
+static size_t inode_refs_hash(const ht_link_t *item)
+{
+	ext4_inode_ref_t *ref =
+	    hash_table_get_inst(item, ext4_inode_ref_t, link);
+	return ref->index;
+}
+
+static bool inode_refs_key_equal(const void *key, const ht_link_t *item)
+{
+	const uint32_t *index = key;
+	ext4_inode_ref_t *ref =
+	    hash_table_get_inst(item, ext4_inode_ref_t, link);
+	return ref->index == *index;
+}
+
+static hash_table_ops_t inode_refs_ops = {
+	.hash = inode_refs_hash,
+	.key_hash = inode_refs_key_hash,
+	.key_equal = inode_refs_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Initialize cache of block group and i-node references.
+ *
+ * References are shared by all their concurrent users. Unless the block
+ * cache is write-through, a few recently used references are also kept
+ * after their last user has put them back, so that the blocks containing
+ * hot metadata do not need to be looked up over and over again.
+ *
+ * @param fs    Filesystem
+ * @param cmode Cache mode
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_filesystem_refs_init(ext4_filesystem_t *fs,
+    enum cache_mode cmode)
+{
+	fibril_mutex_initialize(&fs->ref_lock);
+	list_initialize(&fs->bg_lru);
+	list_initialize(&fs->inode_lru);
+	fs->bg_lru_count = 0;
+	fs->inode_lru_count = 0;
+	fs->ref_retain = (cmode == CACHE_MODE_WB);
+
+	if (!hash_table_create(&fs->bg_refs, 0, 0, &bg_refs_ops))
+		return ENOMEM;
+
+	if (!hash_table_create(&fs->inode_refs, 0, 0, &inode_refs_ops)) {
+		hash_table_destroy(&fs->bg_refs);
+		return ENOMEM;
+	}
+
+	return EOK;
+}
+
+/** Release cached block group and i-node references.
+ *
+ * All references must have been put back by their users.
+ *
+ * @param fs Filesystem
+ *
+ */
+static void ext4_filesystem_refs_fini(ext4_filesystem_t *fs)
+{
+	while (!list_empty(&fs->inode_lru)) {
+		ext4_inode_ref_t *ref = list_get_instance(
+		    list_first(&fs->inode_lru), ext4_inode_ref_t, lru_link);
+
+		list_remove(&ref->lru_link);
+		hash_table_remove_item(&fs->inode_refs, &ref->link);
+		block_put(ref->block);
+		free(ref);
+	}
+
+	while (!list_empty(&fs->bg_lru)) {
+		ext4_block_group_ref_t *ref = list_get_instance(
+		    list_first(&fs->bg_lru), ext4_block_group_ref_t, lru_link);
+
+		list_remove(&ref->lru_link);
+		hash_table_remove_item(&fs->bg_refs, &ref->link);
+		block_put(ref->block);
+		free(ref);
+	}
+
+	fs->inode_lru_count = 0;
+	fs->bg_lru_count = 0;
+
+	hash_table_destroy(&fs->inode_refs);
+	hash_table_destroy(&fs->bg_refs);
+}
+
 /** Initialize filesystem for opening.
  *
  * But do not mark mounted just yet.
  *
- * @param fs         Filesystem instance to be initialized
- * @param service_id Block device to open
- * @param cmode      Cache mode
+ * @param fs          Filesystem instance to be initialized
+ * @param service_id  Block device to open
+ * @param cmode       Cache mode
+ * @param check_state Refuse file systems which were not unmounted cleanly
  *
  * @return Error code
  *
  */
 static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_id,
-    enum cache_mode cmode)
+    enum cache_mode cmode, bool check_state)
 {
 	errno_t rc;
 	ext4_superblock_t *temp_superblock = NULL;
 
 	fs->device = service_id;
+	fibril_mutex_initialize(&fs->discard_lock);
 
 	/* Initialize block library (4096 is size of communication channel) */
 	rc = block_init(fs->device, 4096);
@@ -103,6 +242,11 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 	if (rc != EOK)
 		goto err_1;
 
+	/* Initialize cache of block group and i-node references */
+	rc = ext4_filesystem_refs_init(fs, cmode);
+	if (rc != EOK)
+		goto err_2;
+
 	/* Compute limits for indirect block levels */
 	uint32_t block_ids_per_block = block_size / sizeof(uint32_t);
 	fs->inode_block_limits[0] = EXT4_INODE_DIRECT_BLOCK_COUNT;
@@ -119,25 +263,28 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 
 	uint16_t state = ext4_superblock_get_state(fs->superblock);
 
-	if (((state & EXT4_SUPERBLOCK_STATE_VALID_FS) !=
+	if (check_state &&
+	    (((state & EXT4_SUPERBLOCK_STATE_VALID_FS) !=
 	    EXT4_SUPERBLOCK_STATE_VALID_FS) ||
 	    ((state & EXT4_SUPERBLOCK_STATE_ERROR_FS) ==
-	    EXT4_SUPERBLOCK_STATE_ERROR_FS)) {
+	    EXT4_SUPERBLOCK_STATE_ERROR_FS))) {
 		rc = ENOTSUP;
-		goto err_2;
+		goto err_3;
 	}
 
 	rc = ext4_superblock_check_sanity(fs->superblock);
 	if (rc != EOK)
-		goto err_2;
+		goto err_3;
 
 	/* Check flags */
 	bool read_only;
 	rc = ext4_filesystem_check_features(fs, &read_only);
 	if (rc != EOK)
-		goto err_2;
+		goto err_3;
 
 	return EOK;
+err_3:
+	ext4_filesystem_refs_fini(fs);
 err_2:
 	block_cache_fini(fs->device);
 err_1:
@@ -158,6 +305,9 @@ static void ext4_filesystem_fini(ext4_filesystem_t *fs)
 	/* Release memory space for superblock */
 	free(fs->superblock);
 
+	/* Release cached references before the block cache */
+	ext4_filesystem_refs_fini(fs);
+
 	/* Finish work with block library */
 	block_cache_fini(fs->device);
 	block_fini(fs->device);
@@ -300,7 +450,7 @@ errno_t ext4_filesystem_create(ext4_cfg_t *cfg, service_id_t service_id)
 		goto err;
 
 	/* Open file system */
-	rc = ext4_filesystem_init(fs, service_id, CACHE_MODE_WT);
+	rc = ext4_filesystem_init(fs, service_id, CACHE_MODE_WT, true);
 	if (rc != EOK)
 		goto err;
 
@@ -389,7 +539,7 @@ errno_t ext4_filesystem_probe(service_id_t service_id,
 		return ENOMEM;
 
 	/* Initialize the file system for opening */
-	rc = ext4_filesystem_init(fs, service_id, CACHE_MODE_WT);
+	rc = ext4_filesystem_init(fs, service_id, CACHE_MODE_WT, true);
 	if (rc != EOK) {
 		free(fs);
 		return rc;
@@ -406,6 +556,234 @@ errno_t ext4_filesystem_probe(service_id_t service_id,
 	return EOK;
 }
 
+/** Check consistency of a single block group.
+ *
+ * The free blocks and free i-nodes counts of the block group descriptor
+ * are compared with the bitmaps and the used part of the i-node table is
+ * compared with the i-node bitmap. The bitmaps and the i-node table are
+ * prefetched in large reads before they are examined.
+ *
+ * @param fs    Filesystem
+ * @param bgid  Index of the block group
+ * @param check Results of the check to be updated
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_filesystem_check_group(ext4_filesystem_t *fs,
+    uint32_t bgid, ext4_check_t *check)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	block_t *gdt_block;
+	block_t *bitmap_block;
+	block_t *block = NULL;
+	uint32_t bfree;
+	uint32_t ifree;
+	errno_t rc2;
+	errno_t rc;
+
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	uint16_t inode_size = ext4_superblock_get_inode_size(sb);
+	uint32_t desc_size = ext4_superblock_get_desc_size(sb);
+	uint32_t descriptors_per_block = block_size / desc_size;
+
+	/* Load block with the descriptor */
+	aoff64_t block_id = ext4_superblock_get_first_data_block(sb) + 1 +
+	    bgid / descriptors_per_block;
+	uint32_t offset = (bgid % descriptors_per_block) * desc_size;
+
+	rc = block_get(&gdt_block, fs->device, block_id, 0);
+	if (rc != EOK)
+		return rc;
+
+	ext4_block_group_t *bg = gdt_block->data + offset;
+
+	uint64_t blocks_count = ext4_superblock_get_blocks_count(sb);
+	uint64_t block_bitmap = ext4_block_group_get_block_bitmap(bg, sb);
+	uint64_t inode_bitmap = ext4_block_group_get_inode_bitmap(bg, sb);
+	uint64_t inode_table =
+	    ext4_block_group_get_inode_table_first_block(bg, sb);
+	uint32_t itable_size = ext4_filesystem_bg_get_itable_size(sb, bgid);
+	uint32_t free_blocks = ext4_block_group_get_free_blocks_count(bg, sb);
+	uint32_t free_inodes = ext4_block_group_get_free_inodes_count(bg, sb);
+	uint32_t blocks_in_group = ext4_superblock_get_blocks_in_group(sb, bgid);
+	uint32_t inodes_in_group = ext4_superblock_get_inodes_in_group(sb, bgid);
+	bool gdt_csum = ext4_superblock_has_feature_read_only(sb,
+	    EXT4_FEATURE_RO_COMPAT_GDT_CSUM);
+
+	if ((gdt_csum && ext4_block_group_get_checksum(bg) !=
+	    ext4_filesystem_bg_checksum(sb, bgid, bg)) ||
+	    (block_bitmap >= blocks_count) || (inode_bitmap >= blocks_count) ||
+	    (inode_table + itable_size > blocks_count)) {
+		/* Do not follow the metadata pointers */
+		check->bad_descriptors++;
+		check->free_blocks += free_blocks;
+		check->free_inodes += free_inodes;
+		return block_put(gdt_block);
+	}
+
+	bool block_uninit = ext4_block_group_has_flag(bg,
+	    EXT4_BLOCK_GROUP_BLOCK_UNINIT);
+	bool inode_uninit = ext4_block_group_has_flag(bg,
+	    EXT4_BLOCK_GROUP_INODE_UNINIT);
+
+	/* Number of i-nodes which may be in use */
+	uint32_t itable_used = inodes_in_group;
+	if (inode_uninit) {
+		itable_used = 0;
+	} else if (gdt_csum) {
+		uint32_t unused = ext4_block_group_get_itable_unused(bg, sb);
+		if (unused <= inodes_in_group)
+			itable_used -= unused;
+	}
+
+	uint32_t itable_blocks =
+	    ROUND_UP(itable_used * inode_size, block_size) / block_size;
+
+	/*
+	 * Without flexible block groups the bitmaps are followed by the
+	 * i-node table. Read all of them at once in that case.
+	 */
+	if (inode_bitmap == block_bitmap + 1 &&
+	    inode_table == inode_bitmap + 1) {
+		(void) block_prefetch(fs->device, block_bitmap,
+		    itable_blocks + 2);
+	} else if (itable_blocks > 0) {
+		(void) block_prefetch(fs->device, inode_table, itable_blocks);
+	}
+
+	if (!block_uninit) {
+		rc = block_get(&bitmap_block, fs->device, block_bitmap, 0);
+		if (rc != EOK)
+			goto out;
+
+		bfree = ext4_bitmap_count_free_bits(bitmap_block->data,
+		    blocks_in_group);
+
+		rc = block_put(bitmap_block);
+		if (rc != EOK)
+			goto out;
+
+		if (bfree != free_blocks)
+			check->bad_free_blocks++;
+
+		check->free_blocks += bfree;
+	} else {
+		check->free_blocks += free_blocks;
+	}
+
+	if (inode_uninit) {
+		check->free_inodes += free_inodes;
+		goto out;
+	}
+
+	rc = block_get(&bitmap_block, fs->device, inode_bitmap, 0);
+	if (rc != EOK)
+		goto out;
+
+	ifree = ext4_bitmap_count_free_bits(bitmap_block->data,
+	    inodes_in_group);
+	if (ifree != free_inodes)
+		check->bad_free_inodes++;
+
+	check->free_inodes += ifree;
+
+	/* I-nodes with links must be marked used in the bitmap */
+	for (uint32_t i = 0; i < itable_used; i++) {
+		uint32_t byte_offset = i * inode_size;
+
+		if (byte_offset % block_size == 0) {
+			if (block != NULL) {
+				rc = block_put(block);
+				block = NULL;
+				if (rc != EOK)
+					break;
+			}
+
+			rc = block_get(&block, fs->device,
+			    inode_table + byte_offset / block_size, 0);
+			if (rc != EOK) {
+				block = NULL;
+				break;
+			}
+		}
+
+		ext4_inode_t *inode = block->data + byte_offset % block_size;
+		if ((ext4_inode_get_links_count(inode) != 0) &&
+		    ext4_bitmap_is_free_bit(bitmap_block->data, i))
+			check->lost_inodes++;
+	}
+
+	if (block != NULL) {
+		rc2 = block_put(block);
+		if (rc == EOK)
+			rc = rc2;
+	}
+
+	rc2 = block_put(bitmap_block);
+	if (rc == EOK)
+		rc = rc2;
+out:
+	rc2 = block_put(gdt_block);
+	if (rc == EOK)
+		rc = rc2;
+
+	return rc;
+}
+
+/** Check consistency of the file system.
+ *
+ * The block group descriptors are verified against the bitmaps and the
+ * i-node tables. The file system is not modified. It is checked even if
+ * it was not unmounted cleanly, its state is reported in the results.
+ *
+ * @param service_id Block device with the file system
+ * @param check      Output value - results of the check
+ *
+ * @return Error code (inconsistencies found are not considered an error)
+ *
+ */
+errno_t ext4_filesystem_check(service_id_t service_id, ext4_check_t *check)
+{
+	ext4_filesystem_t *fs = NULL;
+	errno_t rc;
+
+	fs = calloc(1, sizeof(ext4_filesystem_t));
+	if (fs == NULL)
+		return ENOMEM;
+
+	/*
+	 * Initialize the file system for opening, but also accept volumes
+	 * which were not unmounted cleanly. Those need checking the most.
+	 */
+	rc = ext4_filesystem_init(fs, service_id, CACHE_MODE_WT, false);
+	if (rc != EOK) {
+		free(fs);
+		return rc;
+	}
+
+	memset(check, 0, sizeof(ext4_check_t));
+	check->groups = ext4_superblock_get_block_group_count(fs->superblock);
+	check->state = ext4_superblock_get_state(fs->superblock);
+
+	(void) ext4_filesystem_prefetch_gdt(fs);
+
+	for (uint32_t bgid = 0; bgid < check->groups; bgid++) {
+		rc = ext4_filesystem_check_group(fs, bgid, check);
+		if (rc != EOK)
+			break;
+	}
+
+	check->sb_free_blocks =
+	    ext4_superblock_get_free_blocks_count(fs->superblock);
+	check->sb_free_inodes =
+	    ext4_superblock_get_free_inodes_count(fs->superblock);
+
+	ext4_filesystem_fini(fs);
+	free(fs);
+	return rc;
+}
+
 /** Open filesystem and read all needed data.
  *
  * @param fs         Filesystem to be initialized
@@ -434,12 +812,19 @@ errno_t ext4_filesystem_open(ext4_instance_t *inst, service_id_t service_id,
 	inst->filesystem = fs;
 
 	/* Initialize the file system for opening */
-	rc = ext4_filesystem_init(fs, service_id, cmode);
+	rc = ext4_filesystem_init(fs, service_id, cmode, true);
 	if (rc != EOK)
 		goto error;
 
 	fs_inited = 1;
 
+	/*
+	 * Block group descriptors are needed by every i-node lookup and
+	 * allocation. Read the whole table at once rather than one block
+	 * at a time as the groups are visited.
+	 */
+	(void) ext4_filesystem_prefetch_gdt(fs);
+
 	/* Read root node */
 	rc = ext4_node_get_core(&root_node, inst, EXT4_INODE_ROOT_INDEX);
 	if (rc != EOK)
@@ -481,6 +866,8 @@ error:
  */
 errno_t ext4_filesystem_close(ext4_filesystem_t *fs)
 {
+	ext4_balloc_discard_flush(fs);
+
 	/* Write the superblock to the device */
 	ext4_superblock_set_state(fs->superblock, EXT4_SUPERBLOCK_STATE_VALID_FS);
 	errno_t rc = ext4_superblock_write_direct(fs->device, fs->superblock);
@@ -896,6 +1283,97 @@ static errno_t ext4_filesystem_init_inode_table(ext4_block_group_ref_t *bg_ref)
 	return EOK;
 }
 
+/** Read the block group descriptor table into the block cache.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_filesystem_prefetch_gdt(ext4_filesystem_t *fs)
+{
+	ext4_superblock_t *sb = fs->superblock;
+
+	uint32_t block_group_count = ext4_superblock_get_block_group_count(sb);
+	uint32_t descriptors_per_block =
+	    ext4_superblock_get_block_size(sb) /
+	    ext4_superblock_get_desc_size(sb);
+
+	/* Block group descriptor table starts at the next block after superblock */
+	aoff64_t block_id = ext4_superblock_get_first_data_block(sb) + 1;
+	uint32_t dtable_blocks =
+	    (block_group_count + descriptors_per_block - 1) /
+	    descriptors_per_block;
+
+	return block_prefetch(fs->device, block_id, dtable_blocks);
+}
+
+/** Find cached block group reference and add a user to it.
+ *
+ * The reference cache lock must be held.
+ *
+ * @param fs   Filesystem
+ * @param bgid Index of block group
+ *
+ * @return Block group reference or NULL if not cached
+ *
+ */
+static ext4_block_group_ref_t *ext4_filesystem_bg_ref_find_locked(
+    ext4_filesystem_t *fs, uint32_t bgid)
+{
+	assert(fibril_mutex_is_locked(&fs->ref_lock));
+
+	ht_link_t *link = hash_table_find(&fs->bg_refs, &bgid);
+	if (link == NULL)
+		return NULL;
+
+	ext4_block_group_ref_t *ref =
+	    hash_table_get_inst(link, ext4_block_group_ref_t, link);
+	if (ref->refcnt++ == 0) {
+		list_remove(&ref->lru_link);
+		fs->bg_lru_count--;
+	}
+
+	return ref;
+}
+
+/** Find cached block group reference and add a user to it.
+ *
+ * @param fs   Filesystem
+ * @param bgid Index of block group
+ *
+ * @return Block group reference or NULL if not cached
+ *
+ */
+static ext4_block_group_ref_t *ext4_filesystem_bg_ref_find(
+    ext4_filesystem_t *fs, uint32_t bgid)
+{
+	fibril_mutex_lock(&fs->ref_lock);
+	ext4_block_group_ref_t *ref = ext4_filesystem_bg_ref_find_locked(fs,
+	    bgid);
+	fibril_mutex_unlock(&fs->ref_lock);
+
+	return ref;
+}
+
+/** Write changes of block group descriptor to its block.
+ *
+ * @param ref Block group reference
+ *
+ */
+static void ext4_filesystem_bg_ref_flush(ext4_block_group_ref_t *ref)
+{
+	/* Compute new checksum of block group */
+	uint16_t checksum =
+	    ext4_filesystem_bg_checksum(ref->fs->superblock, ref->index,
+	    ref->block_group);
+	ext4_block_group_set_checksum(ref->block_group, checksum);
+
+	/* Mark block dirty for writing changes to physical device */
+	ref->block->dirty = true;
+	ref->dirty = false;
+}
+
 /** Get reference to block group specified by index.
  *
  * @param fs   Filesystem to find block group on
@@ -908,6 +1386,11 @@ static errno_t ext4_filesystem_init_inode_table(ext4_block_group_ref_t *bg_ref)
 errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid,
     ext4_block_group_ref_t **ref)
 {
+	/* Try to use a cached reference */
+	*ref = ext4_filesystem_bg_ref_find(fs, bgid);
+	if (*ref != NULL)
+		return EOK;
+
 	/* Allocate memory for new structure */
 	ext4_block_group_ref_t *newref =
 	    malloc(sizeof(ext4_block_group_ref_t));
@@ -940,8 +1423,8 @@ errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid
 	newref->fs = fs;
 	newref->index = bgid;
 	newref->dirty = false;
-
-	*ref = newref;
+	newref->refcnt = 1;
+	link_initialize(&newref->lru_link);
 
 	if (ext4_block_group_has_flag(newref->block_group,
 	    EXT4_BLOCK_GROUP_BLOCK_UNINIT)) {
@@ -986,6 +1469,24 @@ errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid
 		newref->dirty = true;
 	}
 
+	fibril_mutex_lock(&fs->ref_lock);
+
+	*ref = ext4_filesystem_bg_ref_find_locked(fs, bgid);
+	if (*ref == NULL) {
+		hash_table_insert(&fs->bg_refs, &newref->link);
+		fibril_mutex_unlock(&fs->ref_lock);
+		*ref = newref;
+		return EOK;
+	}
+
+	fibril_mutex_unlock(&fs->ref_lock);
+
+	/* Somebody else has loaded the block group meanwhile */
+	if (newref->dirty)
+		ext4_filesystem_bg_ref_flush(newref);
+
+	block_put(newref->block);
+	free(newref);
 	return EOK;
 }
 
@@ -1088,18 +1589,37 @@ uint32_t ext4_filesystem_bg_get_backup_blocks(ext4_block_group_ref_t *bg)
  */
 errno_t ext4_filesystem_put_block_group_ref(ext4_block_group_ref_t *ref)
 {
+	ext4_filesystem_t *fs = ref->fs;
+
 	/* Check if reference modified */
-	if (ref->dirty) {
-		/* Compute new checksum of block group */
-		uint16_t checksum =
-		    ext4_filesystem_bg_checksum(ref->fs->superblock, ref->index,
-		    ref->block_group);
-		ext4_block_group_set_checksum(ref->block_group, checksum);
+	if (ref->dirty)
+		ext4_filesystem_bg_ref_flush(ref);
 
-		/* Mark block dirty for writing changes to physical device */
-		ref->block->dirty = true;
+	fibril_mutex_lock(&fs->ref_lock);
+
+	assert(ref->refcnt > 0);
+	if (--ref->refcnt > 0) {
+		fibril_mutex_unlock(&fs->ref_lock);
+		return EOK;
+	}
+
+	if (fs->ref_retain) {
+		/* Keep the reference, evict the least recently used one */
+		list_append(&ref->lru_link, &fs->bg_lru);
+		if (fs->bg_lru_count++ < EXT4_BG_REF_CACHE_SIZE) {
+			fibril_mutex_unlock(&fs->ref_lock);
+			return EOK;
+		}
+
+		ref = list_get_instance(list_first(&fs->bg_lru),
+		    ext4_block_group_ref_t, lru_link);
+		list_remove(&ref->lru_link);
+		fs->bg_lru_count--;
 	}
 
+	hash_table_remove_item(&fs->bg_refs, &ref->link);
+	fibril_mutex_unlock(&fs->ref_lock);
+
 	/* Put back block, that contains block group descriptor */
 	errno_t rc = block_put(ref->block);
 	free(ref);
@@ -1107,6 +1627,53 @@ errno_t ext4_filesystem_put_block_group_ref(ext4_block_group_ref_t *ref)
 	return rc;
 }
 
+/** Find cached i-node reference and add a user to it.
+ *
+ * The reference cache lock must be held.
+ *
+ * @param fs    Filesystem
+ * @param index Index of i-node
+ *
+ * @return I-node reference or NULL if not cached
+ *
+ */
+static ext4_inode_ref_t *ext4_filesystem_inode_ref_find_locked(
+    ext4_filesystem_t *fs, uint32_t index)
+{
+	assert(fibril_mutex_is_locked(&fs->ref_lock));
+
+	ht_link_t *link = hash_table_find(&fs->inode_refs, &index);
+	if (link == NULL)
+		return NULL;
+
+	ext4_inode_ref_t *ref = hash_table_get_inst(link, ext4_inode_ref_t,
+	    link);
+	if (ref->refcnt++ == 0) {
+		list_remove(&ref->lru_link);
+		fs->inode_lru_count--;
+	}
+
+	return ref;
+}
+
+/** Find cached i-node reference and add a user to it.
+ *
+ * @param fs    Filesystem
+ * @param index Index of i-node
+ *
+ * @return I-node reference or NULL if not cached
+ *
+ */
+static ext4_inode_ref_t *ext4_filesystem_inode_ref_find(ext4_filesystem_t *fs,
+    uint32_t index)
+{
+	fibril_mutex_lock(&fs->ref_lock);
+	ext4_inode_ref_t *ref = ext4_filesystem_inode_ref_find_locked(fs, index);
+	fibril_mutex_unlock(&fs->ref_lock);
+
+	return ref;
+}
+
 /** Get reference to i-node specified by index.
  *
  * @param fs    Filesystem to find i-node on
@@ -1119,6 +1686,11 @@ errno_t ext4_filesystem_put_block_group_ref(ext4_block_group_ref_t *ref)
 errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
     ext4_inode_ref_t **ref)
 {
+	/* Try to use a cached reference */
+	*ref = ext4_filesystem_inode_ref_find(fs, index);
+	if (*ref != NULL)
+		return EOK;
+
 	/* Allocate memory for new structure */
 	ext4_inode_ref_t *newref =
 	    malloc(sizeof(ext4_inode_ref_t));
@@ -1178,9 +1750,24 @@ errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
 	newref->index = index + 1;
 	newref->fs = fs;
 	newref->dirty = false;
+	newref->refcnt = 1;
+	link_initialize(&newref->lru_link);
+
+	fibril_mutex_lock(&fs->ref_lock);
 
-	*ref = newref;
+	*ref = ext4_filesystem_inode_ref_find_locked(fs, newref->index);
+	if (*ref == NULL) {
+		hash_table_insert(&fs->inode_refs, &newref->link);
+		fibril_mutex_unlock(&fs->ref_lock);
+		*ref = newref;
+		return EOK;
+	}
 
+	fibril_mutex_unlock(&fs->ref_lock);
+
+	/* Somebody else has loaded the i-node meanwhile */
+	block_put(newref->block);
+	free(newref);
 	return EOK;
 }
 
@@ -1193,12 +1780,40 @@ errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
  */
 errno_t ext4_filesystem_put_inode_ref(ext4_inode_ref_t *ref)
 {
+	ext4_filesystem_t *fs = ref->fs;
+
 	/* Check if reference modified */
 	if (ref->dirty) {
 		/* Mark block dirty for writing changes to physical device */
 		ref->block->dirty = true;
+		ref->dirty = false;
+	}
+
+	fibril_mutex_lock(&fs->ref_lock);
+
+	assert(ref->refcnt > 0);
+	if (--ref->refcnt > 0) {
+		fibril_mutex_unlock(&fs->ref_lock);
+		return EOK;
 	}
 
+	if (fs->ref_retain) {
+		/* Keep the reference, evict the least recently used one */
+		list_append(&ref->lru_link, &fs->inode_lru);
+		if (fs->inode_lru_count++ < EXT4_INODE_REF_CACHE_SIZE) {
+			fibril_mutex_unlock(&fs->ref_lock);
+			return EOK;
+		}
+
+		ref = list_get_instance(list_first(&fs->inode_lru),
+		    ext4_inode_ref_t, lru_link);
+		list_remove(&ref->lru_link);
+		fs->inode_lru_count--;
+	}
+
+	hash_table_remove_item(&fs->inode_refs, &ref->link);
+	fibril_mutex_unlock(&fs->ref_lock);
+
 	/* Put back block, that contains i-node */
 	errno_t rc = block_put(ref->block);
 	free(ref);
@@ -1501,6 +2116,8 @@ finish:
 		ext4_inode_set_file_acl(inode_ref->inode, fs->superblock, 0);
 	}
 
+	ext4_balloc_discard_flush(fs);
+
 	/* Free inode by allocator */
 	errno_t rc;
 	if (ext4_inode_is_type(fs->superblock, inode_ref->inode,
@@ -1569,6 +2186,8 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 		}
 	}
 
+	ext4_balloc_discard_flush(inode_ref->fs);
+
 	/* Update i-node */
 	ext4_inode_set_size(inode_ref->inode, new_size);
 	inode_ref->dirty = true;
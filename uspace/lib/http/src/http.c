@@ -66,6 +66,8 @@ http_t *http_create(const char *host, uint16_t port)
 		return NULL;
 	}
 	http->port = port;
+	http->tcp = NULL;
+	http->conn = NULL;
 
 	http->buffer_size = 4096;
 	errno_t rc = recv_buffer_init(&http->recv_buffer, http->buffer_size,
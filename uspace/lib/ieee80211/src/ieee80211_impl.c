@@ -227,6 +227,14 @@ errno_t ieee80211_aes_key_unwrap(uint8_t *kek, uint8_t *data, size_t data_size,
 		return ENOMEM;
 
 	uint32_t n = data_size / 8 - 1;
+
+	aes_ctx_t ctx;
+	errno_t rc = aes_init(&ctx, kek, AES_CIPHER_LENGTH);
+	if (rc != EOK) {
+		memset(output, 0, n * 8);
+		return rc;
+	}
+
 	uint8_t work_data[n * 8];
 	uint8_t work_input[AES_CIPHER_LENGTH];
 	uint8_t work_output[AES_CIPHER_LENGTH];
@@ -250,7 +258,7 @@ errno_t ieee80211_aes_key_unwrap(uint8_t *kek, uint8_t *data, size_t data_size,
 			work_block = work_data + (i - 1) * 8;
 			memcpy(work_input, a, 8);
 			memcpy(work_input + 8, work_block, 8);
-			aes_decrypt(kek, work_input, work_output);
+			aes_decrypt_block(&ctx, work_input, work_output);
 			memcpy(a, work_output, 8);
 			memcpy(work_data + (i - 1) * 8, work_output + 8, 8);
 		}
@@ -264,10 +272,17 @@ errno_t ieee80211_aes_key_unwrap(uint8_t *kek, uint8_t *data, size_t data_size,
 
 	if (it == 8) {
 		memcpy(output, work_data, n * 8);
-		return EOK;
+		rc = EOK;
+	} else {
+		memset(output, 0, n * 8);
+		rc = EINVAL;
 	}
 
-	return EINVAL;
+	/* Do not leave the key schedule and the unwrapped key behind */
+	memset(&ctx, 0, sizeof(ctx));
+	memset(work_data, 0, n * 8);
+
+	return rc;
 }
 
 static void ieee80211_michael_mic_block(uint32_t *l, uint32_t *r,
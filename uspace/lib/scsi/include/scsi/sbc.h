@@ -133,6 +133,38 @@ typedef struct {
 	uint32_t block_size;
 } scsi_read_capacity_10_data_t;
 
+/** Service action of SCSI Read Capacity (16) command */
+#define SCSI_SA_READ_CAPACITY_16  0x10
+
+/** SCSI Read Capacity (16) command */
+typedef struct {
+	/** Operation code (SCSI_CMD_READ_CAPACITY_16) */
+	uint8_t op_code;
+	/** Reserved, Service Action (SCSI_SA_READ_CAPACITY_16) */
+	uint8_t service_action;
+	/** Obsolete */
+	uint64_t lba;
+	/** Allocation length */
+	uint32_t alloc_len;
+	/** Obsolete, PMI */
+	uint8_t pmi;
+	/** Control */
+	uint8_t control;
+} __attribute__((packed)) scsi_cdb_read_capacity_16_t;
+
+/** Read Capacity (16) parameter data.
+ *
+ * Returned for Read Capacity (16) command.
+ */
+typedef struct {
+	/** Logical address of last block */
+	uint64_t last_lba;
+	/** Size of block in bytes */
+	uint32_t block_size;
+	/** Protection information, logical blocks per physical block etc. */
+	uint8_t reserved[20];
+} __attribute__((packed)) scsi_read_capacity_16_data_t;
+
 /** SCSI Synchronize Cache (10) command */
 typedef struct {
 	/** Operation code (SCSI_CMD_SYNC_CACHE_10) */
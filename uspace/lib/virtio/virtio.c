@@ -184,6 +184,27 @@ void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
 	fibril_mutex_unlock(&q->lock);
 }
 
+/** Enable or disable interrupts for a virtqueue
+ *
+ * Disabling interrupts is only a hint to the device, the driver must still
+ * cope with interrupts which arrive meanwhile.
+ *
+ * @param vdev[in]    VIRTIO device.
+ * @param num[in]     Index of the virtqueue.
+ * @param enable[in]  True if the device should interrupt when it uses
+ *                    buffers from the virtqueue, false otherwise.
+ */
+void virtio_virtq_interrupt_enable(virtio_dev_t *vdev, uint16_t num,
+    bool enable)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	fibril_mutex_lock(&q->lock);
+	pio_write_le16(&q->avail->flags,
+	    enable ? 0 : VIRTQ_AVAIL_F_NO_INTERRUPT);
+	fibril_mutex_unlock(&q->lock);
+}
+
 bool virtio_virtq_consume_used(virtio_dev_t *vdev, uint16_t num,
     uint16_t *descno, uint32_t *len)
 {
@@ -298,8 +319,13 @@ void virtio_virtq_teardown(virtio_dev_t *vdev, uint16_t num)
 /**
  * Perform device initialization as described in section 3.1.1 of the
  * specification, steps 1 - 6.
+ *
+ * The device must offer all @a features, the @a optional features are
+ * accepted only if the device offers them. The accepted features are
+ * stored in vdev->features.
  */
-errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
+errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features,
+    uint32_t optional)
 {
 	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
 
@@ -328,7 +354,7 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 
 	if (features != (features & device_features))
 		return ENOTSUP;
-	features &= device_features;
+	features |= optional & device_features;
 
 	if (reserved_features != (reserved_features & device_reserved_features))
 		return ENOTSUP;
@@ -342,6 +368,7 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 
 	ddf_msg(LVL_NOTE, "accepted features %x, reserved features %x",
 	    features, reserved_features);
+	vdev->features = features;
 
 	/* 5. Set FEATURES_OK */
 	status |= VIRTIO_DEV_STATUS_FEATURES_OK;
@@ -36,43 +36,67 @@
  *
  * Allows accessing a file as a block device. Useful for, e.g., mounting
  * a disk image.
+ *
+ * Requests use positional I/O on the image file and do not share any file
+ * position, so they are served concurrently. Optionally the image is mapped
+ * via the VFS pager and blocks are read straight from the mapping. Writes
+ * to a mapped image are serialized. Every page of the mapping that has been
+ * touched stays resident, so only images up to MAP_MAX_SIZE are mapped.
  */
 
 #include <stdio.h>
 #include <async.h>
 #include <as.h>
 #include <bd_srv.h>
-#include <fibril_synch.h>
+#include <ipc/services.h>
 #include <loc.h>
+#include <mem.h>
+#include <ns.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <errno.h>
+#include <fibril_synch.h>
 #include <str_error.h>
 #include <stdbool.h>
 #include <task.h>
 #include <macros.h>
 #include <str.h>
+#include <vfs/vfs.h>
 
 #define NAME "file_bd"
 
 #define DEFAULT_BLOCK_SIZE 512
 
+/** Largest image mapped via the VFS pager */
+#define MAP_MAX_SIZE (64 * 1024 * 1024)
+
 static size_t block_size;
 static aoff64_t num_blocks;
-static FILE *img;
+static int img_fd;
+
+/** Image mapping or @c NULL if the image is not mapped */
+static uint8_t *img_map;
+static async_sess_t *pager_sess;
+
+/**
+ * Serializes writes to a mapped image, so that the file and the mapping
+ * are updated in the same order.
+ */
+static FIBRIL_MUTEX_INITIALIZE(img_map_lock);
 
 static service_id_t service_id;
 static bd_srvs_t bd_srvs;
-static fibril_mutex_t dev_lock;
 
 static void print_usage(void);
-static errno_t file_bd_init(const char *fname);
+static errno_t file_bd_init(const char *fname, bool map);
+static errno_t file_bd_map(void);
 static void file_bd_connection(ipc_call_t *icall, void *);
 
 static errno_t file_bd_open(bd_srvs_t *, bd_srv_t *);
 static errno_t file_bd_close(bd_srv_t *);
 static errno_t file_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t);
 static errno_t file_bd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
+static errno_t file_bd_sync_cache(bd_srv_t *, aoff64_t, size_t);
 static errno_t file_bd_get_block_size(bd_srv_t *, size_t *);
 static errno_t file_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
 
@@ -81,6 +105,7 @@ static bd_ops_t file_bd_ops = {
 	.close = file_bd_close,
 	.read_blocks = file_bd_read_blocks,
 	.write_blocks = file_bd_write_blocks,
+	.sync_cache = file_bd_sync_cache,
 	.get_block_size = file_bd_get_block_size,
 	.get_num_blocks = file_bd_get_num_blocks
 };
@@ -91,6 +116,7 @@ int main(int argc, char **argv)
 	char *image_name;
 	char *device_name;
 	category_id_t disk_cat;
+	bool map = false;
 
 	printf(NAME ": File-backed block device driver\n");
 
@@ -115,6 +141,8 @@ int main(int argc, char **argv)
 			}
 			++argv;
 			--argc;
+		} else if (str_cmp(*argv, "-m") == 0) {
+			map = true;
 		} else {
 			printf("Invalid option '%s'.\n", *argv);
 			print_usage();
@@ -133,7 +161,7 @@ int main(int argc, char **argv)
 	image_name = argv[0];
 	device_name = argv[1];
 
-	if (file_bd_init(image_name) != EOK)
+	if (file_bd_init(image_name, map) != EOK)
 		return -1;
 
 	rc = loc_service_register(device_name, &service_id);
@@ -166,13 +194,17 @@ int main(int argc, char **argv)
 
 static void print_usage(void)
 {
-	printf("Usage: " NAME " [-b <block_size>] <image_file> <device_name>\n");
+	printf("Usage: " NAME " [-b <block_size>] [-m] <image_file> "
+	    "<device_name>\n");
+	printf("  -m  Map the image file via the VFS pager (images up to "
+	    "%u MiB)\n", MAP_MAX_SIZE / (1024 * 1024));
 }
 
-static errno_t file_bd_init(const char *fname)
+static errno_t file_bd_init(const char *fname, bool map)
 {
 	bd_srvs_init(&bd_srvs);
 	bd_srvs.ops = &file_bd_ops;
+	bd_srvs.max_requests = BD_SRV_MAX_REQUESTS;
 
 	async_set_fallback_port_handler(file_bd_connection, NULL);
 	errno_t rc = loc_server_register(NAME);
@@ -181,25 +213,59 @@ static errno_t file_bd_init(const char *fname)
 		return rc;
 	}
 
-	img = fopen(fname, "rb+");
-	if (img == NULL)
+	rc = vfs_lookup_open(fname, WALK_REGULAR, MODE_READ | MODE_WRITE,
+	    &img_fd);
+	if (rc != EOK)
 		return EINVAL;
 
-	if (fseek(img, 0, SEEK_END) != 0) {
-		fclose(img);
+	vfs_stat_t stat;
+	rc = vfs_stat(img_fd, &stat);
+	if (rc != EOK) {
+		vfs_put(img_fd);
 		return EIO;
 	}
 
-	off64_t img_size = ftell(img);
-	if (img_size < 0) {
-		fclose(img);
-		return EIO;
+	num_blocks = stat.size / block_size;
+
+	if (map) {
+		rc = file_bd_map();
+		if (rc != EOK) {
+			printf("%s: Unable to map image, falling back to "
+			    "read requests: %s.\n", NAME, str_error(rc));
+		}
 	}
 
-	num_blocks = img_size / block_size;
+	return EOK;
+}
+
+/** Map the image file via the VFS pager.
+ *
+ * Pages of the mapping are private, so writes must update both the file
+ * and the mapping under img_map_lock. Touched pages are not given back
+ * until the server exits, so the mapping may cost as much memory as the
+ * image is large.
+ */
+static errno_t file_bd_map(void)
+{
+	if (num_blocks == 0 || num_blocks > MAP_MAX_SIZE / block_size)
+		return ELIMIT;
 
-	fibril_mutex_initialize(&dev_lock);
+	pager_sess = service_connect_blocking(SERVICE_VFS, INTERFACE_PAGER,
+	    0, NULL);
+	if (pager_sess == NULL)
+		return ENOENT;
+
+	void *area = async_as_area_create(AS_AREA_ANY,
+	    num_blocks * block_size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, pager_sess,
+	    img_fd, 0, 0);
+	if (area == AS_MAP_FAILED) {
+		async_hangup(pager_sess);
+		pager_sess = NULL;
+		return ENOMEM;
+	}
 
+	img_map = area;
 	return EOK;
 }
 
@@ -237,24 +303,16 @@ static errno_t file_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt, void *
 		return ELIMIT;
 	}
 
-	fibril_mutex_lock(&dev_lock);
-
-	clearerr(img);
-	if (fseek(img, ba * block_size, SEEK_SET) < 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
+	if (img_map != NULL) {
+		memcpy(buf, img_map + ba * block_size, cnt * block_size);
+		return EOK;
 	}
 
-	n_rd = fread(buf, block_size, cnt, img);
-
-	if (ferror(img)) {
-		fibril_mutex_unlock(&dev_lock);
+	aoff64_t pos = ba * block_size;
+	if (vfs_read(img_fd, &pos, buf, cnt * block_size, &n_rd) != EOK)
 		return EIO;	/* Read error */
-	}
 
-	fibril_mutex_unlock(&dev_lock);
-
-	if (n_rd < cnt)
+	if (n_rd < cnt * block_size)
 		return EINVAL;	/* Read beyond end of device */
 
 	return EOK;
@@ -277,27 +335,30 @@ static errno_t file_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
 		return ELIMIT;
 	}
 
-	fibril_mutex_lock(&dev_lock);
-
-	clearerr(img);
-	if (fseek(img, ba * block_size, SEEK_SET) < 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
+	if (img_map != NULL)
+		fibril_mutex_lock(&img_map_lock);
+
+	errno_t rc = EOK;
+	aoff64_t pos = ba * block_size;
+	if (vfs_write(img_fd, &pos, buf, cnt * block_size, &n_wr) != EOK ||
+	    n_wr < cnt * block_size) {
+		rc = EIO;	/* Write error */
+	} else if (img_map != NULL) {
+		/* Keep the private pages of the mapping in sync with the file */
+		memcpy(img_map + ba * block_size, buf, cnt * block_size);
 	}
 
-	n_wr = fwrite(buf, block_size, cnt, img);
+	if (img_map != NULL)
+		fibril_mutex_unlock(&img_map_lock);
 
-	if (ferror(img) || n_wr < cnt) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;	/* Write error */
-	}
+	return rc;
+}
 
-	if (fflush(img) != 0) {
-		fibril_mutex_unlock(&dev_lock);
+/** Flush the image file to its backing store. */
+static errno_t file_bd_sync_cache(bd_srv_t *bd, aoff64_t ba, size_t cnt)
+{
+	if (vfs_sync(img_fd) != EOK)
 		return EIO;
-	}
-
-	fibril_mutex_unlock(&dev_lock);
 
 	return EOK;
 }
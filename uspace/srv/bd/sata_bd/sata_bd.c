@@ -65,6 +65,7 @@ static errno_t sata_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t)
 static errno_t sata_bd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
 static errno_t sata_bd_get_block_size(bd_srv_t *, size_t *);
 static errno_t sata_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
+static errno_t sata_bd_discard(bd_srv_t *, aoff64_t, size_t);
 
 static bd_ops_t sata_bd_ops = {
 	.open = sata_bd_open,
@@ -72,7 +73,8 @@ static bd_ops_t sata_bd_ops = {
 	.read_blocks = sata_bd_read_blocks,
 	.write_blocks = sata_bd_write_blocks,
 	.get_block_size = sata_bd_get_block_size,
-	.get_num_blocks = sata_bd_get_num_blocks
+	.get_num_blocks = sata_bd_get_num_blocks,
+	.discard = sata_bd_discard
 };
 
 static sata_bd_dev_t *bd_srv_sata(bd_srv_t *bd)
@@ -109,6 +111,7 @@ static errno_t scan_device_tree(devman_handle_t funh)
 		bd_srvs_init(&disk[disk_count].bds);
 		disk[disk_count].bds.ops = &sata_bd_ops;
 		disk[disk_count].bds.sarg = &disk[disk_count];
+		disk[disk_count].bds.max_requests = BD_SRV_MAX_REQUESTS;
 
 		printf("Device %s - %s , blocks: %lu, block_size: %lu\n",
 		    disk[disk_count].dev_name, disk[disk_count].sata_dev_name,
@@ -224,6 +227,14 @@ static errno_t sata_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
 	return ahci_write_blocks(sbd->sess, ba, cnt, (void *)buf);
 }
 
+/** Discard blocks of partition. */
+static errno_t sata_bd_discard(bd_srv_t *bd, aoff64_t ba, size_t cnt)
+{
+	sata_bd_dev_t *sbd = bd_srv_sata(bd);
+
+	return ahci_discard_blocks(sbd->sess, ba, cnt);
+}
+
 /** Get device block size. */
 static errno_t sata_bd_get_block_size(bd_srv_t *bd, size_t *rsize)
 {
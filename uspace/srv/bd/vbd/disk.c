@@ -62,12 +62,13 @@ static errno_t vbds_disk_parts_remove(vbds_disk_t *, vbds_rem_flag_t);
 
 static errno_t vbds_bd_open(bd_srvs_t *, bd_srv_t *);
 static errno_t vbds_bd_close(bd_srv_t *);
-static errno_t vbds_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t);
+static errno_t vbds_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, ipc_call_t *);
 static errno_t vbds_bd_sync_cache(bd_srv_t *, aoff64_t, size_t);
-static errno_t vbds_bd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *,
-    size_t);
+static errno_t vbds_bd_write_blocks(bd_srv_t *, aoff64_t, size_t,
+    ipc_call_t *);
 static errno_t vbds_bd_get_block_size(bd_srv_t *, size_t *);
 static errno_t vbds_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
+static errno_t vbds_bd_discard(bd_srv_t *, aoff64_t, size_t);
 
 static errno_t vbds_bsa_translate(vbds_part_t *, aoff64_t, size_t, aoff64_t *);
 
@@ -86,11 +87,12 @@ static errno_t vbds_label_write(void *, aoff64_t, size_t, const void *);
 static bd_ops_t vbds_bd_ops = {
 	.open = vbds_bd_open,
 	.close = vbds_bd_close,
-	.read_blocks = vbds_bd_read_blocks,
+	.read_blocks_forward = vbds_bd_read_blocks,
 	.sync_cache = vbds_bd_sync_cache,
-	.write_blocks = vbds_bd_write_blocks,
+	.write_blocks_forward = vbds_bd_write_blocks,
 	.get_block_size = vbds_bd_get_block_size,
-	.get_num_blocks = vbds_bd_get_num_blocks
+	.get_num_blocks = vbds_bd_get_num_blocks,
+	.discard = vbds_bd_discard
 };
 
 /** Provide disk access to liblabel */
@@ -331,6 +333,7 @@ static errno_t vbds_part_add(vbds_disk_t *disk, label_part_t *lpart,
 	bd_srvs_init(&part->bds);
 	part->bds.ops = &vbds_bd_ops;
 	part->bds.sarg = part;
+	part->bds.max_requests = BD_SRV_MAX_REQUESTS;
 
 	if (lpinfo.pkind != lpk_extended) {
 		rc = vbds_part_svc_register(part);
@@ -967,32 +970,49 @@ static errno_t vbds_bd_close(bd_srv_t *bd)
 	return EOK;
 }
 
-static errno_t vbds_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
-    void *buf, size_t size)
+/** Translate data transfer request and forward its data call to the disk.
+ *
+ * The data travel between the client and the disk directly, without
+ * being copied into our address space.
+ */
+static errno_t vbds_bd_forward(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    ipc_call_t *dcall, bool write)
 {
 	vbds_part_t *part = bd_srv_part(bd);
+	size_t size = ipc_get_arg2(dcall);
 	aoff64_t gba;
 	errno_t rc;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_read_blocks()");
 	fibril_rwlock_read_lock(&part->lock);
 
 	if (cnt * part->disk->block_size < size) {
 		fibril_rwlock_read_unlock(&part->lock);
+		async_answer_0(dcall, EINVAL);
 		return EINVAL;
 	}
 
 	if (vbds_bsa_translate(part, ba, cnt, &gba) != EOK) {
 		fibril_rwlock_read_unlock(&part->lock);
+		async_answer_0(dcall, ELIMIT);
 		return ELIMIT;
 	}
 
-	rc = block_read_direct(part->disk->svc_id, gba, cnt, buf);
-	fibril_rwlock_read_unlock(&part->lock);
+	if (write)
+		rc = block_write_forward(part->disk->svc_id, gba, cnt, dcall);
+	else
+		rc = block_read_forward(part->disk->svc_id, gba, cnt, dcall);
 
+	fibril_rwlock_read_unlock(&part->lock);
 	return rc;
 }
 
+static errno_t vbds_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    ipc_call_t *rcall)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_read_blocks()");
+	return vbds_bd_forward(bd, ba, cnt, rcall, false);
+}
+
 static errno_t vbds_bd_sync_cache(bd_srv_t *bd, aoff64_t ba, size_t cnt)
 {
 	vbds_part_t *part = bd_srv_part(bd);
@@ -1018,26 +1038,27 @@ static errno_t vbds_bd_sync_cache(bd_srv_t *bd, aoff64_t ba, size_t cnt)
 }
 
 static errno_t vbds_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
-    const void *buf, size_t size)
+    ipc_call_t *wcall)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_write_blocks()");
+	return vbds_bd_forward(bd, ba, cnt, wcall, true);
+}
+
+static errno_t vbds_bd_discard(bd_srv_t *bd, aoff64_t ba, size_t cnt)
 {
 	vbds_part_t *part = bd_srv_part(bd);
 	aoff64_t gba;
 	errno_t rc;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_write_blocks()");
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_discard()");
 	fibril_rwlock_read_lock(&part->lock);
 
-	if (cnt * part->disk->block_size < size) {
-		fibril_rwlock_read_unlock(&part->lock);
-		return EINVAL;
-	}
-
 	if (vbds_bsa_translate(part, ba, cnt, &gba) != EOK) {
 		fibril_rwlock_read_unlock(&part->lock);
 		return ELIMIT;
 	}
 
-	rc = block_write_direct(part->disk->svc_id, gba, cnt, buf);
+	rc = block_discard(part->disk->svc_id, gba, cnt);
 	fibril_rwlock_read_unlock(&part->lock);
 	return rc;
 }
@@ -127,6 +127,9 @@ typedef struct {
 	struct exfat_node	*nodep;
 } exfat_idx_t;
 
+/** Name cache of a directory. */
+typedef struct exfat_dcache exfat_dcache_t;
+
 /** exFAT in-core node. */
 typedef struct exfat_node {
 	/** Back pointer to the FS node. */
@@ -161,6 +164,11 @@ typedef struct exfat_node {
 	bool		currc_cached_valid;
 	aoff64_t	currc_cached_bn;
 	exfat_cluster_t	currc_cached_value;
+
+	/** Name cache of a directory, built on the first lookup. */
+	exfat_dcache_t	*dcache;
+	/** Directory has too many entries for a name cache. */
+	bool		dcache_large;
 } exfat_node_t;
 
 extern vfs_out_ops_t exfat_ops;
@@ -243,6 +243,9 @@ errno_t exfat_bitmap_free_clusters(exfat_bs_t *bs, exfat_node_t *nodep,
 	lastc = nodep->firstc + ROUND_UP(nodep->size, BPC(bs)) / BPC(bs) - 1;
 	lastc -= count;
 
+	/* Discard the clusters while they cannot be allocated yet. */
+	exfat_discard_clusters(bs, nodep->idx->service_id, lastc + 1, count);
+
 	return exfat_bitmap_clear_clusters(bs, nodep->idx->service_id, lastc + 1, count);
 }
 
@@ -45,6 +45,11 @@
 #include <stdlib.h>
 #include <str.h>
 #include <align.h>
+#include <ctype.h>
+#include <assert.h>
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <fibril_synch.h>
 
 void exfat_directory_init(exfat_directory_t *di)
 {
@@ -555,6 +560,313 @@ errno_t exfat_directory_lookup_free(exfat_directory_t *di, size_t count)
 	return ENOSPC;
 }
 
+/** Name cache of a directory
+ *
+ * Maps names of the directory entries to the positions of their file
+ * entries so that lookups do not need to scan the whole directory. The
+ * cache is built on the first lookup and kept up to date as entries are
+ * linked and unlinked. It is protected by the lock of the directory node.
+ *
+ * Each entry takes a separate allocation and stays until the node is
+ * destroyed, so the number of entries is limited both per directory and
+ * in total. Directories whose cache would not fit are scanned instead.
+ */
+struct exfat_dcache {
+	hash_table_t names;
+	/** Number of entries */
+	size_t count;
+};
+
+/** Maximum number of entries in the name cache of one directory */
+#define EXFAT_DCACHE_MAX_ENTRIES  4096
+
+/** Maximum number of entries in all name caches together */
+#define EXFAT_DCACHE_MAX_TOTAL  16384
+
+/** Number of entries in all name caches */
+static size_t exfat_dcache_total = 0;
+
+/** Protects @c exfat_dcache_total */
+static FIBRIL_MUTEX_INITIALIZE(exfat_dcache_total_lock);
+
+/** Cached directory entry */
+typedef struct {
+	ht_link_t link;
+	/** Position of the file entry */
+	aoff64_t pos;
+	/** Name of the entry */
+	char name[];
+} exfat_dcache_entry_t;
+
+/** Hash a name so that names equal by str_casecmp() hash equally. */
+static size_t exfat_dcache_name_hash(const char *name)
+{
+	size_t size = str_size(name);
+	size_t off = 0;
+	size_t hash = 0;
+
+	while (off < size)
+		hash = hash_combine(hash, tolower(str_decode(name, &off, size)));
+
+	return hash;
+}
+
+static size_t exfat_dcache_key_hash(const void *key)
+{
+	return exfat_dcache_name_hash(key);
+}
+
+static size_t exfat_dcache_hash(const ht_link_t *item)
+{
+	exfat_dcache_entry_t *entry =
+	    hash_table_get_inst(item, exfat_dcache_entry_t, link);
+	return exfat_dcache_name_hash(entry->name);
+}
+
+static bool exfat_dcache_key_equal(const void *key, const ht_link_t *item)
+{
+	exfat_dcache_entry_t *entry =
+	    hash_table_get_inst(item, exfat_dcache_entry_t, link);
+	return str_casecmp(entry->name, key) == 0;
+}
+
+static void exfat_dcache_remove_callback(ht_link_t *item)
+{
+	free(hash_table_get_inst(item, exfat_dcache_entry_t, link));
+}
+
+static hash_table_ops_t exfat_dcache_ops = {
+	.hash = exfat_dcache_hash,
+	.key_hash = exfat_dcache_key_hash,
+	.key_equal = exfat_dcache_key_equal,
+	.equal = NULL,
+	.remove_callback = exfat_dcache_remove_callback
+};
+
+/** Find cached entry with the given name and position. */
+static exfat_dcache_entry_t *exfat_dcache_find(exfat_dcache_t *dcache,
+    const char *name, aoff64_t pos)
+{
+	ht_link_t *first = hash_table_find(&dcache->names, name);
+	ht_link_t *link = first;
+
+	while (link != NULL) {
+		exfat_dcache_entry_t *entry =
+		    hash_table_get_inst(link, exfat_dcache_entry_t, link);
+		if (entry->pos == pos)
+			return entry;
+		link = hash_table_find_next(&dcache->names, first, link);
+	}
+
+	return NULL;
+}
+
+/** Account for entries leaving the name caches. */
+static void exfat_dcache_uncharge(size_t count)
+{
+	fibril_mutex_lock(&exfat_dcache_total_lock);
+	exfat_dcache_total -= count;
+	fibril_mutex_unlock(&exfat_dcache_total_lock);
+}
+
+/** Insert an entry into a name cache.
+ *
+ * @return		EOK on success, ELIMIT if the cache is full or
+ *			ENOMEM if out of memory.
+ */
+static errno_t exfat_dcache_insert(exfat_dcache_t *dcache, const char *name,
+    aoff64_t pos)
+{
+	if (exfat_dcache_find(dcache, name, pos) != NULL)
+		return EOK;
+
+	if (dcache->count >= EXFAT_DCACHE_MAX_ENTRIES)
+		return ELIMIT;
+
+	fibril_mutex_lock(&exfat_dcache_total_lock);
+	if (exfat_dcache_total >= EXFAT_DCACHE_MAX_TOTAL) {
+		fibril_mutex_unlock(&exfat_dcache_total_lock);
+		return ELIMIT;
+	}
+	exfat_dcache_total++;
+	fibril_mutex_unlock(&exfat_dcache_total_lock);
+
+	size_t size = str_size(name) + 1;
+	exfat_dcache_entry_t *entry =
+	    malloc(sizeof(exfat_dcache_entry_t) + size);
+	if (entry == NULL) {
+		exfat_dcache_uncharge(1);
+		return ENOMEM;
+	}
+
+	entry->pos = pos;
+	str_cpy(entry->name, size, name);
+	hash_table_insert(&dcache->names, &entry->link);
+	dcache->count++;
+	return EOK;
+}
+
+/** Build the name cache of a directory by reading all its entries. */
+static errno_t exfat_directory_cache_build(exfat_node_t *nodep)
+{
+	char name[EXFAT_FILENAME_LEN + 1];
+	exfat_file_dentry_t df;
+	exfat_stream_dentry_t ds;
+	exfat_directory_t di;
+	errno_t rc;
+
+	exfat_dcache_t *dcache = malloc(sizeof(exfat_dcache_t));
+	if (dcache == NULL)
+		return ENOMEM;
+
+	if (!hash_table_create(&dcache->names, 0, 0, &exfat_dcache_ops)) {
+		free(dcache);
+		return ENOMEM;
+	}
+
+	dcache->count = 0;
+
+	rc = exfat_directory_open(nodep, &di);
+	if (rc != EOK)
+		goto error;
+
+	while ((rc = exfat_directory_read_file(&di, name, EXFAT_FILENAME_LEN,
+	    &df, &ds)) == EOK) {
+		rc = exfat_dcache_insert(dcache, name, di.pos);
+		if (rc != EOK)
+			break;
+		rc = exfat_directory_next(&di);
+		if (rc != EOK)
+			break;
+	}
+
+	/* Reaching the end of the directory is the expected outcome */
+	if (rc != ENOENT) {
+		(void) exfat_directory_close(&di);
+		goto error;
+	}
+
+	rc = exfat_directory_close(&di);
+	if (rc != EOK)
+		goto error;
+
+	nodep->dcache = dcache;
+	return EOK;
+
+error:
+	if (dcache->count >= EXFAT_DCACHE_MAX_ENTRIES)
+		nodep->dcache_large = true;
+
+	exfat_dcache_uncharge(dcache->count);
+	hash_table_destroy(&dcache->names);
+	free(dcache);
+	return rc;
+}
+
+/** Look up a directory entry by name.
+ *
+ * The name cache of the directory is built on the first lookup. The
+ * directory node must be locked.
+ *
+ * @param nodep		Directory node.
+ * @param name		Name to look up.
+ * @param pos		Place to store the position of the file entry.
+ *
+ * @return		EOK on success, ENOENT if there is no such entry,
+ *			ELIMIT if the directory is too large to be cached or
+ *			another error code if the cache could not be built.
+ */
+errno_t exfat_directory_cache_lookup(exfat_node_t *nodep, const char *name,
+    aoff64_t *pos)
+{
+	errno_t rc;
+
+	assert(fibril_mutex_is_locked(&nodep->lock));
+
+	/* Large directories are scanned by the caller */
+	if (nodep->dcache_large)
+		return ELIMIT;
+
+	if (nodep->dcache == NULL) {
+		rc = exfat_directory_cache_build(nodep);
+		if (rc != EOK)
+			return rc;
+	}
+
+	ht_link_t *link = hash_table_find(&nodep->dcache->names, name);
+	if (link == NULL)
+		return ENOENT;
+
+	*pos = hash_table_get_inst(link, exfat_dcache_entry_t, link)->pos;
+	return EOK;
+}
+
+/** Add a new directory entry to the name cache.
+ *
+ * The directory node must be locked.
+ *
+ * @param nodep		Directory node.
+ * @param name		Name of the entry.
+ * @param pos		Position of the file entry.
+ */
+void exfat_directory_cache_add(exfat_node_t *nodep, const char *name,
+    aoff64_t pos)
+{
+	assert(fibril_mutex_is_locked(&nodep->lock));
+
+	if (nodep->dcache == NULL)
+		return;
+
+	/* Rather drop the cache than let it become incomplete */
+	if (exfat_dcache_insert(nodep->dcache, name, pos) != EOK) {
+		if (nodep->dcache->count >= EXFAT_DCACHE_MAX_ENTRIES)
+			nodep->dcache_large = true;
+		exfat_directory_cache_destroy(nodep);
+	}
+}
+
+/** Remove an erased directory entry from the name cache.
+ *
+ * The directory node must be locked.
+ *
+ * @param nodep		Directory node.
+ * @param name		Name of the entry.
+ * @param pos		Position of the file entry.
+ */
+void exfat_directory_cache_remove(exfat_node_t *nodep, const char *name,
+    aoff64_t pos)
+{
+	assert(fibril_mutex_is_locked(&nodep->lock));
+
+	if (nodep->dcache == NULL)
+		return;
+
+	exfat_dcache_entry_t *entry =
+	    exfat_dcache_find(nodep->dcache, name, pos);
+	if (entry != NULL) {
+		hash_table_remove_item(&nodep->dcache->names, &entry->link);
+		nodep->dcache->count--;
+		exfat_dcache_uncharge(1);
+	} else {
+		exfat_directory_cache_destroy(nodep);
+	}
+}
+
+/** Destroy the name cache of a directory.
+ *
+ * @param nodep		Directory node.
+ */
+void exfat_directory_cache_destroy(exfat_node_t *nodep)
+{
+	if (nodep->dcache == NULL)
+		return;
+
+	exfat_dcache_uncharge(nodep->dcache->count);
+	hash_table_destroy(&nodep->dcache->names);
+	free(nodep->dcache);
+	nodep->dcache = NULL;
+}
+
 /**
  * @}
  */
@@ -79,6 +79,13 @@ extern errno_t exfat_directory_expand(exfat_directory_t *);
 extern errno_t exfat_directory_lookup_free(exfat_directory_t *, size_t);
 extern errno_t exfat_directory_print(exfat_directory_t *);
 
+extern errno_t exfat_directory_cache_lookup(exfat_node_t *, const char *,
+    aoff64_t *);
+extern void exfat_directory_cache_add(exfat_node_t *, const char *, aoff64_t);
+extern void exfat_directory_cache_remove(exfat_node_t *, const char *,
+    aoff64_t);
+extern void exfat_directory_cache_destroy(exfat_node_t *);
+
 #endif
 
 /**
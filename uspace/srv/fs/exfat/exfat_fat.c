@@ -352,7 +352,59 @@ exit_error:
 	return rc;
 }
 
+/** Discard a run of consecutive clusters.
+ *
+ * The clusters must still be allocated so that the discard cannot race
+ * with their reuse by another file.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param firstc	First cluster of the run.
+ * @param ncl		Number of clusters in the run.
+ */
+void
+exfat_discard_clusters(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t firstc, exfat_cluster_t ncl)
+{
+	/* Discarding is only a hint for the device, ignore errors. */
+	(void) block_discard(service_id, DATA_FS(bs) +
+	    (firstc - EXFAT_CLST_FIRST) * SPC(bs), (size_t) ncl * SPC(bs));
+}
+
+/** Discard and free a run of consecutive clusters of a cluster chain.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param firstc	First cluster of the run.
+ * @param ncl		Number of clusters in the run.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t
+exfat_free_run(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t firstc, exfat_cluster_t ncl)
+{
+	exfat_cluster_t clst;
+	errno_t rc;
+
+	exfat_discard_clusters(bs, service_id, firstc, ncl);
+
+	for (clst = firstc; clst < firstc + ncl; clst++) {
+		rc = exfat_set_cluster(bs, service_id, clst, 0);
+		if (rc != EOK)
+			return rc;
+		rc = exfat_bitmap_clear_cluster(bs, service_id, clst);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
 /** Free clusters forming a cluster chain in FAT.
+ *
+ * Runs of consecutive clusters in the chain are discarded on the device
+ * with a single request each before they are marked as free.
  *
  * @param bs		Buffer hodling the boot sector of the file system.
  * @param service_id	Service ID of the file system.
@@ -364,6 +416,8 @@ errno_t
 exfat_free_clusters(exfat_bs_t *bs, service_id_t service_id, exfat_cluster_t firstc)
 {
 	exfat_cluster_t nextc;
+	exfat_cluster_t runc = 0;
+	exfat_cluster_t run = 0;
 	errno_t rc;
 
 	/* Mark all clusters in the chain as free */
@@ -372,15 +426,25 @@ exfat_free_clusters(exfat_bs_t *bs, service_id_t service_id, exfat_cluster_t fir
 		rc = exfat_get_cluster(bs, service_id, firstc, &nextc);
 		if (rc != EOK)
 			return rc;
-		rc = exfat_set_cluster(bs, service_id, firstc, 0);
-		if (rc != EOK)
-			return rc;
-		rc = exfat_bitmap_clear_cluster(bs, service_id, firstc);
-		if (rc != EOK)
-			return rc;
+
+		if (run > 0 && firstc == runc + run) {
+			run++;
+		} else {
+			if (run > 0) {
+				rc = exfat_free_run(bs, service_id, runc, run);
+				if (rc != EOK)
+					return rc;
+			}
+			runc = firstc;
+			run = 1;
+		}
+
 		firstc = nextc;
 	}
 
+	if (run > 0)
+		return exfat_free_run(bs, service_id, runc, run);
+
 	return EOK;
 }
 
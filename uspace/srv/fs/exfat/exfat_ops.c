@@ -112,6 +112,8 @@ static void exfat_node_initialize(exfat_node_t *node)
 	node->currc_cached_valid = false;
 	node->currc_cached_bn = 0;
 	node->currc_cached_value = 0;
+	node->dcache = NULL;
+	node->dcache_large = false;
 }
 
 static errno_t exfat_node_sync(exfat_node_t *node)
@@ -200,6 +202,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		exfat_directory_cache_destroy(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -238,12 +241,14 @@ static errno_t exfat_node_get_new(exfat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				exfat_directory_cache_destroy(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
 			}
 		}
 		idxp_tmp->nodep = NULL;
+		exfat_directory_cache_destroy(nodep);
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
 		fn = FS_NODE(nodep);
@@ -511,53 +516,65 @@ errno_t exfat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 	exfat_file_dentry_t df;
 	exfat_stream_dentry_t ds;
 	service_id_t service_id;
+	aoff64_t pos;
 	errno_t rc;
 
 	fibril_mutex_lock(&parentp->idx->lock);
 	service_id = parentp->idx->service_id;
 	fibril_mutex_unlock(&parentp->idx->lock);
 
-	exfat_directory_t di;
-	rc = exfat_directory_open(parentp, &di);
-	if (rc != EOK)
-		return rc;
+	fibril_mutex_lock(&parentp->lock);
+	rc = exfat_directory_cache_lookup(parentp, component, &pos);
+	fibril_mutex_unlock(&parentp->lock);
 
-	while (exfat_directory_read_file(&di, name, EXFAT_FILENAME_LEN, &df,
-	    &ds) == EOK) {
-		if (str_casecmp(name, component) == 0) {
-			/* hit */
-			exfat_node_t *nodep;
-			aoff64_t o = di.pos %
-			    (BPS(di.bs) / sizeof(exfat_dentry_t));
-			exfat_idx_t *idx = exfat_idx_get_by_pos(service_id,
-			    parentp->firstc, di.bnum * DPS(di.bs) + o);
-			if (!idx) {
-				/*
-				 * Can happen if memory is low or if we
-				 * run out of 32-bit indices.
-				 */
-				rc = exfat_directory_close(&di);
-				return (rc == EOK) ? ENOMEM : rc;
-			}
-			rc = exfat_node_get_core(&nodep, idx);
-			fibril_mutex_unlock(&idx->lock);
-			if (rc != EOK) {
-				(void) exfat_directory_close(&di);
-				return rc;
-			}
-			*rfn = FS_NODE(nodep);
-			rc = exfat_directory_close(&di);
-			if (rc != EOK)
-				(void) exfat_node_put(*rfn);
+	if (rc == ENOENT) {
+		*rfn = NULL;
+		return EOK;
+	}
+
+	if (rc != EOK) {
+		/* Without the name cache, scan the directory */
+		exfat_directory_t di;
+		rc = exfat_directory_open(parentp, &di);
+		if (rc != EOK)
 			return rc;
-		} else {
-			rc = exfat_directory_next(&di);
-			if (rc != EOK)
+
+		bool found = false;
+		while (exfat_directory_read_file(&di, name, EXFAT_FILENAME_LEN,
+		    &df, &ds) == EOK) {
+			if (str_casecmp(name, component) == 0) {
+				/* hit */
+				found = true;
+				pos = di.pos;
 				break;
+			}
+
+			if (exfat_directory_next(&di) != EOK)
+				break;
+		}
+
+		rc = exfat_directory_close(&di);
+		if (rc != EOK || !found) {
+			*rfn = NULL;
+			return rc;
 		}
 	}
-	(void) exfat_directory_close(&di);
-	*rfn = NULL;
+
+	exfat_node_t *nodep;
+	exfat_idx_t *idx = exfat_idx_get_by_pos(service_id, parentp->firstc,
+	    pos);
+	if (!idx) {
+		/*
+		 * Can happen if memory is low or if we
+		 * run out of 32-bit indices.
+		 */
+		return ENOMEM;
+	}
+	rc = exfat_node_get_core(&nodep, idx);
+	fibril_mutex_unlock(&idx->lock);
+	if (rc != EOK)
+		return rc;
+	*rfn = FS_NODE(nodep);
 	return EOK;
 }
 
@@ -616,6 +633,7 @@ errno_t exfat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		exfat_directory_cache_destroy(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -710,6 +728,7 @@ errno_t exfat_destroy_node(fs_node_t *fn)
 	}
 
 	exfat_idx_destroy(nodep->idx);
+	exfat_directory_cache_destroy(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -759,6 +778,11 @@ errno_t exfat_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 	}
 
 	fibril_mutex_unlock(&parentp->idx->lock);
+
+	fibril_mutex_lock(&parentp->lock);
+	exfat_directory_cache_add(parentp, name, di.pos);
+	fibril_mutex_unlock(&parentp->lock);
+
 	fibril_mutex_lock(&childp->idx->lock);
 
 	childp->idx->pfc = parentp->firstc;
@@ -812,6 +836,8 @@ errno_t exfat_unlink(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	if (rc != EOK)
 		goto error;
 
+	exfat_directory_cache_remove(parentp, nm, childp->idx->pdi);
+
 	/* remove the index structure from the position hash */
 	exfat_idx_hashout(childp->idx);
 	/* clear position information */
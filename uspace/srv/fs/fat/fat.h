@@ -221,6 +221,9 @@ typedef struct {
 	struct fat_node	*nodep;
 } fat_idx_t;
 
+/** Name cache of a directory. */
+typedef struct fat_dcache fat_dcache_t;
+
 /** FAT in-core node. */
 typedef struct fat_node {
 	/** Back pointer to the FS node. */
@@ -253,6 +256,11 @@ typedef struct fat_node {
 	bool		currc_cached_valid;
 	aoff64_t	currc_cached_bn;
 	fat_cluster_t	currc_cached_value;
+
+	/** Name cache of a directory, built on the first lookup. */
+	fat_dcache_t	*dcache;
+	/** Directory has too many entries for a name cache. */
+	bool		dcache_large;
 } fat_node_t;
 
 typedef struct {
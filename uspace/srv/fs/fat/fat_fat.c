@@ -54,8 +54,9 @@
 
 /**
  * The fat_alloc_lock mutex protects all copies of the File Allocation Table
- * during allocation of clusters. The lock does not have to be held durring
- * deallocation of clusters.
+ * during allocation of clusters. It is also held during deallocation of
+ * clusters so that the freed clusters are discarded before they can be
+ * allocated again.
  */
 static FIBRIL_MUTEX_INITIALIZE(fat_alloc_lock);
 
@@ -734,7 +735,27 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 	return ENOSPC;
 }
 
+/** Discard a run of consecutive free clusters.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Device service ID of the file system.
+ * @param firstc	First cluster of the run.
+ * @param ncl		Number of clusters in the run.
+ */
+static void
+fat_discard_clusters(fat_bs_t *bs, service_id_t service_id,
+    fat_cluster_t firstc, unsigned ncl)
+{
+	/* Discarding is only a hint for the device, ignore errors. */
+	(void) block_discard(service_id, CLBN2PBN(bs, firstc, 0),
+	    (size_t) ncl * SPC(bs));
+}
+
 /** Free clusters forming a cluster chain in all copies of FAT.
+ *
+ * The freed clusters are discarded on the device, runs of consecutive
+ * clusters with a single request. This is done before the clusters can
+ * be allocated again.
  *
  * @param bs		Buffer hodling the boot sector of the file system.
  * @param service_id	Device service ID of the file system.
@@ -748,7 +769,11 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 	unsigned fatno;
 	fat_cluster_t nextc = 0;
 	fat_cluster_t clst_bad = FAT_CLST_BAD(bs);
-	errno_t rc;
+	fat_cluster_t runc = 0;
+	unsigned run = 0;
+	errno_t rc = EOK;
+
+	fibril_mutex_lock(&fat_alloc_lock);
 
 	/* Mark all clusters in the chain as free in all copies of FAT. */
 	while (firstc < FAT_CLST_LAST1(bs)) {
@@ -756,19 +781,34 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 
 		rc = fat_get_cluster(bs, service_id, FAT1, firstc, &nextc);
 		if (rc != EOK)
-			return rc;
+			break;
 
 		for (fatno = FAT1; fatno < FATCNT(bs); fatno++) {
 			rc = fat_set_cluster(bs, service_id, fatno, firstc,
 			    FAT_CLST_RES0);
 			if (rc != EOK)
-				return rc;
+				break;
+		}
+		if (rc != EOK)
+			break;
+
+		if (run > 0 && firstc == runc + run) {
+			run++;
+		} else {
+			if (run > 0)
+				fat_discard_clusters(bs, service_id, runc, run);
+			runc = firstc;
+			run = 1;
 		}
 
 		firstc = nextc;
 	}
 
-	return EOK;
+	if (run > 0)
+		fat_discard_clusters(bs, service_id, runc, run);
+
+	fibril_mutex_unlock(&fat_alloc_lock);
+	return rc;
 }
 
 /** Append a cluster chain to the last file cluster in all FATs.
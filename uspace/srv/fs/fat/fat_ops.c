@@ -111,6 +111,8 @@ static void fat_node_initialize(fat_node_t *node)
 	node->currc_cached_valid = false;
 	node->currc_cached_bn = 0;
 	node->currc_cached_value = 0;
+	node->dcache = NULL;
+	node->dcache_large = false;
 }
 
 static errno_t fat_node_sync(fat_node_t *node)
@@ -192,6 +194,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fat_directory_cache_destroy(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -230,12 +233,14 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fat_directory_cache_destroy(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
 			}
 		}
 		idxp_tmp->nodep = NULL;
+		fat_directory_cache_destroy(nodep);
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
 		fn = FS_NODE(nodep);
@@ -375,52 +380,63 @@ errno_t fat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 	char name[FAT_LFN_NAME_SIZE];
 	fat_dentry_t *d;
 	service_id_t service_id;
+	aoff64_t pos;
 	errno_t rc;
 
 	fibril_mutex_lock(&parentp->idx->lock);
 	service_id = parentp->idx->service_id;
 	fibril_mutex_unlock(&parentp->idx->lock);
 
-	fat_directory_t di;
-	rc = fat_directory_open(parentp, &di);
-	if (rc != EOK)
-		return rc;
+	fibril_mutex_lock(&parentp->lock);
+	rc = fat_directory_cache_lookup(parentp, component, &pos);
+	fibril_mutex_unlock(&parentp->lock);
 
-	while (fat_directory_read(&di, name, &d) == EOK) {
-		if (fat_dentry_namecmp(name, component) == 0) {
-			/* hit */
-			fat_node_t *nodep;
-			aoff64_t o = di.pos %
-			    (BPS(di.bs) / sizeof(fat_dentry_t));
-			fat_idx_t *idx = fat_idx_get_by_pos(service_id,
-			    parentp->firstc, di.bnum * DPS(di.bs) + o);
-			if (!idx) {
-				/*
-				 * Can happen if memory is low or if we
-				 * run out of 32-bit indices.
-				 */
-				rc = fat_directory_close(&di);
-				return (rc == EOK) ? ENOMEM : rc;
-			}
-			rc = fat_node_get_core(&nodep, idx);
-			fibril_mutex_unlock(&idx->lock);
-			if (rc != EOK) {
-				(void) fat_directory_close(&di);
-				return rc;
-			}
-			*rfn = FS_NODE(nodep);
-			rc = fat_directory_close(&di);
-			if (rc != EOK)
-				(void) fat_node_put(*rfn);
+	if (rc == ENOENT) {
+		*rfn = NULL;
+		return EOK;
+	}
+
+	if (rc != EOK) {
+		/* Without the name cache, scan the directory */
+		fat_directory_t di;
+		rc = fat_directory_open(parentp, &di);
+		if (rc != EOK)
 			return rc;
-		} else {
-			rc = fat_directory_next(&di);
-			if (rc != EOK)
+
+		bool found = false;
+		while (fat_directory_read(&di, name, &d) == EOK) {
+			if (fat_dentry_namecmp(name, component) == 0) {
+				/* hit */
+				found = true;
+				pos = di.pos;
+				break;
+			}
+
+			if (fat_directory_next(&di) != EOK)
 				break;
 		}
+
+		rc = fat_directory_close(&di);
+		if (rc != EOK || !found) {
+			*rfn = NULL;
+			return rc;
+		}
 	}
-	(void) fat_directory_close(&di);
-	*rfn = NULL;
+
+	fat_node_t *nodep;
+	fat_idx_t *idx = fat_idx_get_by_pos(service_id, parentp->firstc, pos);
+	if (!idx) {
+		/*
+		 * Can happen if memory is low or if we
+		 * run out of 32-bit indices.
+		 */
+		return ENOMEM;
+	}
+	rc = fat_node_get_core(&nodep, idx);
+	fibril_mutex_unlock(&idx->lock);
+	if (rc != EOK)
+		return rc;
+	*rfn = FS_NODE(nodep);
 	return EOK;
 }
 
@@ -476,6 +492,7 @@ errno_t fat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fat_directory_cache_destroy(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -569,6 +586,7 @@ errno_t fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fat_directory_cache_destroy(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -629,6 +647,10 @@ errno_t fat_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 
 	fibril_mutex_unlock(&parentp->idx->lock);
 
+	fibril_mutex_lock(&parentp->lock);
+	fat_directory_cache_add(parentp, name, di.pos);
+	fibril_mutex_unlock(&parentp->lock);
+
 	fibril_mutex_lock(&childp->idx->lock);
 
 	if (childp->type == FAT_DIRECTORY) {
@@ -730,6 +752,8 @@ errno_t fat_unlink(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	if (rc != EOK)
 		goto error;
 
+	fat_directory_cache_remove(parentp, nm, childp->idx->pdi);
+
 	/* remove the index structure from the position hash */
 	fat_idx_hashout(childp->idx);
 	/* clear position information */
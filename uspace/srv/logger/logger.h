@@ -35,6 +35,7 @@
 #ifndef LOGGER_H_
 #define LOGGER_H_
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <adt/prodcons.h>
 #include <io/log.h>
@@ -62,6 +63,7 @@ typedef struct {
 
 struct logger_log {
 	link_t link;
+	ht_link_t id_link;
 
 	size_t ref_counter;
 
@@ -81,12 +83,14 @@ typedef struct {
 	logger_log_t *logs[MAX_REFERENCED_LOGS_PER_CLIENT];
 } logger_registered_logs_t;
 
+errno_t logs_init(void);
 logger_log_t *find_log_by_name_and_lock(const char *name);
 logger_log_t *find_or_create_log_and_lock(const char *, sysarg_t);
 logger_log_t *find_log_by_id_and_lock(sysarg_t);
 bool shall_log_message(logger_log_t *, log_level_t);
 void log_unlock(logger_log_t *);
 void write_to_log(logger_log_t *, log_level_t, const char *);
+void flush_log(logger_log_t *);
 void log_release(logger_log_t *);
 
 void registered_logs_init(logger_registered_logs_t *);
@@ -29,6 +29,8 @@
 /** @addtogroup logger
  * @{
  */
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <assert.h>
 #include <errno.h>
 #include <stdio.h>
@@ -39,6 +41,44 @@
 static FIBRIL_MUTEX_INITIALIZE(log_list_guard);
 static LIST_INITIALIZE(log_list);
 
+/** Logs hashed by their ID (protected by log_list_guard). */
+static hash_table_t log_id_hash;
+
+static size_t log_id_key_hash(const void *key)
+{
+	const sysarg_t *id = key;
+	return hash_mix(*id);
+}
+
+static size_t log_id_hash_fn(const ht_link_t *item)
+{
+	logger_log_t *log = hash_table_get_inst(item, logger_log_t, id_link);
+	return hash_mix((sysarg_t) log);
+}
+
+static bool log_id_key_equal(const void *key, const ht_link_t *item)
+{
+	const sysarg_t *id = key;
+	logger_log_t *log = hash_table_get_inst(item, logger_log_t, id_link);
+	return (sysarg_t) log == *id;
+}
+
+static hash_table_ops_t log_id_hash_ops = {
+	.hash = log_id_hash_fn,
+	.key_hash = log_id_key_hash,
+	.key_equal = log_id_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+errno_t logs_init(void)
+{
+	if (!hash_table_create(&log_id_hash, 0, 0, &log_id_hash_ops))
+		return ENOMEM;
+
+	return EOK;
+}
+
 static logger_log_t *find_log_by_name_and_parent_no_list_lock(const char *name, logger_log_t *parent)
 {
 	list_foreach(log_list, link, logger_log_t, log) {
@@ -122,6 +162,7 @@ logger_log_t *find_or_create_log_and_lock(const char *name, sysarg_t parent_id)
 		if (result == NULL)
 			goto leave;
 		list_append(&result->link, &log_list);
+		hash_table_insert(&log_id_hash, &result->id_link);
 		if (result->parent != NULL) {
 			fibril_mutex_lock(&result->parent->guard);
 			result->parent->ref_counter++;
@@ -159,12 +200,10 @@ logger_log_t *find_log_by_id_and_lock(sysarg_t id)
 	logger_log_t *result = NULL;
 
 	fibril_mutex_lock(&log_list_guard);
-	list_foreach(log_list, link, logger_log_t, log) {
-		if ((sysarg_t) log == id) {
-			fibril_mutex_lock(&log->guard);
-			result = log;
-			break;
-		}
+	ht_link_t *link = hash_table_find(&log_id_hash, &id);
+	if (link != NULL) {
+		result = hash_table_get_inst(link, logger_log_t, id_link);
+		fibril_mutex_lock(&result->guard);
 	}
 	fibril_mutex_unlock(&log_list_guard);
 
@@ -256,6 +295,7 @@ void log_release(logger_log_t *log)
 	assert(log->ref_counter == 0);
 
 	list_remove(&log->link);
+	hash_table_remove_item(&log_id_hash, &log->id_link);
 	fibril_mutex_unlock(&log_list_guard);
 	fibril_mutex_unlock(&log->guard);
 
@@ -282,6 +322,12 @@ void log_release(logger_log_t *log)
 	free(log);
 }
 
+/** Write message to the log destination.
+ *
+ * The message is only buffered, call flush_log() to write it out.
+ *
+ * Precondition: log is locked.
+ */
 void write_to_log(logger_log_t *log, log_level_t level, const char *message)
 {
 	assert(fibril_mutex_is_locked(&log->guard));
@@ -294,12 +340,25 @@ void write_to_log(logger_log_t *log, log_level_t level, const char *message)
 		fprintf(log->dest->logfile, "[%s] %s: %s\n",
 		    log->full_name, log_level_str(level),
 		    (const char *) message);
-		fflush(log->dest->logfile);
 	}
 
 	fibril_mutex_unlock(&log->dest->guard);
 }
 
+/** Flush messages buffered by write_to_log().
+ *
+ * Precondition: log is locked.
+ */
+void flush_log(logger_log_t *log)
+{
+	assert(fibril_mutex_is_locked(&log->guard));
+	assert(log->dest != NULL);
+	fibril_mutex_lock(&log->dest->guard);
+	if (log->dest->logfile != NULL)
+		fflush(log->dest->logfile);
+	fibril_mutex_unlock(&log->dest->guard);
+}
+
 void registered_logs_init(logger_registered_logs_t *logs)
 {
 	logs->logs_count = 0;
@@ -34,6 +34,7 @@
 /** @file
  */
 
+#include <align.h>
 #include <ipc/services.h>
 #include <ipc/logger.h>
 #include <io/log.h>
@@ -81,6 +82,7 @@ static errno_t handle_receive_message(sysarg_t log_id, sysarg_t level)
 	    log->full_name, log_level_str(level),
 	    (const char *) message);
 	write_to_log(log, level, message);
+	flush_log(log);
 
 	rc = EOK;
 
@@ -91,6 +93,69 @@ leave:
 	return rc;
 }
 
+/** Receive a batch of messages.
+ *
+ * Consecutive messages to the same log are written while holding the
+ * log locked and the destination is flushed only when the log changes
+ * or at the end of the batch.
+ */
+static errno_t handle_receive_batch(void)
+{
+	void *batch = NULL;
+	size_t size;
+	errno_t rc = async_data_write_accept(&batch, false, 0,
+	    LOGGER_BATCH_SIZE, 0, &size);
+	if (rc != EOK)
+		return rc;
+
+	logger_log_t *log = NULL;
+	size_t pos = 0;
+
+	while (pos + sizeof(logger_batch_hdr_t) <= size) {
+		logger_batch_hdr_t *hdr = (logger_batch_hdr_t *)
+		    ((uint8_t *) batch + pos);
+		const char *message = (const char *) (hdr + 1);
+
+		pos += sizeof(logger_batch_hdr_t);
+		if ((hdr->size == 0) || (hdr->size > size - pos) ||
+		    (message[hdr->size - 1] != '\0') ||
+		    (hdr->level >= LVL_LIMIT)) {
+			rc = EINVAL;
+			break;
+		}
+
+		pos += ALIGN_UP(hdr->size, sizeof(sysarg_t));
+
+		if ((log == NULL) || ((sysarg_t) log != hdr->log)) {
+			if (log != NULL) {
+				flush_log(log);
+				log_unlock(log);
+			}
+
+			log = find_log_by_id_and_lock(hdr->log);
+			if (log == NULL) {
+				rc = ENOENT;
+				continue;
+			}
+		}
+
+		if (!shall_log_message(log, hdr->level))
+			continue;
+
+		KLOG_PRINTF(hdr->level, "[%s] %s: %s",
+		    log->full_name, log_level_str(hdr->level), message);
+		write_to_log(log, hdr->level, message);
+	}
+
+	if (log != NULL) {
+		flush_log(log);
+		log_unlock(log);
+	}
+
+	free(batch);
+	return rc;
+}
+
 void logger_connection_handler_writer(ipc_call_t *icall)
 {
 	logger_log_t *log;
@@ -133,6 +198,10 @@ void logger_connection_handler_writer(ipc_call_t *icall)
 			    ipc_get_arg2(&call));
 			async_answer_0(&call, rc);
 			break;
+		case LOGGER_WRITER_MESSAGE_BATCH:
+			rc = handle_receive_batch();
+			async_answer_0(&call, rc);
+			break;
 		default:
 			async_answer_0(&call, EINVAL);
 			break;